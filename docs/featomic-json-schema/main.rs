@@ -7,6 +7,8 @@ use featomic::calculators::SortedDistances;
 use featomic::calculators::SphericalExpansionParameters;
 use featomic::calculators::LodeSphericalExpansionParameters;
 use featomic::calculators::PowerSpectrumParameters;
+use featomic::calculators::LambdaSoapParameters;
+use featomic::calculators::CompressedPowerSpectrumParameters;
 use featomic::calculators::RadialSpectrumParameters;
 use featomic::calculators::NeighborList;
 
@@ -99,5 +101,7 @@ fn main() {
     generate_schema!("SphericalExpansion", SphericalExpansionParameters);
     generate_schema!("LodeSphericalExpansion", LodeSphericalExpansionParameters);
     generate_schema!("SoapPowerSpectrum", PowerSpectrumParameters);
+    generate_schema!("LambdaSoap", LambdaSoapParameters);
+    generate_schema!("SoapCompressedPowerSpectrum", CompressedPowerSpectrumParameters);
     generate_schema!("SoapRadialSpectrum", RadialSpectrumParameters);
 }
@@ -0,0 +1,131 @@
+#ifndef FEATOMIC_SERVER_HPP
+#define FEATOMIC_SERVER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <featomic.hpp>
+#include <metatensor.hpp>
+
+namespace featomic_server {
+
+/// Options used to create a `Server`
+struct ServerOptions {
+    /// Path of the Unix socket the server should listen on. Any existing file
+    /// at this path is removed.
+    std::string socket_path;
+    /// Number of threads running calculations. Each calculation is itself
+    /// parallelized over systems by featomic.
+    size_t workers = 1;
+    /// Maximal number of systems to gather in a single calculation when
+    /// batching concurrent requests using the same calculator
+    size_t max_batch_systems = 256;
+};
+
+/// Long-lived descriptor service, listening for requests from `Client` on a
+/// Unix socket.
+///
+/// The server keeps all the calculators it created alive (keyed by name and
+/// parameters), so clients do not pay for calculator construction (splines,
+/// etc.) and thread pool startup on every calculation. Concurrent requests for
+/// the same calculator and gradients are gathered in a single calculation.
+///
+/// Systems are sent by the client in a POSIX shared memory segment, and the
+/// descriptor is sent back (serialized with `metatensor::io::save_buffer`) in
+/// another shared memory segment, so only small headers go through the
+/// socket.
+class Server {
+public:
+    /// Create a new server, and start listening on `options.socket_path` in
+    /// background threads.
+    explicit Server(ServerOptions options);
+    /// Stop the server, see `Server::stop`
+    ~Server();
+
+    /// Server is **NOT** copy-constructible
+    Server(const Server&) = delete;
+    /// Server can **NOT** be copy-assigned
+    Server& operator=(const Server&) = delete;
+    /// Server is **NOT** move-constructible
+    Server(Server&&) = delete;
+    /// Server can **NOT** be move-assigned
+    Server& operator=(Server&&) = delete;
+
+    /// Stop accepting new connections, close all existing connections and
+    /// wait for all background threads to finish. This is called
+    /// automatically by the destructor.
+    void stop();
+
+    /// Get the number of requests processed since this server was created
+    uint64_t requests_count() const;
+
+    /// Get the number of calculations executed since this server was created.
+    /// This is smaller than `requests_count()` when requests are batched
+    /// together.
+    uint64_t calculations_count() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/// Client for a running `Server`, keeping a connection open to the server
+/// until it is destroyed. A single client should not be used concurrently
+/// from multiple threads, create one client per thread instead.
+class Client {
+public:
+    /// Connect to the server listening on `socket_path`
+    explicit Client(const std::string& socket_path);
+    ~Client();
+
+    /// Client is **NOT** copy-constructible
+    Client(const Client&) = delete;
+    /// Client can **NOT** be copy-assigned
+    Client& operator=(const Client&) = delete;
+
+    /// Client is move-constructible
+    Client(Client&& other) noexcept;
+    /// Client can be move-assigned
+    Client& operator=(Client&& other) noexcept;
+
+    /// Compute the descriptor of the calculator with the given `name` and
+    /// `parameters` (see `featomic::Calculator`) for all `systems`, including
+    /// the requested `gradients`. Only the atomic types, positions and cell of
+    /// the systems are sent to the server, which uses its own neighbor list.
+    ///
+    /// @throws featomic::FeatomicError if the server reports an error or if
+    ///         the communication with the server fails.
+    template<typename SystemImpl, typename std::enable_if<std::is_base_of<featomic::System, SystemImpl>::value, bool>::type = true>
+    metatensor::TensorMap compute(
+        const std::string& name,
+        const std::string& parameters,
+        const std::vector<SystemImpl>& systems,
+        const std::vector<std::string>& gradients = {}
+    ) {
+        auto pointers = std::vector<const featomic::System*>();
+        pointers.reserve(systems.size());
+        for (const auto& system: systems) {
+            pointers.push_back(&system);
+        }
+        return this->compute(name, parameters, pointers, gradients);
+    }
+
+    /// Compute the descriptor for all the `systems`, see above.
+    metatensor::TensorMap compute(
+        const std::string& name,
+        const std::string& parameters,
+        const std::vector<const featomic::System*>& systems,
+        const std::vector<std::string>& gradients = {}
+    );
+
+private:
+    int socket_ = -1;
+    uint64_t requests_ = 0;
+};
+
+}
+
+#endif
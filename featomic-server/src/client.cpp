@@ -0,0 +1,122 @@
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "featomic/server.hpp"
+#include "protocol.hpp"
+
+using namespace featomic_server;
+
+Client::Client(const std::string& socket_path) {
+    auto address = sockaddr_un{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw featomic::FeatomicError("socket path is too long: " + socket_path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_ < 0) {
+        throw featomic::FeatomicError(std::string("failed to create socket: ") + std::strerror(errno));
+    }
+
+    if (::connect(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        auto message = std::string("failed to connect to featomic-server at '") + socket_path + "': " + std::strerror(errno);
+        ::close(socket_);
+        socket_ = -1;
+        throw featomic::FeatomicError(message);
+    }
+}
+
+Client::~Client() {
+    if (socket_ >= 0) {
+        ::close(socket_);
+    }
+}
+
+Client::Client(Client&& other) noexcept {
+    *this = std::move(other);
+}
+
+Client& Client::operator=(Client&& other) noexcept {
+    if (socket_ >= 0) {
+        ::close(socket_);
+    }
+
+    socket_ = other.socket_;
+    requests_ = other.requests_;
+    other.socket_ = -1;
+
+    return *this;
+}
+
+metatensor::TensorMap Client::compute(
+    const std::string& name,
+    const std::string& parameters,
+    const std::vector<const featomic::System*>& systems,
+    const std::vector<std::string>& gradients
+) {
+    if (socket_ < 0) {
+        throw featomic::FeatomicError("this client is not connected to a server");
+    }
+
+    try {
+        auto systems_size = protocol::systems_size(systems);
+        auto request_shm = protocol::SharedMemory::create(protocol::unique_shm_name("client"), systems_size);
+
+        auto response = protocol::ResponseHeader{};
+        auto success = false;
+        try {
+            protocol::write_systems(systems, request_shm.data());
+
+            auto joined_gradients = protocol::join_gradients(gradients);
+            auto request = protocol::RequestHeader{
+                protocol::MAGIC,
+                name.size(),
+                parameters.size(),
+                joined_gradients.size(),
+                request_shm.name().size(),
+                systems_size,
+            };
+
+            protocol::write_all(socket_, &request, sizeof(request));
+            protocol::write_all(socket_, name.data(), name.size());
+            protocol::write_all(socket_, parameters.data(), parameters.size());
+            protocol::write_all(socket_, joined_gradients.data(), joined_gradients.size());
+            protocol::write_all(socket_, request_shm.name().data(), request_shm.name().size());
+            requests_ += 1;
+
+            success = protocol::read_all(socket_, &response, sizeof(response));
+        } catch (...) {
+            request_shm.unlink();
+            throw;
+        }
+        // the server is done reading the systems once it sent a response
+        request_shm.unlink();
+
+        if (!success) {
+            throw featomic::FeatomicError("featomic-server closed the connection");
+        }
+
+        if (response.magic != protocol::MAGIC) {
+            throw featomic::FeatomicError("invalid response from featomic-server");
+        }
+
+        auto message = protocol::read_string(socket_, response.message_size);
+        auto shm_name = protocol::read_string(socket_, response.shm_name_size);
+        if (response.status != 0) {
+            throw featomic::FeatomicError("featomic-server error: " + message);
+        }
+
+        auto response_shm = protocol::SharedMemory::open(shm_name, response.shm_size);
+        response_shm.unlink();
+
+        return metatensor::io::load_buffer(response_shm.data(), response_shm.size());
+    } catch (const featomic::FeatomicError&) {
+        throw;
+    } catch (const std::exception& e) {
+        throw featomic::FeatomicError(e.what());
+    }
+}
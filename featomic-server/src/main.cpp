@@ -0,0 +1,81 @@
+#include <csignal>
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "featomic/server.hpp"
+
+static std::atomic<bool> SHOULD_STOP{false};
+
+static void handle_signal(int /*signal*/) {
+    SHOULD_STOP = true;
+}
+
+static void usage(const char* name) {
+    std::cerr << "usage: " << name << " --socket <path> [--workers <n>] [--max-batch-systems <n>]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    auto options = featomic_server::ServerOptions();
+
+    for (int i = 1; i < argc; i++) {
+        auto argument = std::string(argv[i]);
+        if (argument == "-h" || argument == "--help") {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        auto value = std::string(argv[++i]);
+        try {
+            if (argument == "--socket") {
+                options.socket_path = value;
+            } else if (argument == "--workers") {
+                options.workers = std::stoul(value);
+            } else if (argument == "--max-batch-systems") {
+                options.max_batch_systems = std::stoul(value);
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "invalid value for " << argument << ": " << value << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.socket_path.empty()) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        auto server = featomic_server::Server(options);
+        std::cerr << "featomic-server listening on " << options.socket_path << std::endl;
+
+        while (!SHOULD_STOP) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        server.stop();
+        std::cerr << "featomic-server stopped after " << server.requests_count() << " requests ("
+                  << server.calculations_count() << " calculations)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,263 @@
+#include <cerrno>
+#include <cstring>
+
+#include <atomic>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "protocol.hpp"
+
+using namespace featomic_server::protocol;
+
+static size_t padded(size_t size) {
+    return (size + 7) / 8 * 8;
+}
+
+static std::runtime_error system_error(const std::string& context) {
+    return std::runtime_error(context + ": " + std::strerror(errno));
+}
+
+size_t featomic_server::protocol::systems_size(const std::vector<const featomic::System*>& systems) {
+    size_t size = sizeof(uint64_t);
+    for (const auto* system: systems) {
+        auto n_atoms = system->size();
+        size += sizeof(uint64_t);
+        size += 9 * sizeof(double);
+        size += 3 * n_atoms * sizeof(double);
+        size += padded(n_atoms * sizeof(int32_t));
+    }
+    return size;
+}
+
+void featomic_server::protocol::write_systems(const std::vector<const featomic::System*>& systems, uint8_t* buffer) {
+    auto n_systems = static_cast<uint64_t>(systems.size());
+    std::memcpy(buffer, &n_systems, sizeof(uint64_t));
+    buffer += sizeof(uint64_t);
+
+    for (const auto* system: systems) {
+        auto n_atoms = static_cast<uint64_t>(system->size());
+        std::memcpy(buffer, &n_atoms, sizeof(uint64_t));
+        buffer += sizeof(uint64_t);
+
+        auto cell = system->cell();
+        std::memcpy(buffer, cell.data(), 9 * sizeof(double));
+        buffer += 9 * sizeof(double);
+
+        std::memcpy(buffer, system->positions(), 3 * n_atoms * sizeof(double));
+        buffer += 3 * n_atoms * sizeof(double);
+
+        std::memcpy(buffer, system->types(), n_atoms * sizeof(int32_t));
+        buffer += padded(n_atoms * sizeof(int32_t));
+    }
+}
+
+std::vector<featomic::SimpleSystem> featomic_server::protocol::read_systems(const uint8_t* buffer, size_t size) {
+    const auto* end = buffer + size;
+    auto check_size = [&](size_t needed) {
+        if (static_cast<size_t>(end - buffer) < needed) {
+            throw std::runtime_error("invalid request: systems data is too small");
+        }
+    };
+
+    check_size(sizeof(uint64_t));
+    uint64_t n_systems = 0;
+    std::memcpy(&n_systems, buffer, sizeof(uint64_t));
+    buffer += sizeof(uint64_t);
+
+    auto systems = std::vector<featomic::SimpleSystem>();
+    for (uint64_t system_i = 0; system_i < n_systems; system_i++) {
+        check_size(sizeof(uint64_t) + 9 * sizeof(double));
+        uint64_t n_atoms = 0;
+        std::memcpy(&n_atoms, buffer, sizeof(uint64_t));
+        buffer += sizeof(uint64_t);
+
+        auto cell = featomic::System::CellMatrix();
+        std::memcpy(cell.data(), buffer, 9 * sizeof(double));
+        buffer += 9 * sizeof(double);
+
+        // check the number of atoms before computing any size from it, to
+        // prevent overflow with malformed requests
+        auto remaining = static_cast<size_t>(end - buffer);
+        if (n_atoms > remaining / (3 * sizeof(double) + sizeof(int32_t))) {
+            throw std::runtime_error("invalid request: systems data is too small");
+        }
+        check_size(3 * n_atoms * sizeof(double) + padded(n_atoms * sizeof(int32_t)));
+        const auto* positions = buffer;
+        buffer += 3 * n_atoms * sizeof(double);
+        const auto* types = buffer;
+        buffer += padded(n_atoms * sizeof(int32_t));
+
+        auto system = featomic::SimpleSystem(cell);
+        for (uint64_t atom = 0; atom < n_atoms; atom++) {
+            auto position = std::array<double, 3>();
+            std::memcpy(position.data(), positions + 3 * atom * sizeof(double), 3 * sizeof(double));
+
+            int32_t type = 0;
+            std::memcpy(&type, types + atom * sizeof(int32_t), sizeof(int32_t));
+
+            system.add_atom(type, position);
+        }
+        systems.emplace_back(std::move(system));
+    }
+
+    return systems;
+}
+
+void featomic_server::protocol::write_all(int fd, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+#ifdef MSG_NOSIGNAL
+        // do not raise SIGPIPE if the other end closed the connection
+        auto written = ::send(fd, bytes, size, MSG_NOSIGNAL);
+#else
+        auto written = ::write(fd, bytes, size);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("failed to write to socket");
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+bool featomic_server::protocol::read_all(int fd, void* data, size_t size) {
+    auto* bytes = static_cast<uint8_t*>(data);
+    auto first = true;
+    while (size > 0) {
+        auto count = ::read(fd, bytes, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("failed to read from socket");
+        } else if (count == 0) {
+            if (first) {
+                return false;
+            }
+            throw std::runtime_error("connection closed in the middle of a message");
+        }
+        first = false;
+        bytes += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+std::string featomic_server::protocol::read_string(int fd, size_t size) {
+    auto string = std::string(size, '\0');
+    if (size != 0 && !read_all(fd, &string[0], size)) {
+        throw std::runtime_error("connection closed in the middle of a message");
+    }
+    return string;
+}
+
+std::string featomic_server::protocol::join_gradients(const std::vector<std::string>& gradients) {
+    auto joined = std::string();
+    for (const auto& gradient: gradients) {
+        if (!joined.empty()) {
+            joined += ',';
+        }
+        joined += gradient;
+    }
+    return joined;
+}
+
+std::vector<std::string> featomic_server::protocol::split_gradients(const std::string& gradients) {
+    auto result = std::vector<std::string>();
+    size_t start = 0;
+    while (start < gradients.size()) {
+        auto end = gradients.find(',', start);
+        if (end == std::string::npos) {
+            end = gradients.size();
+        }
+        result.emplace_back(gradients.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+std::string featomic_server::protocol::unique_shm_name(const char* prefix) {
+    static std::atomic<uint64_t> COUNTER{0};
+    return std::string("/featomic-") + prefix + "-" + std::to_string(::getpid()) + "-" + std::to_string(COUNTER++);
+}
+
+SharedMemory SharedMemory::create(const std::string& name, size_t size) {
+    auto fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        throw system_error("failed to create shared memory segment '" + name + "'");
+    }
+
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        auto error = system_error("failed to resize shared memory segment '" + name + "'");
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw error;
+    }
+
+    auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        auto error = system_error("failed to map shared memory segment '" + name + "'");
+        ::shm_unlink(name.c_str());
+        throw error;
+    }
+
+    return SharedMemory(name, static_cast<uint8_t*>(data), size);
+}
+
+SharedMemory SharedMemory::open(const std::string& name, size_t size) {
+    auto fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw system_error("failed to open shared memory segment '" + name + "'");
+    }
+
+    struct stat status = {};
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < size) {
+        ::close(fd);
+        throw std::runtime_error("shared memory segment '" + name + "' is smaller than expected");
+    }
+
+    auto* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw system_error("failed to map shared memory segment '" + name + "'");
+    }
+
+    return SharedMemory(name, static_cast<uint8_t*>(data), size);
+}
+
+SharedMemory::~SharedMemory() {
+    if (data_ != nullptr) {
+        ::munmap(data_, size_);
+    }
+}
+
+SharedMemory::SharedMemory(SharedMemory&& other) noexcept {
+    *this = std::move(other);
+}
+
+SharedMemory& SharedMemory::operator=(SharedMemory&& other) noexcept {
+    if (data_ != nullptr) {
+        ::munmap(data_, size_);
+    }
+
+    name_ = std::move(other.name_);
+    data_ = other.data_;
+    size_ = other.size_;
+
+    other.data_ = nullptr;
+    other.size_ = 0;
+    return *this;
+}
+
+void SharedMemory::unlink() {
+    ::shm_unlink(name_.c_str());
+}
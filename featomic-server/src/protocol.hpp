@@ -0,0 +1,134 @@
+#ifndef FEATOMIC_SERVER_PROTOCOL_HPP
+#define FEATOMIC_SERVER_PROTOCOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <featomic.hpp>
+
+// Communication protocol between `featomic_server::Client` and
+// `featomic_server::Server`. All messages go through a Unix socket, and start
+// with a fixed-size header followed by the variable-size strings announced in
+// the header. Bulk data goes through POSIX shared memory segments.
+//
+// The client creates a shared memory segment containing the systems, and
+// sends a `RequestHeader`, followed by the calculator name, the calculator
+// parameters, the gradients (separated by `,`) and the name of the shared
+// memory segment. The server answers with a `ResponseHeader`, followed by an
+// error message (empty on success) and the name of a shared memory segment
+// containing the serialized descriptor. The client is responsible for
+// unlinking both shared memory segments.
+namespace featomic_server {
+namespace protocol {
+
+/// "FTMCSRV" followed by the version of the protocol
+static constexpr uint64_t MAGIC = 0x01565253434D5446;
+
+struct RequestHeader {
+    uint64_t magic;
+    uint64_t name_size;
+    uint64_t parameters_size;
+    uint64_t gradients_size;
+    uint64_t shm_name_size;
+    uint64_t shm_size;
+};
+
+struct ResponseHeader {
+    uint64_t magic;
+    /// 0 on success, anything else on error
+    int64_t status;
+    uint64_t message_size;
+    uint64_t shm_name_size;
+    uint64_t shm_size;
+};
+
+// Layout of the systems in the request shared memory segment, all values are
+// in native endianness and aligned to 8 bytes:
+//
+// - uint64_t: number of systems
+// - for each system:
+//   - uint64_t: number of atoms `n`
+//   - double[9]: unit cell matrix
+//   - double[3 * n]: positions
+//   - int32_t[n]: atomic types, padded to a multiple of 8 bytes
+
+/// Get the number of bytes required to store the `systems` in shared memory
+size_t systems_size(const std::vector<const featomic::System*>& systems);
+
+/// Write the `systems` to `buffer`, which must contain at least
+/// `systems_size(systems)` bytes
+void write_systems(const std::vector<const featomic::System*>& systems, uint8_t* buffer);
+
+/// Read systems from `buffer`, containing `size` bytes
+std::vector<featomic::SimpleSystem> read_systems(const uint8_t* buffer, size_t size);
+
+/// Write all of `size` bytes from `data` to the file descriptor `fd`
+void write_all(int fd, const void* data, size_t size);
+
+/// Read exactly `size` bytes from the file descriptor `fd` to `data`. Returns
+/// `false` if the other end closed the connection before any byte was read.
+bool read_all(int fd, void* data, size_t size);
+
+/// Read a string of `size` bytes from the file descriptor `fd`
+std::string read_string(int fd, size_t size);
+
+/// Join the `gradients` with `,`
+std::string join_gradients(const std::vector<std::string>& gradients);
+
+/// Split gradients joined by `join_gradients`
+std::vector<std::string> split_gradients(const std::string& gradients);
+
+/// Create a new unique name for a shared memory segment
+std::string unique_shm_name(const char* prefix);
+
+/// RAII wrapper around a memory-mapped POSIX shared memory segment
+class SharedMemory {
+public:
+    /// Create a new read-write segment with the given `name` and `size`
+    static SharedMemory create(const std::string& name, size_t size);
+    /// Open an existing segment with the given `name` and `size` in read-only
+    /// mode
+    static SharedMemory open(const std::string& name, size_t size);
+
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    SharedMemory(SharedMemory&& other) noexcept;
+    SharedMemory& operator=(SharedMemory&& other) noexcept;
+
+    const std::string& name() const {
+        return name_;
+    }
+
+    uint8_t* data() {
+        return data_;
+    }
+
+    const uint8_t* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    /// Remove the name of this segment from the system, the memory is freed
+    /// once all mappings are gone
+    void unlink();
+
+private:
+    SharedMemory(std::string name, uint8_t* data, size_t size):
+        name_(std::move(name)), data_(data), size_(size) {}
+
+    std::string name_;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}
+}
+
+#endif
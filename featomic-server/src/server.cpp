@@ -0,0 +1,368 @@
+#include <cerrno>
+#include <cstring>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "featomic/server.hpp"
+#include "protocol.hpp"
+
+using namespace featomic_server;
+
+namespace {
+    /// A single request from a client, waiting to be computed
+    struct Job {
+        std::string name;
+        std::string parameters;
+        std::string gradients;
+        std::vector<featomic::SimpleSystem> systems;
+        /// serialized descriptor for this job
+        std::promise<std::vector<uint8_t>> result;
+    };
+
+    /// Thread handling the requests of a single client
+    struct Connection {
+        std::thread thread;
+        /// set by the thread once it is done with the client
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+
+}
+
+class Server::Impl {
+public:
+    explicit Impl(ServerOptions options): options_(std::move(options)) {
+        if (options_.workers == 0) {
+            throw featomic::FeatomicError("featomic-server needs at least one worker");
+        }
+
+        auto address = sockaddr_un{};
+        if (options_.socket_path.size() >= sizeof(address.sun_path)) {
+            throw featomic::FeatomicError("socket path is too long: " + options_.socket_path);
+        }
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options_.socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+        listener_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener_ < 0) {
+            throw featomic::FeatomicError(std::string("failed to create socket: ") + std::strerror(errno));
+        }
+
+        ::unlink(options_.socket_path.c_str());
+        if (::bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener_, 64) != 0) {
+            auto message = std::string("failed to listen on '") + options_.socket_path + "': " + std::strerror(errno);
+            ::close(listener_);
+            throw featomic::FeatomicError(message);
+        }
+
+        for (size_t i = 0; i < options_.workers; i++) {
+            workers_.emplace_back([this]() { this->run_worker(); });
+        }
+        acceptor_ = std::thread([this]() { this->accept_connections(); });
+    }
+
+    ~Impl() {
+        this->stop();
+    }
+
+    void stop() {
+        if (stopping_.exchange(true)) {
+            return;
+        }
+
+        if (acceptor_.joinable()) {
+            acceptor_.join();
+        }
+        ::close(listener_);
+        ::unlink(options_.socket_path.c_str());
+
+        {
+            // unblock the threads waiting on clients
+            auto lock = std::lock_guard<std::mutex>(connections_mutex_);
+            for (auto fd: connections_) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+
+        {
+            // make sure the workers waiting on the condition see `stopping_`
+            auto lock = std::lock_guard<std::mutex>(queue_mutex_);
+        }
+        queue_condition_.notify_all();
+        for (auto& worker: workers_) {
+            worker.join();
+        }
+
+        for (auto& connection: connection_threads_) {
+            connection.thread.join();
+        }
+    }
+
+    uint64_t requests_count() const {
+        return requests_;
+    }
+
+    uint64_t calculations_count() const {
+        return calculations_;
+    }
+
+private:
+    void accept_connections() {
+        while (!stopping_) {
+            auto poll_fd = pollfd{listener_, POLLIN, 0};
+            auto status = ::poll(&poll_fd, 1, 100);
+            if (status <= 0) {
+                continue;
+            }
+
+            auto fd = ::accept(listener_, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+
+            auto lock = std::lock_guard<std::mutex>(connections_mutex_);
+            this->reap_connections();
+
+            connections_.insert(fd);
+            auto finished = std::make_shared<std::atomic<bool>>(false);
+            auto thread = std::thread([this, fd, finished]() {
+                this->serve(fd);
+                *finished = true;
+            });
+            connection_threads_.push_back(Connection{std::move(thread), std::move(finished)});
+        }
+    }
+
+    /// Join the threads of all clients that disconnected, so a long-running
+    /// server does not accumulate one thread per client that ever connected.
+    /// This must be called with `connections_mutex_` held.
+    void reap_connections() {
+        auto it = connection_threads_.begin();
+        while (it != connection_threads_.end()) {
+            if (*it->finished) {
+                it->thread.join();
+                it = connection_threads_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /// Handle all the requests from the client connected to `fd`
+    void serve(int fd) {
+        while (!stopping_) {
+            auto job = std::make_shared<Job>();
+            auto request = protocol::RequestHeader{};
+            auto shm_name = std::string();
+            try {
+                if (!protocol::read_all(fd, &request, sizeof(request)) || request.magic != protocol::MAGIC) {
+                    break;
+                }
+
+                job->name = protocol::read_string(fd, request.name_size);
+                job->parameters = protocol::read_string(fd, request.parameters_size);
+                job->gradients = protocol::read_string(fd, request.gradients_size);
+                shm_name = protocol::read_string(fd, request.shm_name_size);
+            } catch (const std::exception&) {
+                break;
+            }
+
+            auto response = protocol::ResponseHeader{protocol::MAGIC, 0, 0, 0, 0};
+            auto message = std::string();
+            auto output = std::optional<protocol::SharedMemory>();
+            try {
+                {
+                    auto input = protocol::SharedMemory::open(shm_name, request.shm_size);
+                    job->systems = protocol::read_systems(input.data(), input.size());
+                }
+
+                auto result = job->result.get_future();
+                {
+                    auto lock = std::lock_guard<std::mutex>(queue_mutex_);
+                    if (stopping_) {
+                        throw std::runtime_error("featomic-server is shutting down");
+                    }
+                    queue_.push_back(job);
+                }
+                queue_condition_.notify_one();
+
+                auto buffer = result.get();
+                output = protocol::SharedMemory::create(protocol::unique_shm_name("server"), buffer.size());
+                std::memcpy(output->data(), buffer.data(), buffer.size());
+                response.shm_size = buffer.size();
+            } catch (const std::exception& e) {
+                response.status = 1;
+                message = e.what();
+            }
+            requests_ += 1;
+
+            auto output_name = output ? output->name() : std::string();
+            response.message_size = message.size();
+            response.shm_name_size = output_name.size();
+            try {
+                protocol::write_all(fd, &response, sizeof(response));
+                protocol::write_all(fd, message.data(), message.size());
+                protocol::write_all(fd, output_name.data(), output_name.size());
+            } catch (const std::exception&) {
+                // the client will never unlink this segment, do it now
+                if (output) {
+                    output->unlink();
+                }
+                break;
+            }
+        }
+
+        auto lock = std::lock_guard<std::mutex>(connections_mutex_);
+        connections_.erase(fd);
+        ::close(fd);
+    }
+
+    void run_worker() {
+        while (true) {
+            auto batch = std::vector<std::shared_ptr<Job>>();
+            {
+                auto lock = std::unique_lock<std::mutex>(queue_mutex_);
+                queue_condition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+
+                auto first = queue_.front();
+                queue_.pop_front();
+                batch.push_back(first);
+
+                // gather all the waiting jobs using the same calculator
+                auto n_systems = first->systems.size();
+                for (auto it = queue_.begin(); it != queue_.end();) {
+                    const auto& job = *it;
+                    if (job->name == first->name &&
+                        job->parameters == first->parameters &&
+                        job->gradients == first->gradients &&
+                        n_systems + job->systems.size() <= options_.max_batch_systems
+                    ) {
+                        n_systems += job->systems.size();
+                        batch.push_back(job);
+                        it = queue_.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+
+            this->run_batch(batch);
+        }
+    }
+
+    void run_batch(std::vector<std::shared_ptr<Job>>& batch) {
+        const auto& first = batch[0];
+        auto gradients = protocol::split_gradients(first->gradients);
+
+        auto systems = std::vector<featomic::SimpleSystem>();
+        auto ranges = std::vector<std::pair<int32_t, int32_t>>();
+        for (auto& job: batch) {
+            auto start = static_cast<int32_t>(systems.size());
+            for (auto& system: job->systems) {
+                systems.emplace_back(std::move(system));
+            }
+            ranges.emplace_back(start, static_cast<int32_t>(systems.size()));
+        }
+
+        auto descriptor = std::optional<metatensor::TensorMap>();
+        try {
+            const auto& calculator = this->calculator(first->name, first->parameters);
+
+            auto options = featomic::CalculationOptions();
+            options.use_native_system = true;
+            for (const auto& gradient: gradients) {
+                options.gradients.push_back(gradient.c_str());
+            }
+
+            // calculators are thread-safe, multiple workers can use the same
+            // one at the same time
+            descriptor = calculator.compute(systems, options);
+            calculations_ += 1;
+        } catch (...) {
+            for (auto& job: batch) {
+                job->result.set_exception(std::current_exception());
+            }
+            return;
+        }
+
+        if (batch.size() == 1) {
+            first->result.set_value(metatensor::io::save_buffer(*descriptor));
+            return;
+        }
+
+        for (size_t job_i = 0; job_i < batch.size(); job_i++) {
+            try {
+                auto range = ranges[job_i];
+                auto extracted = featomic::details::extract_systems(*descriptor, range.first, range.second, gradients);
+                batch[job_i]->result.set_value(metatensor::io::save_buffer(extracted));
+            } catch (...) {
+                batch[job_i]->result.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    /// Get the calculator with the given name and parameters, creating it if
+    /// needed
+    const featomic::Calculator& calculator(const std::string& name, const std::string& parameters) {
+        auto lock = std::lock_guard<std::mutex>(calculators_mutex_);
+        auto key = std::make_pair(name, parameters);
+        auto it = calculators_.find(key);
+        if (it == calculators_.end()) {
+            auto calculator = std::make_unique<featomic::Calculator>(name, parameters);
+            it = calculators_.emplace(std::move(key), std::move(calculator)).first;
+        }
+        return *it->second;
+    }
+
+    ServerOptions options_;
+    int listener_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> calculations_{0};
+
+    std::thread acceptor_;
+    std::vector<std::thread> workers_;
+
+    std::mutex connections_mutex_;
+    std::set<int> connections_;
+    std::list<Connection> connection_threads_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_condition_;
+    std::deque<std::shared_ptr<Job>> queue_;
+
+    std::mutex calculators_mutex_;
+    std::map<std::pair<std::string, std::string>, std::unique_ptr<featomic::Calculator>> calculators_;
+};
+
+Server::Server(ServerOptions options): impl_(std::make_unique<Impl>(std::move(options))) {}
+
+Server::~Server() = default;
+
+void Server::stop() {
+    impl_->stop();
+}
+
+uint64_t Server::requests_count() const {
+    return impl_->requests_count();
+}
+
+uint64_t Server::calculations_count() const {
+    return impl_->calculations_count();
+}
@@ -0,0 +1,150 @@
+#include <unistd.h>
+
+#include <cstring>
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "featomic/server.hpp"
+#include "../src/protocol.hpp"
+#include "catch.hpp"
+
+static const char* HYPERS_JSON = R"({
+    "cutoff": {
+        "radius": 3.0,
+        "smoothing": {"type": "ShiftedCosine", "width": 0.5}
+    },
+    "density": {"type": "Gaussian", "width": 0.3},
+    "basis": {
+        "type": "TensorProduct",
+        "max_angular": 2,
+        "radial": {"type": "Gto", "max_radial": 2}
+    }
+})";
+
+static std::string socket_path() {
+    return "/tmp/featomic-server-tests-" + std::to_string(::getpid()) + ".sock";
+}
+
+static featomic::SimpleSystem water(double shift) {
+    auto system = featomic::SimpleSystem({{{10, 0, 0}, {0, 10, 0}, {0, 0, 10}}});
+    system.add_atom(8, {0.0 + shift, 0.0, 0.0});
+    system.add_atom(1, {0.0 + shift, 0.75, -0.5});
+    system.add_atom(1, {0.0 + shift, -0.75, -0.5});
+    return system;
+}
+
+static void check_same_tensor(metatensor::TensorMap& actual, metatensor::TensorMap& expected) {
+    REQUIRE(actual.keys() == expected.keys());
+    for (uintptr_t block_i = 0; block_i < expected.keys().count(); block_i++) {
+        auto actual_block = actual.block_by_id(block_i);
+        auto expected_block = expected.block_by_id(block_i);
+
+        CHECK(actual_block.samples() == expected_block.samples());
+        CHECK(actual_block.properties() == expected_block.properties());
+        CHECK(actual_block.values() == expected_block.values());
+
+        auto actual_gradient = actual_block.gradient("positions");
+        auto expected_gradient = expected_block.gradient("positions");
+        CHECK(actual_gradient.samples() == expected_gradient.samples());
+        CHECK(actual_gradient.values() == expected_gradient.values());
+    }
+}
+
+TEST_CASE("featomic-server") {
+    auto options = featomic_server::ServerOptions();
+    options.socket_path = socket_path();
+    options.workers = 2;
+    auto server = featomic_server::Server(options);
+
+    auto calculator = featomic::Calculator("spherical_expansion", HYPERS_JSON);
+    auto calculation_options = featomic::CalculationOptions();
+    calculation_options.use_native_system = true;
+    calculation_options.gradients = {"positions"};
+
+    SECTION("single client") {
+        auto systems = std::vector<featomic::SimpleSystem>{water(0.0), water(0.1)};
+        auto expected = calculator.compute(systems, calculation_options);
+
+        auto client = featomic_server::Client(options.socket_path);
+        auto descriptor = client.compute("spherical_expansion", HYPERS_JSON, systems, {"positions"});
+        check_same_tensor(descriptor, expected);
+
+        // re-use the same connection and calculator
+        descriptor = client.compute("spherical_expansion", HYPERS_JSON, systems, {"positions"});
+        check_same_tensor(descriptor, expected);
+
+        CHECK(server.requests_count() == 2);
+    }
+
+    SECTION("concurrent clients") {
+        auto n_clients = 8;
+        auto threads = std::vector<std::thread>();
+        auto descriptors = std::vector<std::optional<metatensor::TensorMap>>(static_cast<size_t>(n_clients));
+        for (int client_i = 0; client_i < n_clients; client_i++) {
+            threads.emplace_back([&, client_i]() {
+                auto client = featomic_server::Client(options.socket_path);
+                auto systems = std::vector<featomic::SimpleSystem>{water(0.1 * client_i)};
+                descriptors[static_cast<size_t>(client_i)] = client.compute(
+                    "spherical_expansion", HYPERS_JSON, systems, {"positions"}
+                );
+            });
+        }
+
+        for (auto& thread: threads) {
+            thread.join();
+        }
+
+        for (int client_i = 0; client_i < n_clients; client_i++) {
+            auto system = water(0.1 * client_i);
+            auto expected = calculator.compute(system, calculation_options);
+            check_same_tensor(*descriptors[static_cast<size_t>(client_i)], expected);
+        }
+
+        CHECK(server.requests_count() == 8);
+        CHECK(server.calculations_count() <= 8);
+    }
+
+    SECTION("errors") {
+        auto systems = std::vector<featomic::SimpleSystem>{water(0.0)};
+        auto client = featomic_server::Client(options.socket_path);
+        CHECK_THROWS_WITH(
+            client.compute("not-a-calculator", "{}", systems),
+            "featomic-server error: invalid parameter: unknown calculator with name 'not-a-calculator'"
+        );
+
+        // the connection is still usable after an error
+        auto descriptor = client.compute("spherical_expansion", HYPERS_JSON, systems, {"positions"});
+        CHECK(descriptor.keys().count() != 0);
+    }
+
+    SECTION("missing server") {
+        CHECK_THROWS(featomic_server::Client("/tmp/featomic-server-does-not-exist.sock"));
+    }
+}
+
+TEST_CASE("malformed systems") {
+    auto buffer = std::vector<uint8_t>(sizeof(uint64_t) * 2 + 9 * sizeof(double) + 64, 0);
+
+    uint64_t n_systems = 1;
+    std::memcpy(buffer.data(), &n_systems, sizeof(uint64_t));
+
+    // this number of atoms overflows the size computations if they are not
+    // checked before
+    uint64_t n_atoms = uint64_t(1) << 62;
+    std::memcpy(buffer.data() + sizeof(uint64_t), &n_atoms, sizeof(uint64_t));
+
+    CHECK_THROWS_WITH(
+        featomic_server::protocol::read_systems(buffer.data(), buffer.size()),
+        "invalid request: systems data is too small"
+    );
+
+    n_atoms = 3;
+    std::memcpy(buffer.data() + sizeof(uint64_t), &n_atoms, sizeof(uint64_t));
+    CHECK_THROWS_WITH(
+        featomic_server::protocol::read_systems(buffer.data(), buffer.size()),
+        "invalid request: systems data is too small"
+    );
+}
@@ -52,7 +52,7 @@ fn run_spherical_expansion(mut group: BenchmarkGroup<WallTime>,
                 }}
             }}
         }}"#);
-        let mut calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
+        let calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
 
         group.bench_function(format!("smearing = {}", smearing), |b| b.iter_custom(|repeat| {
             let start = std::time::Instant::now();
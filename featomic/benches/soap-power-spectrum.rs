@@ -71,7 +71,7 @@ fn run_soap_power_spectrum(
             }}
         }}"#);
 
-        let mut calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
+        let calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
 
         group.bench_function(format!("max_radial = max_angular = {}", max_basis), |b| b.iter_custom(|repeat| {
             let start = std::time::Instant::now();
@@ -69,7 +69,7 @@ fn run_spherical_expansion(mut group: BenchmarkGroup<WallTime>,
                 }}
             }}
         }}"#);
-        let mut calculator = Calculator::new("spherical_expansion", parameters).unwrap();
+        let calculator = Calculator::new("spherical_expansion", parameters).unwrap();
 
         group.bench_function(format!("max_radial = max_angular = {}", max_basis), |b| b.iter_custom(|repeat| {
             let start = std::time::Instant::now();
@@ -154,6 +154,7 @@ int read_systems_example(const char* path, featomic_system_t** systems, uintptr_
         (*systems)[step].compute_neighbors = chemfiles_system_neighbors;
         (*systems)[step].pairs = NULL;
         (*systems)[step].pairs_containing = NULL;
+        (*systems)[step].local_size = NULL;
 
         system = NULL;
     }
@@ -229,6 +229,14 @@ typedef struct featomic_system_t {
                                         uintptr_t atom,
                                         const struct featomic_pair_t **pairs,
                                         uintptr_t *count);
+  /**
+   * This function should set `*local_size` to the number of local atoms in
+   * this system. Atoms with index in `[0, local_size)` are local, and all
+   * other atoms are ghosts: they are used as neighbors of the local atoms,
+   * but no atom-centered sample is created for them. This function pointer
+   * can be NULL, in which case all atoms are considered local.
+   */
+  featomic_status_t (*local_size)(const void *user_data, uintptr_t *local_size);
 } featomic_system_t;
 
 /**
@@ -349,6 +357,45 @@ typedef struct featomic_calculation_options_t {
   const mts_labels_t *selected_keys;
 } featomic_calculation_options_t;
 
+/**
+ * Iterator over systems, used by `featomic_calculator_compute_chunks` to get
+ * the systems to run the calculation on.
+ */
+typedef struct featomic_systems_iterator_t {
+  /**
+   * User-provided data should be stored here, it will be passed as the
+   * first parameter to `next`.
+   */
+  void *user_data;
+  /**
+   * This function should write the next system in `*system` and set
+   * `*done` to `false`, or set `*done` to `true` if there are no more
+   * systems.
+   *
+   * The system must stay valid until the descriptor for the chunk
+   * containing it has been given to the `featomic_chunk_callback_t`.
+   */
+  featomic_status_t (*next)(void *user_data, struct featomic_system_t *system, bool *done);
+} featomic_systems_iterator_t;
+
+/**
+ * Callback receiving the descriptor for a chunk of systems in
+ * `featomic_calculator_compute_chunks`.
+ *
+ * `first_system` is the index of the first system of the chunk in the
+ * sequence of systems produced by the `featomic_systems_iterator_t`, and
+ * `systems_count` is the number of systems in the chunk. The `"system"`
+ * dimension of the samples in `descriptor` is relative to the chunk.
+ *
+ * The callback takes ownership of the `descriptor`, which must be released
+ * with `mts_tensormap_free`. The callback should return `FEATOMIC_SUCCESS`
+ * (0) on success, and any other value to interrupt the calculation.
+ */
+typedef featomic_status_t (*featomic_chunk_callback_t)(void *user_data,
+                                                       uintptr_t first_system,
+                                                       uintptr_t systems_count,
+                                                       mts_tensormap_t *descriptor);
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
@@ -473,6 +520,9 @@ featomic_status_t featomic_calculator_cutoffs(const struct featomic_calculator_t
  * This function allocates a new `mts_tensormap_t` in `*descriptor`, which
  * memory needs to be released by the user with `mts_tensormap_free`.
  *
+ * This function can be called concurrently from multiple threads with the same
+ * `calculator`, as long as each call uses different `systems`.
+ *
  * @param calculator pointer to an existing calculator
  * @param descriptor pointer to an `mts_tensormap_t *` that will be allocated
  *                   by this function
@@ -484,12 +534,116 @@ featomic_status_t featomic_calculator_cutoffs(const struct featomic_calculator_t
  *          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
  *          error message.
  */
-featomic_status_t featomic_calculator_compute(struct featomic_calculator_t *calculator,
+featomic_status_t featomic_calculator_compute(const struct featomic_calculator_t *calculator,
                                               mts_tensormap_t **descriptor,
                                               struct featomic_system_t *systems,
                                               uintptr_t systems_count,
                                               struct featomic_calculation_options_t options);
 
+/**
+ * Compute the representation of all the systems produced by the `systems`
+ * iterator with a `calculator`, splitting them in chunks such that the
+ * descriptor for each chunk uses around `memory_budget` bytes.
+ *
+ * The size of the chunks is adapted as the calculation progresses, using the
+ * memory used by each atom in the previous chunks. Each chunk contains at
+ * least one system. The descriptor for each chunk is given to `callback`,
+ * which runs in a separate thread while the next chunk is computed. Calls to
+ * `callback` are made in order and never overlap.
+ *
+ * @param calculator pointer to an existing calculator
+ * @param systems iterator over the systems to compute
+ * @param memory_budget approximate memory to use for the descriptor of each
+ *                      chunk, in bytes
+ * @param options options for this calculation
+ * @param callback function called with the descriptor for each chunk
+ * @param callback_data user data passed as the first parameter to `callback`
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
+ *          error message.
+ */
+featomic_status_t featomic_calculator_compute_chunks(const struct featomic_calculator_t *calculator,
+                                                     struct featomic_systems_iterator_t systems,
+                                                     uintptr_t memory_budget,
+                                                     struct featomic_calculation_options_t options,
+                                                     featomic_chunk_callback_t callback,
+                                                     void *callback_data);
+
+/**
+ * Compute the per-system atomic composition of many systems stored as a
+ * single packed array of atomic types, without going through a calculator.
+ *
+ * This gives the same counts as the `atomic_composition` calculator with
+ * `per_system=true`, stored in a single block with one `system` sample per
+ * system and one `center_type` property per atomic type. This is intended for
+ * dataset-wide statistics over many systems, where creating systems, keys and
+ * samples for the full calculator would dominate the cost.
+ *
+ * This function allocates a new `mts_tensormap_t` in `*descriptor`, which
+ * memory needs to be released by the user with `mts_tensormap_free`.
+ *
+ * @param descriptor pointer to an `mts_tensormap_t *` that will be allocated
+ *                   by this function
+ * @param types atomic types of all atoms in all systems, one system after the
+ *              other
+ * @param types_count number of entries in `types`
+ * @param system_offsets offset of the first atom of each system in `types`,
+ *                       followed by `types_count`. This array must start with
+ *                       0 and be sorted.
+ * @param system_offsets_count number of entries in `system_offsets`, i.e. the
+ *                             number of systems + 1
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
+ *          error message.
+ */
+featomic_status_t featomic_atomic_composition_packed(mts_tensormap_t **descriptor,
+                                                     const int32_t *types,
+                                                     uintptr_t types_count,
+                                                     const uintptr_t *system_offsets,
+                                                     uintptr_t system_offsets_count);
+
+/**
+ * Register a tabulated radial basis with the given `name`, from a dense array
+ * of spline points.
+ *
+ * @verbatim embed:rst:leading-asterisk
+ *
+ * The registered basis can then be used in the hyper-parameters of SOAP and
+ * LODE calculators with ``{"type": "Tabulated", "registered": "<name>"}``
+ * instead of giving all the spline ``points`` in JSON. The data is read
+ * directly from the given buffers (for example from a memory-mapped NumPy
+ * ``.npy`` file), validated once, and then shared by all calculators using
+ * this basis.
+ *
+ * @endverbatim
+ *
+ * Since calculators only refer to the basis by name, a name can not be re-used
+ * for different data: registering the exact same data again does nothing, and
+ * registering different data under an existing name is an error.
+ *
+ * @param name name of the basis as a NULL-terminated string
+ * @param points pointer to a row-major array of `n_points x (1 + 2 * n_basis)`
+ *               values. Each row contains the position of a spline point, the
+ *               `n_basis` values and the `n_basis` derivatives at this
+ *               position.
+ * @param n_points number of spline points (rows) in `points`
+ * @param n_basis number of radial basis functions in the spline
+ * @param center_contribution pointer to an array of `n_basis` values containing
+ *                            the LODE center contribution for this basis, or
+ *                            `NULL`. This is only used by LODE calculators.
+ *
+ * @returns The status code of this operation. If the status is not
+ *          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
+ *          error message.
+ */
+featomic_status_t featomic_register_tabulated_basis(const char *name,
+                                                    const double *points,
+                                                    uintptr_t n_points,
+                                                    uintptr_t n_basis,
+                                                    const double *center_contribution);
+
 /**
  * Clear all collected profiling data
  *
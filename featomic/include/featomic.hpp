@@ -5,9 +5,17 @@
 #include <cstdint>
 
 #include <array>
+#include <deque>
 #include <string>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <condition_variable>
 #include <utility>
 #include <optional>
 #include <stdexcept>
@@ -172,6 +180,14 @@ public:
     /// Get the number of atoms in this system
     virtual uintptr_t size() const = 0;
 
+    /// Get the number of local atoms in this system. Atoms with index in
+    /// `[0, local_size())` are local, all other atoms are ghosts: they are
+    /// used as neighbors of the local atoms, but no atom-centered sample is
+    /// created for them. By default, all atoms are local.
+    virtual uintptr_t local_size() const {
+        return this->size();
+    }
+
     /// Get a pointer to the first element a contiguous array (typically
     /// `std::vector` or memory allocated with `new[]`) containing the atomic
     /// type of each atom in this system. Different atomics types should be
@@ -272,6 +288,12 @@ public:
                     *pairs = cpp_pairs.data();
                     *size = cpp_pairs.size();
                 );
+            },
+            // local_size
+            [](const void* self, uintptr_t* local_size) {
+                FEATOMIC_SYSTEM_CATCH_EXCEPTIONS(
+                    *local_size = static_cast<const System*>(self)->local_size();
+                );
             }
         };
     }
@@ -546,6 +568,11 @@ private:
 /// The `Calculator` class implements the calculation of a given atomic scale
 /// representation. Specific implementation are registered globally, and
 /// requested at construction.
+///
+/// All the `compute` functions are `const` and thread-safe: a single
+/// `Calculator` can be used concurrently from multiple threads, sharing all
+/// the pre-computed data (splines, etc.) between threads. Each thread must use
+/// its own systems.
 class Calculator {
 public:
     /// Create a new calculator with the given `name` and `parameters`.
@@ -692,6 +719,85 @@ public:
         return metatensor::TensorMap(descriptor);
     }
 
+    /// Runs a calculation for all the systems in `[begin, end)`, splitting them
+    /// in chunks such that the descriptor for each chunk uses around
+    /// `memory_budget` bytes.
+    ///
+    /// For each chunk, `callback` is called with the index of the first system
+    /// in the chunk, the number of systems in the chunk and the corresponding
+    /// descriptor. The `"system"` dimension of the samples in the descriptor is
+    /// relative to the chunk. The callback runs in a separate thread while the
+    /// next chunk is computed, but calls to the callback are made in order and
+    /// never overlap.
+    ///
+    /// The systems must stay alive until the descriptor for the chunk
+    /// containing them has been given to the `callback`.
+    template<typename Iterator>
+    void compute_chunks(
+        Iterator begin,
+        Iterator end,
+        uintptr_t memory_budget,
+        std::function<void(uintptr_t, uintptr_t, metatensor::TensorMap)> callback,
+        CalculationOptions options = CalculationOptions()
+    ) const {
+        struct ChunksState {
+            Iterator current;
+            Iterator end;
+            std::function<void(uintptr_t, uintptr_t, metatensor::TensorMap)> callback;
+        };
+
+        auto state = ChunksState{std::move(begin), std::move(end), std::move(callback)};
+
+        auto systems = featomic_systems_iterator_t{};
+        systems.user_data = static_cast<void*>(&state);
+        systems.next = [](void* user_data, featomic_system_t* system, bool* done) {
+            try {
+                auto* state = static_cast<ChunksState*>(user_data);
+                if (state->current == state->end) {
+                    *done = true;
+                } else {
+                    *system = state->current->as_featomic_system_t();
+                    ++state->current;
+                    *done = false;
+                }
+                return featomic_status_t(FEATOMIC_SUCCESS);
+            } catch (...) {
+                return featomic_status_t(details::GlobalExceptionsStore::save_exception(
+                    std::current_exception()
+                ));
+            }
+        };
+
+        featomic_chunk_callback_t chunk_callback = [](
+            void* user_data,
+            uintptr_t first_system,
+            uintptr_t systems_count,
+            mts_tensormap_t* descriptor
+        ) {
+            try {
+                // take ownership of the descriptor first, to make sure it is
+                // released even if the callback throws
+                auto tensor = metatensor::TensorMap(descriptor);
+                auto* state = static_cast<ChunksState*>(user_data);
+                state->callback(first_system, systems_count, std::move(tensor));
+                return featomic_status_t(FEATOMIC_SUCCESS);
+            } catch (...) {
+                return featomic_status_t(details::GlobalExceptionsStore::save_exception(
+                    std::current_exception()
+                ));
+            }
+        };
+
+        details::check_status(featomic_calculator_compute_chunks(
+            calculator_,
+            systems,
+            memory_budget,
+            options.as_featomic_calculation_options_t(),
+            chunk_callback,
+            static_cast<void*>(&state)
+        ));
+    }
+
     /// Get the underlying pointer to a `featomic_calculator_t`.
     ///
     /// This is an advanced function that most users don't need to call
@@ -713,6 +819,654 @@ private:
 };
 
 
+namespace details {
+    /// Get the names of `labels` as a vector of `std::string`
+    inline std::vector<std::string> labels_names(const metatensor::Labels& labels) {
+        auto names = labels.names();
+        return std::vector<std::string>(names.begin(), names.end());
+    }
+
+    /// Copy the rows `rows` of `array` (along the first dimension) in a new
+    /// array
+    inline std::unique_ptr<metatensor::SimpleDataArray<double>> select_rows(
+        const metatensor::NDArray<double>& array,
+        const std::vector<uintptr_t>& rows
+    ) {
+        auto shape = array.shape();
+        uintptr_t row_size = 1;
+        for (size_t i = 1; i < shape.size(); i++) {
+            row_size *= shape[i];
+        }
+
+        auto data = std::vector<double>();
+        data.reserve(rows.size() * row_size);
+        for (auto row: rows) {
+            const auto* start = array.data() + row * row_size;
+            data.insert(data.end(), start, start + row_size);
+        }
+
+        shape[0] = rows.size();
+        return std::make_unique<metatensor::SimpleDataArray<double>>(shape, std::move(data));
+    }
+
+    /// Find the position of the dimension called `name` in `names`, throwing
+    /// a `FeatomicError` if there is no such dimension.
+    inline uintptr_t find_dimension(const std::vector<std::string>& names, const std::string& name) {
+        for (uintptr_t dimension = 0; dimension < names.size(); dimension++) {
+            if (names[dimension] == name) {
+                return dimension;
+            }
+        }
+
+        auto message = std::string("expected a \"") + name + "\" dimension in the samples, got [";
+        for (uintptr_t dimension = 0; dimension < names.size(); dimension++) {
+            if (dimension != 0) {
+                message += ", ";
+            }
+            message += names[dimension];
+        }
+        throw FeatomicError(message + "]");
+    }
+
+    /// Extract the part of `tensor` corresponding to the systems in `[start,
+    /// stop)`, renumbering the systems to start at 0. The samples must contain
+    /// a `"system"` dimension (at any position), and the first dimension of
+    /// the gradient samples must be `"sample"`. Blocks without any sample for
+    /// these systems are removed.
+    inline metatensor::TensorMap extract_systems(
+        metatensor::TensorMap& tensor,
+        int32_t start,
+        int32_t stop,
+        const std::vector<std::string>& gradients
+    ) {
+        auto keys = tensor.keys();
+        auto new_keys = std::vector<int32_t>();
+        auto new_blocks = std::vector<metatensor::TensorBlock>();
+
+        for (uintptr_t block_i = 0; block_i < keys.count(); block_i++) {
+            auto block = tensor.block_by_id(block_i);
+            auto samples = block.samples();
+            auto system_dimension = find_dimension(labels_names(samples), "system");
+
+            auto rows = std::vector<uintptr_t>();
+            // new index of each sample, or -1 if the sample is not selected
+            auto new_sample = std::vector<int32_t>(samples.count(), -1);
+            auto new_samples = std::vector<int32_t>();
+            for (uintptr_t sample_i = 0; sample_i < samples.count(); sample_i++) {
+                auto system = samples(sample_i, system_dimension);
+                if (system >= start && system < stop) {
+                    new_sample[sample_i] = static_cast<int32_t>(rows.size());
+                    rows.push_back(sample_i);
+
+                    for (uintptr_t dimension = 0; dimension < samples.size(); dimension++) {
+                        auto value = samples(sample_i, dimension);
+                        if (dimension == system_dimension) {
+                            value -= start;
+                        }
+                        new_samples.push_back(value);
+                    }
+                }
+            }
+
+            if (rows.empty()) {
+                continue;
+            }
+
+            auto properties = block.properties();
+            auto new_block = metatensor::TensorBlock(
+                select_rows(block.values(), rows),
+                metatensor::Labels(labels_names(samples), new_samples.data(), rows.size()),
+                block.components(),
+                properties
+            );
+
+            for (const auto& parameter: gradients) {
+                auto gradient = block.gradient(parameter);
+                auto gradient_samples = gradient.samples();
+                auto names = labels_names(gradient_samples);
+                if (find_dimension(names, "sample") != 0) {
+                    throw FeatomicError("expected \"sample\" to be the first dimension of gradient samples");
+                }
+
+                // cell and strain gradients don't have a "system" dimension
+                auto gradient_system_dimension = names.size();
+                for (uintptr_t dimension = 0; dimension < names.size(); dimension++) {
+                    if (names[dimension] == "system") {
+                        gradient_system_dimension = dimension;
+                    }
+                }
+
+                auto gradient_rows = std::vector<uintptr_t>();
+                auto new_gradient_samples = std::vector<int32_t>();
+                for (uintptr_t gradient_i = 0; gradient_i < gradient_samples.count(); gradient_i++) {
+                    auto sample = new_sample[static_cast<uintptr_t>(gradient_samples(gradient_i, 0))];
+                    if (sample < 0) {
+                        continue;
+                    }
+
+                    gradient_rows.push_back(gradient_i);
+                    new_gradient_samples.push_back(sample);
+                    for (uintptr_t dimension = 1; dimension < names.size(); dimension++) {
+                        auto value = gradient_samples(gradient_i, dimension);
+                        if (dimension == gradient_system_dimension) {
+                            value -= start;
+                        }
+                        new_gradient_samples.push_back(value);
+                    }
+                }
+
+                new_block.add_gradient(parameter, metatensor::TensorBlock(
+                    select_rows(gradient.values(), gradient_rows),
+                    metatensor::Labels(names, new_gradient_samples.data(), gradient_rows.size()),
+                    gradient.components(),
+                    properties
+                ));
+            }
+
+            for (uintptr_t dimension = 0; dimension < keys.size(); dimension++) {
+                new_keys.push_back(keys(block_i, dimension));
+            }
+            new_blocks.emplace_back(std::move(new_block));
+        }
+
+        return metatensor::TensorMap(
+            metatensor::Labels(labels_names(keys), new_keys.data(), new_blocks.size()),
+            std::move(new_blocks)
+        );
+    }
+}
+
+
+/// Options controlling how a `BatchedCalculator` groups requests together
+struct BatchingOptions {
+    /// Maximal time a request waits for other requests to join its batch
+    /// before the calculation starts
+    std::chrono::microseconds max_latency = std::chrono::microseconds(200);
+    /// Maximal number of systems in a single batch
+    uintptr_t max_batch_size = 64;
+    /// List of gradients to compute, see `CalculationOptions::gradients`
+    std::vector<std::string> gradients;
+    /// Copy the data from systems into native `SimpleSystem`, see
+    /// `CalculationOptions::use_native_system`
+    bool use_native_system = true;
+};
+
+/// Thread-safe front-end to a `Calculator` for applications making many small
+/// concurrent calculations, each on a single system.
+///
+/// Concurrent calls to `BatchedCalculator::compute` are collected for at most
+/// `BatchingOptions::max_latency` (or until `BatchingOptions::max_batch_size`
+/// systems are waiting), and then computed together in a single call to
+/// `Calculator::compute` running in a background thread. This amortizes the
+/// per-call overhead of featomic, and allows the calculator to use multiple
+/// threads on the whole batch. The descriptor for each system is then
+/// extracted from the batched descriptor, and given back to the caller.
+///
+/// Since the keys of a descriptor depend on all the systems in a calculation,
+/// blocks without any sample for a given system are removed from the
+/// corresponding descriptor.
+class BatchedCalculator {
+public:
+    /// Create a new `BatchedCalculator` running calculations with the given
+    /// `calculator`, grouping requests according to `options`.
+    BatchedCalculator(Calculator calculator, BatchingOptions options = BatchingOptions()):
+        calculator_(std::move(calculator)),
+        options_(std::move(options))
+    {
+        if (options_.max_batch_size == 0) {
+            throw FeatomicError("max_batch_size must be at least 1 in BatchedCalculator");
+        }
+
+        worker_ = std::thread([this]() { this->run(); });
+    }
+
+    ~BatchedCalculator() {
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        worker_.join();
+    }
+
+    /// BatchedCalculator is **NOT** copy-constructible
+    BatchedCalculator(const BatchedCalculator&) = delete;
+    /// BatchedCalculator can **NOT** be copy-assigned
+    BatchedCalculator& operator=(const BatchedCalculator&) = delete;
+    /// BatchedCalculator is **NOT** move-constructible
+    BatchedCalculator(BatchedCalculator&&) = delete;
+    /// BatchedCalculator can **NOT** be move-assigned
+    BatchedCalculator& operator=(BatchedCalculator&&) = delete;
+
+    /// Runs a calculation for a single `system`, possibly batched together
+    /// with calculations from other threads. This function blocks until the
+    /// calculation is finished, and the `system` must not be modified in the
+    /// meantime.
+    ///
+    /// This function can be called from multiple threads at the same time.
+    template<typename SystemImpl, typename std::enable_if<std::is_base_of<System, SystemImpl>::value, bool>::type = true>
+    metatensor::TensorMap compute(SystemImpl& system) {
+        auto request = std::make_shared<Request>();
+        request->system = system.as_featomic_system_t();
+        request->arrival = std::chrono::steady_clock::now();
+        auto result = request->result.get_future();
+
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            pending_.push_back(request);
+        }
+        condition_.notify_one();
+
+        return result.get();
+    }
+
+    /// Get the total number of systems computed by this `BatchedCalculator`
+    uint64_t requests_count() const {
+        return requests_;
+    }
+
+    /// Get the number of calls to `Calculator::compute` made by this
+    /// `BatchedCalculator`
+    uint64_t batches_count() const {
+        return batches_;
+    }
+
+private:
+    /// A single system waiting to be computed
+    struct Request {
+        featomic_system_t system;
+        std::chrono::steady_clock::time_point arrival;
+        std::promise<metatensor::TensorMap> result;
+    };
+
+    void run() {
+        while (true) {
+            auto batch = std::vector<std::shared_ptr<Request>>();
+            {
+                auto lock = std::unique_lock<std::mutex>(mutex_);
+                condition_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+                if (pending_.empty()) {
+                    return;
+                }
+
+                // wait for more requests to join the batch, up to the
+                // latency budget of the oldest request
+                auto deadline = pending_.front()->arrival + options_.max_latency;
+                condition_.wait_until(lock, deadline, [this]() {
+                    return stopping_ || pending_.size() >= options_.max_batch_size;
+                });
+
+                while (!pending_.empty() && batch.size() < options_.max_batch_size) {
+                    batch.emplace_back(std::move(pending_.front()));
+                    pending_.pop_front();
+                }
+            }
+
+            this->compute_batch(batch);
+        }
+    }
+
+    void compute_batch(std::vector<std::shared_ptr<Request>>& batch) {
+        auto systems = std::vector<featomic_system_t>();
+        systems.reserve(batch.size());
+        for (const auto& request: batch) {
+            systems.push_back(request->system);
+        }
+
+        auto options = CalculationOptions();
+        options.use_native_system = options_.use_native_system;
+        for (const auto& gradient: options_.gradients) {
+            options.gradients.push_back(gradient.c_str());
+        }
+
+        auto descriptor = std::optional<metatensor::TensorMap>();
+        try {
+            descriptor = calculator_.compute(systems, std::move(options));
+        } catch (...) {
+            for (auto& request: batch) {
+                request->result.set_exception(std::current_exception());
+            }
+            return;
+        }
+
+        batches_ += 1;
+        requests_ += batch.size();
+
+        if (batch.size() == 1) {
+            batch[0]->result.set_value(std::move(*descriptor));
+            return;
+        }
+
+        for (uintptr_t system_i = 0; system_i < batch.size(); system_i++) {
+            try {
+                auto system = static_cast<int32_t>(system_i);
+                batch[system_i]->result.set_value(details::extract_systems(
+                    *descriptor, system, system + 1, options_.gradients
+                ));
+            } catch (...) {
+                batch[system_i]->result.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    Calculator calculator_;
+    BatchingOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::shared_ptr<Request>> pending_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> batches_{0};
+
+    std::thread worker_;
+};
+
+
+/// Compressed, read-only copy of the positions gradients of a single
+/// `metatensor::TensorBlock`.
+///
+/// Positions gradients are stored by featomic as one dense `[3, <components>,
+/// properties]` array for each `(sample, system, atom)` gradient sample. For a
+/// given pair, only a subset of the properties is usually non-zero, especially
+/// after moving the neighbor types to properties (e.g. with
+/// `keys_to_properties("neighbor_type")`), since each neighbor only contributes
+/// to the properties associated with its own type. These properties are not
+/// always contiguous (e.g. for a power spectrum with the types of both
+/// neighbors in the properties).
+///
+/// This class stores, for each gradient sample, the list of contiguous ranges
+/// of properties containing non-zero values, and indexes the gradient samples
+/// in CSR format, grouping together all gradient samples associated with the
+/// same "sample".
+///
+/// The compressed gradients are created from the dense gradients, so this
+/// does not reduce the peak memory usage of the calculation. The dense
+/// gradients can be released once this compressed version has been created,
+/// reducing the memory used afterward.
+class CompressedPositionsGradient {
+public:
+    /// Create a compressed version of the given positions `gradient`. The
+    /// gradient samples must be `["sample", "system", "atom"]`, sorted by
+    /// `"sample"` (which is always the case for gradients created by featomic),
+    /// and the first component must be the `xyz` direction.
+    ///
+    /// @param gradient positions gradients, usually obtained with
+    ///                 `block.gradient("positions")`
+    /// @param samples_count number of samples in the parent block
+    ///
+    /// @throws FeatomicError if the gradient samples are not sorted or do not
+    ///         have the expected names
+    CompressedPositionsGradient(metatensor::TensorBlock& gradient, uintptr_t samples_count) {
+        auto samples = gradient.samples();
+        auto names = samples.names();
+        if (names.size() != 3 ||
+            std::strcmp(names[0], "sample") != 0 ||
+            std::strcmp(names[1], "system") != 0 ||
+            std::strcmp(names[2], "atom") != 0
+        ) {
+            throw FeatomicError(
+                "invalid gradient samples in CompressedPositionsGradient: "
+                "expected [\"sample\", \"system\", \"atom\"]"
+            );
+        }
+
+        auto values = gradient.values();
+        const auto& shape = values.shape();
+        if (shape.size() < 3 || shape[1] != 3) {
+            throw FeatomicError(
+                "invalid gradient shape in CompressedPositionsGradient: "
+                "expected at least 3 dimensions, with the second one being xyz"
+            );
+        }
+
+        properties_count_ = shape[shape.size() - 1];
+        components_size_ = 1;
+        for (size_t i = 1; i < shape.size() - 1; i++) {
+            components_size_ *= shape[i];
+        }
+
+        auto gradient_samples_count = samples.count();
+        systems_.reserve(gradient_samples_count);
+        atoms_.reserve(gradient_samples_count);
+        ranges_offsets_.reserve(gradient_samples_count + 1);
+        ranges_offsets_.push_back(0);
+
+        sample_offsets_.resize(samples_count + 1, 0);
+
+        const auto* data = values.data();
+        auto row_size = components_size_ * properties_count_;
+        auto non_zero = std::vector<bool>(properties_count_);
+        int32_t previous_sample = 0;
+        for (uintptr_t grad_sample_i = 0; grad_sample_i < gradient_samples_count; grad_sample_i++) {
+            auto sample_i = samples(grad_sample_i, 0);
+            if (sample_i < previous_sample || static_cast<uintptr_t>(sample_i) >= samples_count) {
+                throw FeatomicError(
+                    "invalid gradient samples in CompressedPositionsGradient: "
+                    "the \"sample\" dimension must be sorted and smaller than "
+                    "the number of samples"
+                );
+            }
+            previous_sample = sample_i;
+            sample_offsets_[static_cast<uintptr_t>(sample_i) + 1] += 1;
+
+            systems_.push_back(samples(grad_sample_i, 1));
+            atoms_.push_back(samples(grad_sample_i, 2));
+
+            // find the properties containing non-zero values for any component
+            const auto* row = data + grad_sample_i * row_size;
+            std::fill(non_zero.begin(), non_zero.end(), false);
+            for (uintptr_t component = 0; component < components_size_; component++) {
+                const auto* values_row = row + component * properties_count_;
+                for (uintptr_t property = 0; property < properties_count_; property++) {
+                    if (values_row[property] != 0.0) {
+                        non_zero[property] = true;
+                    }
+                }
+            }
+
+            // store each contiguous range of non-zero properties
+            uintptr_t property = 0;
+            while (property < properties_count_) {
+                if (!non_zero[property]) {
+                    property += 1;
+                    continue;
+                }
+
+                auto begin = property;
+                while (property < properties_count_ && non_zero[property]) {
+                    property += 1;
+                }
+
+                ranges_.push_back(PropertiesRange{begin, property, data_.size()});
+                for (uintptr_t component = 0; component < components_size_; component++) {
+                    const auto* values_row = row + component * properties_count_;
+                    data_.insert(data_.end(), values_row + begin, values_row + property);
+                }
+            }
+            ranges_offsets_.push_back(ranges_.size());
+        }
+
+        for (uintptr_t sample_i = 0; sample_i < samples_count; sample_i++) {
+            sample_offsets_[sample_i + 1] += sample_offsets_[sample_i];
+        }
+    }
+
+    ~CompressedPositionsGradient() = default;
+
+    /// CompressedPositionsGradient is copy-constructible
+    CompressedPositionsGradient(const CompressedPositionsGradient&) = default;
+    /// CompressedPositionsGradient is move-constructible
+    CompressedPositionsGradient(CompressedPositionsGradient&&) noexcept = default;
+    /// CompressedPositionsGradient can be copy-assigned
+    CompressedPositionsGradient& operator=(const CompressedPositionsGradient&) = default;
+    /// CompressedPositionsGradient can be move-assigned
+    CompressedPositionsGradient& operator=(CompressedPositionsGradient&&) noexcept = default;
+
+    /// Get the number of samples in the parent block
+    uintptr_t samples_count() const {
+        return sample_offsets_.size() - 1;
+    }
+
+    /// Get the number of gradient samples, i.e. the number of `(sample,
+    /// system, atom)` entries
+    uintptr_t gradient_samples_count() const {
+        return systems_.size();
+    }
+
+    /// Get the number of properties in the parent block
+    uintptr_t properties_count() const {
+        return properties_count_;
+    }
+
+    /// Get the total size of all components, including the `xyz` component
+    uintptr_t components_size() const {
+        return components_size_;
+    }
+
+    /// Get the number of values actually stored, to be compared with
+    /// `gradient_samples_count() * components_size() * properties_count()`
+    /// for the dense storage.
+    uintptr_t stored_size() const {
+        return data_.size();
+    }
+
+    /// Get the range `[begin, end)` of gradient samples associated with the
+    /// given `sample`
+    std::pair<uintptr_t, uintptr_t> gradient_samples_for(uintptr_t sample) const {
+        return {sample_offsets_.at(sample), sample_offsets_.at(sample + 1)};
+    }
+
+    /// Get the system index of the given `gradient_sample`
+    int32_t system(uintptr_t gradient_sample) const {
+        return systems_.at(gradient_sample);
+    }
+
+    /// Get the atom index (i.e. the atom we are taking the gradient with respect
+    /// to) of the given `gradient_sample`
+    int32_t atom(uintptr_t gradient_sample) const {
+        return atoms_.at(gradient_sample);
+    }
+
+    /// Get the ranges `[begin, end)` of properties stored for the given
+    /// `gradient_sample`, sorted by `begin`. All properties outside of these
+    /// ranges are zero.
+    std::vector<std::pair<uintptr_t, uintptr_t>> properties_ranges(uintptr_t gradient_sample) const {
+        auto result = std::vector<std::pair<uintptr_t, uintptr_t>>();
+        auto ranges_begin = ranges_offsets_.at(gradient_sample);
+        auto ranges_end = ranges_offsets_.at(gradient_sample + 1);
+        for (auto range_i = ranges_begin; range_i < ranges_end; range_i++) {
+            result.emplace_back(ranges_[range_i].begin, ranges_[range_i].end);
+        }
+        return result;
+    }
+
+    /// Get the value of the gradient for a given `gradient_sample`, flattened
+    /// `component` (including `xyz` as the first component) and `property`.
+    double get(uintptr_t gradient_sample, uintptr_t component, uintptr_t property) const {
+        auto ranges_begin = ranges_offsets_.at(gradient_sample);
+        auto ranges_end = ranges_offsets_.at(gradient_sample + 1);
+        if (component >= components_size_ || property >= properties_count_) {
+            throw FeatomicError("out of bounds access in CompressedPositionsGradient");
+        }
+
+        for (auto range_i = ranges_begin; range_i < ranges_end; range_i++) {
+            const auto& range = ranges_[range_i];
+            if (property >= range.begin && property < range.end) {
+                auto width = range.end - range.begin;
+                return data_[range.data_offset + component * width + (property - range.begin)];
+            }
+        }
+
+        return 0.0;
+    }
+
+    /// Compute the vector-Jacobian product of these gradients with the
+    /// gradient of some quantity with respect to the values of the parent
+    /// block, i.e. accumulate the gradient of this quantity with respect to
+    /// the atomic positions.
+    ///
+    /// @param values_gradient gradient with respect to the values of the
+    ///        parent block, stored as a contiguous array with shape
+    ///        `[samples, <components>, properties]`
+    /// @param atoms_offsets index of the first atom of each system in
+    ///        `positions_gradient`. For a single system, this should be `{0}`.
+    /// @param positions_gradient contiguous array with shape `[atoms, 3]`,
+    ///        where the gradients with respect to positions will be added
+    void vjp(
+        const double* values_gradient,
+        const std::vector<uintptr_t>& atoms_offsets,
+        double* positions_gradient
+    ) const {
+        auto n_components = components_size_ / 3;
+        for (uintptr_t sample_i = 0; sample_i < this->samples_count(); sample_i++) {
+            const auto* sample_gradient = values_gradient + sample_i * n_components * properties_count_;
+
+            for (auto grad_sample_i = sample_offsets_[sample_i]; grad_sample_i < sample_offsets_[sample_i + 1]; grad_sample_i++) {
+                auto ranges_begin = ranges_offsets_[grad_sample_i];
+                auto ranges_end = ranges_offsets_[grad_sample_i + 1];
+                if (ranges_begin == ranges_end) {
+                    continue;
+                }
+
+                auto atom_i = atoms_offsets.at(static_cast<uintptr_t>(systems_[grad_sample_i]));
+                atom_i += static_cast<uintptr_t>(atoms_[grad_sample_i]);
+
+                for (uintptr_t xyz = 0; xyz < 3; xyz++) {
+                    auto sum = 0.0;
+                    for (auto range_i = ranges_begin; range_i < ranges_end; range_i++) {
+                        const auto& range = ranges_[range_i];
+                        auto width = range.end - range.begin;
+                        const auto* data = data_.data() + range.data_offset;
+                        for (uintptr_t component = 0; component < n_components; component++) {
+                            const auto* row = data + (xyz * n_components + component) * width;
+                            const auto* upstream = sample_gradient + component * properties_count_ + range.begin;
+                            for (uintptr_t property = 0; property < width; property++) {
+                                sum += row[property] * upstream[property];
+                            }
+                        }
+                    }
+                    positions_gradient[3 * atom_i + xyz] += sum;
+                }
+            }
+        }
+    }
+
+private:
+    /// A contiguous range of non-zero properties for a single gradient sample
+    struct PropertiesRange {
+        /// first property in this range
+        uintptr_t begin;
+        /// one past the last property in this range
+        uintptr_t end;
+        /// start of the `[<components>, end - begin]` data for this range in
+        /// `data_`
+        uintptr_t data_offset;
+    };
+
+    /// number of properties in the parent block
+    uintptr_t properties_count_ = 0;
+    /// product of the size of all components, including xyz
+    uintptr_t components_size_ = 0;
+    /// CSR offsets, gradient samples for sample `i` are in
+    /// `[sample_offsets_[i], sample_offsets_[i + 1])`
+    std::vector<uintptr_t> sample_offsets_;
+    /// system index for each gradient sample
+    std::vector<int32_t> systems_;
+    /// atom index for each gradient sample
+    std::vector<int32_t> atoms_;
+    /// CSR offsets, the ranges of properties for gradient sample `i` are in
+    /// `ranges_[ranges_offsets_[i]..ranges_offsets_[i + 1]]`
+    std::vector<uintptr_t> ranges_offsets_;
+    /// ranges of non-zero properties for all gradient samples
+    std::vector<PropertiesRange> ranges_;
+    /// compressed gradient data, each range of properties is stored as a
+    /// `[<components>, end - begin]` array
+    std::vector<double> data_;
+};
+
+
 /// Featomic uses the [`time_graph`](https://docs.rs/time-graph/) to collect
 /// timing information on the calculations. The `Profiler` static class provides
 /// access to this functionality.
@@ -767,6 +1521,33 @@ public:
     }
 };
 
+/// Register a tabulated radial basis with the given `name`, to be used in
+/// calculators hyper-parameters with `{"type": "Tabulated", "registered":
+/// "<name>"}` instead of giving all the spline points in JSON.
+///
+/// Registering the exact same data again under a name does nothing, while
+/// registering different data under an existing name throws an error.
+///
+/// @param name name of the basis
+/// @param points row-major array of `n_points x (1 + 2 * n_basis)` values. Each
+///               row contains the position of a spline point, the `n_basis`
+///               values and the `n_basis` derivatives at this position.
+/// @param n_points number of spline points (rows) in `points`
+/// @param n_basis number of radial basis functions in the spline
+/// @param center_contribution array of `n_basis` values with the LODE center
+///                            contribution for this basis, or `nullptr`
+inline void register_tabulated_basis(
+    const std::string& name,
+    const double* points,
+    size_t n_points,
+    size_t n_basis,
+    const double* center_contribution = nullptr
+) {
+    details::check_status(featomic_register_tabulated_basis(
+        name.c_str(), points, n_points, n_basis, center_contribution
+    ));
+}
+
 }
 
 #endif
@@ -0,0 +1,65 @@
+use std::os::raw::c_char;
+use std::ffi::CStr;
+
+use ndarray::{ArrayView1, ArrayView2};
+
+use crate::calculators::register_tabulated_basis;
+
+use super::{catch_unwind, featomic_status_t};
+
+/// Register a tabulated radial basis with the given `name`, from a dense array
+/// of spline points.
+///
+/// @verbatim embed:rst:leading-asterisk
+///
+/// The registered basis can then be used in the hyper-parameters of SOAP and
+/// LODE calculators with ``{"type": "Tabulated", "registered": "<name>"}``
+/// instead of giving all the spline ``points`` in JSON. The data is read
+/// directly from the given buffers (for example from a memory-mapped NumPy
+/// ``.npy`` file), validated once, and then shared by all calculators using
+/// this basis.
+///
+/// @endverbatim
+///
+/// Since calculators only refer to the basis by name, a name can not be re-used
+/// for different data: registering the exact same data again does nothing, and
+/// registering different data under an existing name is an error.
+///
+/// @param name name of the basis as a NULL-terminated string
+/// @param points pointer to a row-major array of `n_points x (1 + 2 * n_basis)`
+///               values. Each row contains the position of a spline point, the
+///               `n_basis` values and the `n_basis` derivatives at this
+///               position.
+/// @param n_points number of spline points (rows) in `points`
+/// @param n_basis number of radial basis functions in the spline
+/// @param center_contribution pointer to an array of `n_basis` values containing
+///                            the LODE center contribution for this basis, or
+///                            `NULL`. This is only used by LODE calculators.
+///
+/// @returns The status code of this operation. If the status is not
+///          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn featomic_register_tabulated_basis(
+    name: *const c_char,
+    points: *const f64,
+    n_points: usize,
+    n_basis: usize,
+    center_contribution: *const f64,
+) -> featomic_status_t {
+    catch_unwind(|| {
+        check_pointers!(name, points);
+        let name = CStr::from_ptr(name).to_str()?;
+
+        let points = ArrayView2::from_shape_ptr((n_points, 1 + 2 * n_basis), points);
+        let center_contribution = if center_contribution.is_null() {
+            None
+        } else {
+            Some(ArrayView1::from_shape_ptr(n_basis, center_contribution))
+        };
+
+        register_tabulated_basis(name, points, center_contribution)?;
+
+        Ok(())
+    })
+}
@@ -1,4 +1,4 @@
-use std::os::raw::c_char;
+use std::os::raw::{c_char, c_void};
 use std::ffi::CStr;
 use std::ops::{Deref, DerefMut};
 
@@ -6,11 +6,12 @@ use metatensor::{Labels, TensorMap};
 use metatensor::c_api::{mts_tensormap_t, mts_labels_t};
 
 use crate::{CalculationOptions, Calculator, Error, LabelsSelection, System};
+use crate::calculators::AtomicComposition;
 
 use super::utils::copy_str_to_c;
 use super::{catch_unwind, featomic_status_t};
 
-use super::system::featomic_system_t;
+use super::system::{featomic_system_t, CSystem};
 
 /// Opaque type representing a `Calculator`
 #[allow(non_camel_case_types)]
@@ -371,6 +372,52 @@ pub struct featomic_calculation_options_t {
     selected_keys: *const mts_labels_t,
 }
 
+/// Convert the C calculation `options` to Rust `CalculationOptions`, and call
+/// `function` with them.
+unsafe fn with_rust_options<T, F>(options: &featomic_calculation_options_t, function: F) -> Result<T, Error>
+    where F: FnOnce(CalculationOptions<'_>) -> Result<T, Error>
+{
+    let c_gradients = if options.gradients_count == 0 {
+        &[]
+    } else {
+        assert_ne!(options.gradients, std::ptr::null());
+        std::slice::from_raw_parts(options.gradients, options.gradients_count)
+    };
+    let mut gradients = Vec::new();
+    for &parameter in c_gradients {
+        gradients.push(CStr::from_ptr(parameter).to_str()?);
+    }
+
+    let mut selected_samples = None;
+    let mut predefined_samples = None;
+    let selected_samples = convert_labels_selection(
+        &options.selected_samples,
+        &mut selected_samples,
+        &mut predefined_samples
+    )?;
+
+    let mut selected_properties = None;
+    let mut predefined_properties = None;
+    let selected_properties = convert_labels_selection(
+        &options.selected_properties,
+        &mut selected_properties,
+        &mut predefined_properties
+    )?;
+
+    let mut selected_keys = None;
+    let selected_keys = key_selection(options.selected_keys, &mut selected_keys)?;
+
+    let rust_options = CalculationOptions {
+        gradients: &gradients,
+        use_native_system: options.use_native_system,
+        selected_samples,
+        selected_properties,
+        selected_keys,
+    };
+
+    return function(rust_options);
+}
+
 #[allow(clippy::doc_markdown)]
 /// Compute the representation of the given list of `systems` with a
 /// `calculator`
@@ -378,6 +425,9 @@ pub struct featomic_calculation_options_t {
 /// This function allocates a new `mts_tensormap_t` in `*descriptor`, which
 /// memory needs to be released by the user with `mts_tensormap_free`.
 ///
+/// This function can be called concurrently from multiple threads with the same
+/// `calculator`, as long as each call uses different `systems`.
+///
 /// @param calculator pointer to an existing calculator
 /// @param descriptor pointer to an `mts_tensormap_t *` that will be allocated
 ///                   by this function
@@ -390,7 +440,7 @@ pub struct featomic_calculation_options_t {
 ///          error message.
 #[no_mangle]
 pub unsafe extern fn featomic_calculator_compute(
-    calculator: *mut featomic_calculator_t,
+    calculator: *const featomic_calculator_t,
     descriptor: *mut *mut mts_tensormap_t,
     systems: *mut featomic_system_t,
     systems_count: usize,
@@ -412,49 +462,230 @@ pub unsafe extern fn featomic_calculator_compute(
         };
         let mut systems = Vec::with_capacity(c_systems.len());
         for system in c_systems {
-            systems.push(Box::new(system) as Box<dyn System>);
+            systems.push(Box::new(CSystem::new(*system)) as Box<dyn System>);
         }
 
-        let c_gradients = if options.gradients_count == 0 {
-            &[]
-        } else {
-            assert_ne!(options.gradients, std::ptr::null());
-            std::slice::from_raw_parts(options.gradients, options.gradients_count)
+        let tensor = with_rust_options(&options, |rust_options| {
+            (*calculator).compute(&mut systems, rust_options)
+        })?;
+
+        *descriptor = TensorMap::into_raw(tensor);
+        Ok(())
+    })
+}
+
+/// Iterator over systems, used by `featomic_calculator_compute_chunks` to get
+/// the systems to run the calculation on.
+#[repr(C)]
+#[allow(non_camel_case_types)]
+pub struct featomic_systems_iterator_t {
+    /// User-provided data should be stored here, it will be passed as the
+    /// first parameter to `next`.
+    user_data: *mut c_void,
+    /// This function should write the next system in `*system` and set
+    /// `*done` to `false`, or set `*done` to `true` if there are no more
+    /// systems.
+    ///
+    /// The system must stay valid until the descriptor for the chunk
+    /// containing it has been given to the `featomic_chunk_callback_t`.
+    next: Option<unsafe extern fn(user_data: *mut c_void, system: *mut featomic_system_t, done: *mut bool) -> featomic_status_t>,
+}
+
+/// Callback receiving the descriptor for a chunk of systems in
+/// `featomic_calculator_compute_chunks`.
+///
+/// `first_system` is the index of the first system of the chunk in the
+/// sequence of systems produced by the `featomic_systems_iterator_t`, and
+/// `systems_count` is the number of systems in the chunk. The `"system"`
+/// dimension of the samples in `descriptor` is relative to the chunk.
+///
+/// The callback takes ownership of the `descriptor`, which must be released
+/// with `mts_tensormap_free`. The callback should return `FEATOMIC_SUCCESS`
+/// (0) on success, and any other value to interrupt the calculation.
+#[allow(non_camel_case_types)]
+pub type featomic_chunk_callback_t = Option<unsafe extern fn(
+    user_data: *mut c_void,
+    first_system: usize,
+    systems_count: usize,
+    descriptor: *mut mts_tensormap_t,
+) -> featomic_status_t>;
+
+/// Wrapper around the chunk callback and corresponding user data, to be able
+/// to send them to the thread running the callback.
+struct ChunkCallback {
+    function: unsafe extern fn(*mut c_void, usize, usize, *mut mts_tensormap_t) -> featomic_status_t,
+    user_data: *mut c_void,
+}
+
+// SAFETY: the callback is never called concurrently, and users are told that
+// it will run on a different thread
+unsafe impl Send for ChunkCallback {}
+
+impl ChunkCallback {
+    fn call(&self, first_system: usize, systems_count: usize, tensor: TensorMap) -> Result<(), Error> {
+        let status = unsafe {
+            (self.function)(self.user_data, first_system, systems_count, TensorMap::into_raw(tensor))
         };
-        let mut gradients = Vec::new();
-        for &parameter in c_gradients {
-            gradients.push(CStr::from_ptr(parameter).to_str()?);
+
+        if !status.is_success() {
+            return Err(Error::External {
+                status: status.as_i32(),
+                message: "call to featomic_chunk_callback_t failed".into(),
+            });
         }
 
-        let mut selected_samples = None;
-        let mut predefined_samples = None;
-        let selected_samples = convert_labels_selection(
-            &options.selected_samples,
-            &mut selected_samples,
-            &mut predefined_samples
-        )?;
+        return Ok(());
+    }
+}
 
-        let mut selected_properties = None;
-        let mut predefined_properties = None;
-        let selected_properties = convert_labels_selection(
-            &options.selected_properties,
-            &mut selected_properties,
-            &mut predefined_properties
-        )?;
+/// Iterator adapter producing `Box<dyn System>` from a
+/// `featomic_systems_iterator_t`
+struct CSystemsIterator {
+    iterator: featomic_systems_iterator_t,
+    done: bool,
+}
+
+impl Iterator for CSystemsIterator {
+    type Item = Result<Box<dyn System>, Error>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.done {
+            return None;
+        }
+
+        let next = self.iterator.next.expect("checked before creating the iterator");
+
+        let mut system = std::mem::MaybeUninit::<featomic_system_t>::uninit();
+        let mut done = false;
+        let status = unsafe {
+            next(self.iterator.user_data, system.as_mut_ptr(), &mut done)
+        };
+
+        if !status.is_success() {
+            self.done = true;
+            return Some(Err(Error::External {
+                status: status.as_i32(),
+                message: "call to featomic_systems_iterator_t.next failed".into(),
+            }));
+        }
+
+        if done {
+            self.done = true;
+            return None;
+        }
+
+        // SAFETY: the system was initialized by the callback
+        let system = unsafe { system.assume_init() };
+        return Some(Ok(Box::new(CSystem::new(system)) as Box<dyn System>));
+    }
+}
+
+#[allow(clippy::doc_markdown)]
+/// Compute the representation of all the systems produced by the `systems`
+/// iterator with a `calculator`, splitting them in chunks such that the
+/// descriptor for each chunk uses around `memory_budget` bytes.
+///
+/// The size of the chunks is adapted as the calculation progresses, using the
+/// memory used by each atom in the previous chunks. Each chunk contains at
+/// least one system. The descriptor for each chunk is given to `callback`,
+/// which runs in a separate thread while the next chunk is computed. Calls to
+/// `callback` are made in order and never overlap.
+///
+/// @param calculator pointer to an existing calculator
+/// @param systems iterator over the systems to compute
+/// @param memory_budget approximate memory to use for the descriptor of each
+///                      chunk, in bytes
+/// @param options options for this calculation
+/// @param callback function called with the descriptor for each chunk
+/// @param callback_data user data passed as the first parameter to `callback`
+///
+/// @returns The status code of this operation. If the status is not
+///          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn featomic_calculator_compute_chunks(
+    calculator: *const featomic_calculator_t,
+    systems: featomic_systems_iterator_t,
+    memory_budget: usize,
+    options: featomic_calculation_options_t,
+    callback: featomic_chunk_callback_t,
+    callback_data: *mut c_void,
+) -> featomic_status_t {
+    catch_unwind(move || {
+        check_pointers!(calculator);
 
-        let mut selected_keys = None;
-        let selected_keys = key_selection(options.selected_keys, &mut selected_keys)?;
+        if systems.next.is_none() {
+            return Err(Error::InvalidParameter(
+                "featomic_systems_iterator_t.next function is NULL".into()
+            ));
+        }
+
+        let callback = ChunkCallback {
+            function: callback.ok_or_else(|| Error::InvalidParameter(
+                "got invalid NULL pointer for callback".into()
+            ))?,
+            user_data: callback_data,
+        };
 
-        let rust_options = CalculationOptions {
-            gradients: &gradients,
-            use_native_system: options.use_native_system,
-            selected_samples,
-            selected_properties,
-            selected_keys,
+        let systems = CSystemsIterator {
+            iterator: systems,
+            done: false,
         };
 
-        let tensor = (*calculator).compute(&mut systems, rust_options)?;
+        with_rust_options(&options, |rust_options| {
+            (*calculator).compute_chunks(systems, rust_options, memory_budget, move |first_system, systems_count, tensor| {
+                callback.call(first_system, systems_count, tensor)
+            })
+        })
+    })
+}
+
+/// Compute the per-system atomic composition of many systems stored as a
+/// single packed array of atomic types, without going through a calculator.
+///
+/// This gives the same counts as the `atomic_composition` calculator with
+/// `per_system=true`, stored in a single block with one `system` sample per
+/// system and one `center_type` property per atomic type. This is intended for
+/// dataset-wide statistics over many systems, where creating systems, keys and
+/// samples for the full calculator would dominate the cost.
+///
+/// This function allocates a new `mts_tensormap_t` in `*descriptor`, which
+/// memory needs to be released by the user with `mts_tensormap_free`.
+///
+/// @param descriptor pointer to an `mts_tensormap_t *` that will be allocated
+///                   by this function
+/// @param types atomic types of all atoms in all systems, one system after the
+///              other
+/// @param types_count number of entries in `types`
+/// @param system_offsets offset of the first atom of each system in `types`,
+///                       followed by `types_count`. This array must start with
+///                       0 and be sorted.
+/// @param system_offsets_count number of entries in `system_offsets`, i.e. the
+///                             number of systems + 1
+///
+/// @returns The status code of this operation. If the status is not
+///          `FEATOMIC_SUCCESS`, you can use `featomic_last_error()` to get the full
+///          error message.
+#[no_mangle]
+pub unsafe extern fn featomic_atomic_composition_packed(
+    descriptor: *mut *mut mts_tensormap_t,
+    types: *const i32,
+    types_count: usize,
+    system_offsets: *const usize,
+    system_offsets_count: usize,
+) -> featomic_status_t {
+    catch_unwind(move || {
+        check_pointers!(descriptor, system_offsets);
+
+        let types = if types_count == 0 {
+            &[]
+        } else {
+            check_pointers!(types);
+            std::slice::from_raw_parts(types, types_count)
+        };
+        let system_offsets = std::slice::from_raw_parts(system_offsets, system_offsets_count);
 
+        let tensor = AtomicComposition::compute_packed(types, system_offsets)?;
         *descriptor = TensorMap::into_raw(tensor);
         Ok(())
     })
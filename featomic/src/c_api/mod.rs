@@ -15,5 +15,6 @@ pub use self::logging::{featomic_logging_callback_t, featomic_set_logging_callba
 
 pub mod system;
 pub mod calculator;
+pub mod basis;
 
 pub mod profiling;
@@ -1,7 +1,10 @@
+use std::borrow::Cow;
 use std::os::raw::c_void;
 
+use once_cell::sync::OnceCell;
+
 use crate::types::{Vector3D, Matrix3};
-use crate::systems::{SimpleSystem, Pair, UnitCell};
+use crate::systems::{SimpleSystem, Pair, UnitCell, TypesSummary};
 use crate::{Error, System};
 
 use super::FEATOMIC_SYSTEM_ERROR;
@@ -60,6 +63,7 @@ pub struct featomic_pair_t {
 // Finally `extern` defaults to `extern "C"`, setting the ABI of the function to
 // the default C ABI on the current system.
 #[repr(C)]
+#[derive(Clone, Copy)]
 #[allow(non_camel_case_types)]
 pub struct featomic_system_t {
     /// User-provided data should be stored here, it will be passed as the
@@ -105,12 +109,20 @@ pub struct featomic_system_t {
     /// included both in the return of `pairs_containing(i)` and
     /// `pairs_containing(j)`.
     pairs_containing: Option<unsafe extern fn(user_data: *const c_void, atom: usize, pairs: *mut *const featomic_pair_t, count: *mut usize) -> featomic_status_t>,
+    /// This function should set `*local_size` to the number of local atoms in
+    /// this system. Atoms with index in `[0, local_size)` are local, and all
+    /// other atoms are ghosts: they are used as neighbors of the local atoms,
+    /// but no atom-centered sample is created for them. This function pointer
+    /// can be NULL, in which case all atoms are considered local.
+    local_size: Option<unsafe extern fn(user_data: *const c_void, local_size: *mut usize) -> featomic_status_t>,
 }
 
 unsafe impl Send for featomic_system_t {}
 unsafe impl Sync for featomic_system_t {}
 
-impl System for &mut featomic_system_t {
+// These functions mirror the `System` trait, which is implemented by
+// `CSystem` on top of them.
+impl featomic_system_t {
     fn size(&self) -> Result<usize, Error> {
         let function = self.size.ok_or_else(|| Error::External {
             status: FEATOMIC_SYSTEM_ERROR,
@@ -132,6 +144,38 @@ impl System for &mut featomic_system_t {
         return Ok(value);
     }
 
+    fn local_size(&self) -> Result<usize, Error> {
+        let function = match self.local_size {
+            Some(function) => function,
+            None => return self.size(),
+        };
+
+        let mut value = 0;
+        let status = unsafe {
+            function(self.user_data, &mut value)
+        };
+
+        if !status.is_success() {
+            return Err(Error::External {
+                status: status.as_i32(),
+                message: "call to featomic_system_t.local_size failed".into(),
+            });
+        }
+
+        let size = self.size()?;
+        if value > size {
+            return Err(Error::External {
+                status: FEATOMIC_SYSTEM_ERROR,
+                message: format!(
+                    "featomic_system_t.local_size returned {} which is larger than the number of atoms ({})",
+                    value, size
+                ),
+            });
+        }
+
+        return Ok(value);
+    }
+
     fn types(&self) -> Result<&[i32], Error> {
         let function = self.types.ok_or_else(|| Error::External {
             status: FEATOMIC_SYSTEM_ERROR,
@@ -317,6 +361,78 @@ impl System for &mut featomic_system_t {
     }
 }
 
+/// `System` implementation for a `featomic_system_t`, adding the summary of
+/// atomic types (see `System::types_summary`) which is not part of the C API.
+/// The summary is computed on first use after each change of cutoff, and then
+/// cached for all the keys and samples builders of a calculation.
+pub(super) struct CSystem {
+    system: featomic_system_t,
+    /// cutoff used in the last call to `compute_neighbors`
+    cutoff: Option<f64>,
+    types_summary: OnceCell<TypesSummary>,
+}
+
+impl CSystem {
+    pub(super) fn new(system: featomic_system_t) -> CSystem {
+        CSystem {
+            system: system,
+            cutoff: None,
+            types_summary: OnceCell::new(),
+        }
+    }
+}
+
+impl System for CSystem {
+    fn size(&self) -> Result<usize, Error> {
+        self.system.size()
+    }
+
+    fn local_size(&self) -> Result<usize, Error> {
+        self.system.local_size()
+    }
+
+    fn types(&self) -> Result<&[i32], Error> {
+        self.system.types()
+    }
+
+    fn positions(&self) -> Result<&[Vector3D], Error> {
+        self.system.positions()
+    }
+
+    fn cell(&self) -> Result<UnitCell, Error> {
+        self.system.cell()
+    }
+
+    #[allow(clippy::float_cmp)]
+    fn compute_neighbors(&mut self, cutoff: f64) -> Result<(), Error> {
+        self.system.compute_neighbors(cutoff)?;
+        if self.cutoff != Some(cutoff) {
+            self.cutoff = Some(cutoff);
+            self.types_summary = OnceCell::new();
+        }
+        Ok(())
+    }
+
+    fn pairs(&self) -> Result<&[Pair], Error> {
+        self.system.pairs()
+    }
+
+    fn pairs_containing(&self, atom: usize) -> Result<&[Pair], Error> {
+        self.system.pairs_containing(atom)
+    }
+
+    fn types_summary(&self) -> Result<Cow<'_, TypesSummary>, Error> {
+        if self.cutoff.is_none() {
+            return Err(Error::Internal("neighbor list is not initialized".into()));
+        }
+
+        let summary = self.types_summary.get_or_try_init(|| {
+            Ok::<_, Error>(TypesSummary::new(self.system.types()?, self.system.pairs()?))
+        })?;
+        Ok(Cow::Borrowed(summary))
+    }
+}
+
 /// Convert a Simple System to a `featomic_system_t`
 impl From<SimpleSystem> for featomic_system_t {
     fn from(system: SimpleSystem) -> featomic_system_t {
@@ -327,6 +443,13 @@ impl From<SimpleSystem> for featomic_system_t {
             })
         }
 
+        unsafe extern fn local_size(this: *const c_void, local_size: *mut usize) -> featomic_status_t {
+            catch_unwind(|| {
+                *local_size = (*this.cast::<SimpleSystem>()).local_size()?;
+                Ok(())
+            })
+        }
+
         unsafe extern fn types(this: *const c_void, types: *mut *const i32) -> featomic_status_t {
             catch_unwind(|| {
                 *types = (*this.cast::<SimpleSystem>()).types()?.as_ptr();
@@ -406,6 +529,51 @@ impl From<SimpleSystem> for featomic_system_t {
             compute_neighbors: Some(compute_neighbors),
             pairs: Some(pairs),
             pairs_containing: Some(pairs_containing),
+            local_size: Some(local_size),
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use crate::systems::test_utils::test_system;
+    use crate::systems::TypesSummary;
+    use crate::System;
+
+    use super::{featomic_system_t, CSystem};
+
+    #[test]
+    fn types_summary() {
+        let system = test_system("water");
+        let expected_types = system.types().unwrap().to_vec();
+
+        let mut system = CSystem::new(featomic_system_t::from(system));
+        assert!(system.types_summary().is_err());
+
+        system.compute_neighbors(2.0).unwrap();
+        let summary = system.types_summary().unwrap();
+        assert_eq!(*summary, TypesSummary::new(&expected_types, system.pairs().unwrap()));
+        assert!(summary.pairs.contains(&(1, 1)));
+
+        // the summary is updated when the cutoff changes
+        system.compute_neighbors(1.0).unwrap();
+        let summary = system.types_summary().unwrap();
+        assert_eq!(*summary, TypesSummary::new(&expected_types, system.pairs().unwrap()));
+        assert!(!summary.pairs.contains(&(1, 1)));
+    }
+
+    #[test]
+    fn null_local_size() {
+        let mut system = test_system("water");
+        system.set_local_size(1);
+
+        let system = CSystem::new(featomic_system_t::from(system));
+        assert_eq!(system.local_size().unwrap(), 1);
+
+        // systems created without setting `local_size` only have local atoms
+        let mut system = featomic_system_t::from(test_system("water"));
+        system.local_size = None;
+        let system = CSystem::new(system);
+        assert_eq!(system.local_size().unwrap(), 3);
+    }
+}
@@ -0,0 +1,720 @@
+use std::collections::{BTreeMap, BTreeSet, HashMap, VecDeque};
+use std::sync::Arc;
+
+use indexmap::IndexMap;
+use ndarray::{ArrayD, Axis};
+
+use metatensor::{Labels, LabelsBuilder, LabelValue};
+use metatensor::{TensorBlock, TensorBlockRef, TensorMap};
+
+use crate::{Calculator, CalculationOptions, LabelsSelection};
+use crate::{Error, System};
+use crate::systems::{SimpleSystem, UnitCell};
+
+/// Data for a single gradient of a cached block
+struct CachedGradient {
+    parameter: String,
+    sample_names: Vec<String>,
+    /// gradient samples, with the `"sample"` dimension relative to the samples
+    /// of this system only
+    samples: Vec<Vec<LabelValue>>,
+    components: Vec<Labels>,
+    values: ArrayD<f64>,
+}
+
+/// Data for one block of a cached descriptor, restricted to a single system
+struct CachedBlock {
+    sample_names: Vec<String>,
+    /// position of the `"system"` dimension in `sample_names`
+    system_dimension: usize,
+    /// samples for this system, the `"system"` dimension is re-written when
+    /// assembling the full descriptor
+    samples: Vec<Vec<LabelValue>>,
+    components: Vec<Labels>,
+    properties: Labels,
+    values: ArrayD<f64>,
+    gradients: Vec<CachedGradient>,
+}
+
+/// Full key of a cache entry: all the data that can change the descriptor of
+/// a single system. Entries are looked up by hash and then compared with the
+/// full key, so hash collisions can not return the descriptor of another
+/// system.
+#[derive(Clone, PartialEq, Eq, Hash)]
+struct CacheKey {
+    /// calculator name & parameters, and the sorted list of gradients. This is
+    /// shared by all the systems in a single call to `DescriptorCache::compute`
+    calculator: Arc<(String, String, Vec<String>)>,
+    types: Vec<i32>,
+    /// bit patterns of the positions and cell, to compare them exactly
+    positions: Vec<[u64; 3]>,
+    cell: [[u64; 3]; 3],
+    local_size: usize,
+}
+
+impl CacheKey {
+    fn new(calculator: &Arc<(String, String, Vec<String>)>, system: &dyn System) -> Result<CacheKey, Error> {
+        let positions = system.positions()?.iter()
+            .map(|position| [position[0].to_bits(), position[1].to_bits(), position[2].to_bits()])
+            .collect();
+
+        let matrix = system.cell()?.matrix();
+        let mut cell = [[0; 3]; 3];
+        for (row, matrix_row) in cell.iter_mut().zip(matrix.iter()) {
+            for (value, matrix_value) in row.iter_mut().zip(matrix_row) {
+                *value = matrix_value.to_bits();
+            }
+        }
+
+        return Ok(CacheKey {
+            calculator: Arc::clone(calculator),
+            types: system.types()?.to_vec(),
+            positions: positions,
+            cell: cell,
+            local_size: system.local_size()?,
+        });
+    }
+}
+
+/// Descriptor for a single system, stored in the cache
+struct CachedDescriptor {
+    key_names: Vec<String>,
+    /// non-empty blocks for this system, indexed by key
+    blocks: BTreeMap<Vec<i32>, CachedBlock>,
+}
+
+/// Entry in the cache, with the generation of its last use
+struct CacheEntry {
+    descriptor: Arc<CachedDescriptor>,
+    last_use: u64,
+}
+
+/// In-memory cache of per-system descriptors, sitting in front of
+/// `Calculator::compute`.
+///
+/// Descriptors are stored for each system separately, indexed by the system
+/// (atomic types, positions, cell and number of local atoms), the calculator
+/// (name and parameters) and the requested gradients. When calling
+/// `DescriptorCache::compute`, only the systems which are not already in the
+/// cache are sent to the calculator, and the full descriptor is assembled from
+/// the per-system data. This is intended for workflows that compute the same
+/// descriptor for the same systems multiple times, for example when training a
+/// model over multiple epochs.
+///
+/// The cache keeps at most `capacity` systems, evicting the least recently
+/// used ones first. Finding, updating and evicting entries takes (amortized)
+/// constant time, independently of the capacity.
+///
+/// The assembled descriptor only contains blocks for the keys with at least
+/// one sample in the systems, and the keys are sorted. Selection of samples,
+/// properties or keys in the calculation options is not supported.
+pub struct DescriptorCache {
+    capacity: usize,
+    entries: HashMap<Arc<CacheKey>, CacheEntry>,
+    /// Uses of the entries, from the oldest to the most recent. The same key
+    /// can appear multiple times, only the use with the same generation as
+    /// `CacheEntry::last_use` is current, and the other ones are skipped when
+    /// evicting entries.
+    uses: VecDeque<(u64, Arc<CacheKey>)>,
+    /// generation of the most recent use
+    generation: u64,
+}
+
+impl std::fmt::Debug for DescriptorCache {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("DescriptorCache")
+            .field("capacity", &self.capacity)
+            .field("len", &self.entries.len())
+            .finish()
+    }
+}
+
+impl DescriptorCache {
+    /// Create a new empty cache, containing at most `capacity` systems
+    pub fn new(capacity: usize) -> DescriptorCache {
+        DescriptorCache {
+            capacity: capacity,
+            entries: HashMap::new(),
+            uses: VecDeque::new(),
+            generation: 0,
+        }
+    }
+
+    /// Get the number of systems currently stored in this cache
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    /// Check if this cache is empty
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Remove all entries from this cache
+    pub fn clear(&mut self) {
+        self.entries.clear();
+        self.uses.clear();
+    }
+
+    /// Record a new use of the entry with the given `key`, returning the
+    /// corresponding generation
+    fn record_use(&mut self, key: &Arc<CacheKey>) -> u64 {
+        self.generation += 1;
+        self.uses.push_back((self.generation, Arc::clone(key)));
+        return self.generation;
+    }
+
+    /// Remove the least recently used entry from the cache
+    fn evict_oldest(&mut self) {
+        while let Some((generation, key)) = self.uses.pop_front() {
+            if self.entries.get(&*key).is_some_and(|entry| entry.last_use == generation) {
+                self.entries.remove(&*key);
+                return;
+            }
+        }
+    }
+
+    /// Remove outdated uses, to keep the size of `uses` proportional to the
+    /// number of entries. This is amortized over the calls to `record_use`.
+    fn compact_uses(&mut self) {
+        if self.uses.len() <= 2 * self.entries.len() + 16 {
+            return;
+        }
+
+        let entries = &self.entries;
+        self.uses.retain(|(generation, key)| {
+            entries.get(&**key).is_some_and(|entry| entry.last_use == *generation)
+        });
+    }
+
+    /// Compute the descriptor for all the given `systems` with `calculator`,
+    /// re-using the data from previous calls for the systems already in the
+    /// cache.
+    pub fn compute(
+        &mut self,
+        calculator: &Calculator,
+        systems: &mut [Box<dyn System>],
+        options: CalculationOptions,
+    ) -> Result<TensorMap, Error> {
+        if !matches!(options.selected_samples, LabelsSelection::All) ||
+           !matches!(options.selected_properties, LabelsSelection::All) ||
+           options.selected_keys.is_some() {
+            return Err(Error::InvalidParameter(
+                "selection of samples, properties or keys is not supported with DescriptorCache".into()
+            ));
+        }
+
+        if systems.is_empty() {
+            return calculator.compute(systems, options);
+        }
+
+        let mut gradients = options.gradients.iter().map(|&g| g.to_owned()).collect::<Vec<_>>();
+        gradients.sort_unstable();
+        let calculator_key = Arc::new((calculator.name(), calculator.parameters().to_owned(), gradients));
+
+        let cache_keys = systems.iter()
+            .map(|system| CacheKey::new(&calculator_key, &**system).map(Arc::new))
+            .collect::<Result<Vec<_>, Error>>()?;
+
+        let mut descriptors = vec![None; systems.len()];
+        // index of the first system with a given key not in the cache
+        let mut missing = IndexMap::new();
+        for (system_i, cache_key) in cache_keys.iter().enumerate() {
+            if self.entries.contains_key(&**cache_key) {
+                // make this entry the most recently used
+                let generation = self.record_use(cache_key);
+                let entry = self.entries.get_mut(&**cache_key).expect("missing entry");
+                entry.last_use = generation;
+                descriptors[system_i] = Some(Arc::clone(&entry.descriptor));
+            } else {
+                missing.entry(cache_key).or_insert(system_i);
+            }
+        }
+
+        if !missing.is_empty() {
+            let missing_systems = missing.values().copied().collect::<Vec<_>>();
+            let computed = compute_missing(calculator, systems, &missing_systems, options)?;
+
+            let mut new_entries = HashMap::new();
+            for (&cache_key, descriptor) in missing.keys().zip(computed) {
+                let descriptor = Arc::new(descriptor);
+                new_entries.insert(cache_key, Arc::clone(&descriptor));
+
+                if self.capacity > 0 {
+                    if self.entries.len() >= self.capacity {
+                        self.evict_oldest();
+                    }
+                    let generation = self.record_use(cache_key);
+                    self.entries.insert(Arc::clone(cache_key), CacheEntry {
+                        descriptor: descriptor,
+                        last_use: generation,
+                    });
+                }
+            }
+
+            for (system_i, cache_key) in cache_keys.iter().enumerate() {
+                if descriptors[system_i].is_none() {
+                    descriptors[system_i] = Some(Arc::clone(&new_entries[cache_key]));
+                }
+            }
+        }
+
+        self.compact_uses();
+
+        let descriptors = descriptors.into_iter()
+            .map(|descriptor| descriptor.expect("missing descriptor"))
+            .collect::<Vec<_>>();
+
+        return assemble(&descriptors, options.gradients);
+    }
+}
+
+/// Compute the descriptor for the systems at the indexes in `missing`, and
+/// split it into one `CachedDescriptor` per system
+fn compute_missing(
+    calculator: &Calculator,
+    systems: &mut [Box<dyn System>],
+    missing: &[usize],
+    options: CalculationOptions,
+) -> Result<Vec<CachedDescriptor>, Error> {
+    let tensor = if missing.len() == systems.len() {
+        calculator.compute(systems, options)
+    } else {
+        // temporarily move the systems to compute out of the slice, to avoid
+        // copying them
+        let mut missing_systems = missing.iter().map(|&system_i| {
+            let placeholder = Box::new(SimpleSystem::new(UnitCell::infinite())) as Box<dyn System>;
+            std::mem::replace(&mut systems[system_i], placeholder)
+        }).collect::<Vec<_>>();
+
+        let tensor = calculator.compute(&mut missing_systems, options);
+
+        for (&system_i, system) in missing.iter().zip(missing_systems) {
+            systems[system_i] = system;
+        }
+
+        tensor
+    }?;
+
+    return split_by_system(&tensor, missing.len(), options.gradients);
+}
+
+/// Split `tensor` into per-system descriptors, only keeping non-empty blocks
+fn split_by_system(tensor: &TensorMap, n_systems: usize, gradients: &[&str]) -> Result<Vec<CachedDescriptor>, Error> {
+    let key_names = tensor.keys().names().iter().map(|&name| name.to_owned()).collect::<Vec<_>>();
+    let mut descriptors = (0..n_systems).map(|_| CachedDescriptor {
+        key_names: key_names.clone(),
+        blocks: BTreeMap::new(),
+    }).collect::<Vec<_>>();
+
+    for (key, block) in tensor.keys().iter().zip(tensor.blocks()) {
+        let samples = block.samples();
+        let system_dimension = samples.names().iter().position(|&name| name == "system").ok_or_else(|| {
+            Error::InvalidParameter(format!(
+                "DescriptorCache requires a \"system\" dimension in the samples, got [{}]",
+                samples.names().join(", ")
+            ))
+        })?;
+
+        let mut rows_per_system = vec![Vec::new(); n_systems];
+        let mut sample_indexes = vec![Vec::new(); n_systems];
+        // system and position in the rows of this system for each sample
+        let mut sample_systems = Vec::with_capacity(samples.count());
+        let mut local_row = Vec::with_capacity(samples.count());
+        for (sample_i, sample) in samples.iter().enumerate() {
+            let system_i = sample[system_dimension].usize();
+            sample_systems.push(system_i);
+            local_row.push(rows_per_system[system_i].len());
+            rows_per_system[system_i].push(sample.to_vec());
+            sample_indexes[system_i].push(sample_i);
+        }
+
+        let mut gradients_per_system = (0..n_systems).map(|_| Vec::new()).collect::<Vec<_>>();
+        for &parameter in gradients {
+            if let Some(gradient) = block.gradient(parameter) {
+                let split = split_gradient(parameter, &gradient, &sample_systems, &local_row, &rows_per_system)?;
+                for (system_gradients, cached) in gradients_per_system.iter_mut().zip(split) {
+                    system_gradients.extend(cached);
+                }
+            }
+        }
+
+        let values = block.values().to_array();
+        let per_system = rows_per_system.into_iter().zip(&sample_indexes).zip(gradients_per_system);
+        for (system_i, ((rows, indexes), gradients)) in per_system.enumerate() {
+            if rows.is_empty() {
+                continue;
+            }
+
+            let cached = CachedBlock {
+                sample_names: samples.names().iter().map(|&name| name.to_owned()).collect(),
+                system_dimension: system_dimension,
+                samples: rows,
+                components: block.components(),
+                properties: block.properties(),
+                values: values.select(Axis(0), indexes),
+                gradients: gradients,
+            };
+
+            descriptors[system_i].blocks.insert(key.iter().map(|value| value.i32()).collect(), cached);
+        }
+    }
+
+    return Ok(descriptors);
+}
+
+/// Split the rows of `gradient` by system, in a single pass over the gradient
+/// samples. The output contains one entry per system, which is `None` for
+/// systems without samples in this block.
+fn split_gradient(
+    parameter: &str,
+    gradient: &TensorBlockRef<'_>,
+    sample_systems: &[usize],
+    local_row: &[usize],
+    rows_per_system: &[Vec<Vec<LabelValue>>],
+) -> Result<Vec<Option<CachedGradient>>, Error> {
+    let gradient_samples = gradient.samples();
+    if gradient_samples.names().first() != Some(&"sample") {
+        return Err(Error::Internal(format!(
+            "expected \"sample\" as the first dimension of {} gradient samples", parameter
+        )));
+    }
+
+    let n_systems = rows_per_system.len();
+    let mut rows = vec![Vec::new(); n_systems];
+    let mut indexes = vec![Vec::new(); n_systems];
+    for (gradient_sample_i, gradient_sample) in gradient_samples.iter().enumerate() {
+        let sample_i = gradient_sample[0].usize();
+        let system_i = sample_systems[sample_i];
+
+        let mut row = gradient_sample.to_vec();
+        row[0] = local_row[sample_i].into();
+        rows[system_i].push(row);
+        indexes[system_i].push(gradient_sample_i);
+    }
+
+    let sample_names = gradient_samples.names().iter().map(|&name| name.to_owned()).collect::<Vec<_>>();
+    let values = gradient.values().to_array();
+
+    let split = rows.into_iter().zip(indexes).zip(rows_per_system).map(|((rows, indexes), samples)| {
+        if samples.is_empty() {
+            return None;
+        }
+
+        return Some(CachedGradient {
+            parameter: parameter.to_owned(),
+            sample_names: sample_names.clone(),
+            samples: rows,
+            components: gradient.components(),
+            values: values.select(Axis(0), &indexes),
+        });
+    }).collect();
+
+    return Ok(split);
+}
+
+/// Assemble the full descriptor from the per-system `descriptors`
+fn assemble(descriptors: &[Arc<CachedDescriptor>], gradients: &[&str]) -> Result<TensorMap, Error> {
+    let key_names = &descriptors[0].key_names;
+    if descriptors.iter().any(|descriptor| &descriptor.key_names != key_names) {
+        return Err(Error::Internal("cached descriptors have different key names".into()));
+    }
+
+    let all_keys = descriptors.iter()
+        .flat_map(|descriptor| descriptor.blocks.keys())
+        .collect::<BTreeSet<_>>();
+
+    let mut keys = LabelsBuilder::new(key_names.iter().map(|name| &**name).collect());
+    let mut blocks = Vec::new();
+    for key in all_keys {
+        keys.add(key);
+
+        let parts = descriptors.iter().enumerate()
+            .filter_map(|(system_i, descriptor)| descriptor.blocks.get(key).map(|block| (system_i, block)))
+            .collect::<Vec<_>>();
+
+        let first = parts[0].1;
+        for (_, block) in &parts {
+            if block.sample_names != first.sample_names || block.components != first.components || block.properties != first.properties {
+                return Err(Error::Internal(
+                    "cached descriptors have different samples names, components or properties for the same key".into()
+                ));
+            }
+        }
+
+        let mut samples = LabelsBuilder::new(first.sample_names.iter().map(|name| &**name).collect());
+        for &(system_i, block) in &parts {
+            for sample in &block.samples {
+                let mut sample = sample.clone();
+                sample[first.system_dimension] = system_i.into();
+                samples.add(&sample);
+            }
+        }
+        let samples = samples.finish();
+
+        let values = concatenate(parts.iter().map(|(_, block)| &block.values))?;
+        let mut new_block = TensorBlock::new(values, &samples, &first.components, &first.properties)?;
+
+        for &parameter in gradients {
+            let gradient_parts = parts.iter()
+                .map(|&(system_i, block)| {
+                    let gradient = block.gradients.iter().find(|gradient| gradient.parameter == parameter);
+                    (system_i, block.samples.len(), gradient)
+                })
+                .collect::<Vec<_>>();
+
+            let first_gradient = match gradient_parts[0].2 {
+                Some(gradient) => gradient,
+                None => continue,
+            };
+
+            let system_dimension = first_gradient.sample_names.iter().position(|name| name == "system");
+            let mut gradient_samples = LabelsBuilder::new(
+                first_gradient.sample_names.iter().map(|name| &**name).collect()
+            );
+            let mut gradient_values = Vec::new();
+            let mut samples_offset = 0;
+            for (system_i, n_samples, gradient) in gradient_parts {
+                let gradient = gradient.ok_or_else(|| Error::Internal(format!(
+                    "missing {} gradients in cached descriptor", parameter
+                )))?;
+
+                for sample in &gradient.samples {
+                    let mut sample = sample.clone();
+                    sample[0] = (sample[0].usize() + samples_offset).into();
+                    if let Some(dimension) = system_dimension {
+                        sample[dimension] = system_i.into();
+                    }
+                    gradient_samples.add(&sample);
+                }
+                gradient_values.push(&gradient.values);
+                samples_offset += n_samples;
+            }
+
+            new_block.add_gradient(parameter, TensorBlock::new(
+                concatenate(gradient_values.into_iter())?,
+                &gradient_samples.finish(),
+                &first_gradient.components,
+                &first.properties,
+            )?)?;
+        }
+
+        blocks.push(new_block);
+    }
+
+    return Ok(TensorMap::new(keys.finish(), blocks)?);
+}
+
+fn concatenate<'a>(arrays: impl Iterator<Item=&'a ArrayD<f64>>) -> Result<ArrayD<f64>, Error> {
+    let views = arrays.map(|array| array.view()).collect::<Vec<_>>();
+    return ndarray::concatenate(Axis(0), &views).map_err(|e| Error::Internal(format!(
+        "failed to assemble cached descriptor: {}", e
+    )));
+}
+
+#[cfg(test)]
+mod tests {
+    use approx::assert_relative_eq;
+    use ndarray::Axis;
+    use metatensor::{Labels, TensorBlock, TensorMap};
+
+    use crate::Calculator;
+    use crate::calculators::CalculatorBase;
+    use crate::calculators::{DummyCalculator, NeighborList};
+    use crate::System;
+    use crate::systems::test_utils::{test_system, test_systems};
+
+    use std::sync::Arc;
+
+    use super::{CacheKey, DescriptorCache, split_by_system};
+
+    fn calculator() -> Calculator {
+        Calculator::from(Box::new(DummyCalculator{
+            cutoff: 1.5,
+            delta: 3,
+            name: String::new(),
+        }) as Box<dyn CalculatorBase>)
+    }
+
+    fn assert_same_descriptor(expected: &TensorMap, actual: &TensorMap) {
+        assert_eq!(expected.keys(), actual.keys());
+        for (expected, actual) in expected.blocks().iter().zip(actual.blocks()) {
+            assert_eq!(expected.samples(), actual.samples());
+            assert_eq!(expected.properties(), actual.properties());
+            assert_relative_eq!(expected.values().to_array(), actual.values().to_array());
+
+            let expected = expected.gradient("positions").unwrap();
+            let actual = actual.gradient("positions").unwrap();
+            assert_eq!(expected.samples(), actual.samples());
+            assert_relative_eq!(expected.values().to_array(), actual.values().to_array());
+        }
+    }
+
+    #[test]
+    fn cached_compute() {
+        let calculator = calculator();
+        let mut cache = DescriptorCache::new(10);
+        let options = crate::CalculationOptions {
+            gradients: &["positions"],
+            ..Default::default()
+        };
+
+        let mut systems = test_systems(&["water"]);
+        let descriptor = cache.compute(&calculator, &mut systems, options).unwrap();
+        let expected = calculator.compute(&mut systems, options).unwrap();
+        assert_same_descriptor(&expected, &descriptor);
+        assert_eq!(cache.len(), 1);
+
+        // mix of cached and new systems
+        let mut systems = test_systems(&["CH", "water", "methane"]);
+        let descriptor = cache.compute(&calculator, &mut systems, options).unwrap();
+        let expected = calculator.compute(&mut systems, options).unwrap();
+        assert_same_descriptor(&expected, &descriptor);
+        assert_eq!(cache.len(), 3);
+
+        // everything is cached
+        let descriptor = cache.compute(&calculator, &mut systems, options).unwrap();
+        assert_same_descriptor(&expected, &descriptor);
+        assert_eq!(cache.len(), 3);
+
+        // different options use different entries
+        cache.compute(&calculator, &mut systems, Default::default()).unwrap();
+        assert_eq!(cache.len(), 6);
+    }
+
+    #[test]
+    fn local_size() {
+        let calculator = calculator();
+        let mut cache = DescriptorCache::new(10);
+
+        let mut systems = test_systems(&["water"]);
+        cache.compute(&calculator, &mut systems, Default::default()).unwrap();
+        assert_eq!(cache.len(), 1);
+
+        // same atoms, but with ghosts: this is a different entry
+        let mut water = test_system("water");
+        water.set_local_size(2);
+        let mut systems = vec![Box::new(water) as Box<dyn System>];
+        let descriptor = cache.compute(&calculator, &mut systems, Default::default()).unwrap();
+        let expected = calculator.compute(&mut systems, Default::default()).unwrap();
+        assert_eq!(cache.len(), 2);
+
+        assert_eq!(expected.keys(), descriptor.keys());
+        for (expected, actual) in expected.blocks().iter().zip(descriptor.blocks()) {
+            assert_eq!(expected.samples(), actual.samples());
+        }
+    }
+
+    #[test]
+    fn system_not_first() {
+        // the single block neighbor list has the atomic types before the
+        // "system" dimension in the samples
+        let calculator = Calculator::from(Box::new(NeighborList {
+            cutoff: 2.0,
+            full_neighbor_list: false,
+            self_pairs: false,
+            single_block: true,
+        }) as Box<dyn CalculatorBase>);
+        let options = crate::CalculationOptions {
+            gradients: &["positions"],
+            ..Default::default()
+        };
+
+        let mut cache = DescriptorCache::new(10);
+        let mut systems = test_systems(&["water"]);
+        cache.compute(&calculator, &mut systems, options).unwrap();
+
+        let mut systems = test_systems(&["methane", "water"]);
+        let descriptor = cache.compute(&calculator, &mut systems, options).unwrap();
+        let expected = calculator.compute(&mut systems, options).unwrap();
+
+        // the samples are grouped by system in the cached descriptor, so we
+        // compare them one by one
+        assert_eq!(expected.keys(), descriptor.keys());
+        let expected = expected.block_by_id(0);
+        let actual = descriptor.block_by_id(0);
+
+        let expected_samples = expected.samples();
+        let actual_samples = actual.samples();
+        assert_eq!(expected_samples.names(), actual_samples.names());
+        assert_eq!(expected_samples.count(), actual_samples.count());
+
+        let expected_values = expected.values().to_array();
+        let actual_values = actual.values().to_array();
+        for (expected_i, sample) in expected_samples.iter().enumerate() {
+            let actual_i = actual_samples.position(sample).expect("missing sample");
+            assert_relative_eq!(
+                expected_values.index_axis(Axis(0), expected_i),
+                actual_values.index_axis(Axis(0), actual_i)
+            );
+        }
+
+        let expected_gradient = expected.gradient("positions").unwrap();
+        let actual_gradient = actual.gradient("positions").unwrap();
+        assert_eq!(expected_gradient.samples().count(), actual_gradient.samples().count());
+    }
+
+    #[test]
+    fn missing_system_dimension() {
+        let block = TensorBlock::new(
+            ndarray::ArrayD::<f64>::zeros(vec![1, 1]),
+            &Labels::new(["structure", "atom"], &[[0, 0]]),
+            &[],
+            &Labels::new(["property"], &[[0]]),
+        ).unwrap();
+        let tensor = TensorMap::new(Labels::new(["key"], &[[0]]), vec![block]).unwrap();
+
+        let error = split_by_system(&tensor, 1, &[]).err().unwrap();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: DescriptorCache requires a \"system\" dimension in the samples, got [structure, atom]"
+        );
+    }
+
+    #[test]
+    fn eviction() {
+        let calculator = calculator();
+        let mut cache = DescriptorCache::new(2);
+
+        let mut systems = test_systems(&["CH", "water", "methane"]);
+        cache.compute(&calculator, &mut systems, Default::default()).unwrap();
+        assert_eq!(cache.len(), 2);
+
+        cache.clear();
+        assert!(cache.is_empty());
+    }
+
+    #[test]
+    fn least_recently_used() {
+        let calculator = calculator();
+        let mut cache = DescriptorCache::new(2);
+
+        let contains = |cache: &DescriptorCache, name: &str| {
+            let calculator_key = Arc::new((calculator.name(), calculator.parameters().to_owned(), Vec::new()));
+            let key = CacheKey::new(&calculator_key, &test_system(name)).unwrap();
+            cache.entries.contains_key(&key)
+        };
+
+        cache.compute(&calculator, &mut test_systems(&["CH"]), Default::default()).unwrap();
+        cache.compute(&calculator, &mut test_systems(&["water"]), Default::default()).unwrap();
+
+        // using CH again makes water the least recently used entry
+        cache.compute(&calculator, &mut test_systems(&["CH"]), Default::default()).unwrap();
+        cache.compute(&calculator, &mut test_systems(&["methane"]), Default::default()).unwrap();
+        assert_eq!(cache.len(), 2);
+        assert!(contains(&cache, "CH"));
+        assert!(contains(&cache, "methane"));
+        assert!(!contains(&cache, "water"));
+
+        // repeated hits do not grow the list of uses without bounds
+        for _ in 0..100 {
+            cache.compute(&calculator, &mut test_systems(&["methane", "CH"]), Default::default()).unwrap();
+        }
+        assert!(cache.uses.len() <= 2 * cache.entries.len() + 16);
+
+        cache.compute(&calculator, &mut test_systems(&["water"]), Default::default()).unwrap();
+        assert!(contains(&cache, "CH"));
+        assert!(!contains(&cache, "methane"));
+        assert!(contains(&cache, "water"));
+    }
+}
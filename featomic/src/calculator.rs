@@ -1,12 +1,14 @@
-use std::collections::BTreeMap;
+use std::collections::{BTreeMap, BTreeSet};
+use std::sync::Mutex;
 
 use log::warn;
 use metatensor::c_api::MTS_INVALID_PARAMETER_ERROR;
 use once_cell::sync::Lazy;
 
-use metatensor::{Labels, LabelsBuilder};
+use metatensor::{Labels, LabelsBuilder, LabelValue};
 use metatensor::{TensorBlockRef, TensorBlock, TensorMap};
-use ndarray::ArrayD;
+use ndarray::{ArrayD, Axis};
+use rayon::prelude::*;
 
 use crate::{System, Error};
 use crate::systems::SimpleSystem;
@@ -103,7 +105,9 @@ impl LabelsSelection<'_> {
                     for entry in matches {
                         builder.add(&labels[entry as usize]);
                     }
-                    results.push(builder.finish());
+                    // SAFETY: `matches` contains unique indexes into `labels`,
+                    // which itself only contains unique entries
+                    results.push(unsafe { builder.finish_assume_unique() });
                 }
 
                 return Ok(results);
@@ -284,7 +288,7 @@ impl Calculator {
     }
 
     #[time_graph::instrument(name="Calculator::prepare")]
-    fn prepare(&mut self, systems: &mut [Box<dyn System>], options: CalculationOptions) -> Result<TensorMap, Error> {
+    fn prepare(&self, systems: &mut [Box<dyn System>], options: CalculationOptions) -> Result<TensorMap, Error> {
         let default_keys = self.implementation.keys(systems)?;
 
         let keys = match options.selected_keys {
@@ -301,7 +305,9 @@ impl Calculator {
                     for entry in matches {
                         builder.add(&default_keys[entry as usize]);
                     }
-                    builder.finish()
+                    // SAFETY: `matches` contains unique indexes into
+                    // `default_keys`, which itself only contains unique entries
+                    unsafe { builder.finish_assume_unique() }
                 }
             }
             None => default_keys,
@@ -357,14 +363,9 @@ impl Calculator {
                 );
             }
 
-            let mut cell_gradient_samples = Vec::new();
-            for samples in &samples {
-                let mut builder = LabelsBuilder::new(vec!["sample"]);
-                for sample_i in 0..samples.count() {
-                    builder.add(&[sample_i]);
-                }
-                cell_gradient_samples.push(builder.finish());
-            }
+            let cell_gradient_samples = samples.iter()
+                .map(|samples| range_gradient_samples(samples.count()))
+                .collect::<Vec<_>>();
             Some(cell_gradient_samples)
         } else {
             None
@@ -378,14 +379,9 @@ impl Calculator {
                 )));
             }
 
-            let mut strain_gradient_samples = Vec::new();
-            for samples in &samples {
-                let mut builder = LabelsBuilder::new(vec!["sample"]);
-                for sample_i in 0..samples.count() {
-                    builder.add(&[sample_i]);
-                }
-                strain_gradient_samples.push(builder.finish());
-            }
+            let strain_gradient_samples = samples.iter()
+                .map(|samples| range_gradient_samples(samples.count()))
+                .collect::<Vec<_>>();
             Some(strain_gradient_samples)
         } else {
             None
@@ -406,11 +402,6 @@ impl Calculator {
         assert_eq!(keys.count(), components.len());
         assert_eq!(keys.count(), properties.len());
 
-        let xyz = Labels::new(["xyz"], &[[0], [1], [2]]);
-        let abc = Labels::new(["abc"], &[[0], [1], [2]]);
-        let xyz_1 = Labels::new(["xyz_1"], &[[0], [1], [2]]);
-        let xyz_2 = Labels::new(["xyz_2"], &[[0], [1], [2]]);
-
         let mut blocks = Vec::new();
         for (block_i, ((samples, components), properties)) in samples.into_iter().zip(components).zip(properties).enumerate() {
             let shape = shape_from_labels(
@@ -429,7 +420,7 @@ impl Calculator {
 
                 // add the x/y/z component for gradients
                 let mut components = components.clone();
-                components.insert(0, xyz.clone());
+                components.insert(0, XYZ_COMPONENT.clone());
                 let shape = shape_from_labels(
                     gradient_samples, &components, &properties
                 );
@@ -450,8 +441,8 @@ impl Calculator {
 
                 // add the components for cell gradients
                 let mut components = components.clone();
-                components.insert(0, abc.clone());
-                components.insert(0, xyz.clone());
+                components.insert(0, ABC_COMPONENT.clone());
+                components.insert(0, XYZ_COMPONENT.clone());
                 let shape = shape_from_labels(
                     gradient_samples, &components, &properties
                 );
@@ -472,8 +463,8 @@ impl Calculator {
 
                 // add the components for strain gradients
                 let mut components = components;
-                components.insert(0, xyz_1.clone());
-                components.insert(0, xyz_2.clone());
+                components.insert(0, XYZ_1_COMPONENT.clone());
+                components.insert(0, XYZ_2_COMPONENT.clone());
                 let shape = shape_from_labels(
                     gradient_samples, &components, &properties
                 );
@@ -500,8 +491,12 @@ impl Calculator {
     ///
     /// This function computes the full descriptor, using all samples and all
     /// features.
+    ///
+    /// `Calculator` is `Sync`, and this function can be called concurrently
+    /// from multiple threads with the same calculator, sharing the
+    /// pre-computed data (splines, etc.) between all calculations.
     pub fn compute(
-        &mut self,
+        &self,
         systems: &mut [Box<dyn System>],
         options: CalculationOptions,
     ) -> Result<TensorMap, Error> {
@@ -524,6 +519,519 @@ impl Calculator {
 
         return Ok(tensor);
     }
+
+    /// Compute the descriptors of all `calculators` for the same `systems`,
+    /// sharing the neighbor lists between calculators when possible. This
+    /// returns one `TensorMap` for each calculator, in the same order as
+    /// `calculators`. The same `options` are used for all calculators.
+    ///
+    /// Compared to calling `compute` for each calculator, the systems are
+    /// converted to `SimpleSystem` at most once (if `options.use_native_system`
+    /// is set), and the calculators are grouped by cutoffs. For groups using a
+    /// single cutoff, the neighbor lists are computed once (in parallel over the
+    /// systems) and shared by all the calculators in the group. Systems only
+    /// keep the neighbor list for the last cutoff, so calculators using multiple
+    /// cutoffs compute their own neighbor lists. Calculators with the same name
+    /// and parameters are only run once, the other descriptors are copies of
+    /// the first one.
+    ///
+    /// Everything else is still computed separately by each calculator,
+    /// including labels and pair contributions. In particular, SOAP
+    /// calculators which only differ by their density scaling or
+    /// `center_atom_weight` each evaluate the radial integral and spherical
+    /// harmonics for all pairs, even if these only depend on the cutoff and
+    /// basis.
+    pub fn compute_many(
+        calculators: &[&Calculator],
+        systems: &mut [Box<dyn System>],
+        options: CalculationOptions,
+    ) -> Result<Vec<TensorMap>, Error> {
+        let mut native_systems;
+        let systems = if options.use_native_system {
+            native_systems = Vec::with_capacity(systems.len());
+            for system in systems {
+                native_systems.push(Box::new(SimpleSystem::try_from(&**system)?) as Box<dyn System>);
+            }
+            &mut native_systems
+        } else {
+            systems
+        };
+
+        let options = CalculationOptions {
+            use_native_system: false,
+            ..options
+        };
+
+        // group the calculators using the same cutoffs, to only compute the
+        // neighbor lists once per group
+        let mut groups: Vec<(&[f64], Vec<usize>)> = Vec::new();
+        for (calculator_i, calculator) in calculators.iter().enumerate() {
+            let cutoffs = calculator.cutoffs();
+            match groups.iter_mut().find(|(group_cutoffs, _)| *group_cutoffs == cutoffs) {
+                Some((_, members)) => members.push(calculator_i),
+                None => groups.push((cutoffs, vec![calculator_i])),
+            }
+        }
+
+        let mut descriptors = calculators.iter().map(|_| None).collect::<Vec<Option<TensorMap>>>();
+        for (cutoffs, members) in groups {
+            // systems only store the neighbors for a single cutoff, so there
+            // is nothing to share for calculators using multiple cutoffs
+            if let &[cutoff] = cutoffs {
+                systems.par_iter_mut().try_for_each(|system| system.compute_neighbors(cutoff))?;
+            }
+
+            for (position, &calculator_i) in members.iter().enumerate() {
+                let calculator = calculators[calculator_i];
+
+                // identical calculators always have the same cutoffs, so they
+                // are in the same group
+                let duplicate = members[..position].iter().copied().find(|&other_i| {
+                    let other = calculators[other_i];
+                    other.parameters() == calculator.parameters() && other.name() == calculator.name()
+                });
+
+                let descriptor = match duplicate {
+                    Some(other_i) => {
+                        descriptors[other_i].as_ref().expect("missing descriptor").try_clone()?
+                    }
+                    None => calculator.compute(systems, options)?,
+                };
+                descriptors[calculator_i] = Some(descriptor);
+            }
+        }
+
+        return Ok(descriptors.into_iter().map(|descriptor| descriptor.expect("missing descriptor")).collect());
+    }
+
+    /// Compute the descriptor for all the systems produced by the `systems`
+    /// iterator, splitting them in chunks to keep the memory used by each
+    /// chunk's descriptor around `memory_budget` bytes.
+    ///
+    /// The size of the chunks is adjusted as the calculation progresses, using
+    /// the memory used per atom in the previous chunks. Each chunk contains at
+    /// least one system.
+    ///
+    /// For each chunk, `callback` is called with the index of the first system
+    /// in the chunk, the number of systems in the chunk and the corresponding
+    /// descriptor. The callback runs in a separate thread while the next chunk
+    /// is being computed, but two calls to the callback never overlap and they
+    /// are always made in order. The `"system"` dimension in the descriptor
+    /// (and in the sample selection from `options`) is relative to the chunk.
+    pub fn compute_chunks<I, F>(
+        &self,
+        systems: I,
+        options: CalculationOptions,
+        memory_budget: usize,
+        callback: F,
+    ) -> Result<(), Error>
+        where I: IntoIterator<Item=Result<Box<dyn System>, Error>>,
+              F: FnMut(usize, usize, TensorMap) -> Result<(), Error> + Send,
+    {
+        if memory_budget == 0 {
+            return Err(Error::InvalidParameter("memory budget for chunked calculation must be positive".into()));
+        }
+
+        let mut systems = systems.into_iter().peekable();
+
+        // use a rendezvous channel, so at most one chunk is waiting for the
+        // callback while the next one is being computed
+        let (sender, receiver) = std::sync::mpsc::sync_channel::<(usize, usize, TensorMap)>(0);
+        return std::thread::scope(|scope| {
+            let consumer = scope.spawn(move || -> Result<(), Error> {
+                let mut callback = callback;
+                for (first_system, systems_count, tensor) in receiver {
+                    callback(first_system, systems_count, tensor)?;
+                }
+                Ok(())
+            });
+
+            let mut produce = || -> Result<(), Error> {
+                // start with a single system per chunk, until we have an
+                // estimate of the memory used per atom
+                let mut bytes_per_atom = None;
+                let mut first_system = 0;
+                while systems.peek().is_some() {
+                    let mut chunk = Vec::new();
+                    let mut chunk_atoms = 0;
+                    for system in systems.by_ref() {
+                        let system = system?;
+                        chunk_atoms += system.size()?;
+                        chunk.push(system);
+
+                        match bytes_per_atom {
+                            None => break,
+                            Some(bytes_per_atom) => {
+                                if chunk_atoms * bytes_per_atom >= memory_budget {
+                                    break;
+                                }
+                            }
+                        }
+                    }
+
+                    let tensor = self.compute(&mut chunk, options)?;
+
+                    if chunk_atoms != 0 {
+                        let bytes = std::cmp::max(tensor_memory(&tensor, options.gradients) / chunk_atoms, 1);
+                        bytes_per_atom = Some(bytes_per_atom.map_or(bytes, |previous: usize| previous.max(bytes)));
+                    }
+
+                    let systems_count = chunk.len();
+                    if sender.send((first_system, systems_count, tensor)).is_err() {
+                        // the callback failed, the corresponding error will
+                        // be reported when joining the consumer thread
+                        break;
+                    }
+                    first_system += systems_count;
+                }
+                Ok(())
+            };
+
+            let produced = produce();
+            std::mem::drop(sender);
+
+            let consumed = consumer.join().map_err(Error::from)?;
+            produced?;
+            consumed?;
+
+            return Ok(());
+        });
+    }
+
+    /// Update the `previous` descriptor of a single system after some atoms
+    /// moved, only re-computing the samples affected by the move.
+    ///
+    /// `previous_system` should be the system used to compute `previous`, and
+    /// `system` the same system with the new positions. `moved_atoms` contains
+    /// the indexes of the atoms that moved between the two. Only the atoms
+    /// which are within the cutoff of a moved atom (either before or after the
+    /// move) are re-computed, all the other samples are taken from `previous`.
+    ///
+    /// The atoms around the previous positions are found in the neighbor list
+    /// of `previous_system`, which was already computed when computing
+    /// `previous`. The neighbor list of `system` is still built from scratch,
+    /// since the calculators need it for the new positions. When no gradients
+    /// are requested, the re-computed samples are written directly in
+    /// `previous`; otherwise the blocks are re-assembled from `previous` and
+    /// the re-computed samples to account for the new gradient samples.
+    ///
+    /// This requires a calculator with atom-centered samples (`["system",
+    /// "atom"]`) and a finite cutoff, and `previous` must have been computed
+    /// with the same gradients as `options`, without any selection. If the
+    /// move changes the set of keys, or the calculator has no finite cutoff,
+    /// the full descriptor is re-computed.
+    #[allow(clippy::too_many_lines)]
+    pub fn compute_incremental(
+        &self,
+        system: &mut Box<dyn System>,
+        previous_system: &mut Box<dyn System>,
+        previous: TensorMap,
+        moved_atoms: &[usize],
+        options: CalculationOptions,
+    ) -> Result<TensorMap, Error> {
+        if !matches!(options.selected_samples, LabelsSelection::All) ||
+           !matches!(options.selected_properties, LabelsSelection::All) ||
+           options.selected_keys.is_some() {
+            return Err(Error::InvalidParameter(
+                "selection of samples, properties or keys is not supported for incremental calculations".into()
+            ));
+        }
+
+        let n_atoms = system.size()?;
+        if previous_system.size()? != n_atoms || previous_system.types()? != system.types()? {
+            return Err(Error::InvalidParameter(
+                "the previous system must contain the same atoms as the new system".into()
+            ));
+        }
+
+        if let Some(&atom) = moved_atoms.iter().find(|&&atom| atom >= n_atoms) {
+            return Err(Error::InvalidParameter(format!(
+                "moved atom index {} is out of bounds for a system with {} atoms", atom, n_atoms
+            )));
+        }
+
+        for block in previous.blocks() {
+            if block.samples().names() != ["system", "atom"] {
+                return Err(Error::InvalidParameter(
+                    "incremental calculations require atom-centered samples".into()
+                ));
+            }
+
+            for &parameter in options.gradients {
+                if block.gradient(parameter).is_none() {
+                    return Err(Error::InvalidParameter(format!(
+                        "missing {} gradients in the previous descriptor", parameter
+                    )));
+                }
+            }
+        }
+
+        let systems = std::slice::from_mut(system);
+        let cutoff = self.cutoffs().iter().copied().fold(0.0, f64::max);
+        if !cutoff.is_finite() || cutoff <= 0.0 {
+            return self.compute(systems, options);
+        }
+
+        // find all the atoms within the cutoff of a moved atom, both in the
+        // new and the previous positions. This does not re-compute the
+        // neighbor list of the previous system if it was already computed with
+        // this cutoff.
+        systems[0].compute_neighbors(cutoff)?;
+        previous_system.compute_neighbors(cutoff)?;
+
+        let mut affected = moved_atoms.iter().copied().collect::<BTreeSet<_>>();
+        for &atom in moved_atoms {
+            for pair in systems[0].pairs_containing(atom)?.iter().chain(previous_system.pairs_containing(atom)?) {
+                affected.insert(pair.first);
+                affected.insert(pair.second);
+            }
+        }
+
+        let mut selection = LabelsBuilder::new(vec!["atom"]);
+        for &atom in &affected {
+            selection.add(&[atom]);
+        }
+        // SAFETY: entries come from a set, so they are unique
+        let selection = unsafe { selection.finish_assume_unique() };
+
+        let updated = self.compute(systems, CalculationOptions {
+            selected_samples: LabelsSelection::Subset(&selection),
+            ..options
+        })?;
+
+        if updated.keys() != previous.keys() {
+            // the set of keys changed, we need to re-compute everything
+            return self.compute(systems, options);
+        }
+
+        let mut previous = previous;
+        if update_values_in_place(&mut previous, &updated, &affected)? {
+            return Ok(previous);
+        }
+
+        let mut blocks = Vec::new();
+        for (previous_block, updated_block) in previous.blocks().into_iter().zip(updated.blocks()) {
+            blocks.push(splice_incremental_block(&previous_block, &updated_block, &affected, options.gradients)?);
+        }
+
+        return Ok(TensorMap::new(previous.keys().clone(), blocks)?);
+    }
+}
+
+// Components added to the gradients blocks. These never change, so we create
+// them once and share them between all blocks and all calls to `compute`.
+static XYZ_COMPONENT: Lazy<Labels> = Lazy::new(|| Labels::new(["xyz"], &[[0], [1], [2]]));
+static ABC_COMPONENT: Lazy<Labels> = Lazy::new(|| Labels::new(["abc"], &[[0], [1], [2]]));
+static XYZ_1_COMPONENT: Lazy<Labels> = Lazy::new(|| Labels::new(["xyz_1"], &[[0], [1], [2]]));
+static XYZ_2_COMPONENT: Lazy<Labels> = Lazy::new(|| Labels::new(["xyz_2"], &[[0], [1], [2]]));
+
+/// Maximal number of entries in `RANGE_GRADIENT_SAMPLES`
+const MAX_CACHED_RANGE_GRADIENT_SAMPLES: usize = 256;
+
+/// Cache for the gradient samples of cell and strain gradients, indexed by the
+/// number of samples in the corresponding block.
+static RANGE_GRADIENT_SAMPLES: Lazy<Mutex<BTreeMap<usize, Labels>>> = Lazy::new(Default::default);
+
+/// Get `Labels` with a single "sample" dimension, containing all values from
+/// `0` to `count`. This is used as the gradient samples for cell and strain
+/// gradients, and the corresponding `Labels` are shared between all blocks with
+/// the same number of samples and between calls to `compute`.
+fn range_gradient_samples(count: usize) -> Labels {
+    let mut cache = RANGE_GRADIENT_SAMPLES.lock().expect("mutex was poisoned");
+    if let Some(labels) = cache.get(&count) {
+        return labels.clone();
+    }
+
+    let mut builder = LabelsBuilder::new(vec!["sample"]);
+    builder.reserve(count);
+    for sample_i in 0..count {
+        builder.add(&[sample_i]);
+    }
+    // SAFETY: all values in a range are unique
+    let labels = unsafe { builder.finish_assume_unique() };
+
+    if cache.len() >= MAX_CACHED_RANGE_GRADIENT_SAMPLES {
+        // evict the smallest entry, which is the cheapest to re-create
+        cache.pop_first();
+    }
+    cache.insert(count, labels.clone());
+
+    return labels;
+}
+
+/// Get the approximate memory used by the values and the requested `gradients`
+/// in `tensor`, in bytes
+fn tensor_memory(tensor: &TensorMap, gradients: &[&str]) -> usize {
+    let mut size = 0;
+    for block in tensor.blocks() {
+        size += block.values().to_array().len();
+        for &parameter in gradients {
+            if let Some(gradient) = block.gradient(parameter) {
+                size += gradient.values().to_array().len();
+                size += gradient.samples().count() * gradient.samples().size();
+            }
+        }
+        size += block.samples().count() * block.samples().size();
+    }
+
+    return size * std::mem::size_of::<f64>();
+}
+
+/// Overwrite the rows of `previous` for the `affected` atoms with the values
+/// from `updated`, without copying the other rows.
+///
+/// This is only possible when `previous` has no gradients, and each block of
+/// `previous` contains exactly the same samples for the affected atoms as the
+/// corresponding block of `updated`. Otherwise, `previous` is left untouched
+/// and this function returns `false`.
+fn update_values_in_place(
+    previous: &mut TensorMap,
+    updated: &TensorMap,
+    affected: &BTreeSet<usize>,
+) -> Result<bool, Error> {
+    let mut rows_by_block = Vec::new();
+    for (previous_block, updated_block) in previous.blocks().into_iter().zip(updated.blocks()) {
+        if !previous_block.gradient_list().is_empty() {
+            return Ok(false);
+        }
+
+        let previous_samples = previous_block.samples();
+        let updated_samples = updated_block.samples();
+
+        let mut rows = Vec::with_capacity(updated_samples.count());
+        for sample in updated_samples.iter() {
+            match previous_samples.position(sample) {
+                Some(row) => rows.push(row),
+                None => return Ok(false),
+            }
+        }
+
+        let previous_affected = affected.iter().filter(|&&atom| {
+            previous_samples.position(&[LabelValue::new(0), LabelValue::from(atom)]).is_some()
+        }).count();
+        if previous_affected != rows.len() {
+            return Ok(false);
+        }
+
+        rows_by_block.push(rows);
+    }
+
+    for (block_i, (_, mut block)) in (&mut *previous).into_iter().enumerate() {
+        let updated_block = updated.block_by_id(block_i);
+        let updated_values = updated_block.values().to_array();
+
+        let block_data = block.data_mut();
+        let array = block_data.values.to_array_mut();
+        for (updated_row, &row) in rows_by_block[block_i].iter().enumerate() {
+            array.index_axis_mut(Axis(0), row).assign(&updated_values.index_axis(Axis(0), updated_row));
+        }
+    }
+
+    return Ok(true);
+}
+
+/// Where to take a sample from when merging blocks in
+/// `Calculator::compute_incremental`
+#[derive(Clone, Copy)]
+enum IncrementalSource {
+    Previous(usize),
+    Updated(usize),
+}
+
+/// Merge the samples of `previous` for atoms not in `affected` with the samples
+/// of `updated`, keeping the samples sorted by atom.
+fn splice_incremental_block(
+    previous: &TensorBlockRef<'_>,
+    updated: &TensorBlockRef<'_>,
+    affected: &BTreeSet<usize>,
+    gradients: &[&str],
+) -> Result<TensorBlock, Error> {
+    let previous_samples = previous.samples();
+    let updated_samples = updated.samples();
+
+    let mut sources = Vec::with_capacity(previous_samples.count());
+    for (sample_i, [_, atom]) in previous_samples.iter_fixed_size().enumerate() {
+        if !affected.contains(&atom.usize()) {
+            sources.push((atom.usize(), IncrementalSource::Previous(sample_i)));
+        }
+    }
+    for (sample_i, [_, atom]) in updated_samples.iter_fixed_size().enumerate() {
+        sources.push((atom.usize(), IncrementalSource::Updated(sample_i)));
+    }
+    sources.sort_by_key(|&(atom, _)| atom);
+
+    let mut previous_mapping = vec![None; previous_samples.count()];
+    let mut updated_mapping = vec![0; updated_samples.count()];
+    let mut samples = LabelsBuilder::new(previous_samples.names());
+    samples.reserve(sources.len());
+    for (new_sample_i, &(atom, source)) in sources.iter().enumerate() {
+        samples.add(&[0, atom]);
+        match source {
+            IncrementalSource::Previous(i) => previous_mapping[i] = Some(new_sample_i),
+            IncrementalSource::Updated(i) => updated_mapping[i] = new_sample_i,
+        }
+    }
+    // SAFETY: each atom appears at most once, either from `previous` or from
+    // `updated`
+    let samples = unsafe { samples.finish_assume_unique() };
+
+    let copy_rows = |previous: &ArrayD<f64>, updated: &ArrayD<f64>, rows: &[IncrementalSource]| {
+        let mut shape = previous.shape().to_vec();
+        shape[0] = rows.len();
+        let mut values = ArrayD::from_elem(shape, 0.0);
+        for (mut row, &source) in values.axis_iter_mut(Axis(0)).zip(rows) {
+            match source {
+                IncrementalSource::Previous(i) => row.assign(&previous.index_axis(Axis(0), i)),
+                IncrementalSource::Updated(i) => row.assign(&updated.index_axis(Axis(0), i)),
+            }
+        }
+        values
+    };
+
+    let rows = sources.iter().map(|&(_, source)| source).collect::<Vec<_>>();
+    let values = copy_rows(previous.values().to_array(), updated.values().to_array(), &rows);
+    let mut new_block = TensorBlock::new(values, &samples, &previous.components(), &previous.properties())?;
+
+    for &parameter in gradients {
+        let previous_gradient = previous.gradient(parameter).expect("missing gradient in previous descriptor");
+        let updated_gradient = updated.gradient(parameter).expect("missing gradient in updated descriptor");
+
+        let mut gradient_sources = Vec::new();
+        for (gradient_sample_i, gradient_sample) in previous_gradient.samples().iter().enumerate() {
+            if let Some(new_sample_i) = previous_mapping[gradient_sample[0].usize()] {
+                let mut gradient_sample = gradient_sample.to_vec();
+                gradient_sample[0] = new_sample_i.into();
+                gradient_sources.push((gradient_sample, IncrementalSource::Previous(gradient_sample_i)));
+            }
+        }
+        for (gradient_sample_i, gradient_sample) in updated_gradient.samples().iter().enumerate() {
+            let mut gradient_sample = gradient_sample.to_vec();
+            gradient_sample[0] = updated_mapping[gradient_sample[0].usize()].into();
+            gradient_sources.push((gradient_sample, IncrementalSource::Updated(gradient_sample_i)));
+        }
+        // stable sort, keeping the initial order within each sample
+        gradient_sources.sort_by_key(|(gradient_sample, _)| gradient_sample[0].usize());
+
+        let mut gradient_samples = LabelsBuilder::new(previous_gradient.samples().names());
+        gradient_samples.reserve(gradient_sources.len());
+        for (gradient_sample, _) in &gradient_sources {
+            gradient_samples.add(gradient_sample);
+        }
+        // SAFETY: the gradient samples in `previous` and `updated` are unique,
+        // and they refer to different samples after the re-mapping
+        let gradient_samples = unsafe { gradient_samples.finish_assume_unique() };
+
+        let rows = gradient_sources.iter().map(|&(_, source)| source).collect::<Vec<_>>();
+        let values = copy_rows(previous_gradient.values().to_array(), updated_gradient.values().to_array(), &rows);
+        new_block.add_gradient(parameter, TensorBlock::new(
+            values,
+            &gradient_samples,
+            &previous_gradient.components(),
+            &previous_gradient.properties(),
+        )?)?;
+    }
+
+    return Ok(new_block);
 }
 
 fn shape_from_labels(samples: &Labels, components: &[Labels], properties: &Labels) -> Vec<usize> {
@@ -548,6 +1056,8 @@ use crate::calculators::{SphericalExpansionByPair, SphericalExpansionParameters}
 use crate::calculators::SphericalExpansion;
 use crate::calculators::{SoapRadialSpectrum, RadialSpectrumParameters};
 use crate::calculators::{SoapPowerSpectrum, PowerSpectrumParameters};
+use crate::calculators::{LambdaSoap, LambdaSoapParameters};
+use crate::calculators::{SoapCompressedPowerSpectrum, CompressedPowerSpectrumParameters};
 use crate::calculators::{LodeSphericalExpansion, LodeSphericalExpansionParameters};
 
 
@@ -582,6 +1092,8 @@ static REGISTERED_CALCULATORS: Lazy<BTreeMap<&'static str, CalculatorCreator>> =
     add_calculator!(map, "spherical_expansion", SphericalExpansion, SphericalExpansionParameters);
     add_calculator!(map, "soap_radial_spectrum", SoapRadialSpectrum, RadialSpectrumParameters);
     add_calculator!(map, "soap_power_spectrum", SoapPowerSpectrum, PowerSpectrumParameters);
+    add_calculator!(map, "lambda_soap", LambdaSoap, LambdaSoapParameters);
+    add_calculator!(map, "soap_compressed_power_spectrum", SoapCompressedPowerSpectrum, CompressedPowerSpectrumParameters);
 
     add_calculator!(map, "lode_spherical_expansion", LodeSphericalExpansion, LodeSphericalExpansionParameters);
     return map;
@@ -1,4 +1,9 @@
-use metatensor::{Labels, LabelsBuilder, TensorMap};
+use std::collections::BTreeSet;
+
+use ndarray::{Array2, Axis};
+use rayon::prelude::*;
+
+use metatensor::{Labels, LabelsBuilder, TensorBlock, TensorMap};
 
 use crate::{Error, System};
 
@@ -15,6 +20,10 @@ use crate::labels::{CenterTypesKeys, KeysBuilder};
 /// For `per_system=True` a sum for each system is performed and the number of
 /// atoms per system is saved. The only sample left is names `system`.
 ///
+/// Only local atoms are included (see `System::local_size`): ghost atoms do
+/// not get samples with `per_system=False` and are not counted with
+/// `per_system=True`.
+///
 /// Positions/cell gradients of the composition are zero everywhere. Therefore,
 /// the gradient data will only be an empty array.
 #[derive(Debug, Clone, serde::Deserialize, serde::Serialize, schemars::JsonSchema)]
@@ -23,6 +32,89 @@ pub struct AtomicComposition {
     pub per_system: bool,
 }
 
+impl AtomicComposition {
+    /// Compute the per-system composition of a batch of systems stored as a
+    /// single packed buffer of atomic types, without going through the full
+    /// calculator machinery (systems, keys and samples selection, gradients).
+    ///
+    /// `types` contains the atomic types of all atoms in all systems, one
+    /// system after the other, and the types of system `i` are
+    /// `types[system_offsets[i]..system_offsets[i + 1]]`. `system_offsets`
+    /// must start with 0, be sorted, and end with `types.len()`.
+    ///
+    /// The output contains a single block, with a single `_` key, one
+    /// `system` sample per system and one `center_type` property for each
+    /// atomic type in the batch. Values are the number of atoms of a given type
+    /// in a given system, i.e. the same as the blocks of this calculator with
+    /// `per_system=true`, stored in a single dense array.
+    pub fn compute_packed(types: &[i32], system_offsets: &[usize]) -> Result<TensorMap, Error> {
+        if system_offsets.first() != Some(&0) {
+            return Err(Error::InvalidParameter(
+                "system_offsets must start with 0".into()
+            ));
+        }
+
+        if system_offsets.windows(2).any(|w| w[0] > w[1]) {
+            return Err(Error::InvalidParameter(
+                "system_offsets must be sorted in increasing order".into()
+            ));
+        }
+
+        if system_offsets[system_offsets.len() - 1] != types.len() {
+            return Err(Error::InvalidParameter(format!(
+                "the last entry in system_offsets ({}) must be the number of atoms ({})",
+                system_offsets[system_offsets.len() - 1], types.len()
+            )));
+        }
+
+        let all_types = types.par_chunks(4096)
+            .fold(BTreeSet::new, |mut set, chunk| {
+                set.extend(chunk.iter().copied());
+                set
+            })
+            .reduce(BTreeSet::new, |mut a, mut b| {
+                a.append(&mut b);
+                a
+            });
+        let all_types = all_types.into_iter().collect::<Vec<_>>();
+
+        let n_systems = system_offsets.len() - 1;
+        let mut values = Array2::<f64>::zeros((n_systems, all_types.len()));
+        values.axis_iter_mut(Axis(0))
+            .into_par_iter()
+            .zip_eq(system_offsets.par_windows(2))
+            .for_each(|(mut row, range)| {
+                for atomic_type in &types[range[0]..range[1]] {
+                    let type_i = all_types.binary_search(atomic_type).expect("missing atomic type");
+                    row[type_i] += 1.0;
+                }
+            });
+
+        let mut samples = LabelsBuilder::new(vec!["system"]);
+        for system_i in 0..n_systems {
+            samples.add(&[system_i]);
+        }
+        // SAFETY: each system is added exactly once
+        let samples = unsafe { samples.finish_assume_unique() };
+
+        let mut properties = LabelsBuilder::new(vec!["center_type"]);
+        for &atomic_type in &all_types {
+            properties.add(&[atomic_type]);
+        }
+        // SAFETY: all_types comes from a set
+        let properties = unsafe { properties.finish_assume_unique() };
+
+        let block = TensorBlock::new(
+            values.into_dyn(),
+            &samples,
+            &[],
+            &properties,
+        ).expect("invalid TensorBlock");
+
+        return Ok(TensorMap::new(Labels::new(["_"], &[[0]]), vec![block]).expect("invalid TensorMap"));
+    }
+}
+
 impl CalculatorBase for AtomicComposition {
     fn name(&self) -> String {
         return "atom-centered composition features".into();
@@ -59,15 +151,17 @@ impl CalculatorBase for AtomicComposition {
                     builder.add(&[system_i]);
                 } else {
                     let types = system.types()?;
+                    let n_local = system.local_size()?;
 
-                    for (center_i, &center_type) in types.iter().enumerate() {
+                    for (center_i, &center_type) in types.iter().take(n_local).enumerate() {
                         if center_type_key.i32() == center_type {
                             builder.add(&[system_i, center_i]);
                         }
                     }
                 }
             }
-            samples.push(builder.finish());
+            // SAFETY: each system and atom is added at most once
+            samples.push(unsafe { builder.finish_assume_unique() });
         }
 
         return Ok(samples);
@@ -109,7 +203,7 @@ impl CalculatorBase for AtomicComposition {
     }
 
     fn compute(
-        &mut self,
+        &self,
         systems: &mut [Box<dyn System>],
         descriptor: &mut TensorMap,
     ) -> Result<(), Error> {
@@ -130,7 +224,8 @@ impl CalculatorBase for AtomicComposition {
                             // Current system is saved in the 0th index of the samples.
                             let system_i = samples[0].usize();
                             let system = &systems[system_i];
-                            for &atomic_type in system.types()? {
+                            let n_local = system.local_size()?;
+                            for &atomic_type in &system.types()?[..n_local] {
                                 if atomic_type == center_type {
                                     value += 1.0;
                                 }
@@ -149,11 +244,11 @@ impl CalculatorBase for AtomicComposition {
 
 #[cfg(test)]
 mod tests {
-    use metatensor::Labels;
+    use metatensor::{Labels, LabelValue};
     use ndarray::array;
 
     use crate::systems::test_utils::{test_system, test_systems};
-    use crate::Calculator;
+    use crate::{Calculator, System};
 
     use super::super::CalculatorBase;
     use super::AtomicComposition;
@@ -170,7 +265,7 @@ mod tests {
 
     #[test]
     fn values() {
-        let mut calculator = Calculator::from(Box::new(AtomicComposition {
+        let calculator = Calculator::from(Box::new(AtomicComposition {
             per_system: false,
         }) as Box<dyn CalculatorBase>);
 
@@ -189,7 +284,7 @@ mod tests {
 
     #[test]
     fn values_per_system() {
-        let mut calculator = Calculator::from(Box::new(AtomicComposition {
+        let calculator = Calculator::from(Box::new(AtomicComposition {
             per_system: true,
         }) as Box<dyn CalculatorBase>);
 
@@ -206,6 +301,75 @@ mod tests {
         assert_eq!(values, array![[2.0]].into_dyn());
     }
 
+    #[test]
+    fn ghost_atoms() {
+        let mut water = test_system("water");
+        water.set_local_size(2);
+        let mut systems = vec![Box::new(water) as Box<dyn System>];
+
+        let calculator = Calculator::from(Box::new(AtomicComposition {
+            per_system: false,
+        }) as Box<dyn CalculatorBase>);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(1)]).unwrap());
+        assert_eq!(block.samples(), Labels::new(["system", "atom"], &[[0, 1]]));
+
+        let calculator = Calculator::from(Box::new(AtomicComposition {
+            per_system: true,
+        }) as Box<dyn CalculatorBase>);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(1)]).unwrap());
+        assert_eq!(block.values().to_array(), array![[1.0]].into_dyn());
+    }
+
+    #[test]
+    fn packed() {
+        let calculator = Calculator::from(Box::new(AtomicComposition {
+            per_system: true,
+        }) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water", "methane", "CH"]);
+        let reference = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        let mut types = Vec::new();
+        let mut system_offsets = vec![0];
+        for system in &systems {
+            types.extend_from_slice(system.types().unwrap());
+            system_offsets.push(types.len());
+        }
+
+        let descriptor = AtomicComposition::compute_packed(&types, &system_offsets).unwrap();
+        assert_eq!(descriptor.keys(), &Labels::new(["_"], &[[0]]));
+
+        let block = descriptor.block_by_id(0);
+        assert_eq!(block.samples(), Labels::new(["system"], &[[0], [1], [2]]));
+        assert_eq!(block.properties(), Labels::new(["center_type"], &[[-42], [1], [6]]));
+
+        let values = block.values().to_array();
+        for (type_i, &[center_type]) in block.properties().iter_fixed_size().enumerate() {
+            let block_i = reference.keys().position(&[center_type]).unwrap();
+            let expected = reference.block_by_id(block_i);
+            let expected_values = expected.values().to_array();
+            for system_i in 0..3 {
+                let value = match expected.samples().position(&[LabelValue::new(system_i as i32)]) {
+                    Some(sample_i) => expected_values[[sample_i, 0]],
+                    None => 0.0,
+                };
+                assert_eq!(values[[system_i, type_i]], value);
+            }
+        }
+
+        let error = AtomicComposition::compute_packed(&types, &[0, 3, 2, types.len()]).unwrap_err();
+        assert_eq!(error.to_string(), "invalid parameter: system_offsets must be sorted in increasing order");
+
+        let error = AtomicComposition::compute_packed(&types, &[0, 3]).unwrap_err();
+        assert_eq!(error.to_string(), format!(
+            "invalid parameter: the last entry in system_offsets (3) must be the number of atoms ({})", types.len()
+        ));
+    }
+
     #[test]
     fn finite_differences_positions() {
         let calculator = Calculator::from(Box::new(AtomicComposition {
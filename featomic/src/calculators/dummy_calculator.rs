@@ -110,7 +110,7 @@ impl CalculatorBase for DummyCalculator {
     }
 
     #[time_graph::instrument(name = "DummyCalculator::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         if self.name.contains("log-test-info:") {
             info!("{}", self.name);
         } else if self.name.contains("log-test-warn:") {
@@ -253,7 +253,7 @@ mod tests {
 
     #[test]
     fn values() {
-        let mut calculator = Calculator::from(Box::new(DummyCalculator{
+        let calculator = Calculator::from(Box::new(DummyCalculator{
             cutoff: 1.0,
             delta: 9,
             name: String::new(),
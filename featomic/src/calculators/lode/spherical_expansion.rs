@@ -25,7 +25,7 @@ use crate::math::{expi, erfc, gamma};
 use super::radial_integral::LodeRadialIntegralCacheByAngular;
 
 use super::super::shared::descriptors_by_systems::{split_tensor_map_by_system, array_mut_for_system};
-use super::super::shared::LodeRadialBasis;
+use super::super::shared::{LodeRadialBasis, ScratchPool};
 
 /// Parameters for LODE spherical expansion calculator.
 ///
@@ -61,7 +61,10 @@ impl LodeSphericalExpansionParameters {
 }
 
 
-/// The actual calculator used to compute LODE spherical expansion coefficients
+/// The actual calculator used to compute LODE spherical expansion coefficients.
+///
+/// Systems with ghost atoms (see `System::local_size`) are rejected, since the
+/// reciprocal space sums already include all the periodic images of the atoms.
 pub struct LodeSphericalExpansion {
     /// Parameters governing the spherical expansion
     parameters: LodeSphericalExpansionParameters,
@@ -71,8 +74,9 @@ pub struct LodeSphericalExpansion {
     radial_integral: ThreadLocal<RefCell<LodeRadialIntegralCacheByAngular>>,
     /// Cached allocations for the k-vector to nlm projection coefficients.
     /// The map contains different l values, and the Array is indexed by
-    /// `m, n, k`.
-    k_vector_to_m_n: ThreadLocal<RefCell<BTreeMap<usize, Array3<f64>>>>,
+    /// `m, n, k`. These are used across nested parallel loops, so they can not
+    /// be thread-local.
+    k_vector_to_m_n: ScratchPool<BTreeMap<usize, Array3<f64>>>,
     /// Cached allocation for everything that only depends on the k vector
     k_dependent_values: ThreadLocal<RefCell<Array1<f64>>>,
 }
@@ -219,12 +223,15 @@ impl LodeSphericalExpansion {
             parameters,
             spherical_harmonics: ThreadLocal::new(),
             radial_integral: ThreadLocal::new(),
-            k_vector_to_m_n: ThreadLocal::new(),
+            k_vector_to_m_n: ScratchPool::new(),
             k_dependent_values: ThreadLocal::new(),
         });
     }
 
-    fn project_k_to_nlm(&self, k_vectors: &[KVector]) {
+    /// Compute the projection coefficients of the k-vectors on the nlm basis,
+    /// using an allocation from the `k_vector_to_m_n` pool. The caller should
+    /// give it back to the pool when done.
+    fn project_k_to_nlm(&self, k_vectors: &[KVector]) -> BTreeMap<usize, Array3<f64>> {
         let mut radial_integral = self.radial_integral.get_or(|| {
             let radial_integral = LodeRadialIntegralCacheByAngular::new(
                 self.parameters.density.kind,
@@ -240,14 +247,13 @@ impl LodeSphericalExpansion {
             RefCell::new(SphericalHarmonicsCache::new(max_angular))
         }).borrow_mut();
 
-        let mut k_vector_to_m_n = self.k_vector_to_m_n.get_or(|| {
+        let mut k_vector_to_m_n = self.k_vector_to_m_n.take(|| {
             let mut k_vector_to_m_n = BTreeMap::new();
             for o3_lambda in self.parameters.basis.angular_channels() {
                 k_vector_to_m_n.insert(o3_lambda, Array3::from_elem((0, 0, 0), 0.0));
             }
-
-            return RefCell::new(k_vector_to_m_n);
-        }).borrow_mut();
+            return k_vector_to_m_n;
+        });
 
         for o3_lambda in self.parameters.basis.angular_channels() {
             let radial_size = radial_integral.get(o3_lambda).expect("missing o3_lambda").size();
@@ -274,6 +280,8 @@ impl LodeSphericalExpansion {
                 }
             }
         }
+
+        return k_vector_to_m_n;
     }
 
     #[allow(clippy::float_cmp)]
@@ -394,7 +402,7 @@ impl LodeSphericalExpansion {
     /// By symmetry, this only affects the (l, m) = (0, 0) components of the
     /// projection coefficients and only the neighbor type blocks that agrees
     /// with the center atom.
-    fn do_center_contribution(&mut self, systems: &mut[Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn do_center_contribution(&self, systems: &mut[Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         if !self.parameters.basis.angular_channels().contains(&0) {
             // o3_lambda is not part of the output, skip self contributions
             return Ok(());
@@ -463,6 +471,14 @@ impl CalculatorBase for LodeSphericalExpansion {
     }
 
     fn keys(&self, systems: &mut [Box<dyn System>]) -> Result<Labels, Error> {
+        for system in &*systems {
+            if system.local_size()? != system.size()? {
+                return Err(Error::InvalidParameter(
+                    "LODE calculators do not support systems with ghost atoms".into()
+                ));
+            }
+        }
+
         let builder = AllTypesPairsKeys {};
         let keys = builder.keys(systems)?;
 
@@ -599,7 +615,7 @@ impl CalculatorBase for LodeSphericalExpansion {
     }
 
     #[time_graph::instrument(name = "LodeSphericalExpansion::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert_eq!(descriptor.keys().names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_type"]);
 
         self.do_center_contribution(systems, descriptor)?;
@@ -643,7 +659,7 @@ impl CalculatorBase for LodeSphericalExpansion {
                     return Err(Error::InvalidParameter("No k-vectors for current combination of hyper parameters.".into()));
                 }
 
-                self.project_k_to_nlm(&k_vectors);
+                let k_vector_to_m_n = self.project_k_to_nlm(&k_vectors);
 
                 let structure_factors = compute_structure_factors(
                     system.positions()?,
@@ -686,10 +702,6 @@ impl CalculatorBase for LodeSphericalExpansion {
                     }
                 }
 
-                let k_vector_to_m_n = self.k_vector_to_m_n.get()
-                    .expect("k_vector_to_m_n should have been created")
-                    .borrow();
-
                 // Main loop: Iterate over all blocks, and then all samples in
                 // each block (in parallel) to evaluate the projection
                 // coefficients
@@ -872,6 +884,8 @@ impl CalculatorBase for LodeSphericalExpansion {
                     }
                 }
 
+                self.k_vector_to_m_n.give_back(k_vector_to_m_n);
+
                 return Ok(());
             }
         )?;
@@ -927,6 +941,35 @@ mod tests {
         }
     }
 
+    #[test]
+    fn ghost_atoms() {
+        let calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
+            LodeSphericalExpansionParameters {
+                k_cutoff: None,
+                density: Density {
+                    kind: DensityKind::SmearedPowerLaw { smearing: 1.0, exponent: 1 },
+                    scaling: None,
+                    center_atom_weight: 1.0,
+                },
+                basis: SphericalExpansionBasis::TensorProduct(TensorProductBasis {
+                    max_angular: 2,
+                    radial: LodeRadialBasis::Gto { max_radial: 3, radius: 1.0 },
+                    spline_accuracy: Some(1e-8),
+                }),
+            }
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut water = test_system("water");
+        water.set_local_size(2);
+        let mut systems = vec![Box::new(water) as Box<dyn System>];
+
+        let error = calculator.compute(&mut systems, Default::default()).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: LODE calculators do not support systems with ghost atoms"
+        );
+    }
+
     #[test]
     fn compute_partial() {
         let calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
@@ -1087,7 +1130,7 @@ mod tests {
         by_angular.insert(1, LodeRadialBasis::Gto { max_radial: 5, radius: 5.5 });
         by_angular.insert(12, LodeRadialBasis::Gto { max_radial: 3, radius: 3.4 });
 
-        let mut calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
+        let calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
             LodeSphericalExpansionParameters {
                 k_cutoff: None,
                 density: Density {
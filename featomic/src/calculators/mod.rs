@@ -9,8 +9,13 @@ use crate::{Error, System};
 /// in [`crate::Calculator`] instead.
 ///
 /// `std::panic::RefUnwindSafe` is a required super-trait to enable passing
-/// calculators across the C API.
-pub trait CalculatorBase: std::panic::RefUnwindSafe {
+/// calculators across the C API. `Send` and `Sync` are required to allow
+/// multiple threads to run calculations with the same calculator concurrently:
+/// all the functions in this trait take `&self`, and any scratch memory
+/// should be stored in thread-safe containers (`ThreadLocal` for allocations
+/// which are not used across nested parallel loops, and
+/// `shared::ScratchPool` otherwise).
+pub trait CalculatorBase: std::panic::RefUnwindSafe + Send + Sync {
     /// Get the name of this Calculator
     fn name(&self) -> String;
 
@@ -66,7 +71,9 @@ pub trait CalculatorBase: std::panic::RefUnwindSafe {
     /// block if they are supported according to
     /// [`CalculatorBase::supports_gradient`], and the users requested them as
     /// part of the calculation options.
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error>;
+    ///
+    /// This function can be called concurrently from multiple threads.
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error>;
 }
 
 
@@ -88,13 +95,15 @@ pub use self::neighbor_list::NeighborList;
 mod shared;
 pub use self::shared::{Density, DensityKind, DensityScaling};
 pub use self::shared::{SphericalExpansionBasis, TensorProductBasis};
-pub use self::shared::{SoapRadialBasis, LodeRadialBasis};
+pub use self::shared::{SoapRadialBasis, LodeRadialBasis, register_tabulated_basis};
 
 pub mod soap;
 pub use self::soap::{SphericalExpansionByPair, SphericalExpansionParameters};
 pub use self::soap::SphericalExpansion;
 pub use self::soap::{SoapRadialSpectrum, RadialSpectrumParameters};
 pub use self::soap::{SoapPowerSpectrum, PowerSpectrumParameters};
+pub use self::soap::{LambdaSoap, LambdaSoapParameters};
+pub use self::soap::{SoapCompressedPowerSpectrum, CompressedPowerSpectrumParameters};
 
 pub mod lode;
 pub use self::lode::{LodeSphericalExpansion, LodeSphericalExpansionParameters};
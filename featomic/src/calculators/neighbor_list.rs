@@ -1,4 +1,6 @@
-use std::collections::BTreeSet;
+use std::collections::{BTreeMap, BTreeSet};
+
+use rayon::prelude::*;
 
 use metatensor::TensorMap;
 use metatensor::{Labels, LabelsBuilder, LabelValue};
@@ -6,6 +8,7 @@ use metatensor::{Labels, LabelsBuilder, LabelValue};
 use super::CalculatorBase;
 
 use crate::{Error, System};
+use crate::systems::Pair;
 
 
 /// This calculator computes the neighbor list for a given spherical cutoff, and
@@ -28,6 +31,16 @@ use crate::{Error, System};
 ///
 /// The samples contain the two atoms indexes, as well as the number of cell
 /// boundaries crossed to create this pair.
+///
+/// For systems with ghost atoms (see `System::local_size`), pairs between two
+/// ghosts are not included. Full neighbor lists only contain the entries where
+/// the first atom is local, and self pairs are only added for local atoms.
+///
+/// By default, there is one block for each pair of atomic types. With
+/// `single_block = true`, all pairs are instead stored in a single block, with
+/// the atomic types as additional samples dimensions. The samples are then
+/// sorted by pair of atomic types, such that all pairs with the same types are
+/// contiguous in memory.
 #[derive(Debug, Clone)]
 #[derive(serde::Deserialize, serde::Serialize, schemars::JsonSchema)]
 pub struct NeighborList {
@@ -41,6 +54,11 @@ pub struct NeighborList {
     /// to `true` will add "self pairs", i.e. pairs between an atom and itself,
     /// with the distance 0.
     pub self_pairs: bool,
+    /// Should all the pairs be stored in a single block (with
+    /// `"first_atom_type"` and `"second_atom_type"` as samples), or in separate
+    /// blocks for each pair of atomic types?
+    #[serde(default)]
+    pub single_block: bool,
 }
 
 /// Sort a pair and return true if the pair was inverted
@@ -68,37 +86,43 @@ impl CalculatorBase for NeighborList {
     fn keys(&self, systems: &mut [Box<dyn System>]) -> Result<Labels, Error> {
         assert!(self.cutoff > 0.0 && self.cutoff.is_finite());
 
-        if self.full_neighbor_list {
-            FullNeighborList {
-                cutoff: self.cutoff,
-                self_pairs: self.self_pairs,
-            }.keys(systems)
-        } else {
-            HalfNeighborList {
-                cutoff: self.cutoff,
-                self_pairs: self.self_pairs,
-            }.keys(systems)
+        if self.single_block {
+            return Ok(Labels::new(["_"], &[[0]]));
         }
+
+        return self.types_pairs_keys(systems);
     }
 
     fn sample_names(&self) -> Vec<&str> {
-        return vec!["system", "first_atom", "second_atom", "cell_shift_a", "cell_shift_b", "cell_shift_c"];
+        if self.single_block {
+            return SINGLE_BLOCK_SAMPLE_NAMES.to_vec();
+        }
+        return PAIR_SAMPLE_NAMES.to_vec();
     }
 
     fn samples(&self, keys: &Labels, systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
         assert!(self.cutoff > 0.0 && self.cutoff.is_finite());
 
-        if self.full_neighbor_list {
-            FullNeighborList {
-                cutoff: self.cutoff,
-                self_pairs: self.self_pairs,
-            }.samples(keys, systems)
-        } else {
-            HalfNeighborList {
-                cutoff: self.cutoff,
-                self_pairs: self.self_pairs,
-            }.samples(keys, systems)
+        if self.single_block {
+            assert_eq!(keys.names(), ["_"]);
+
+            let types_pairs = self.types_pairs_keys(systems)?;
+            let samples_by_types = self.types_pairs_samples(&types_pairs, systems)?;
+
+            let mut builder = LabelsBuilder::new(SINGLE_BLOCK_SAMPLE_NAMES.to_vec());
+            for (&[first_type, second_type], samples) in types_pairs.iter_fixed_size().zip(&samples_by_types) {
+                for sample in samples.iter() {
+                    let mut entry = vec![first_type, second_type];
+                    entry.extend_from_slice(sample);
+                    builder.add(&entry);
+                }
+            }
+            let samples = builder.finish();
+
+            return Ok(vec![samples; keys.count()]);
         }
+
+        return self.types_pairs_samples(keys, systems);
     }
 
     fn supports_gradient(&self, parameter: &str) -> bool {
@@ -110,11 +134,17 @@ impl CalculatorBase for NeighborList {
     }
 
     fn positions_gradient_samples(&self, _keys: &Labels, samples: &[Labels], _systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
-        let mut results = Vec::new();
+        // skip the atomic types in the samples when using a single block
+        let start = if self.single_block { 2 } else { 0 };
 
+        let mut results = Vec::new();
         for block_samples in samples {
             let mut builder = LabelsBuilder::new(vec!["sample", "system", "atom"]);
-            for (sample_i, &[system_i, first, second, cell_a, cell_b, cell_c]) in block_samples.iter_fixed_size().enumerate() {
+            for (sample_i, sample) in block_samples.iter().enumerate() {
+                let &[system_i, first, second, cell_a, cell_b, cell_c] = &sample[start..] else {
+                    unreachable!("invalid neighbor list sample");
+                };
+
                 // self pairs do not contribute to gradients
                 if first == second && cell_a == 0 && cell_b == 0 && cell_c == 0 {
                     continue;
@@ -147,7 +177,20 @@ impl CalculatorBase for NeighborList {
     }
 
     #[time_graph::instrument(name = "NeighborList::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+        if self.single_block {
+            let types_pairs = self.types_pairs_keys(systems)?;
+            return fill_pairs(
+                self.full_neighbor_list,
+                self.cutoff,
+                self.self_pairs,
+                &types_pairs,
+                true,
+                systems,
+                descriptor,
+            );
+        }
+
         if self.full_neighbor_list {
             FullNeighborList {
                 cutoff: self.cutoff,
@@ -162,6 +205,39 @@ impl CalculatorBase for NeighborList {
     }
 }
 
+impl NeighborList {
+    /// Get the pairs of atomic types in these systems, i.e. the keys when not
+    /// using a single block
+    fn types_pairs_keys(&self, systems: &mut [Box<dyn System>]) -> Result<Labels, Error> {
+        if self.full_neighbor_list {
+            FullNeighborList {
+                cutoff: self.cutoff,
+                self_pairs: self.self_pairs,
+            }.keys(systems)
+        } else {
+            HalfNeighborList {
+                cutoff: self.cutoff,
+                self_pairs: self.self_pairs,
+            }.keys(systems)
+        }
+    }
+
+    /// Get the samples for each pair of atomic types in `keys`
+    fn types_pairs_samples(&self, keys: &Labels, systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
+        if self.full_neighbor_list {
+            FullNeighborList {
+                cutoff: self.cutoff,
+                self_pairs: self.self_pairs,
+            }.samples(keys, systems)
+        } else {
+            HalfNeighborList {
+                cutoff: self.cutoff,
+                self_pairs: self.self_pairs,
+            }.samples(keys, systems)
+        }
+    }
+}
+
 /// Implementation of half neighbor list, only including pairs once (such that
 /// `types[atom_i] <= types[atom_j]`)
 #[derive(Debug, Clone)]
@@ -176,16 +252,15 @@ impl HalfNeighborList {
         for system in systems {
             system.compute_neighbors(self.cutoff)?;
 
-            let types = system.types()?;
-            for pair in system.pairs()? {
-                let (types_pair, _) = sort_pair((types[pair.first], types[pair.second]));
-                all_types_pairs.insert(types_pair);
-            }
+            // the summary contains both orders for each pair of types, only
+            // keep the sorted one
+            let summary = system.types_summary()?;
+            all_types_pairs.extend(summary.pairs.iter().copied().filter(|(first, second)| first <= second));
 
             // make sure we have self-pairs keys even if the system does not
             // contain any neighbors with the same atomic type
             if self.self_pairs {
-                for &atomic_type in types {
+                for &atomic_type in summary.types.keys() {
                     all_types_pairs.insert((atomic_type, atomic_type));
                 }
             }
@@ -200,165 +275,12 @@ impl HalfNeighborList {
     }
 
     fn samples(&self, keys: &Labels, systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
-        let mut results = Vec::new();
-
-        for [first_atom_type, second_atom_type] in keys.iter_fixed_size() {
-            let mut builder = LabelsBuilder::new(vec![
-                "system",
-                "first_atom",
-                "second_atom",
-                "cell_shift_a",
-                "cell_shift_b",
-                "cell_shift_c"
-            ]);
-
-            for (system_i, system) in systems.iter_mut().enumerate() {
-                system.compute_neighbors(self.cutoff)?;
-                let types = system.types()?;
-
-                for pair in system.pairs()? {
-                    let ((type_i, type_j), invert) = sort_pair((types[pair.first], types[pair.second]));
-
-                    let shifts = pair.cell_shift_indices;
-                    let (cell_a, cell_b, cell_c) = if invert {
-                        (-shifts[0], -shifts[1], -shifts[2])
-                    } else {
-                        (shifts[0], shifts[1], shifts[2])
-                    };
-
-                    let (atom_i, atom_j) = if invert {
-                        (pair.second, pair.first)
-                    } else {
-                        (pair.first, pair.second)
-                    };
-
-                    if type_i == first_atom_type.i32() && type_j == second_atom_type.i32() {
-                        builder.add(&[
-                            LabelValue::from(system_i),
-                            LabelValue::from(atom_i),
-                            LabelValue::from(atom_j),
-                            LabelValue::from(cell_a),
-                            LabelValue::from(cell_b),
-                            LabelValue::from(cell_c),
-                        ]);
-                    }
-                }
-
-                // handle self pairs
-                if self.self_pairs && first_atom_type == second_atom_type {
-                    for center_i in 0..system.size()? {
-                        if types[center_i] == first_atom_type.i32() {
-                            builder.add(&[
-                                system_i.into(),
-                                center_i.into(),
-                                center_i.into(),
-                                LabelValue::from(0),
-                                LabelValue::from(0),
-                                LabelValue::from(0),
-                            ]);
-                        }
-                    }
-                }
-            }
-
-            results.push(builder.finish());
-        }
-
-        return Ok(results);
+        return pairs_samples(false, self.cutoff, self.self_pairs, keys, systems);
     }
 
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
-        for (system_i, system) in systems.iter_mut().enumerate() {
-            system.compute_neighbors(self.cutoff)?;
-            let types = system.types()?;
-
-            for pair in system.pairs()? {
-                // Sort the atomic types in the pair to ensure a canonical order of
-                // the atoms in it. This guarantee that multiple call to this
-                // calculator always returns pairs in the same order, even if
-                // the underlying neighbor list implementation (which comes from
-                // the systems) changes.
-                //
-                // The `invert` variable tells us if we need to invert the pair
-                // vector or not.
-                let ((type_i, type_j), invert) = sort_pair((types[pair.first], types[pair.second]));
-
-                let pair_vector = if invert {
-                    -pair.vector
-                } else {
-                    pair.vector
-                };
-
-                let shifts = pair.cell_shift_indices;
-                let (cell_a, cell_b, cell_c) = if invert {
-                    (-shifts[0], -shifts[1], -shifts[2])
-                } else {
-                    (shifts[0], shifts[1], shifts[2])
-                };
-
-                let (atom_i, atom_j) = if invert {
-                    (pair.second, pair.first)
-                } else {
-                    (pair.first, pair.second)
-                };
-
-                let block_i = descriptor.keys().position(&[
-                    type_i.into(), type_j.into()
-                ]);
-
-                if let Some(block_i) = block_i {
-                    let mut block = descriptor.block_mut_by_id(block_i);
-                    let block_data = block.data_mut();
-
-                    let sample_i = block_data.samples.position(&[
-                        LabelValue::from(system_i),
-                        LabelValue::from(atom_i),
-                        LabelValue::from(atom_j),
-                        LabelValue::from(cell_a),
-                        LabelValue::from(cell_b),
-                        LabelValue::from(cell_c),
-                    ]);
-
-                    if let Some(sample_i) = sample_i {
-                        let array = block_data.values.to_array_mut();
-                        for (property_i, &[distance]) in block_data.properties.iter_fixed_size().enumerate() {
-                            if distance == 1 {
-                                array[[sample_i, 0, property_i]] = pair_vector[0];
-                                array[[sample_i, 1, property_i]] = pair_vector[1];
-                                array[[sample_i, 2, property_i]] = pair_vector[2];
-                            }
-                        }
-
-                        if let Some(mut gradient) = block.gradient_mut("positions") {
-                            let gradient = gradient.data_mut();
-
-                            let first_grad_sample_i = gradient.samples.position(&[
-                                sample_i.into(), system_i.into(), atom_i.into()
-                            ]).expect("missing gradient sample");
-                            let second_grad_sample_i = gradient.samples.position(&[
-                                sample_i.into(), system_i.into(), atom_j.into()
-                            ]).expect("missing gradient sample");
-
-                            let array = gradient.values.to_array_mut();
-
-                            for (property_i, &[distance]) in gradient.properties.iter_fixed_size().enumerate() {
-                                if distance == 1 {
-                                    array[[first_grad_sample_i, 0, 0, property_i]] = -1.0;
-                                    array[[first_grad_sample_i, 1, 1, property_i]] = -1.0;
-                                    array[[first_grad_sample_i, 2, 2, property_i]] = -1.0;
-
-                                    array[[second_grad_sample_i, 0, 0, property_i]] = 1.0;
-                                    array[[second_grad_sample_i, 1, 1, property_i]] = 1.0;
-                                    array[[second_grad_sample_i, 2, 2, property_i]] = 1.0;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        return Ok(());
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+        let keys = descriptor.keys().clone();
+        return fill_pairs(false, self.cutoff, self.self_pairs, &keys, false, systems, descriptor);
     }
 }
 
@@ -377,16 +299,13 @@ impl FullNeighborList {
         for system in systems {
             system.compute_neighbors(self.cutoff)?;
 
-            let types = system.types()?;
-            for pair in system.pairs()? {
-                all_types_pairs.insert((types[pair.first], types[pair.second]));
-                all_types_pairs.insert((types[pair.second], types[pair.first]));
-            }
+            let summary = system.types_summary()?;
+            all_types_pairs.extend(summary.pairs.iter().copied());
 
             // make sure we have self-pairs keys even if the system does not
             // contain any neighbors with the same atomic type
             if self.self_pairs {
-                for &atomic_type in types {
+                for &atomic_type in summary.types.keys() {
                     all_types_pairs.insert((atomic_type, atomic_type));
                 }
             }
@@ -401,218 +320,389 @@ impl FullNeighborList {
     }
 
     pub(crate) fn samples(&self, keys: &Labels, systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
-        let mut results = Vec::new();
-
-        for &[first_atom_type, second_atom_type] in keys.iter_fixed_size() {
-            let mut builder = LabelsBuilder::new(vec![
-                "system",
-                "first_atom",
-                "second_atom",
-                "cell_shift_a",
-                "cell_shift_b",
-                "cell_shift_c"
-            ]);
+        return pairs_samples(true, self.cutoff, self.self_pairs, keys, systems);
+    }
 
-            for (system_i, system) in systems.iter_mut().enumerate() {
-                system.compute_neighbors(self.cutoff)?;
-                let types = system.types()?;
-
-                for pair in system.pairs()? {
-                    let cell_a = pair.cell_shift_indices[0];
-                    let cell_b = pair.cell_shift_indices[1];
-                    let cell_c = pair.cell_shift_indices[2];
-
-                    if first_atom_type == second_atom_type {
-                        // same type for both atoms in the pair, add the pair
-                        // twice in both directions.
-                        if types[pair.first] == first_atom_type.i32() && types[pair.second] == second_atom_type.i32() {
-                            builder.add(&[
-                                LabelValue::from(system_i),
-                                LabelValue::from(pair.first),
-                                LabelValue::from(pair.second),
-                                LabelValue::from(cell_a),
-                                LabelValue::from(cell_b),
-                                LabelValue::from(cell_c),
-                            ]);
-
-                            builder.add(&[
-                                LabelValue::from(system_i),
-                                LabelValue::from(pair.second),
-                                LabelValue::from(pair.first),
-                                LabelValue::from(-cell_a),
-                                LabelValue::from(-cell_b),
-                                LabelValue::from(-cell_c),
-                            ]);
-                        }
-                    } else {
-                        // different types, find the right order for the pair
-                        if types[pair.first] == first_atom_type.i32() && types[pair.second] == second_atom_type.i32() {
-                            builder.add(&[
-                                LabelValue::from(system_i),
-                                LabelValue::from(pair.first),
-                                LabelValue::from(pair.second),
-                                LabelValue::from(cell_a),
-                                LabelValue::from(cell_b),
-                                LabelValue::from(cell_c),
-                            ]);
-                        } else if types[pair.second] == first_atom_type.i32() && types[pair.first] == second_atom_type.i32() {
-                            builder.add(&[
-                                LabelValue::from(system_i),
-                                LabelValue::from(pair.second),
-                                LabelValue::from(pair.first),
-                                LabelValue::from(-cell_a),
-                                LabelValue::from(-cell_b),
-                                LabelValue::from(-cell_c),
-                            ]);
-                        }
-                    }
-                }
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+        let keys = descriptor.keys().clone();
+        return fill_pairs(true, self.cutoff, self.self_pairs, &keys, false, systems, descriptor);
+    }
+}
 
-                // handle self pairs
-                if self.self_pairs && first_atom_type == second_atom_type {
-                    for center_i in 0..system.size()? {
-                        if types[center_i] == first_atom_type.i32() {
-                            builder.add(&[
-                                system_i.into(),
-                                center_i.into(),
-                                center_i.into(),
-                                LabelValue::from(0),
-                                LabelValue::from(0),
-                                LabelValue::from(0),
-                            ]);
-                        }
-                    }
-                }
-            }
+/// Names of the samples for the neighbor list, with one block per pair of types
+const PAIR_SAMPLE_NAMES: [&str; 6] = [
+    "system", "first_atom", "second_atom", "cell_shift_a", "cell_shift_b", "cell_shift_c"
+];
+
+/// Names of the samples for the neighbor list, when all pairs are in a single
+/// block
+const SINGLE_BLOCK_SAMPLE_NAMES: [&str; 8] = [
+    "first_atom_type", "second_atom_type",
+    "system", "first_atom", "second_atom", "cell_shift_a", "cell_shift_b", "cell_shift_c"
+];
+
+/// Get the entries corresponding to a single pair in the neighbor list output,
+/// as the atomic types of the entry and whether the pair must be inverted
+/// (i.e. going from `pair.second` to `pair.first`).
+///
+/// Half neighbor lists contain a single entry for each pair, sorting the
+/// atomic types in the pair to ensure a canonical order of the atoms in it.
+/// This guarantee that multiple call to this calculator always returns pairs
+/// in the same order, even if the underlying neighbor list implementation
+/// (which comes from the systems) changes. Full neighbor lists contain two
+/// entries for each pair, one in each direction.
+///
+/// Atoms with an index larger than `n_local` are ghosts: full neighbor lists
+/// only contain the entries starting from a local atom, and half neighbor lists
+/// skip pairs between two ghosts.
+fn pair_entries(full: bool, n_local: usize, types: &[i32], pair: &Pair) -> [Option<((i32, i32), bool)>; 2] {
+    let first_type = types[pair.first];
+    let second_type = types[pair.second];
+
+    if full {
+        if pair.first == pair.second {
+            // self pairs should not be part of the neighbors list
+            assert_ne!(pair.cell_shift_indices, [0, 0, 0]);
+        }
 
-            results.push(builder.finish());
+        return [
+            (pair.first < n_local).then_some(((first_type, second_type), false)),
+            (pair.second < n_local).then_some(((second_type, first_type), true)),
+        ];
+    } else {
+        if pair.first >= n_local && pair.second >= n_local {
+            return [None, None];
         }
 
-        return Ok(results);
+        let (types_pair, invert) = sort_pair((first_type, second_type));
+        return [Some((types_pair, invert)), None];
     }
+}
 
-    #[allow(clippy::too_many_lines)]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
-        for (system_i, system) in systems.iter_mut().enumerate() {
-            system.compute_neighbors(self.cutoff)?;
-            let types = system.types()?;
+/// Get the sample corresponding to the given pair, potentially inverted
+fn pair_sample(system_i: usize, pair: &Pair, invert: bool) -> [LabelValue; 6] {
+    let shifts = pair.cell_shift_indices;
+    if invert {
+        return [
+            LabelValue::from(system_i),
+            LabelValue::from(pair.second),
+            LabelValue::from(pair.first),
+            LabelValue::from(-shifts[0]),
+            LabelValue::from(-shifts[1]),
+            LabelValue::from(-shifts[2]),
+        ];
+    } else {
+        return [
+            LabelValue::from(system_i),
+            LabelValue::from(pair.first),
+            LabelValue::from(pair.second),
+            LabelValue::from(shifts[0]),
+            LabelValue::from(shifts[1]),
+            LabelValue::from(shifts[2]),
+        ];
+    }
+}
 
-            for pair in system.pairs()? {
-                if pair.first == pair.second {
-                    // self pairs should not be part of the neighbors list
-                    assert_ne!(pair.cell_shift_indices, [0, 0, 0]);
+/// Get the samples for the given `keys` (containing pairs of atomic types),
+/// going over the pairs in each system only once.
+///
+/// For each system, the samples contain first the pairs in the order of
+/// `System::pairs`, and then the self pairs if requested. `fill_pairs` relies
+/// on this order.
+fn pairs_samples(
+    full: bool,
+    cutoff: f64,
+    self_pairs: bool,
+    keys: &Labels,
+    systems: &mut [Box<dyn System>],
+) -> Result<Vec<Labels>, Error> {
+    let blocks = keys.iter_fixed_size().enumerate()
+        .map(|(block_i, &[first_type, second_type])| ((first_type.i32(), second_type.i32()), block_i))
+        .collect::<BTreeMap<_, _>>();
+
+    let mut builders = (0..keys.count())
+        .map(|_| LabelsBuilder::new(PAIR_SAMPLE_NAMES.to_vec()))
+        .collect::<Vec<_>>();
+
+    for (system_i, system) in systems.iter_mut().enumerate() {
+        system.compute_neighbors(cutoff)?;
+        let types = system.types()?;
+        let n_local = system.local_size()?;
+
+        for pair in system.pairs()? {
+            for (types_pair, invert) in pair_entries(full, n_local, types, pair).into_iter().flatten() {
+                if let Some(&block_i) = blocks.get(&types_pair) {
+                    builders[block_i].add(&pair_sample(system_i, pair, invert));
                 }
+            }
+        }
 
-                let first_block_i = descriptor.keys().position(&[
-                    types[pair.first].into(), types[pair.second].into()
-                ]);
-
-                let second_block_i = descriptor.keys().position(&[
-                    types[pair.second].into(), types[pair.first].into()
-                ]);
-
-                let cell_a = pair.cell_shift_indices[0];
-                let cell_b = pair.cell_shift_indices[1];
-                let cell_c = pair.cell_shift_indices[2];
-
-                // first, the pair first -> second
-                if let Some(first_block_i) = first_block_i {
-                    let mut block = descriptor.block_mut_by_id(first_block_i);
-                    let block_data = block.data_mut();
-
-                    let sample_i = block_data.samples.position(&[
+        if self_pairs {
+            for (center_i, &center_type) in types.iter().take(n_local).enumerate() {
+                if let Some(&block_i) = blocks.get(&(center_type, center_type)) {
+                    builders[block_i].add(&[
                         LabelValue::from(system_i),
-                        LabelValue::from(pair.first),
-                        LabelValue::from(pair.second),
-                        LabelValue::from(cell_a),
-                        LabelValue::from(cell_b),
-                        LabelValue::from(cell_c),
+                        LabelValue::from(center_i),
+                        LabelValue::from(center_i),
+                        LabelValue::from(0),
+                        LabelValue::from(0),
+                        LabelValue::from(0),
                     ]);
+                }
+            }
+        }
+    }
 
-                    if let Some(sample_i) = sample_i {
-                        let array = block_data.values.to_array_mut();
-
-                        for (property_i, &[distance]) in block_data.properties.iter_fixed_size().enumerate() {
-                            if distance == 1 {
-                                array[[sample_i, 0, property_i]] = pair.vector[0];
-                                array[[sample_i, 1, property_i]] = pair.vector[1];
-                                array[[sample_i, 2, property_i]] = pair.vector[2];
-                            }
-                        }
-
-                        if let Some(mut gradient) = block.gradient_mut("positions") {
-                            let gradient = gradient.data_mut();
+    return Ok(builders.into_iter().map(LabelsBuilder::finish).collect());
+}
 
-                            let first_grad_sample_i = gradient.samples.position(&[
-                                sample_i.into(), system_i.into(), pair.first.into()
-                            ]).expect("missing gradient sample");
-                            let second_grad_sample_i = gradient.samples.position(&[
-                                sample_i.into(), system_i.into(), pair.second.into()
-                            ]).expect("missing gradient sample");
+/// Number of pairs handled by a single task when filling the neighbor list in
+/// parallel
+const PAIRS_CHUNK_SIZE: usize = 4096;
+
+/// Pointer to the data of a block, used to write to different samples of the
+/// same block from multiple threads
+#[derive(Debug, Clone, Copy)]
+struct DataPtr(*mut f64);
+
+// SAFETY: the pointers are only used to write to non-overlapping samples from
+// different threads, while the corresponding `TensorMap` is not accessed
+unsafe impl Send for DataPtr {}
+// SAFETY: see above
+unsafe impl Sync for DataPtr {}
+
+/// Where the samples for a given pair of atomic types are in the output
+#[derive(Debug, Clone, Copy)]
+struct TypesPairOutput {
+    /// Index of the block containing these samples
+    block_i: usize,
+    /// Index of the first sample for this pair of types
+    first_sample: usize,
+    /// Index of the first positions gradient sample for this pair of types
+    first_gradient_sample: usize,
+}
 
-                            let array = gradient.values.to_array_mut();
+/// Fill the values (and positions gradients) of the neighbor list output in
+/// parallel.
+///
+/// The pairs of all systems are split in chunks. A first counting pass gives
+/// the number of entries for each pair of types in each chunk, and from this
+/// the position of the samples of each chunk in the output, assuming the
+/// samples are in the order created by `pairs_samples`. The second pass then
+/// writes directly at this position, only searching for the sample when it
+/// does not match (for example when the user requested a subset of the
+/// samples).
+///
+/// `type_pairs` contains the pairs of atomic types in the output. If
+/// `single_block` is `false`, these must be the keys of `descriptor`.
+/// Otherwise the descriptor must contain a single block, with samples for all
+/// `type_pairs` one after the other.
+#[allow(clippy::too_many_lines)]
+fn fill_pairs(
+    full: bool,
+    cutoff: f64,
+    self_pairs: bool,
+    type_pairs: &Labels,
+    single_block: bool,
+    systems: &mut [Box<dyn System>],
+    descriptor: &mut TensorMap,
+) -> Result<(), Error> {
+    systems.par_iter_mut().try_for_each(|system| system.compute_neighbors(cutoff))?;
+    let systems = &*systems;
+
+    let n_type_pairs = type_pairs.count();
+    let type_pairs_ids = type_pairs.iter_fixed_size().enumerate()
+        .map(|(id, &[first_type, second_type])| ((first_type.i32(), second_type.i32()), id))
+        .collect::<BTreeMap<_, _>>();
+
+    // split the pairs of all systems in chunks
+    let mut chunks = Vec::new();
+    let mut chunks_by_system = Vec::new();
+    for (system_i, system) in systems.iter().enumerate() {
+        let n_pairs = system.pairs()?.len();
+        let first_chunk = chunks.len();
+        for start in (0..n_pairs).step_by(PAIRS_CHUNK_SIZE) {
+            chunks.push((system_i, start..usize::min(start + PAIRS_CHUNK_SIZE, n_pairs)));
+        }
+        chunks_by_system.push(first_chunk..chunks.len());
+    }
 
-                            for (property_i, &[distance]) in gradient.properties.iter_fixed_size().enumerate() {
-                                if distance == 1 {
-                                    array[[first_grad_sample_i, 0, 0, property_i]] = -1.0;
-                                    array[[first_grad_sample_i, 1, 1, property_i]] = -1.0;
-                                    array[[first_grad_sample_i, 2, 2, property_i]] = -1.0;
+    // counting pass, getting the number of entries for each pair of types in
+    // each chunk
+    let counts = chunks.par_iter().map(|(system_i, pairs_range)| {
+        let system = &systems[*system_i];
+        let types = system.types()?;
+        let n_local = system.local_size()?;
+
+        let mut counts = vec![0; n_type_pairs];
+        for pair in &system.pairs()?[pairs_range.clone()] {
+            for (types_pair, _) in pair_entries(full, n_local, types, pair).into_iter().flatten() {
+                if let Some(&id) = type_pairs_ids.get(&types_pair) {
+                    counts[id] += 1;
+                }
+            }
+        }
+        return Ok::<_, Error>(counts);
+    }).collect::<Result<Vec<_>, Error>>()?;
+
+    // get the position of the first sample of each chunk, for each pair of
+    // types. Self pairs come after all the other pairs in a system, and do not
+    // have gradients.
+    let mut chunks_offsets = vec![Vec::new(); chunks.len()];
+    let mut n_samples = vec![0; n_type_pairs];
+    let mut n_gradient_samples = vec![0; n_type_pairs];
+    for (system, system_chunks) in systems.iter().zip(&chunks_by_system) {
+        for chunk_i in system_chunks.clone() {
+            chunks_offsets[chunk_i] = n_samples.iter().copied().zip(n_gradient_samples.iter().copied()).collect();
+            for id in 0..n_type_pairs {
+                n_samples[id] += counts[chunk_i][id];
+                n_gradient_samples[id] += 2 * counts[chunk_i][id];
+            }
+        }
 
-                                    array[[second_grad_sample_i, 0, 0, property_i]] = 1.0;
-                                    array[[second_grad_sample_i, 1, 1, property_i]] = 1.0;
-                                    array[[second_grad_sample_i, 2, 2, property_i]] = 1.0;
-                                }
-                            }
-                        }
-                    }
+        if self_pairs {
+            // self pairs are only created for local atoms
+            let n_local = system.local_size()?;
+            for atomic_type in &system.types()?[..n_local] {
+                if let Some(&id) = type_pairs_ids.get(&(*atomic_type, *atomic_type)) {
+                    n_samples[id] += 1;
                 }
+            }
+        }
+    }
 
-                // then the pair second -> first
-                if let Some(second_block_i) = second_block_i {
-                    let mut block = descriptor.block_mut_by_id(second_block_i);
+    let outputs = if single_block {
+        assert_eq!(descriptor.keys().count(), 1);
+        let mut first_sample = 0;
+        let mut first_gradient_sample = 0;
+        (0..n_type_pairs).map(|id| {
+            let output = TypesPairOutput {
+                block_i: 0,
+                first_sample: first_sample,
+                first_gradient_sample: first_gradient_sample,
+            };
+            first_sample += n_samples[id];
+            first_gradient_sample += n_gradient_samples[id];
+            Some(output)
+        }).collect::<Vec<_>>()
+    } else {
+        type_pairs.iter().map(|types_pair| {
+            descriptor.keys().position(types_pair).map(|block_i| TypesPairOutput {
+                block_i: block_i,
+                first_sample: 0,
+                first_gradient_sample: 0,
+            })
+        }).collect::<Vec<_>>()
+    };
+
+    let n_blocks = descriptor.keys().count();
+    let samples = (0..n_blocks)
+        .map(|block_i| descriptor.block_by_id(block_i).samples())
+        .collect::<Vec<_>>();
+    let gradient_samples = (0..n_blocks)
+        .map(|block_i| descriptor.block_by_id(block_i).gradient("positions").map(|gradient| gradient.samples()))
+        .collect::<Vec<_>>();
+    let properties = (0..n_blocks).map(|block_i| {
+        let properties = descriptor.block_by_id(block_i).properties();
+        (properties.count(), properties.position(&[LabelValue::new(1)]))
+    }).collect::<Vec<_>>();
+
+    let mut values = Vec::new();
+    let mut gradients = Vec::new();
+    for (_, mut block) in &mut *descriptor {
+        let block_data = block.data_mut();
+        let array = block_data.values.to_array_mut();
+        assert!(array.is_standard_layout());
+        values.push(DataPtr(array.as_mut_ptr()));
+
+        gradients.push(block.gradient_mut("positions").map(|mut gradient| {
+            let gradient = gradient.data_mut();
+            let array = gradient.values.to_array_mut();
+            assert!(array.is_standard_layout());
+            DataPtr(array.as_mut_ptr())
+        }));
+    }
 
-                    let block_data = block.data_mut();
-                    let sample_i = block_data.samples.position(&[
-                        LabelValue::from(system_i),
-                        LabelValue::from(pair.second),
-                        LabelValue::from(pair.first),
-                        LabelValue::from(-cell_a),
-                        LabelValue::from(-cell_b),
-                        LabelValue::from(-cell_c),
-                    ]);
+    chunks.par_iter().zip_eq(&chunks_offsets).try_for_each(|((system_i, pairs_range), offsets)| {
+        let system_i = *system_i;
+        let system = &systems[system_i];
+        let types = system.types()?;
+        let n_local = system.local_size()?;
+
+        let mut offsets = offsets.clone();
+        let mut full_sample = [LabelValue::new(0); 8];
+        for pair in &system.pairs()?[pairs_range.clone()] {
+            for (types_pair, invert) in pair_entries(full, n_local, types, pair).into_iter().flatten() {
+                let Some(&id) = type_pairs_ids.get(&types_pair) else {
+                    continue;
+                };
 
-                    if let Some(sample_i) = sample_i {
-                        let array = block_data.values.to_array_mut();
-                        for (property_i, &[distance]) in block_data.properties.iter_fixed_size().enumerate() {
-                            if distance == 1 {
-                                array[[sample_i, 0, property_i]] = -pair.vector[0];
-                                array[[sample_i, 1, property_i]] = -pair.vector[1];
-                                array[[sample_i, 2, property_i]] = -pair.vector[2];
-                            }
-                        }
+                let (expected_sample, expected_gradient_sample) = offsets[id];
+                offsets[id].0 += 1;
+                offsets[id].1 += 2;
 
-                        if let Some(mut gradient) = block.gradient_mut("positions") {
-                            let gradient = gradient.data_mut();
+                let Some(output) = outputs[id] else {
+                    continue;
+                };
+                let block_i = output.block_i;
+
+                full_sample[0] = LabelValue::from(types_pair.0);
+                full_sample[1] = LabelValue::from(types_pair.1);
+                full_sample[2..].copy_from_slice(&pair_sample(system_i, pair, invert));
+                let sample = if single_block { &full_sample[..] } else { &full_sample[2..] };
+
+                let samples = &samples[block_i];
+                let expected_sample = output.first_sample + expected_sample;
+                let sample_i = if expected_sample < samples.count() && &samples[expected_sample] == sample {
+                    expected_sample
+                } else if let Some(sample_i) = samples.position(sample) {
+                    sample_i
+                } else {
+                    continue;
+                };
 
-                            let first_grad_sample_i = gradient.samples.position(&[
-                                sample_i.into(), system_i.into(), pair.second.into()
-                            ]).expect("missing gradient sample");
-                            let second_grad_sample_i = gradient.samples.position(&[
-                                sample_i.into(), system_i.into(), pair.first.into()
-                            ]).expect("missing gradient sample");
+                let (n_properties, distance_property) = properties[block_i];
+                let Some(property_i) = distance_property else {
+                    continue;
+                };
 
-                            let array = gradient.values.to_array_mut();
+                let vector = if invert { -pair.vector } else { pair.vector };
+                for xyz in 0..3 {
+                    // SAFETY: the values array has shape (samples, 3,
+                    // properties), and each sample corresponds to a single
+                    // entry of a single pair, so different threads always
+                    // write to different locations.
+                    unsafe {
+                        *values[block_i].0.add((sample_i * 3 + xyz) * n_properties + property_i) = vector[xyz];
+                    }
+                }
 
-                            for (property_i, &[distance]) in gradient.properties.iter_fixed_size().enumerate() {
-                                if distance == 1 {
-                                    array[[first_grad_sample_i, 0, 0, property_i]] = -1.0;
-                                    array[[first_grad_sample_i, 1, 1, property_i]] = -1.0;
-                                    array[[first_grad_sample_i, 2, 2, property_i]] = -1.0;
+                if let (Some(gradient_samples), Some(gradient)) = (&gradient_samples[block_i], gradients[block_i]) {
+                    let (first, second) = if invert {
+                        (pair.second, pair.first)
+                    } else {
+                        (pair.first, pair.second)
+                    };
 
-                                    array[[second_grad_sample_i, 0, 0, property_i]] = 1.0;
-                                    array[[second_grad_sample_i, 1, 1, property_i]] = 1.0;
-                                    array[[second_grad_sample_i, 2, 2, property_i]] = 1.0;
-                                }
+                    let expected_gradient_sample = output.first_gradient_sample + expected_gradient_sample;
+                    let atoms = [(first, -1.0), (second, 1.0)];
+                    for (delta, (atom, value)) in atoms.into_iter().enumerate() {
+                        let gradient_sample = [LabelValue::from(sample_i), LabelValue::from(system_i), LabelValue::from(atom)];
+
+                        let expected = expected_gradient_sample + delta;
+                        let gradient_sample_i = if expected < gradient_samples.count() && gradient_samples[expected] == gradient_sample {
+                            expected
+                        } else {
+                            gradient_samples.position(&gradient_sample).expect("missing gradient sample")
+                        };
+
+                        for xyz in 0..3 {
+                            // SAFETY: the gradient array has shape (gradient
+                            // samples, 3, 3, properties), and each gradient
+                            // sample is only written by a single thread
+                            unsafe {
+                                let index = ((gradient_sample_i * 3 + xyz) * 3 + xyz) * n_properties + property_i;
+                                *gradient.0.add(index) = value;
                             }
                         }
                     }
@@ -620,28 +710,32 @@ impl FullNeighborList {
             }
         }
 
-        return Ok(());
-    }
+        return Ok::<(), Error>(());
+    })?;
+
+    return Ok(());
 }
 
 
 #[cfg(test)]
 mod tests {
     use approx::assert_relative_eq;
-    use metatensor::Labels;
+    use ndarray::s;
+    use metatensor::{Labels, LabelValue};
 
     use crate::systems::test_utils::{test_systems, test_system};
-    use crate::Calculator;
+    use crate::{Calculator, CalculationOptions, System};
 
-    use super::NeighborList;
+    use super::{NeighborList, PAIRS_CHUNK_SIZE, pair_entries, pair_sample};
     use super::super::CalculatorBase;
 
     #[test]
     fn half_neighbor_list() {
-        let mut calculator = Calculator::from(Box::new(NeighborList{
+        let calculator = Calculator::from(Box::new(NeighborList{
             cutoff: 2.0,
             full_neighbor_list: false,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
 
         let mut systems = test_systems(&["water"]);
@@ -692,10 +786,11 @@ mod tests {
 
     #[test]
     fn full_neighbor_list() {
-        let mut calculator = Calculator::from(Box::new(NeighborList{
+        let calculator = Calculator::from(Box::new(NeighborList{
             cutoff: 2.0,
             full_neighbor_list: true,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
 
         let mut systems = test_systems(&["water"]);
@@ -770,10 +865,11 @@ mod tests {
 
     #[test]
     fn periodic_neighbor_list() {
-        let mut calculator = Calculator::from(Box::new(NeighborList{
+        let calculator = Calculator::from(Box::new(NeighborList{
             cutoff: 12.0,
             full_neighbor_list: false,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
 
         let mut systems = test_systems(&["CH"]);
@@ -801,10 +897,11 @@ mod tests {
         assert_relative_eq!(array, expected, max_relative=1e-6);
 
         // now a full NL
-        let mut calculator = Calculator::from(Box::new(NeighborList{
+        let calculator = Calculator::from(Box::new(NeighborList{
             cutoff: 12.0,
             full_neighbor_list: true,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
 
         let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
@@ -844,6 +941,7 @@ mod tests {
             cutoff: 1.0,
             full_neighbor_list: false,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
 
         let system = test_system("water");
@@ -859,8 +957,78 @@ mod tests {
             cutoff: 1.0,
             full_neighbor_list: true,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
         crate::calculators::tests_utils::finite_differences_positions(calculator, &system, options);
+
+        // single block
+        for full_neighbor_list in [false, true] {
+            let calculator = Calculator::from(Box::new(NeighborList {
+                cutoff: 1.0,
+                full_neighbor_list: full_neighbor_list,
+                self_pairs: false,
+                single_block: true,
+            }) as Box<dyn CalculatorBase>);
+            crate::calculators::tests_utils::finite_differences_positions(calculator, &system, options);
+        }
+    }
+
+    #[test]
+    fn single_block() {
+        for full_neighbor_list in [false, true] {
+            let calculator = Calculator::from(Box::new(NeighborList {
+                cutoff: 3.0,
+                full_neighbor_list: full_neighbor_list,
+                self_pairs: true,
+                single_block: false,
+            }) as Box<dyn CalculatorBase>);
+            let mut systems = test_systems(&["water", "methane"]);
+            let options = CalculationOptions {
+                gradients: &["positions"],
+                ..Default::default()
+            };
+            let by_types = calculator.compute(&mut systems, options).unwrap();
+
+            let calculator = Calculator::from(Box::new(NeighborList {
+                cutoff: 3.0,
+                full_neighbor_list: full_neighbor_list,
+                self_pairs: true,
+                single_block: true,
+            }) as Box<dyn CalculatorBase>);
+            let mut systems = test_systems(&["water", "methane"]);
+            let options = CalculationOptions {
+                gradients: &["positions"],
+                ..Default::default()
+            };
+            let descriptor = calculator.compute(&mut systems, options).unwrap();
+
+            assert_eq!(descriptor.keys(), &Labels::new(["_"], &[[0]]));
+            let block = descriptor.block_by_id(0);
+            let samples = block.samples();
+            assert_eq!(samples.names(), [
+                "first_atom_type", "second_atom_type",
+                "system", "first_atom", "second_atom", "cell_shift_a", "cell_shift_b", "cell_shift_c"
+            ]);
+            let values = block.values().to_array();
+
+            // the single block contains all the blocks one after the other
+            let mut sample_i = 0;
+            let mut n_gradient_samples = 0;
+            for (key, expected) in by_types.keys().iter().zip(by_types.blocks()) {
+                let expected_values = expected.values().to_array();
+                for (expected_i, expected_sample) in expected.samples().iter().enumerate() {
+                    assert_eq!(&samples[sample_i][..2], key);
+                    assert_eq!(&samples[sample_i][2..], expected_sample);
+                    assert_eq!(values.slice(s![sample_i, .., ..]), expected_values.slice(s![expected_i, .., ..]));
+                    sample_i += 1;
+                }
+                n_gradient_samples += expected.gradient("positions").unwrap().samples().count();
+            }
+            assert_eq!(sample_i, samples.count());
+
+            let gradient = block.gradient("positions").unwrap();
+            assert_eq!(gradient.samples().count(), n_gradient_samples);
+        }
     }
 
     #[test]
@@ -870,6 +1038,7 @@ mod tests {
             cutoff: 3.0,
             full_neighbor_list: false,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
         let mut systems = test_systems(&["water", "methane"]);
 
@@ -897,18 +1066,72 @@ mod tests {
             cutoff: 3.0,
             full_neighbor_list: true,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
         crate::calculators::tests_utils::compute_partial(
             calculator, &mut systems, &keys, &samples, &properties
         );
     }
 
+    #[test]
+    fn many_pairs() {
+        // use a large cutoff to get more pairs than fit in a single chunk,
+        // with multiple systems to check the offsets between systems
+        let cutoff = 25.0;
+        let mut systems = test_systems(&["water", "water"]);
+        for system in &mut systems {
+            system.compute_neighbors(cutoff).unwrap();
+            assert!(system.pairs().unwrap().len() > 2 * PAIRS_CHUNK_SIZE);
+        }
+
+        for full in [false, true] {
+            let calculator = Calculator::from(Box::new(NeighborList {
+                cutoff: cutoff,
+                full_neighbor_list: full,
+                self_pairs: true,
+                single_block: false,
+            }) as Box<dyn CalculatorBase>);
+            let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+            // go over the pairs one by one, and check the corresponding sample
+            let mut n_samples = 0;
+            for (system_i, system) in systems.iter().enumerate() {
+                let types = system.types().unwrap();
+                n_samples += types.len();
+
+                for pair in system.pairs().unwrap() {
+                    for ((first_type, second_type), invert) in pair_entries(full, types.len(), types, pair).into_iter().flatten() {
+                        n_samples += 1;
+
+                        let key = [LabelValue::new(first_type), LabelValue::new(second_type)];
+                        let block = descriptor.block_by_id(descriptor.keys().position(&key).unwrap());
+                        let sample_i = block.samples().position(&pair_sample(system_i, pair, invert)).unwrap();
+
+                        let vector = if invert { -pair.vector } else { pair.vector };
+                        let values = block.values().to_array();
+                        let values = values.slice(s![sample_i, .., 0]);
+                        for xyz in 0..3 {
+                            assert_eq!(values[xyz], vector[xyz]);
+                        }
+                    }
+                }
+            }
+
+            let mut total_samples = 0;
+            for (_, block) in &descriptor {
+                total_samples += block.samples().count();
+            }
+            assert_eq!(total_samples, n_samples);
+        }
+    }
+
     #[test]
     fn check_self_pairs() {
-        let mut calculator = Calculator::from(Box::new(NeighborList {
+        let calculator = Calculator::from(Box::new(NeighborList {
             cutoff: 2.0,
             full_neighbor_list: true,
             self_pairs: true,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
         let mut systems = test_systems(&["water"]);
 
@@ -940,10 +1163,11 @@ mod tests {
     }
     #[test]
     fn check_empty_response() {
-        let mut calculator = Calculator::from(Box::new(NeighborList {
+        let calculator = Calculator::from(Box::new(NeighborList {
             cutoff: 0.1,
             full_neighbor_list: true,
             self_pairs: false,
+            single_block: false,
         }) as Box<dyn CalculatorBase>);
         let mut systems = test_systems(&["water"]);
 
@@ -955,4 +1179,63 @@ mod tests {
             &[],
         ));
     }
+
+    #[test]
+    fn ghost_atoms() {
+        let sample_names = ["system", "first_atom", "second_atom", "cell_shift_a", "cell_shift_b", "cell_shift_c"];
+
+        // only the oxygen is local
+        let mut water = test_system("water");
+        water.set_local_size(1);
+        let mut systems = vec![Box::new(water) as Box<dyn System>];
+
+        let half = Calculator::from(Box::new(NeighborList {
+            cutoff: 2.0,
+            full_neighbor_list: false,
+            self_pairs: false,
+            single_block: false,
+        }) as Box<dyn CalculatorBase>);
+        let descriptor = half.compute(&mut systems, Default::default()).unwrap();
+
+        // O-H pairs are kept, H-H pairs are between two ghosts
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(-42), LabelValue::new(1)]).unwrap());
+        assert_eq!(block.samples(), Labels::new(sample_names, &[[0, 0, 1, 0, 0, 0], [0, 0, 2, 0, 0, 0]]));
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(1), LabelValue::new(1)]).unwrap());
+        assert_eq!(block.samples().count(), 0);
+
+        let full = Calculator::from(Box::new(NeighborList {
+            cutoff: 2.0,
+            full_neighbor_list: true,
+            self_pairs: true,
+            single_block: false,
+        }) as Box<dyn CalculatorBase>);
+        let options = CalculationOptions {
+            gradients: &["positions"],
+            ..Default::default()
+        };
+        let descriptor = full.compute(&mut systems, options).unwrap();
+
+        // only entries starting from the oxygen remain
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(-42), LabelValue::new(-42)]).unwrap());
+        assert_eq!(block.samples(), Labels::new(sample_names, &[[0, 0, 0, 0, 0, 0]]));
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(1), LabelValue::new(-42)]).unwrap());
+        assert_eq!(block.samples().count(), 0);
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(1), LabelValue::new(1)]).unwrap());
+        assert_eq!(block.samples().count(), 0);
+
+        let block = descriptor.block_by_id(descriptor.keys().position(&[LabelValue::new(-42), LabelValue::new(1)]).unwrap());
+        assert_eq!(block.samples(), Labels::new(sample_names, &[[0, 0, 1, 0, 0, 0], [0, 0, 2, 0, 0, 0]]));
+
+        // values and gradients are the same as without ghosts
+        let mut reference_systems = test_systems(&["water"]);
+        let reference = full.compute(&mut reference_systems, options).unwrap();
+        let expected = reference.block_by_id(reference.keys().position(&[LabelValue::new(-42), LabelValue::new(1)]).unwrap());
+        assert_eq!(block.samples(), expected.samples());
+        assert_relative_eq!(block.values().to_array(), expected.values().to_array());
+
+        let gradient = block.gradient("positions").unwrap();
+        let expected = expected.gradient("positions").unwrap();
+        assert_eq!(gradient.samples(), expected.samples());
+        assert_relative_eq!(gradient.values().to_array(), expected.values().to_array());
+    }
 }
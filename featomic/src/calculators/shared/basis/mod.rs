@@ -2,7 +2,7 @@ pub(crate) mod radial;
 
 use std::collections::BTreeMap;
 
-pub use self::radial::{SoapRadialBasis, LodeRadialBasis};
+pub use self::radial::{SoapRadialBasis, LodeRadialBasis, register_tabulated_basis};
 
 /// Possible Basis functions to use for the SOAP or LODE spherical expansion.
 ///
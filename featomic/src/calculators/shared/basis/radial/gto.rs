@@ -1,7 +1,23 @@
+use std::collections::BTreeMap;
+use std::sync::{Arc, Mutex};
+
 use ndarray::{Array1, Array2};
+use once_cell::sync::{Lazy, OnceCell};
 
 use crate::math::gamma;
 
+/// Maximal number of entries in `ORTHONORMALIZATION_MATRICES`
+const MAX_CACHED_ORTHONORMALIZATION: usize = 64;
+
+/// Cache for the GTO orthonormalization matrices, indexed by the basis size
+/// and the bits of the basis radius. The matrix does not depend on the angular
+/// channel, so all channels (and all calculators) with the same basis share
+/// the same entry. Each entry is initialized once, even when multiple threads
+/// ask for the same matrix at the same time.
+static ORTHONORMALIZATION_MATRICES: Lazy<Mutex<BTreeMap<(usize, u64), CachedMatrix>>> = Lazy::new(Default::default);
+
+type CachedMatrix = Arc<OnceCell<Array2<f64>>>;
+
 /// Use a radial basis similar to Gaussian-Type Orbitals.
 ///
 /// The basis is defined as `R_n(r) ∝ r^n e^{- r^2 / (2 σ_n^2)}`, where `σ_n
@@ -49,8 +65,28 @@ impl GtoRadialBasis {
         }).collect();
     }
 
-    /// Get the matrix to orthonormalize the GTO basis
+    /// Get the matrix to orthonormalize the GTO basis.
+    ///
+    /// The matrix is only computed once for a given basis size and radius, and
+    /// then re-used for all angular channels and all calculators.
     pub fn orthonormalization_matrix(&self) -> Array2<f64> {
+        let key = (self.size, self.radius.to_bits());
+        let entry = {
+            let mut cache = ORTHONORMALIZATION_MATRICES.lock().expect("mutex was poisoned");
+            if !cache.contains_key(&key) && cache.len() >= MAX_CACHED_ORTHONORMALIZATION {
+                cache.pop_first();
+            }
+            Arc::clone(cache.entry(key).or_default())
+        };
+
+        // compute the matrix without holding the lock on the whole cache,
+        // since this can panic for ill-conditioned basis. Other threads asking
+        // for the same matrix wait for this computation instead of repeating
+        // it, and try again if it panicked.
+        return entry.get_or_init(|| self.compute_orthonormalization_matrix()).clone();
+    }
+
+    fn compute_orthonormalization_matrix(&self) -> Array2<f64> {
         let normalization = self.gaussian_widths().iter()
             .zip(0..self.size)
             .map(|(sigma, n)| f64::sqrt(2.0 / (sigma.powi(2 * n as i32 + 3) * gamma(n as f64 + 1.5))))
@@ -78,7 +114,8 @@ impl GtoRadialBasis {
 
 #[cfg(test)]
 mod tests {
-    use approx::assert_ulps_eq;
+    use approx::{assert_relative_eq, assert_ulps_eq};
+    use rayon::prelude::*;
     use super::*;
 
     #[test]
@@ -102,4 +139,35 @@ mod tests {
             }
         }
     }
+
+    #[test]
+    fn cached_orthonormalization() {
+        let basis = GtoRadialBasis {
+            size: 7,
+            radius: 4.2,
+        };
+
+        let first = basis.orthonormalization_matrix();
+        let cached = basis.orthonormalization_matrix();
+        assert_eq!(first, cached);
+        assert_relative_eq!(first, basis.compute_orthonormalization_matrix(), max_relative=1e-12);
+
+        let other = GtoRadialBasis {
+            size: 7,
+            radius: 4.3,
+        };
+        assert_ne!(first, other.orthonormalization_matrix());
+
+        // concurrent requests for a new basis all get the same matrix
+        let basis = GtoRadialBasis {
+            size: 9,
+            radius: 4.2,
+        };
+        let matrices = (0..16).into_par_iter()
+            .map(|_| basis.orthonormalization_matrix())
+            .collect::<Vec<_>>();
+        for matrix in &matrices {
+            assert_eq!(matrix, &matrices[0]);
+        }
+    }
 }
@@ -2,7 +2,7 @@ mod gto;
 pub use self::gto::GtoRadialBasis;
 
 mod tabulated;
-pub use self::tabulated::{Tabulated, LodeTabulated};
+pub use self::tabulated::{Tabulated, LodeTabulated, register_tabulated_basis};
 
 
 /// The different kinds of radial basis supported by SOAP calculators
@@ -1,6 +1,8 @@
-use std::sync::Arc;
+use std::collections::BTreeMap;
+use std::sync::{Arc, Mutex};
 
-use ndarray::Array1;
+use ndarray::{Array1, ArrayView1, ArrayView2};
+use once_cell::sync::Lazy;
 
 use crate::math::{HermitCubicSpline, HermitSplinePoint, SplineParameters};
 use crate::Error;
@@ -12,6 +14,8 @@ use crate::Error;
 #[serde(into = "TabulatedSerde")]
 pub struct Tabulated {
     pub(crate) spline: Arc<HermitCubicSpline<ndarray::Ix1>>,
+    /// Name of the registered basis this spline comes from, if any
+    pub(crate) registered: Option<String>,
 }
 
 impl Tabulated {
@@ -30,6 +34,8 @@ impl Tabulated {
 pub struct LodeTabulated {
     pub(crate) spline: Arc<HermitCubicSpline<ndarray::Ix1>>,
     pub(crate) center_contribution: Option<Array1<f64>>,
+    /// Name of the registered basis this spline comes from, if any
+    pub(crate) registered: Option<String>,
 }
 
 impl LodeTabulated {
@@ -46,7 +52,12 @@ impl LodeTabulated {
 #[serde(deny_unknown_fields)]
 pub struct TabulatedSerde {
     /// Points defining the spline
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
     pub points: Vec<SplinePoint>,
+    /// Name of a tabulated radial basis registered with
+    /// `featomic_register_tabulated_basis`, to use instead of `points`
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub registered: Option<String>,
 }
 
 /// Serde-compatible struct, used to serialize/deserialize splines
@@ -55,7 +66,13 @@ pub struct TabulatedSerde {
 #[serde(deny_unknown_fields)]
 pub struct LodeTabulatedSerde {
     /// Points defining the spline
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
     pub points: Vec<SplinePoint>,
+    /// Name of a tabulated radial basis registered with
+    /// `featomic_register_tabulated_basis`, to use instead of `points` and
+    /// `center_contribution`
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub registered: Option<String>,
     /// The `center_contribution` is defined as `c_n = \sqrt{4π} \int dr r^2
     /// R_n(r) g(r)` where `g(r)` is a radially symmetric density function,
     /// `R_n(r)` the radial basis function and `n` the current radial channel.
@@ -83,13 +100,30 @@ impl TryFrom<TabulatedSerde> for Tabulated {
     type Error = Error;
 
     fn try_from(tabulated: TabulatedSerde) -> Result<Self, Self::Error> {
+        if let Some(name) = tabulated.registered {
+            if !tabulated.points.is_empty() {
+                return Err(Error::InvalidParameter(
+                    "only one of 'points' and 'registered' can be given in 'Tabulated' radial basis".into()
+                ));
+            }
+
+            let registered = get_registered_tabulated(&name)?;
+            return Ok(Tabulated { spline: registered.spline, registered: Some(name) });
+        }
+
         let spline = spline_from_tabulated(tabulated.points)?;
-        return Ok(Tabulated { spline });
+        return Ok(Tabulated { spline, registered: None });
     }
 }
 
 impl From<Tabulated> for TabulatedSerde {
     fn from(tabulated: Tabulated) -> TabulatedSerde {
+        if tabulated.registered.is_some() {
+            // only refer to the registered basis, without copying all the
+            // points in the parameters
+            return TabulatedSerde { points: Vec::new(), registered: tabulated.registered };
+        }
+
         let spline = &tabulated.spline;
 
         let mut points = Vec::new();
@@ -101,7 +135,7 @@ impl From<Tabulated> for TabulatedSerde {
             });
         }
 
-        return TabulatedSerde { points };
+        return TabulatedSerde { points, registered: None };
     }
 }
 
@@ -110,27 +144,44 @@ impl TryFrom<LodeTabulatedSerde> for LodeTabulated {
     type Error = Error;
 
     fn try_from(tabulated: LodeTabulatedSerde) -> Result<Self, Self::Error> {
+        if let Some(name) = tabulated.registered {
+            if !tabulated.points.is_empty() || tabulated.center_contribution.is_some() {
+                return Err(Error::InvalidParameter(
+                    "'points' and 'center_contribution' can not be given together \
+                    with 'registered' in 'Tabulated' radial basis".into()
+                ));
+            }
+
+            let registered = get_registered_tabulated(&name)?;
+            return Ok(LodeTabulated {
+                spline: registered.spline,
+                center_contribution: registered.center_contribution,
+                registered: Some(name),
+            });
+        }
+
         let spline = spline_from_tabulated(tabulated.points)?;
 
         let mut center_contribution = None;
         if let Some(vector) = tabulated.center_contribution {
-            if vector.len() != spline.shape()[0] {
-                return Err(Error::InvalidParameter(format!(
-                    "expected the 'center_contribution' in 'Tabulated' \
-                    radial basis to have the same number of basis function as \
-                    the spline, got {} and {}",
-                    vector.len(), spline.shape()[0]
-                )));
-            }
+            check_center_contribution(vector.len(), spline.shape()[0])?;
             center_contribution = Some(Array1::from(vector));
         }
 
-        return Ok(LodeTabulated { spline, center_contribution });
+        return Ok(LodeTabulated { spline, center_contribution, registered: None });
     }
 }
 
 impl From<LodeTabulated> for LodeTabulatedSerde {
     fn from(tabulated: LodeTabulated) -> LodeTabulatedSerde {
+        if tabulated.registered.is_some() {
+            return LodeTabulatedSerde {
+                points: Vec::new(),
+                registered: tabulated.registered,
+                center_contribution: None,
+            };
+        }
+
         let spline = &tabulated.spline;
 
         let mut points = Vec::new();
@@ -143,35 +194,24 @@ impl From<LodeTabulated> for LodeTabulatedSerde {
         }
 
         let center_contribution = tabulated.center_contribution.as_ref().map(Array1::to_vec);
-        return LodeTabulatedSerde { points, center_contribution };
+        return LodeTabulatedSerde { points, registered: None, center_contribution };
     }
 }
 
 fn spline_from_tabulated(points: Vec<SplinePoint>) -> Result<Arc<HermitCubicSpline<ndarray::Ix1>>, Error> {
-    let points = check_spline_points(points)?;
-
-    let spline_parameters = SplineParameters {
-        start: points[0].position,
-        stop: points[points.len() - 1].position,
-        shape: vec![points[0].values.len()],
-    };
+    let points = points.into_iter().map(|point| HermitSplinePoint {
+        position: point.position,
+        values: Array1::from(point.values),
+        derivatives: Array1::from(point.derivatives),
+    }).collect();
 
-    let mut new_spline_points = Vec::new();
-    for point in points {
-        new_spline_points.push(
-            HermitSplinePoint{
-                position: point.position,
-                values: Array1::from(point.values),
-                derivatives: Array1::from(point.derivatives),
-            }
-        );
-    }
-    let spline = Arc::new(HermitCubicSpline::new(spline_parameters, new_spline_points));
-
-    return Ok(spline);
+    return spline_from_points(points);
 }
 
-fn check_spline_points(mut points: Vec<SplinePoint>) -> Result<Vec<SplinePoint>, Error> {
+/// Validate the `points` of a tabulated radial basis, and create the
+/// corresponding spline. This is shared by points coming from JSON and from
+/// `register_tabulated_basis`.
+fn spline_from_points(mut points: Vec<HermitSplinePoint<ndarray::Ix1>>) -> Result<Arc<HermitCubicSpline<ndarray::Ix1>>, Error> {
     if points.len() < 2 {
         return Err(Error::InvalidParameter(
             "we need at least two points to define a 'Tabulated' radial basis".into()
@@ -206,5 +246,219 @@ fn check_spline_points(mut points: Vec<SplinePoint>) -> Result<Vec<SplinePoint>,
     }
 
     points.sort_unstable_by(|a, b| a.position.total_cmp(&b.position));
-    return Ok(points);
+
+    let start = points[0].position;
+    let stop = points[points.len() - 1].position;
+    if start >= stop {
+        return Err(Error::InvalidParameter(
+            "expected the points in 'Tabulated' radial basis to have different positions".into()
+        ));
+    }
+
+    let spline_parameters = SplineParameters {
+        start: start,
+        stop: stop,
+        shape: vec![size],
+    };
+
+    return Ok(Arc::new(HermitCubicSpline::new(spline_parameters, points)));
+}
+
+fn check_center_contribution(size: usize, spline_size: usize) -> Result<(), Error> {
+    if size != spline_size {
+        return Err(Error::InvalidParameter(format!(
+            "expected the 'center_contribution' in 'Tabulated' \
+            radial basis to have the same number of basis function as \
+            the spline, got {} and {}",
+            size, spline_size
+        )));
+    }
+    return Ok(());
+}
+
+/// A tabulated radial basis registered with `register_tabulated_basis`
+#[derive(Debug, Clone)]
+struct RegisteredTabulated {
+    spline: Arc<HermitCubicSpline<ndarray::Ix1>>,
+    center_contribution: Option<Array1<f64>>,
+}
+
+impl RegisteredTabulated {
+    /// Check if `self` and `other` contain the same data
+    fn same_data(&self, other: &RegisteredTabulated) -> bool {
+        return self.spline.points == other.spline.points
+            && self.center_contribution == other.center_contribution;
+    }
+}
+
+/// All the tabulated radial basis registered with `register_tabulated_basis`,
+/// indexed by name. The splines are validated and created once when
+/// registering them, and then shared by all the calculators using them.
+static REGISTERED_TABULATED: Lazy<Mutex<BTreeMap<String, RegisteredTabulated>>> = Lazy::new(Default::default);
+
+fn get_registered_tabulated(name: &str) -> Result<RegisteredTabulated, Error> {
+    let registered = REGISTERED_TABULATED.lock().expect("mutex was poisoned");
+    return registered.get(name).cloned().ok_or_else(|| Error::InvalidParameter(format!(
+        "no tabulated radial basis registered with the name '{}'", name
+    )));
+}
+
+/// Register a tabulated radial basis under the given `name`, to be used in
+/// calculators hyper-parameters with `{"type": "Tabulated", "registered":
+/// "<name>"}` instead of giving all the spline points in JSON.
+///
+/// `points` should contain one row per spline point, with `1 + 2 * n_basis`
+/// columns: the position of the point, the `n_basis` values of the radial
+/// basis/radial integral, and then the `n_basis` derivatives. Points do not
+/// need to be sorted by position. `center_contribution` is only used by LODE
+/// calculators, and should contain `n_basis` values (see
+/// `LodeTabulatedSerde::center_contribution`).
+///
+/// The data is validated once here. Since calculators only refer to the basis
+/// by name in their parameters, a name can not be re-used for different data:
+/// registering the exact same data again does nothing, and registering
+/// different data under an existing name is an error.
+pub fn register_tabulated_basis(
+    name: &str,
+    points: ArrayView2<f64>,
+    center_contribution: Option<ArrayView1<f64>>,
+) -> Result<(), Error> {
+    let n_columns = points.ncols();
+    if n_columns < 3 || n_columns % 2 == 0 {
+        return Err(Error::InvalidParameter(format!(
+            "expected the points of a 'Tabulated' radial basis to have \
+            1 + 2 * n_basis columns (position, values and derivatives), got {} columns",
+            n_columns
+        )));
+    }
+    let size = (n_columns - 1) / 2;
+
+    if let Some(center_contribution) = center_contribution {
+        check_center_contribution(center_contribution.len(), size)?;
+    }
+
+    let spline_points = points.rows().into_iter().map(|row| HermitSplinePoint {
+        position: row[0],
+        values: row.slice(ndarray::s![1..(1 + size)]).to_owned(),
+        derivatives: row.slice(ndarray::s![(1 + size)..]).to_owned(),
+    }).collect();
+
+    let new = RegisteredTabulated {
+        spline: spline_from_points(spline_points)?,
+        center_contribution: center_contribution.map(|v| v.to_owned()),
+    };
+
+    let mut registered = REGISTERED_TABULATED.lock().expect("mutex was poisoned");
+    if let Some(existing) = registered.get(name) {
+        if existing.same_data(&new) {
+            return Ok(());
+        }
+
+        return Err(Error::InvalidParameter(format!(
+            "a different tabulated radial basis is already registered with the name '{}'",
+            name
+        )));
+    }
+    registered.insert(name.into(), new);
+
+    return Ok(());
+}
+
+#[cfg(test)]
+mod tests {
+    use ndarray::{array, Array2};
+
+    use super::*;
+
+    #[test]
+    fn registered() {
+        // unsorted points, with 2 basis functions
+        let points = array![
+            [1.0, 0.1, 0.2, 1.1, 1.2],
+            [0.0, 0.0, 0.5, 1.0, 1.5],
+            [2.0, 0.3, 0.4, 1.3, 1.4],
+        ];
+        register_tabulated_basis("test-registered", points.view(), None).unwrap();
+
+        let json = r#"{"registered": "test-registered"}"#;
+        let tabulated: Tabulated = serde_json::from_str(json).unwrap();
+        assert_eq!(tabulated.size(), 2);
+
+        let positions = tabulated.spline.points.iter().map(|p| p.position).collect::<Vec<_>>();
+        assert_eq!(positions, [0.0, 1.0, 2.0]);
+        assert_eq!(tabulated.spline.points[1].values, array![0.1, 0.2]);
+        assert_eq!(tabulated.spline.points[1].derivatives, array![1.1, 1.2]);
+
+        // serialization only refers to the registered name
+        assert_eq!(serde_json::to_string(&tabulated).unwrap(), json.replace(' ', ""));
+
+        let center_contribution = array![3.0, 4.0];
+        register_tabulated_basis("test-registered-lode", points.view(), Some(center_contribution.view())).unwrap();
+        let lode: LodeTabulated = serde_json::from_str(r#"{"registered": "test-registered-lode"}"#).unwrap();
+        assert_eq!(lode.center_contribution, Some(center_contribution));
+
+        // registering the same data again is fine
+        register_tabulated_basis("test-registered", points.view(), None).unwrap();
+
+        // but re-using the name for different data is not, since the
+        // parameters of calculators using the basis would be the same
+        let mut other = points.clone();
+        other[[1, 1]] = 33.0;
+        let error = register_tabulated_basis("test-registered", other.view(), None).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: a different tabulated radial basis is already \
+            registered with the name 'test-registered'"
+        );
+
+        let error = register_tabulated_basis("test-registered-lode", points.view(), None).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: a different tabulated radial basis is already \
+            registered with the name 'test-registered-lode'"
+        );
+
+        let tabulated: Tabulated = serde_json::from_str(json).unwrap();
+        assert_eq!(tabulated.spline.points[1].values, array![0.1, 0.2]);
+    }
+
+    #[test]
+    fn registered_errors() {
+        let error = serde_json::from_str::<Tabulated>(r#"{"registered": "not-there"}"#).unwrap_err();
+        assert!(error.to_string().starts_with(
+            "invalid parameter: no tabulated radial basis registered with the name 'not-there'"
+        ));
+
+        let points = Array2::zeros((3, 4));
+        let error = register_tabulated_basis("test-errors", points.view(), None).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: expected the points of a 'Tabulated' radial basis \
+            to have 1 + 2 * n_basis columns (position, values and derivatives), got 4 columns"
+        );
+
+        let points = array![[0.0, 1.0, 2.0], [f64::NAN, 1.0, 2.0]];
+        let error = register_tabulated_basis("test-errors", points.view(), None).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: expected all points 'position' in 'Tabulated' \
+            radial basis to be finite numbers, got NaN"
+        );
+
+        let points = array![[0.0, 1.0, 2.0], [1.0, 1.0, 2.0]];
+        let center_contribution = array![3.0, 4.0];
+        let error = register_tabulated_basis("test-errors", points.view(), Some(center_contribution.view())).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: expected the 'center_contribution' in 'Tabulated' \
+            radial basis to have the same number of basis function as the spline, got 2 and 1"
+        );
+
+        let points = array![[1.0, 1.0, 2.0], [1.0, 1.0, 2.0]];
+        let error = register_tabulated_basis("test-errors", points.view(), None).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: expected the points in 'Tabulated' radial basis to have different positions"
+        );
+    }
 }
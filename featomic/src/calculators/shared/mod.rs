@@ -1,12 +1,15 @@
 //! This module contains type definition shared between the SOAP and LODE
 //! spherical expansions: atomic density, radial and angular basis, as well as
-//! some parallelization helpers.
+//! some parallelization helpers and scratch allocations pools.
 
 mod density;
 pub use self::density::{Density, DensityKind, DensityScaling};
 
 pub(crate) mod basis;
 pub use self::basis::{SphericalExpansionBasis, TensorProductBasis, ExplicitBasis};
-pub use self::basis::{SoapRadialBasis, LodeRadialBasis};
+pub use self::basis::{SoapRadialBasis, LodeRadialBasis, register_tabulated_basis};
 
 pub mod descriptors_by_systems;
+
+mod scratch;
+pub(crate) use self::scratch::{ScratchPool, ScratchPoolStats, resize_zeroed};
@@ -0,0 +1,154 @@
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// A pool of re-usable scratch allocations of type `T`.
+///
+/// Contrary to thread-local storage, a value taken from the pool belongs to a
+/// single piece of work until it is given back, even if rayon suspends this
+/// work to run tasks from another calculation on the same thread. This allows
+/// to share a calculator between concurrent calls to `compute` while still
+/// re-using allocations between calls.
+///
+/// The pool keeps at most one value per thread of the current rayon thread
+/// pool: values given back when the pool is already full are dropped, so a
+/// burst of concurrent calculations does not keep its memory alive forever.
+pub struct ScratchPool<T> {
+    values: Mutex<Vec<T>>,
+    created: AtomicUsize,
+    reused: AtomicUsize,
+}
+
+/// Statistics about the values taken from a `ScratchPool`
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ScratchPoolStats {
+    /// Number of values which had to be created because the pool was empty
+    pub created: usize,
+    /// Number of values re-used from the pool
+    pub reused: usize,
+}
+
+impl<T> ScratchPool<T> {
+    /// Create a new empty pool
+    pub fn new() -> ScratchPool<T> {
+        ScratchPool {
+            values: Mutex::new(Vec::new()),
+            created: AtomicUsize::new(0),
+            reused: AtomicUsize::new(0),
+        }
+    }
+
+    /// Take a value out of the pool, or create a new one with `create` if the
+    /// pool is empty.
+    pub fn take(&self, create: impl FnOnce() -> T) -> T {
+        let value = self.values.lock().expect("mutex was poisoned").pop();
+        if let Some(value) = value {
+            self.reused.fetch_add(1, Ordering::Relaxed);
+            return value;
+        } else {
+            self.created.fetch_add(1, Ordering::Relaxed);
+            return create();
+        }
+    }
+
+    /// Give a `value` back to the pool, to be re-used by a later call to
+    /// `take`. The value is dropped instead if the pool already contains one
+    /// value per thread in the current rayon thread pool.
+    pub fn give_back(&self, value: T) {
+        let max_retained = rayon::current_num_threads();
+
+        let mut values = self.values.lock().expect("mutex was poisoned");
+        if values.len() < max_retained {
+            values.push(value);
+        }
+        // otherwise `value` is dropped here, after the lock is released
+    }
+
+    /// Get statistics about the values taken from this pool since it was
+    /// created
+    pub fn stats(&self) -> ScratchPoolStats {
+        ScratchPoolStats {
+            created: self.created.load(Ordering::Relaxed),
+            reused: self.reused.load(Ordering::Relaxed),
+        }
+    }
+}
+
+impl<T> Default for ScratchPool<T> {
+    fn default() -> Self {
+        ScratchPool::new()
+    }
+}
+
+impl<T> std::fmt::Debug for ScratchPool<T> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        let count = self.values.lock().expect("mutex was poisoned").len();
+        f.debug_struct("ScratchPool")
+            .field("available", &count)
+            .field("stats", &self.stats())
+            .finish()
+    }
+}
+
+/// Resize `array` to the given `shape` and fill it with zeros, re-using the
+/// existing allocation if it is large enough.
+pub fn resize_zeroed<D: ndarray::Dimension>(array: &mut ndarray::Array<f64, D>, shape: D) {
+    let (mut data, offset) = std::mem::take(array).into_raw_vec_and_offset();
+    debug_assert!(matches!(offset, Some(0) | None));
+
+    data.clear();
+    data.resize(shape.size(), 0.0);
+    *array = ndarray::Array::from_shape_vec(shape, data).expect("wrong shape");
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{ScratchPool, ScratchPoolStats, resize_zeroed};
+
+    #[test]
+    fn take_and_give_back() {
+        let pool = ScratchPool::new();
+        let mut value = pool.take(|| Vec::<f64>::with_capacity(16));
+        value.push(3.0);
+        pool.give_back(value);
+
+        // the allocation is re-used
+        let value = pool.take(Vec::new);
+        assert_eq!(value, [3.0]);
+        assert!(value.capacity() >= 16);
+
+        // the pool is empty, a new value is created
+        let other = pool.take(Vec::new);
+        assert!(other.is_empty());
+
+        assert_eq!(pool.stats(), ScratchPoolStats { created: 2, reused: 1 });
+    }
+
+    #[test]
+    fn bounded_size() {
+        let thread_pool = rayon::ThreadPoolBuilder::new().num_threads(2).build().unwrap();
+        thread_pool.install(|| {
+            let pool = ScratchPool::new();
+            let values = (0..5).map(|_| pool.take(Vec::<f64>::new)).collect::<Vec<_>>();
+            for value in values {
+                pool.give_back(value);
+            }
+
+            // only one value per thread is kept
+            assert_eq!(pool.values.lock().unwrap().len(), 2);
+        });
+    }
+
+    #[test]
+    fn resize() {
+        let mut array = ndarray::Array2::from_elem((4, 5), 1.0);
+        let pointer = array.as_ptr();
+
+        resize_zeroed(&mut array, ndarray::Dim([2, 3]));
+        assert_eq!(array, ndarray::Array2::zeros((2, 3)));
+        // the allocation was re-used
+        assert_eq!(array.as_ptr(), pointer);
+
+        resize_zeroed(&mut array, ndarray::Dim([10, 3]));
+        assert_eq!(array, ndarray::Array2::zeros((10, 3)));
+    }
+}
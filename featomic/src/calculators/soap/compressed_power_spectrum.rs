@@ -0,0 +1,1018 @@
+use std::collections::{BTreeMap, BTreeSet};
+
+use ndarray::parallel::prelude::*;
+use ndarray::{Array2, Array3, ArrayView2, ArrayViewMut2, Dim, Ix2, s};
+use ndarray::linalg::general_mat_mul;
+
+use metatensor::{TensorMap, TensorBlock, EmptyArray};
+use metatensor::{LabelsBuilder, Labels};
+
+use crate::calculators::CalculatorBase;
+use crate::{CalculationOptions, Calculator, LabelsSelection};
+use crate::{Error, System};
+
+use super::{Cutoff, SphericalExpansionParameters, SphericalExpansion};
+use super::power_spectrum::SphericalExpansionBlock;
+use crate::calculators::shared::{Density, SoapRadialBasis, SphericalExpansionBasis, resize_zeroed};
+
+use crate::labels::{AtomicTypeFilter, SamplesBuilder};
+use crate::labels::AtomCenteredSamples;
+use crate::labels::{KeysBuilder, CenterTypesKeys};
+
+
+/// Parameters for the compressed SOAP power spectrum calculator.
+///
+/// The size of the SOAP power spectrum grows quadratically with both the
+/// number of neighbor types and the number of radial basis functions. This
+/// calculator applies linear contractions to the spherical expansion
+/// coefficients *before* the sum over `m`, mixing neighbor types into a
+/// smaller number of channels (type embedding) and/or radial basis functions
+/// into a smaller number of radial channels:
+///
+/// `< k n l m | X_i > = \sum_{a n'} T_{k a} R_{n n'} < a n' l m | X_i >`
+///
+/// where `a` runs over the neighbor types, `T` is the type embedding and `R`
+/// the radial contraction. The power spectrum is then computed from the
+/// contracted coefficients
+///
+/// `< k1 n1 k2 n2 l | X_i > = \sum_m < k1 n1 l m | X_i > < k2 n2 l m | X_i >`
+///
+/// and only contains `(k1, n1) <= (k2, n2)`, since the other entries are
+/// redundant. The full power spectrum is never computed.
+#[derive(Debug, Clone)]
+#[derive(serde::Deserialize, serde::Serialize, schemars::JsonSchema)]
+pub struct CompressedPowerSpectrumParameters {
+    /// Definition of the atomic environment within a cutoff, and how
+    /// neighboring atoms enter and leave the environment.
+    pub cutoff: Cutoff,
+    /// Definition of the density arising from atoms in the local environment.
+    pub density: Density,
+    /// Definition of the basis functions used to expand the atomic density
+    pub basis: SphericalExpansionBasis<SoapRadialBasis>,
+    /// Atomic types of the neighbors included in the density. Neighbors with
+    /// other types are ignored. The order of this list defines the columns of
+    /// `type_embedding`.
+    pub neighbor_types: Vec<i32>,
+    /// Type embedding matrix, with one row for each output channel and one
+    /// column for each entry in `neighbor_types`. If this is not given, each
+    /// neighbor type gets its own channel.
+    #[serde(default)]
+    pub type_embedding: Option<Vec<Vec<f64>>>,
+    /// Radial contraction matrix, with one row for each contracted radial
+    /// channel and one column for each radial basis function. The same
+    /// contraction is used for all angular channels, which must then have the
+    /// same number of radial basis functions. If this is not given, the radial
+    /// basis functions are used directly.
+    #[serde(default)]
+    pub radial_contraction: Option<Vec<Vec<f64>>>,
+}
+
+/// Calculator implementing a compressed version of the SOAP power spectrum,
+/// using linear contractions of the neighbor types and radial basis functions.
+pub struct SoapCompressedPowerSpectrum {
+    parameters: CompressedPowerSpectrumParameters,
+    spherical_expansion: Calculator,
+    /// Number of radial basis functions for each angular channel
+    radial_sizes: BTreeMap<usize, usize>,
+    /// Type embedding as a `[n_channels, n_neighbor_types]` matrix
+    type_embedding: Array2<f64>,
+    /// Radial contraction as a `[n_contracted, n_radial]` matrix
+    radial_contraction: Option<Array2<f64>>,
+}
+
+impl std::fmt::Debug for SoapCompressedPowerSpectrum {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "{:?}", self.parameters)
+    }
+}
+
+/// Convert a list of rows to a matrix, checking that all the rows have the
+/// expected number of columns
+fn matrix_from_rows(name: &str, rows: &[Vec<f64>], n_columns: usize, columns: &str) -> Result<Array2<f64>, Error> {
+    if rows.is_empty() {
+        return Err(Error::InvalidParameter(format!(
+            "{} must contain at least one row", name
+        )));
+    }
+
+    let mut matrix = Array2::zeros((rows.len(), n_columns));
+    for (i, row) in rows.iter().enumerate() {
+        if row.len() != n_columns {
+            return Err(Error::InvalidParameter(format!(
+                "expected {} columns ({}) in {}, got {} in row {}",
+                n_columns, columns, name, row.len(), i
+            )));
+        }
+
+        for (j, &value) in row.iter().enumerate() {
+            if !value.is_finite() {
+                return Err(Error::InvalidParameter(format!(
+                    "{} must only contain finite values, got {} at [{}, {}]",
+                    name, value, i, j
+                )));
+            }
+            matrix[[i, j]] = value;
+        }
+    }
+
+    return Ok(matrix);
+}
+
+impl SoapCompressedPowerSpectrum {
+    pub fn new(parameters: CompressedPowerSpectrumParameters) -> Result<SoapCompressedPowerSpectrum, Error> {
+        if parameters.neighbor_types.is_empty() {
+            return Err(Error::InvalidParameter(
+                "neighbor_types must contain at least one atomic type".into()
+            ));
+        }
+
+        let unique_types = parameters.neighbor_types.iter().collect::<BTreeSet<_>>();
+        if unique_types.len() != parameters.neighbor_types.len() {
+            return Err(Error::InvalidParameter(
+                "neighbor_types must not contain duplicated atomic types".into()
+            ));
+        }
+
+        let radial_sizes = match parameters.basis {
+            SphericalExpansionBasis::TensorProduct(ref basis) => {
+                (0..=basis.max_angular).map(|l| (l, basis.radial.size())).collect::<BTreeMap<_, _>>()
+            }
+            SphericalExpansionBasis::Explicit(ref basis) => {
+                basis.by_angular.iter().map(|(&l, radial)| (l, radial.size())).collect()
+            }
+        };
+
+        let n_types = parameters.neighbor_types.len();
+        let type_embedding = match parameters.type_embedding {
+            Some(ref embedding) => matrix_from_rows("type_embedding", embedding, n_types, "one per neighbor type")?,
+            None => Array2::eye(n_types),
+        };
+
+        let radial_contraction = match parameters.radial_contraction {
+            Some(ref contraction) => {
+                let n_radial = *radial_sizes.values().next().expect("there should be at least one angular channel");
+                if radial_sizes.values().any(|&size| size != n_radial) {
+                    return Err(Error::InvalidParameter(
+                        "radial_contraction can only be used if all angular channels \
+                        have the same number of radial basis functions".into()
+                    ));
+                }
+                Some(matrix_from_rows("radial_contraction", contraction, n_radial, "one per radial basis function")?)
+            }
+            None => None,
+        };
+
+        let expansion_parameters = SphericalExpansionParameters {
+            cutoff: parameters.cutoff.clone(),
+            density: parameters.density,
+            basis: parameters.basis.clone(),
+        };
+
+        let spherical_expansion = SphericalExpansion::new(expansion_parameters)?;
+
+        return Ok(SoapCompressedPowerSpectrum {
+            parameters: parameters,
+            spherical_expansion: Calculator::from(
+                Box::new(spherical_expansion) as Box<dyn CalculatorBase>
+            ),
+            radial_sizes: radial_sizes,
+            type_embedding: type_embedding,
+            radial_contraction: radial_contraction,
+        });
+    }
+
+    /// Number of radial channels after the contraction for the angular
+    /// channel `l`
+    fn contracted_size(&self, l: usize) -> usize {
+        match self.radial_contraction {
+            Some(ref contraction) => contraction.nrows(),
+            None => self.radial_sizes[&l],
+        }
+    }
+
+    /// Apply the radial contraction and type embedding to the coefficients of
+    /// a single sample. `inputs` contains one `[rows, n_radial]` array for each
+    /// neighbor type, or `None` if this neighbor type does not contribute. The
+    /// `[rows, n_channels * n_contracted]` output is overwritten.
+    ///
+    /// `radial_scratch` is used to store the result of the radial contraction,
+    /// and can be re-used between calls to avoid allocations.
+    fn contract(
+        &self,
+        l: usize,
+        inputs: &[Option<ArrayView2<'_, f64>>],
+        radial_scratch: &mut Array2<f64>,
+        mut output: ArrayViewMut2<'_, f64>,
+    ) {
+        output.fill(0.0);
+
+        let n_contracted = self.contracted_size(l);
+        for (type_i, input) in inputs.iter().enumerate() {
+            let Some(input) = input else {
+                continue;
+            };
+
+            let radial = match self.radial_contraction {
+                Some(ref contraction) => {
+                    resize_zeroed(radial_scratch, Dim([input.nrows(), n_contracted]));
+                    general_mat_mul(1.0, input, &contraction.t(), 0.0, radial_scratch);
+                    radial_scratch.view()
+                }
+                None => input.view(),
+            };
+
+            for (channel, &weight) in self.type_embedding.column(type_i).iter().enumerate() {
+                if weight == 0.0 {
+                    continue;
+                }
+
+                let start = channel * n_contracted;
+                output.slice_mut(s![.., start..(start + n_contracted)]).scaled_add(weight, &radial);
+            }
+        }
+    }
+
+    /// Construct a `TensorMap` containing the set of samples/properties we want
+    /// the spherical expansion calculator to compute.
+    ///
+    /// All the radial basis functions are needed for the contraction, and all
+    /// the blocks for a given center type share the same samples. Only the
+    /// angular channels used by at least one property (given for each block
+    /// in `properties`) are included.
+    fn selected_spx_labels(&self, descriptor: &TensorMap, properties: &[Vec<PropertyToCompute>]) -> TensorMap {
+        assert_eq!(descriptor.keys().names(), ["center_type"]);
+
+        let mut keys_builder = LabelsBuilder::new(vec!["o3_lambda", "o3_sigma", "center_type", "neighbor_type"]);
+        let mut blocks = Vec::new();
+        for ((key, block), properties) in descriptor.iter().zip(properties) {
+            let requested_o3_lambda = properties.iter().map(|p| p.o3_lambda).collect::<BTreeSet<_>>();
+            let samples = block.samples();
+
+            for o3_lambda in requested_o3_lambda {
+                let mut properties = LabelsBuilder::new(vec!["n"]);
+                for n in 0..self.radial_sizes[&o3_lambda] {
+                    properties.add(&[n]);
+                }
+                let properties = properties.finish();
+
+                for &neighbor_type in &self.parameters.neighbor_types {
+                    keys_builder.add(&[o3_lambda.into(), 1.into(), key[0], neighbor_type.into()]);
+                    blocks.push(TensorBlock::new(
+                        EmptyArray::new(vec![samples.count(), properties.count()]),
+                        &samples,
+                        &[],
+                        &properties,
+                    ).expect("invalid TensorBlock"));
+                }
+            }
+        }
+
+        return TensorMap::new(keys_builder.finish(), blocks).expect("invalid TensorMap")
+    }
+
+    /// Check that the properties of a block are within the range defined by
+    /// the type embedding and radial contraction, and get the data needed to
+    /// compute them.
+    fn properties_to_compute(&self, properties: &Labels) -> Result<Vec<PropertyToCompute>, Error> {
+        let n_channels = self.type_embedding.nrows();
+
+        let mut result = Vec::with_capacity(properties.count());
+        for &[l, k_1, n_1, k_2, n_2] in properties.iter_fixed_size() {
+            if l.i32() < 0 || !self.radial_sizes.contains_key(&l.usize()) {
+                return Err(Error::InvalidParameter(format!(
+                    "invalid property l={} for compressed power spectrum: this angular channel is not part of the basis", l.i32()
+                )));
+            }
+
+            let o3_lambda = l.usize();
+            let n_contracted = self.contracted_size(o3_lambda);
+            for (k, n) in [(k_1, n_1), (k_2, n_2)] {
+                if k.i32() < 0 || k.usize() >= n_channels || n.i32() < 0 || n.usize() >= n_contracted {
+                    return Err(Error::InvalidParameter(format!(
+                        "invalid property (k={}, n={}) for compressed power spectrum: expected k < {} and n < {}",
+                        k.i32(), n.i32(), n_channels, n_contracted
+                    )));
+                }
+            }
+
+            let index_1 = k_1.usize() * n_contracted + n_1.usize();
+            let index_2 = k_2.usize() * n_contracted + n_2.usize();
+
+            // For consistency with a full Clebsch-Gordan product we need to add
+            // a `-1^l / sqrt(2 l + 1)` factor to the power spectrum invariants
+            let mut factor = if o3_lambda % 2 == 0 {
+                1.0 / f64::sqrt((2 * o3_lambda + 1) as f64)
+            } else {
+                -1.0 / f64::sqrt((2 * o3_lambda + 1) as f64)
+            };
+
+            if index_1 != index_2 {
+                // We only store values for `(k_1, n_1) < (k_2, n_2)`, the
+                // symmetric entries are the same. To ensure the final kernels
+                // are correct, we have to multiply the corresponding values.
+                factor *= std::f64::consts::SQRT_2;
+            }
+
+            result.push(PropertyToCompute { o3_lambda, index_1, index_2, factor });
+        }
+
+        return Ok(result);
+    }
+}
+
+/// Data needed to compute a single `(l, k_1, n_1, k_2, n_2)` property
+struct PropertyToCompute {
+    /// value of l
+    o3_lambda: usize,
+    /// position of `(k_1, n_1)` in the contracted coefficients
+    index_1: usize,
+    /// position of `(k_2, n_2)` in the contracted coefficients
+    index_2: usize,
+    /// normalization factor, including the `sqrt(2)` for off-diagonal entries
+    factor: f64,
+}
+
+/// Buffers used when contracting the spherical expansion gradients, re-used
+/// between the gradient samples handled by the same rayon task
+#[derive(Default)]
+struct ContractionScratch {
+    /// result of the radial contraction for a single neighbor type
+    radial: Array2<f64>,
+    /// contracted gradients for each value of l
+    outputs: BTreeMap<usize, Array2<f64>>,
+}
+
+impl CalculatorBase for SoapCompressedPowerSpectrum {
+    fn name(&self) -> String {
+        "compressed SOAP power spectrum".into()
+    }
+
+    fn parameters(&self) -> String {
+        serde_json::to_string(&self.parameters).expect("failed to serialize to JSON")
+    }
+
+    fn cutoffs(&self) -> &[f64] {
+        self.spherical_expansion.cutoffs()
+    }
+
+    fn keys(&self, systems: &mut [Box<dyn System>]) -> Result<Labels, Error> {
+        return CenterTypesKeys.keys(systems);
+    }
+
+    fn sample_names(&self) -> Vec<&str> {
+        AtomCenteredSamples::sample_names()
+    }
+
+    fn samples(&self, keys: &Labels, systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
+        assert_eq!(keys.names(), ["center_type"]);
+        let mut result = Vec::new();
+        for [center_type] in keys.iter_fixed_size() {
+            let builder = AtomCenteredSamples {
+                cutoff: self.parameters.cutoff.radius,
+                center_type: AtomicTypeFilter::Single(center_type.i32()),
+                neighbor_type: AtomicTypeFilter::OneOf(self.parameters.neighbor_types.clone()),
+                self_pairs: true,
+            };
+
+            result.push(builder.samples(systems)?);
+        }
+
+        return Ok(result);
+    }
+
+    fn positions_gradient_samples(&self, keys: &Labels, samples: &[Labels], systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
+        assert_eq!(keys.names(), ["center_type"]);
+        assert_eq!(keys.count(), samples.len());
+
+        let mut gradient_samples = Vec::new();
+        for ([center_type], samples) in keys.iter_fixed_size().zip(samples) {
+            let builder = AtomCenteredSamples {
+                cutoff: self.parameters.cutoff.radius,
+                center_type: AtomicTypeFilter::Single(center_type.i32()),
+                neighbor_type: AtomicTypeFilter::OneOf(self.parameters.neighbor_types.clone()),
+                self_pairs: true,
+            };
+
+            gradient_samples.push(builder.gradients_for(systems, samples)?);
+        }
+
+        return Ok(gradient_samples);
+    }
+
+    fn supports_gradient(&self, parameter: &str) -> bool {
+        match parameter {
+            "positions" | "cell" | "strain" => true,
+            _ => false,
+        }
+    }
+
+    fn components(&self, keys: &Labels) -> Vec<Vec<Labels>> {
+        return vec![vec![]; keys.count()];
+    }
+
+    fn property_names(&self) -> Vec<&str> {
+        vec!["l", "k_1", "n_1", "k_2", "n_2"]
+    }
+
+    fn properties(&self, keys: &Labels) -> Vec<Labels> {
+        let n_channels = self.type_embedding.nrows();
+
+        let mut properties = LabelsBuilder::new(self.property_names());
+        for &l in self.radial_sizes.keys() {
+            let n_contracted = self.contracted_size(l);
+            for k_1 in 0..n_channels {
+                for n_1 in 0..n_contracted {
+                    for k_2 in k_1..n_channels {
+                        let first_n_2 = if k_1 == k_2 { n_1 } else { 0 };
+                        for n_2 in first_n_2..n_contracted {
+                            properties.add(&[l, k_1, n_1, k_2, n_2]);
+                        }
+                    }
+                }
+            }
+        }
+
+        return vec![properties.finish(); keys.count()];
+    }
+
+    #[time_graph::instrument(name = "SoapCompressedPowerSpectrum::compute")]
+    #[allow(clippy::too_many_lines)]
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+        assert!(descriptor.keys().count() > 0);
+
+        let mut gradients = Vec::new();
+        if descriptor.block_by_id(0).gradient("positions").is_some() {
+            gradients.push("positions");
+        }
+        if descriptor.block_by_id(0).gradient("cell").is_some() {
+            gradients.push("cell");
+        }
+        if descriptor.block_by_id(0).gradient("strain").is_some() {
+            gradients.push("strain");
+        }
+
+        // check the requested properties before doing any calculation
+        let properties = descriptor.blocks().iter()
+            .map(|block| self.properties_to_compute(&block.properties()))
+            .collect::<Result<Vec<_>, _>>()?;
+
+        let selected = self.selected_spx_labels(descriptor, &properties);
+        if selected.keys().count() == 0 {
+            // no properties to compute
+            return Ok(());
+        }
+
+        let options = CalculationOptions {
+            gradients: &gradients,
+            selected_samples: LabelsSelection::Predefined(&selected),
+            selected_properties: LabelsSelection::Predefined(&selected),
+            selected_keys: Some(selected.keys()),
+            ..Default::default()
+        };
+
+        let spherical_expansion = self.spherical_expansion.compute(
+            systems,
+            options,
+        ).expect("failed to compute spherical expansion");
+
+        let n_channels = self.type_embedding.nrows();
+
+        for ((key, mut block), properties) in descriptor.iter_mut().zip(properties) {
+            let center_type = key[0];
+
+            let mut block_data = block.data_mut();
+            if properties.is_empty() {
+                continue;
+            }
+
+            let requested_o3_lambda = properties.iter().map(|p| p.o3_lambda).collect::<BTreeSet<_>>();
+
+            // get the spherical expansion blocks for each angular channel, with
+            // one entry for each neighbor type
+            let mut spx_blocks = BTreeMap::new();
+            for &o3_lambda in &requested_o3_lambda {
+                let blocks = self.parameters.neighbor_types.iter().map(|&neighbor_type| {
+                    let block_id = spherical_expansion.keys().position(&[
+                        o3_lambda.into(), 1.into(), center_type, neighbor_type.into()
+                    ]).expect("missing block in spherical expansion");
+                    let spx_block = spherical_expansion.block_by_id(block_id);
+
+                    SphericalExpansionBlock {
+                        properties: spx_block.properties(),
+                        values: spx_block.values().to_array(),
+                        positions_gradients: spx_block.gradient("positions").map(|g| g.values().to_array()),
+                        cell_gradients: spx_block.gradient("cell").map(|g| g.values().to_array()),
+                        strain_gradients: spx_block.gradient("strain").map(|g| g.values().to_array()),
+                    }
+                }).collect::<Vec<_>>();
+                spx_blocks.insert(o3_lambda, blocks);
+            }
+
+            // all the spherical expansion blocks share the same samples, so we
+            // only need to look at the first angular channel to find the
+            // corresponding rows
+            let first_l = *requested_o3_lambda.iter().next().expect("empty set of angular channels");
+            let first_spx_blocks = self.parameters.neighbor_types.iter().map(|&neighbor_type| {
+                let block_id = spherical_expansion.keys().position(&[
+                    first_l.into(), 1.into(), center_type, neighbor_type.into()
+                ]).expect("missing block in spherical expansion");
+                spherical_expansion.block_by_id(block_id)
+            }).collect::<Vec<_>>();
+
+            let first_spx_samples = first_spx_blocks.iter().map(|spx_block| spx_block.samples()).collect::<Vec<_>>();
+            let values_mapping = block_data.samples.iter().map(|sample| {
+                first_spx_samples.iter().map(|spx_samples| {
+                    spx_samples.position(sample).expect("missing spherical expansion sample")
+                }).collect::<Vec<_>>()
+            }).collect::<Vec<_>>();
+
+            // contract the spherical expansion for all the samples, this is
+            // much smaller than the full power spectrum
+            let mut contracted = BTreeMap::new();
+            for (&o3_lambda, spx) in &spx_blocks {
+                let n_features = n_channels * self.contracted_size(o3_lambda);
+                let mut array = Array3::zeros((block_data.samples.count(), 2 * o3_lambda + 1, n_features));
+
+                array.axis_iter_mut(ndarray::Axis(0))
+                    .into_par_iter()
+                    .zip_eq(&values_mapping)
+                    .for_each_init(Array2::default, |radial_scratch, (output, spx_samples)| {
+                        let inputs = spx.iter().zip(spx_samples).map(|(spx, &spx_sample)| {
+                            let values = spx.values.slice(s![spx_sample, .., ..]);
+                            Some(values.into_dimensionality::<Ix2>().expect("wrong dimensionality"))
+                        }).collect::<Vec<_>>();
+
+                        self.contract(o3_lambda, &inputs, radial_scratch, output);
+                    });
+
+                contracted.insert(o3_lambda, array);
+            }
+
+            block_data.values.as_array_mut()
+                .axis_iter_mut(ndarray::Axis(0))
+                .into_par_iter()
+                .enumerate()
+                .for_each(|(sample_i, mut values)| {
+                    for (property_i, property) in properties.iter().enumerate() {
+                        let contracted = &contracted[&property.o3_lambda];
+
+                        let mut sum = 0.0;
+                        for m in 0..(2 * property.o3_lambda + 1) {
+                            // unsafe is required to remove the bound checking
+                            // in release mode (`uget` still checks bounds in
+                            // debug mode)
+                            unsafe {
+                                sum += contracted.uget([sample_i, m, property.index_1])
+                                     * contracted.uget([sample_i, m, property.index_2]);
+                            }
+                        }
+
+                        unsafe {
+                            *values.uget_mut(property_i) = sum * property.factor;
+                        }
+                    }
+                });
+
+            // gradients with respect to the atomic positions
+            if let Some(mut gradient) = block.gradient_mut("positions") {
+                let gradient = gradient.data_mut();
+
+                // for each gradient sample, find the corresponding row in the
+                // spherical expansion gradients for all neighbor types
+                let first_spx_gradients = first_spx_blocks.iter().map(|spx_block| {
+                    spx_block.gradient("positions").expect("missing spherical expansion gradients").samples()
+                }).collect::<Vec<_>>();
+
+                let gradient_mapping = gradient.samples.iter_fixed_size().map(|&[sample, system, atom]| {
+                    let spx_samples = &values_mapping[sample.usize()];
+                    first_spx_gradients.iter().zip(spx_samples).map(|(spx_gradient_samples, &spx_sample)| {
+                        spx_gradient_samples.position(&[spx_sample.into(), system, atom])
+                    }).collect::<Vec<_>>()
+                }).collect::<Vec<_>>();
+
+                gradient.values.to_array_mut()
+                    .axis_iter_mut(ndarray::Axis(0))
+                    .into_par_iter()
+                    .zip_eq(gradient.samples.par_iter())
+                    .zip_eq(&gradient_mapping)
+                    .for_each_init(ContractionScratch::default, |scratch, ((mut values, gradient_sample), spx_grad_samples)| {
+                        let sample_i = gradient_sample[0].usize();
+                        let ContractionScratch { radial, outputs: contracted_gradients } = scratch;
+
+                        // contract the gradients of the spherical expansion
+                        for (&o3_lambda, spx) in &spx_blocks {
+                            let n_m = 2 * o3_lambda + 1;
+                            let n_features = n_channels * self.contracted_size(o3_lambda);
+
+                            let inputs = spx.iter().zip(spx_grad_samples).map(|(spx, spx_grad_sample)| {
+                                spx_grad_sample.map(|spx_grad_sample| {
+                                    let gradients = spx.positions_gradients.expect("missing spherical expansion gradients");
+                                    let gradients = gradients.slice(s![spx_grad_sample, .., .., ..]);
+                                    let n_radial = gradients.shape()[2];
+                                    gradients.into_shape_with_order((3 * n_m, n_radial)).expect("spherical expansion gradients should be contiguous")
+                                })
+                            }).collect::<Vec<_>>();
+
+                            let output = contracted_gradients.entry(o3_lambda)
+                                .or_insert_with(|| Array2::zeros((3 * n_m, n_features)));
+                            self.contract(o3_lambda, &inputs, radial, output.view_mut());
+                        }
+
+                        for (property_i, property) in properties.iter().enumerate() {
+                            let n_m = 2 * property.o3_lambda + 1;
+                            let contracted = &contracted[&property.o3_lambda];
+                            let gradients = &contracted_gradients[&property.o3_lambda];
+
+                            let mut sum = [0.0, 0.0, 0.0];
+                            for m in 0..n_m {
+                                // SAFETY: see same loop for values
+                                unsafe {
+                                    let value_1 = contracted.uget([sample_i, m, property.index_1]);
+                                    let value_2 = contracted.uget([sample_i, m, property.index_2]);
+                                    for d in 0..3 {
+                                        sum[d] += value_2 * gradients.uget([d * n_m + m, property.index_1])
+                                                + value_1 * gradients.uget([d * n_m + m, property.index_2]);
+                                    }
+                                }
+                            }
+
+                            for d in 0..3 {
+                                unsafe {
+                                    *values.uget_mut([d, property_i]) = sum[d] * property.factor;
+                                }
+                            }
+                        }
+                    });
+            }
+
+            // gradients with respect to the strain/cell
+            for parameter in ["cell", "strain"] {
+                if let Some(mut gradient) = block.gradient_mut(parameter) {
+                    let gradient = gradient.data_mut();
+
+                    gradient.values.to_array_mut()
+                        .axis_iter_mut(ndarray::Axis(0))
+                        .into_par_iter()
+                        .zip_eq(gradient.samples.par_iter())
+                        .for_each_init(ContractionScratch::default, |scratch, (mut values, gradient_sample)| {
+                            let sample_i = gradient_sample[0].usize();
+                            let spx_samples = &values_mapping[sample_i];
+                            let ContractionScratch { radial, outputs: contracted_gradients } = scratch;
+
+                            for (&o3_lambda, spx) in &spx_blocks {
+                                let n_m = 2 * o3_lambda + 1;
+                                let n_features = n_channels * self.contracted_size(o3_lambda);
+
+                                let inputs = spx.iter().zip(spx_samples).map(|(spx, &spx_sample)| {
+                                    let gradients = if parameter == "cell" {
+                                        spx.cell_gradients
+                                    } else {
+                                        spx.strain_gradients
+                                    };
+                                    let gradients = gradients.expect("missing spherical expansion gradients");
+                                    let gradients = gradients.slice(s![spx_sample, .., .., .., ..]);
+                                    let n_radial = gradients.shape()[3];
+                                    Some(gradients.into_shape_with_order((9 * n_m, n_radial)).expect("spherical expansion gradients should be contiguous"))
+                                }).collect::<Vec<_>>();
+
+                                let output = contracted_gradients.entry(o3_lambda)
+                                    .or_insert_with(|| Array2::zeros((9 * n_m, n_features)));
+                                self.contract(o3_lambda, &inputs, radial, output.view_mut());
+                            }
+
+                            for (property_i, property) in properties.iter().enumerate() {
+                                let n_m = 2 * property.o3_lambda + 1;
+                                let contracted = &contracted[&property.o3_lambda];
+                                let gradients = &contracted_gradients[&property.o3_lambda];
+
+                                let mut sum = [
+                                    [0.0, 0.0, 0.0],
+                                    [0.0, 0.0, 0.0],
+                                    [0.0, 0.0, 0.0],
+                                ];
+                                for m in 0..n_m {
+                                    // SAFETY: see same loop for values
+                                    unsafe {
+                                        let value_1 = contracted.uget([sample_i, m, property.index_1]);
+                                        let value_2 = contracted.uget([sample_i, m, property.index_2]);
+                                        for xyz_1 in 0..3 {
+                                            for xyz_2 in 0..3 {
+                                                let row = (3 * xyz_1 + xyz_2) * n_m + m;
+                                                sum[xyz_1][xyz_2] += value_2 * gradients.uget([row, property.index_1])
+                                                                   + value_1 * gradients.uget([row, property.index_2]);
+                                            }
+                                        }
+                                    }
+                                }
+
+                                for xyz_1 in 0..3 {
+                                    for xyz_2 in 0..3 {
+                                        unsafe {
+                                            *values.uget_mut([xyz_1, xyz_2, property_i]) = sum[xyz_1][xyz_2] * property.factor;
+                                        }
+                                    }
+                                }
+                            }
+                        });
+                }
+            }
+        }
+
+        Ok(())
+    }
+}
+
+
+#[cfg(test)]
+mod tests {
+    use approx::assert_relative_eq;
+    use metatensor::LabelValue;
+
+    use crate::systems::test_utils::{test_systems, test_system};
+    use crate::Calculator;
+
+    use super::*;
+    use crate::calculators::CalculatorBase;
+    use crate::calculators::soap::{SoapPowerSpectrum, PowerSpectrumParameters};
+
+    use crate::calculators::soap::{Cutoff, Smoothing};
+    use crate::calculators::shared::{Density, DensityKind};
+    use crate::calculators::shared::{SoapRadialBasis, SphericalExpansionBasis, TensorProductBasis};
+
+    fn parameters() -> CompressedPowerSpectrumParameters {
+        CompressedPowerSpectrumParameters {
+            cutoff: Cutoff {
+                radius: 8.0,
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
+            },
+            density: Density {
+                kind: DensityKind::Gaussian { width: 0.3 },
+                scaling: None,
+                center_atom_weight: 1.0,
+            },
+            basis: SphericalExpansionBasis::TensorProduct(TensorProductBasis {
+                max_angular: 3,
+                radial: SoapRadialBasis::Gto { max_radial: 3, radius: None },
+                spline_accuracy: Some(1e-8),
+            }),
+            neighbor_types: vec![-42, 1],
+            type_embedding: None,
+            radial_contraction: None,
+        }
+    }
+
+    fn compressed_parameters() -> CompressedPowerSpectrumParameters {
+        let mut parameters = parameters();
+        parameters.type_embedding = Some(vec![vec![0.7, -0.4]]);
+        parameters.radial_contraction = Some(vec![
+            vec![0.5, 0.2, -0.3, 0.1],
+            vec![-0.1, 0.4, 0.6, 0.8],
+        ]);
+        return parameters;
+    }
+
+    #[test]
+    fn invalid_parameters() {
+        let mut parameters = parameters();
+        parameters.type_embedding = Some(vec![vec![1.0, 2.0, 3.0]]);
+        let error = SoapCompressedPowerSpectrum::new(parameters).unwrap_err();
+        assert_eq!(
+            error.to_string(),
+            "invalid parameter: expected 2 columns (one per neighbor type) in type_embedding, got 3 in row 0"
+        );
+
+        let mut parameters = self::parameters();
+        parameters.radial_contraction = Some(vec![]);
+        let error = SoapCompressedPowerSpectrum::new(parameters).unwrap_err();
+        assert_eq!(error.to_string(), "invalid parameter: radial_contraction must contain at least one row");
+
+        let mut parameters = self::parameters();
+        parameters.neighbor_types = vec![1, 1];
+        let error = SoapCompressedPowerSpectrum::new(parameters).unwrap_err();
+        assert_eq!(error.to_string(), "invalid parameter: neighbor_types must not contain duplicated atomic types");
+    }
+
+    #[test]
+    fn keys_and_properties() {
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            compressed_parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        assert_eq!(descriptor.keys(), &Labels::new(["center_type"], &[[-42], [1]]));
+
+        // 4 angular channels, 1 type channel and 2 radial channels, giving 3
+        // pairs of (k, n) for each angular channel
+        for block in descriptor.blocks() {
+            assert_eq!(block.properties().count(), 4 * 3);
+        }
+    }
+
+    #[test]
+    fn identity_is_power_spectrum() {
+        let parameters = parameters();
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters.clone()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let power_spectrum = Calculator::from(Box::new(SoapPowerSpectrum::new(PowerSpectrumParameters {
+            cutoff: parameters.cutoff.clone(),
+            density: parameters.density,
+            basis: parameters.basis,
+        }).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water", "methane"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+        let expected = power_spectrum.compute(&mut systems, Default::default()).unwrap();
+
+        for (key, block) in &descriptor {
+            let values = block.values().to_array();
+            for (property_i, &[l, k_1, n_1, k_2, n_2]) in block.properties().iter_fixed_size().enumerate() {
+                let neighbor_1_type = parameters.neighbor_types[k_1.usize()];
+                let neighbor_2_type = parameters.neighbor_types[k_2.usize()];
+
+                let Ok(expected) = expected.block(&Labels::new(
+                    ["center_type", "neighbor_1_type", "neighbor_2_type"],
+                    &[[key[0].i32(), neighbor_1_type, neighbor_2_type]],
+                )) else {
+                    // these neighbor types are never found together
+                    continue;
+                };
+
+                // the power spectrum contains both (n_1, n_2) and (n_2, n_1)
+                // for the same neighbor types
+                let factor = if neighbor_1_type == neighbor_2_type && n_1 != n_2 {
+                    std::f64::consts::SQRT_2
+                } else {
+                    1.0
+                };
+
+                let expected_values = expected.values().to_array();
+                let expected_i = expected.properties().position(&[l, n_1, n_2]).unwrap();
+                for (expected_sample_i, sample) in expected.samples().iter().enumerate() {
+                    let sample_i = block.samples().position(sample).unwrap();
+                    assert_relative_eq!(
+                        values[[sample_i, property_i]],
+                        factor * expected_values[[expected_sample_i, expected_i]],
+                        epsilon=1e-12, max_relative=1e-10
+                    );
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn contraction() {
+        // the compressed power spectrum should be equal to the contraction of
+        // the full power spectrum
+        let identity = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let parameters = compressed_parameters();
+        let embedding = parameters.type_embedding.clone().unwrap();
+        let contraction = parameters.radial_contraction.clone().unwrap();
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water"]);
+        let full = identity.compute(&mut systems, Default::default()).unwrap();
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        let n_radial = 4;
+        for (block, full) in descriptor.blocks().iter().zip(full.blocks()) {
+            assert_eq!(block.samples(), full.samples());
+
+            let values = block.values().to_array();
+            let full_values = full.values().to_array();
+
+            // reconstruct the full symmetric matrix for each angular channel
+            let get_full = |sample_i: usize, l: usize, i_1: usize, i_2: usize| {
+                let (i_1, i_2) = (usize::min(i_1, i_2), usize::max(i_1, i_2));
+                let property = [
+                    LabelValue::from(l),
+                    LabelValue::from(i_1 / n_radial),
+                    LabelValue::from(i_1 % n_radial),
+                    LabelValue::from(i_2 / n_radial),
+                    LabelValue::from(i_2 % n_radial),
+                ];
+                let property_i = full.properties().position(&property).unwrap();
+                let factor = if i_1 == i_2 { 1.0 } else { std::f64::consts::SQRT_2 };
+                full_values[[sample_i, property_i]] / factor
+            };
+
+            for (property_i, &[l, k_1, n_1, k_2, n_2]) in block.properties().iter_fixed_size().enumerate() {
+                let weight = |k: LabelValue, n: LabelValue, i: usize| {
+                    embedding[k.usize()][i / n_radial] * contraction[n.usize()][i % n_radial]
+                };
+
+                let factor = if (k_1, n_1) == (k_2, n_2) { 1.0 } else { std::f64::consts::SQRT_2 };
+                for sample_i in 0..block.samples().count() {
+                    let mut expected = 0.0;
+                    for i_1 in 0..(2 * n_radial) {
+                        for i_2 in 0..(2 * n_radial) {
+                            expected += weight(k_1, n_1, i_1) * weight(k_2, n_2, i_2) * get_full(sample_i, l.usize(), i_1, i_2);
+                        }
+                    }
+
+                    assert_relative_eq!(
+                        values[[sample_i, property_i]], factor * expected,
+                        epsilon=1e-12, max_relative=1e-10
+                    );
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn finite_differences_positions() {
+        let mut parameters = compressed_parameters();
+        parameters.neighbor_types = vec![1, 6];
+
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("ethanol");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 5e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_positions(calculator, &system, options);
+    }
+
+    #[test]
+    fn finite_differences_cell() {
+        let mut parameters = compressed_parameters();
+        parameters.neighbor_types = vec![1, 6];
+
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("ethanol");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 1e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_cell(calculator, &system, options);
+    }
+
+    #[test]
+    fn finite_differences_strain() {
+        let mut parameters = compressed_parameters();
+        parameters.neighbor_types = vec![1, 6];
+
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("ethanol");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 1e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_strain(calculator, &system, options);
+    }
+
+    #[test]
+    fn compute_partial() {
+        let mut parameters = compressed_parameters();
+        parameters.neighbor_types = vec![1, 6];
+
+        let calculator = Calculator::from(Box::new(SoapCompressedPowerSpectrum::new(
+            parameters
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["methane"]);
+
+        let properties = Labels::new(["l", "k_1", "n_1", "k_2", "n_2"], &[
+            [0, 0, 0, 0, 1],
+            [3, 0, 1, 0, 1],
+            [2, 0, 0, 0, 0],
+            [1, 0, 1, 0, 0],
+        ]);
+
+        let samples = Labels::new(["system", "atom"], &[
+            [0, 2],
+            [0, 1],
+        ]);
+
+        let keys = Labels::new(["center_type"], &[
+            [1],
+            [6],
+            [8], // not part of the default keys
+        ]);
+
+        crate::calculators::tests_utils::compute_partial(
+            calculator, &mut systems, &keys, &samples, &properties
+        );
+    }
+}
@@ -1,7 +1,7 @@
 use crate::Error;
 
 /// Definition of a local environment for SOAP calculations
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone)]
 #[derive(serde::Deserialize, serde::Serialize, schemars::JsonSchema)]
 #[serde(deny_unknown_fields)]
 pub struct Cutoff {
@@ -9,6 +9,55 @@ pub struct Cutoff {
     pub radius: f64,
     /// Cutoff function used to smooth the behavior around the cutoff radius
     pub smoothing: Smoothing,
+    /// Smaller cutoff radius to use for specific pairs of atomic types. Pairs
+    /// of atoms with types not in this list use `radius`.
+    ///
+    /// The neighbor lists are still computed with `radius`, and pairs further
+    /// apart than the cutoff for their types are removed before computing
+    /// their contribution. The smoothing function is applied relative to the
+    /// cutoff for the pair types, while the radial basis is still defined with
+    /// `radius`.
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
+    pub per_type_pair: Vec<TypePairCutoff>,
+}
+
+/// Cutoff radius for a specific pair of atomic types
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[derive(serde::Deserialize, serde::Serialize, schemars::JsonSchema)]
+#[serde(deny_unknown_fields)]
+pub struct TypePairCutoff {
+    /// The two atomic types of this pair. The same cutoff is used regardless
+    /// of which atom is the center and which is the neighbor.
+    pub types: [i32; 2],
+    /// Cutoff radius for this pair of types. This must be smaller than the
+    /// global cutoff radius.
+    pub radius: f64,
+}
+
+/// Cutoff radius for all pairs of atoms in a single system, stored in a dense
+/// table indexed by atomic types. This is created with `Cutoff::pair_radii`,
+/// and avoids searching through `Cutoff::per_type_pair` for every pair.
+#[derive(Debug, Clone)]
+pub struct PairRadii {
+    /// global cutoff radius, used when there is no radius per pair of types
+    radius: f64,
+    /// number of different atomic types in the system
+    n_types: usize,
+    /// index of the atomic type of each atom in the system
+    type_indexes: Vec<usize>,
+    /// `n_types x n_types` table of cutoff radius
+    radii: Vec<f64>,
+}
+
+impl PairRadii {
+    /// Get the cutoff radius for the pair between atoms `first` and `second`
+    #[inline]
+    pub fn radius(&self, first: usize, second: usize) -> f64 {
+        if self.radii.is_empty() {
+            return self.radius;
+        }
+        return self.radii[self.type_indexes[first] * self.n_types + self.type_indexes[second]];
+    }
 }
 
 /// Possible values for the smoothing cutoff function
@@ -41,37 +90,138 @@ impl Cutoff {
                 }
             }
         }
+
+        for (i, pair_cutoff) in self.per_type_pair.iter().enumerate() {
+            if pair_cutoff.radius <= 0.0 || !pair_cutoff.radius.is_finite() {
+                return Err(Error::InvalidParameter(format!(
+                    "expected positive cutoff radius for types {:?}, got {}",
+                    pair_cutoff.types, pair_cutoff.radius
+                )));
+            }
+
+            if pair_cutoff.radius > self.radius {
+                return Err(Error::InvalidParameter(format!(
+                    "cutoff radius for types {:?} ({}) is larger than the global cutoff radius ({})",
+                    pair_cutoff.types, pair_cutoff.radius, self.radius
+                )));
+            }
+
+            if let Smoothing::ShiftedCosine { width } = self.smoothing {
+                if pair_cutoff.radius < width {
+                    return Err(Error::InvalidParameter(format!(
+                        "cutoff radius for types {:?} ({}) is smaller than the width of the smoothing function ({})",
+                        pair_cutoff.types, pair_cutoff.radius, width
+                    )));
+                }
+            }
+
+            let [type_1, type_2] = pair_cutoff.types;
+            let duplicated = self.per_type_pair[..i].iter().any(|other| {
+                other.types == [type_1, type_2] || other.types == [type_2, type_1]
+            });
+            if duplicated {
+                return Err(Error::InvalidParameter(format!(
+                    "the cutoff radius for types {:?} is given multiple times",
+                    pair_cutoff.types
+                )));
+            }
+        }
+
         return Ok(());
     }
 
+    /// Get the cutoff radius for a pair of atoms with the given types.
+    ///
+    /// This searches `per_type_pair`, use `Cutoff::pair_radii` instead when
+    /// looking up the radius of many pairs in the same system.
+    pub fn radius_for_types(&self, type_1: i32, type_2: i32) -> f64 {
+        for pair_cutoff in &self.per_type_pair {
+            let [first, second] = pair_cutoff.types;
+            if (first == type_1 && second == type_2) || (first == type_2 && second == type_1) {
+                return pair_cutoff.radius;
+            }
+        }
+        return self.radius;
+    }
+
+    /// Create a table containing the cutoff radius for all pairs of atoms in
+    /// a system with the given atomic `types`.
+    pub fn pair_radii(&self, types: &[i32]) -> PairRadii {
+        if self.per_type_pair.is_empty() {
+            return PairRadii {
+                radius: self.radius,
+                n_types: 0,
+                type_indexes: Vec::new(),
+                radii: Vec::new(),
+            };
+        }
+
+        let mut all_types = types.to_vec();
+        all_types.sort_unstable();
+        all_types.dedup();
+
+        let n_types = all_types.len();
+        let mut radii = vec![self.radius; n_types * n_types];
+        for pair_cutoff in &self.per_type_pair {
+            let [type_1, type_2] = pair_cutoff.types;
+            if let (Ok(first), Ok(second)) = (all_types.binary_search(&type_1), all_types.binary_search(&type_2)) {
+                radii[first * n_types + second] = pair_cutoff.radius;
+                radii[second * n_types + first] = pair_cutoff.radius;
+            }
+        }
+
+        let type_indexes = types.iter()
+            .map(|atomic_type| all_types.binary_search(atomic_type).expect("missing atomic type"))
+            .collect();
+
+        return PairRadii {
+            radius: self.radius,
+            n_types: n_types,
+            type_indexes: type_indexes,
+            radii: radii,
+        };
+    }
+
     /// Evaluate the smoothing function at the distance `r`
     pub fn smoothing(&self, r: f64) -> f64 {
+        return self.smoothing_with_radius(r, self.radius);
+    }
+
+    /// Evaluate the gradient of the smoothing function at the distance `r`
+    pub fn smoothing_gradient(&self, r: f64) -> f64 {
+        return self.smoothing_gradient_with_radius(r, self.radius);
+    }
+
+    /// Evaluate the smoothing function at the distance `r`, for a pair with
+    /// the given cutoff `radius`
+    pub fn smoothing_with_radius(&self, r: f64, radius: f64) -> f64 {
         match self.smoothing {
             Smoothing::Step => {
-                if r >= self.radius { 0.0 } else { 1.0 }
+                if r >= radius { 0.0 } else { 1.0 }
             },
             Smoothing::ShiftedCosine { width } => {
-                if r <= (self.radius - width) {
+                if r <= (radius - width) {
                     1.0
-                } else if r >= self.radius {
+                } else if r >= radius {
                     0.0
                 } else {
-                    let s = std::f64::consts::PI * (r - self.radius + width) / width;
+                    let s = std::f64::consts::PI * (r - radius + width) / width;
                     0.5 * (1. + f64::cos(s))
                 }
             }
         }
     }
 
-    /// Evaluate the gradient of the smoothing function at the distance `r`
-    pub fn smoothing_gradient(&self, r: f64) -> f64 {
+    /// Evaluate the gradient of the smoothing function at the distance `r`,
+    /// for a pair with the given cutoff `radius`
+    pub fn smoothing_gradient_with_radius(&self, r: f64, radius: f64) -> f64 {
         match self.smoothing {
             Smoothing::Step => 0.0,
             Smoothing::ShiftedCosine { width } => {
-                if r <= (self.radius - width) || r >= self.radius {
+                if r <= (radius - width) || r >= radius {
                     0.0
                 } else {
-                    let s = std::f64::consts::PI * (r - self.radius + width) / width;
+                    let s = std::f64::consts::PI * (r - radius + width) / width;
                     return -0.5 * std::f64::consts::PI * f64::sin(s) / width;
                 }
             }
@@ -82,10 +232,12 @@ impl Cutoff {
 
 #[cfg(test)]
 mod tests {
+    use approx::assert_relative_eq;
+
     use super::*;
     #[test]
     fn no_smoothing() {
-        let cutoff = Cutoff { radius: 4.0, smoothing: Smoothing::Step};
+        let cutoff = Cutoff { radius: 4.0, smoothing: Smoothing::Step, per_type_pair: Vec::new() };
 
         assert_eq!(cutoff.smoothing(2.0), 1.0);
         assert_eq!(cutoff.smoothing(5.0), 0.0);
@@ -96,7 +248,7 @@ mod tests {
 
     #[test]
     fn shifted_cosine() {
-        let cutoff = Cutoff { radius: 4.0, smoothing: Smoothing::ShiftedCosine { width: 0.5 }};
+        let cutoff = Cutoff { radius: 4.0, smoothing: Smoothing::ShiftedCosine { width: 0.5 }, per_type_pair: Vec::new() };
 
         assert_eq!(cutoff.smoothing(2.0), 1.0);
         assert_eq!(cutoff.smoothing(3.5), 1.0);
@@ -110,4 +262,54 @@ mod tests {
         assert_eq!(cutoff.smoothing_gradient(4.0), 0.0);
         assert_eq!(cutoff.smoothing_gradient(5.0), 0.0);
     }
+
+    #[test]
+    fn per_type_pair() {
+        let cutoff = Cutoff {
+            radius: 4.0,
+            smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+            per_type_pair: vec![TypePairCutoff { types: [1, 1], radius: 2.0 }, TypePairCutoff { types: [1, 6], radius: 3.0 }],
+        };
+        cutoff.validate().unwrap();
+
+        assert_eq!(cutoff.radius_for_types(1, 1), 2.0);
+        assert_eq!(cutoff.radius_for_types(1, 6), 3.0);
+        assert_eq!(cutoff.radius_for_types(6, 1), 3.0);
+        assert_eq!(cutoff.radius_for_types(6, 6), 4.0);
+
+        assert_relative_eq!(cutoff.smoothing_with_radius(1.8, 2.0), 0.34549150281252683, max_relative=1e-12);
+        assert_eq!(cutoff.smoothing_with_radius(2.0, 2.0), 0.0);
+        assert_relative_eq!(cutoff.smoothing_gradient_with_radius(1.8, 2.0), -2.987832164741557, max_relative=1e-12);
+
+        let mut invalid = cutoff.clone();
+        invalid.per_type_pair.push(TypePairCutoff { types: [6, 1], radius: 2.5 });
+        assert_eq!(
+            invalid.validate().unwrap_err().to_string(),
+            "invalid parameter: the cutoff radius for types [6, 1] is given multiple times"
+        );
+
+        let mut invalid = cutoff.clone();
+        invalid.per_type_pair.push(TypePairCutoff { types: [6, 8], radius: 4.5 });
+        assert_eq!(
+            invalid.validate().unwrap_err().to_string(),
+            "invalid parameter: cutoff radius for types [6, 8] (4.5) is larger than the global cutoff radius (4)"
+        );
+
+        let mut invalid = cutoff.clone();
+        invalid.per_type_pair.push(TypePairCutoff { types: [6, 8], radius: 0.3 });
+        assert_eq!(
+            invalid.validate().unwrap_err().to_string(),
+            "invalid parameter: cutoff radius for types [6, 8] (0.3) is smaller than the width of the smoothing function (0.5)"
+        );
+
+        let radii = cutoff.pair_radii(&[6, 1, 8, 1]);
+        assert_eq!(radii.radius(1, 3), 2.0);
+        assert_eq!(radii.radius(0, 1), 3.0);
+        assert_eq!(radii.radius(3, 0), 3.0);
+        assert_eq!(radii.radius(0, 0), 4.0);
+        assert_eq!(radii.radius(2, 1), 4.0);
+
+        let radii = Cutoff { per_type_pair: Vec::new(), ..cutoff }.pair_radii(&[6, 1, 8, 1]);
+        assert_eq!(radii.radius(1, 3), 4.0);
+    }
 }
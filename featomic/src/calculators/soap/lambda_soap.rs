@@ -0,0 +1,847 @@
+use std::collections::{BTreeMap, BTreeSet, HashMap};
+
+use ndarray::parallel::prelude::*;
+
+use metatensor::{TensorMap, TensorBlock, EmptyArray};
+use metatensor::{LabelsBuilder, Labels, LabelValue};
+
+use crate::calculators::CalculatorBase;
+use crate::{CalculationOptions, Calculator, LabelsSelection};
+use crate::{Error, System};
+use crate::math::{real_clebsch_gordan, ClebschGordanCoefficient};
+
+use super::{Cutoff, SphericalExpansionParameters, SphericalExpansion};
+use super::power_spectrum::{SphericalExpansionBlock, SamplesMapping};
+use crate::calculators::shared::{Density, SoapRadialBasis, SphericalExpansionBasis};
+
+use crate::labels::{AtomicTypeFilter, SamplesBuilder};
+use crate::labels::AtomCenteredSamples;
+use crate::labels::{KeysBuilder, CenterTwoNeighborsTypesKeys};
+
+
+/// Parameters for the lambda-SOAP calculator.
+///
+/// lambda-SOAP is the equivariant generalization of the SOAP power spectrum,
+/// where pairs of spherical expansion coefficients are coupled with
+/// Clebsch-Gordan coefficients to produce features transforming like
+/// spherical harmonics of degree `o3_lambda` under rotations:
+///
+/// `< n1 l1 n2 l2 | X_i >^{o3_lambda}_{mu} = \sum_{m1 m2} C^{l1 l2 o3_lambda}_{m1 m2 mu} < n1 l1 m1 | X_i > < n2 l2 m2 | X_i >`
+///
+/// where the `< n l m | X_i >` are the spherical expansion coefficients. The
+/// `o3_lambda = 0` block contains the same values as the SOAP power spectrum
+/// (without the `sqrt(2)` factor for different neighbor types).
+///
+/// See [this article](https://doi.org/10.1103/PhysRevLett.120.036002) for more
+/// information on the lambda-SOAP representation.
+#[derive(Debug, Clone)]
+#[derive(serde::Deserialize, serde::Serialize, schemars::JsonSchema)]
+pub struct LambdaSoapParameters {
+    /// Definition of the atomic environment within a cutoff, and how
+    /// neighboring atoms enter and leave the environment.
+    pub cutoff: Cutoff,
+    /// Definition of the density arising from atoms in the local environment.
+    pub density: Density,
+    /// Definition of the basis functions used to expand the atomic density
+    pub basis: SphericalExpansionBasis<SoapRadialBasis>,
+    /// Maximal angular order `o3_lambda` of the output. Values larger than
+    /// twice the maximal angular channel of the basis do not produce any
+    /// additional output.
+    pub max_lambda: usize,
+}
+
+/// Calculator implementing the lambda-SOAP representation, i.e. the
+/// equivariant SOAP power spectrum.
+pub struct LambdaSoap {
+    parameters: LambdaSoapParameters,
+    spherical_expansion: Calculator,
+    /// Number of radial basis functions for each angular channel
+    radial_sizes: BTreeMap<usize, usize>,
+    /// Non-zero Clebsch-Gordan coefficients for all `[l1, l2, o3_lambda]`
+    /// satisfying the selection rules, pre-computed when creating the
+    /// calculator
+    clebsch_gordan: BTreeMap<[usize; 3], Vec<ClebschGordanCoefficient>>,
+}
+
+impl std::fmt::Debug for LambdaSoap {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "{:?}", self.parameters)
+    }
+}
+
+impl LambdaSoap {
+    pub fn new(parameters: LambdaSoapParameters) -> Result<LambdaSoap, Error> {
+        let expansion_parameters = SphericalExpansionParameters {
+            cutoff: parameters.cutoff.clone(),
+            density: parameters.density,
+            basis: parameters.basis.clone(),
+        };
+
+        let spherical_expansion = SphericalExpansion::new(expansion_parameters)?;
+
+        let radial_sizes = match parameters.basis {
+            SphericalExpansionBasis::TensorProduct(ref basis) => {
+                (0..=basis.max_angular).map(|l| (l, basis.radial.size())).collect::<BTreeMap<_, _>>()
+            }
+            SphericalExpansionBasis::Explicit(ref basis) => {
+                basis.by_angular.iter().map(|(&l, radial)| (l, radial.size())).collect()
+            }
+        };
+
+        let mut clebsch_gordan = BTreeMap::new();
+        for &l_1 in radial_sizes.keys() {
+            for &l_2 in radial_sizes.keys() {
+                let max_lambda = usize::min(l_1 + l_2, parameters.max_lambda);
+                for o3_lambda in l_1.abs_diff(l_2)..=max_lambda {
+                    clebsch_gordan.insert([l_1, l_2, o3_lambda], real_clebsch_gordan(l_1, l_2, o3_lambda));
+                }
+            }
+        }
+
+        return Ok(LambdaSoap {
+            parameters: parameters,
+            spherical_expansion: Calculator::from(
+                Box::new(spherical_expansion) as Box<dyn CalculatorBase>
+            ),
+            radial_sizes: radial_sizes,
+            clebsch_gordan: clebsch_gordan,
+        });
+    }
+
+    /// Get all the `(l1, l2)` angular channels that can be coupled to the given
+    /// `o3_lambda` and `o3_sigma`. If both neighbors have the same type, the
+    /// `(l1, l2)` and `(l2, l1)` combinations are redundant and only `l1 <= l2`
+    /// is returned.
+    fn coupled_channels(&self, o3_lambda: usize, o3_sigma: i32, same_neighbors: bool) -> Vec<(usize, usize)> {
+        return self.clebsch_gordan.keys()
+            .filter(|&&[l_1, l_2, lambda]| {
+                let sigma = if (l_1 + l_2 + lambda) % 2 == 0 { 1 } else { -1 };
+                lambda == o3_lambda && sigma == o3_sigma && (!same_neighbors || l_1 <= l_2)
+            })
+            .map(|&[l_1, l_2, _]| (l_1, l_2))
+            .collect();
+    }
+
+    /// Construct a `TensorMap` containing the set of samples/properties we want
+    /// the spherical expansion calculator to compute.
+    ///
+    /// All angular channels are included for every `center_type, neighbor_type`
+    /// pair in the descriptor, and all the blocks for a given pair share the
+    /// same samples. Angular channels which are not needed get an empty set of
+    /// properties.
+    fn selected_spx_labels(&self, descriptor: &TensorMap) -> TensorMap {
+        assert_eq!(descriptor.keys().names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+
+        // first, collect the samples for all `center_type, neighbor_type`
+        let mut samples_by_pair = BTreeMap::new();
+        for (key, block) in descriptor {
+            let center = key[2];
+            for neighbor in [key[3], key[4]] {
+                let samples = samples_by_pair.entry([center, neighbor]).or_insert_with(BTreeSet::new);
+                for &sample in block.samples().iter_fixed_size::<2>() {
+                    samples.insert(sample);
+                }
+            }
+        }
+
+        let mut requested_by_key = BTreeMap::new();
+        for &[center, neighbor] in samples_by_pair.keys() {
+            for &l in self.radial_sizes.keys() {
+                requested_by_key.insert([l.into(), 1.into(), center, neighbor], BTreeSet::new());
+            }
+        }
+
+        // then, go over the requested lambda-SOAP properties and group them
+        // depending on the angular channel and neighbor type
+        for (key, block) in descriptor {
+            let center = key[2];
+            let neighbor_1 = key[3];
+            let neighbor_2 = key[4];
+
+            for &[l_1, l_2, n_1, n_2] in block.properties().iter_fixed_size() {
+                requested_by_key.entry([l_1, 1.into(), center, neighbor_1])
+                    .or_insert_with(BTreeSet::new)
+                    .insert([n_1]);
+
+                requested_by_key.entry([l_2, 1.into(), center, neighbor_2])
+                    .or_insert_with(BTreeSet::new)
+                    .insert([n_2]);
+            }
+        }
+
+        let mut keys_builder = LabelsBuilder::new(vec!["o3_lambda", "o3_sigma", "center_type", "neighbor_type"]);
+        let mut blocks = Vec::new();
+        for (key, properties) in requested_by_key {
+            keys_builder.add(&key);
+
+            let mut samples_builder = LabelsBuilder::new(vec!["system", "atom"]);
+            for entry in &samples_by_pair[&[key[2], key[3]]] {
+                samples_builder.add(entry);
+            }
+            // SAFETY: samples come from a `BTreeSet`, and are thus unique
+            let samples = unsafe { samples_builder.finish_assume_unique() };
+
+            let mut properties_builder = LabelsBuilder::new(vec!["n"]);
+            for entry in properties {
+                properties_builder.add(&entry);
+            }
+            let properties = properties_builder.finish();
+
+            blocks.push(TensorBlock::new(
+                EmptyArray::new(vec![samples.count(), properties.count()]),
+                &samples,
+                &[],
+                &properties,
+            ).expect("invalid TensorBlock"));
+        }
+
+        return TensorMap::new(keys_builder.finish(), blocks).expect("invalid TensorMap")
+    }
+
+    /// Pre-compute the correspondance between samples of the spherical
+    /// expansion & lambda-SOAP, both for values and gradients.
+    ///
+    /// The spherical expansion samples are the same for all angular channels,
+    /// so we only use the blocks with `o3_lambda` equal to `first_l`.
+    fn samples_mapping(
+        descriptor: &TensorMap,
+        spherical_expansion: &TensorMap,
+        first_l: usize,
+    ) -> HashMap<Vec<LabelValue>, SamplesMapping> {
+        let mut mapping = HashMap::new();
+        for (key, block) in descriptor {
+            let center_type = key[2];
+            let neighbor_1_type = key[3];
+            let neighbor_2_type = key[4];
+
+            let block_id_1 = spherical_expansion.keys().position(&[
+                first_l.into(), 1.into(), center_type, neighbor_1_type
+            ]).expect("missing block in spherical expansion");
+            let spx_block_1 = &spherical_expansion.block_by_id(block_id_1);
+            let spx_samples_1 = spx_block_1.samples();
+
+            let block_id_2 = spherical_expansion.keys().position(&[
+                first_l.into(), 1.into(), center_type, neighbor_2_type
+            ]).expect("missing block in spherical expansion");
+            let spx_block_2 = &spherical_expansion.block_by_id(block_id_2);
+            let spx_samples_2 = spx_block_2.samples();
+
+            let samples = block.samples();
+            let mut values_mapping = Vec::with_capacity(samples.count());
+            for sample in samples.iter() {
+                let sample_1 = spx_samples_1.position(sample).expect("missing spherical expansion sample");
+                let sample_2 = spx_samples_2.position(sample).expect("missing spherical expansion sample");
+                values_mapping.push((sample_1, sample_2));
+            }
+
+            let mut gradient_mapping = Vec::new();
+            if let Some(gradient) = block.gradient("positions") {
+                let spx_gradient_1 = spx_block_1.gradient("positions").expect("missing spherical expansion gradients");
+                let spx_gradient_2 = spx_block_2.gradient("positions").expect("missing spherical expansion gradients");
+
+                let gradient_samples = gradient.samples();
+                gradient_mapping.reserve(gradient_samples.count());
+
+                let spx_gradient_1_samples = spx_gradient_1.samples();
+                let spx_gradient_2_samples = spx_gradient_2.samples();
+
+                for &[sample, system, atom] in gradient_samples.iter_fixed_size() {
+                    // same as for the power spectrum, the "sample" dimension
+                    // does not necessarily match between lambda-SOAP and the
+                    // spherical expansion
+                    let (spx_1_sample, spx_2_sample) = values_mapping[sample.usize()];
+
+                    let mapping_1 = spx_gradient_1_samples.position(
+                        &[spx_1_sample.into(), system, atom]
+                    );
+                    let mapping_2 = spx_gradient_2_samples.position(
+                        &[spx_2_sample.into(), system, atom]
+                    );
+
+                    debug_assert!(mapping_1.is_some() || mapping_2.is_some());
+                    gradient_mapping.push((mapping_1, mapping_2));
+                }
+            }
+
+            mapping.insert(key.to_vec(), SamplesMapping {
+                values: values_mapping,
+                gradients: gradient_mapping
+            });
+        }
+
+        return mapping;
+    }
+
+    /// Get the list of spherical expansion properties to couple when computing
+    /// a single block (associated with the given key) of lambda-SOAP.
+    fn spx_properties_to_couple<'a>(
+        &'a self,
+        key: &[LabelValue],
+        properties: &Labels,
+        spherical_expansion: &'a HashMap<&[LabelValue], SphericalExpansionBlock<'a>>,
+    ) -> Vec<SpxPropertiesToCouple<'a>> {
+        let o3_lambda = key[0].usize();
+        let center_type = key[2];
+        let neighbor_1_type = key[3];
+        let neighbor_2_type = key[4];
+
+        return properties.iter_fixed_size().map(|&[l_1, l_2, n_1, n_2]| {
+            let key_1: &[_] = &[l_1, 1.into(), center_type, neighbor_1_type];
+            let block_1 = spherical_expansion.get(&key_1)
+                .expect("missing first neighbor type block in spherical expansion");
+
+            let key_2: &[_] = &[l_2, 1.into(), center_type, neighbor_2_type];
+            let block_2 = spherical_expansion.get(&key_2)
+                .expect("missing second neighbor type block in spherical expansion");
+
+            let clebsch_gordan = self.clebsch_gordan.get(&[l_1.usize(), l_2.usize(), o3_lambda])
+                .map(Vec::as_slice)
+                .unwrap_or_default();
+
+            SpxPropertiesToCouple {
+                property_1: block_1.properties.position(&[n_1]).expect("missing n_1"),
+                property_2: block_2.properties.position(&[n_2]).expect("missing n_2"),
+                spx_1: block_1,
+                spx_2: block_2,
+                clebsch_gordan: clebsch_gordan,
+            }
+        }).collect();
+    }
+}
+
+/// Data about the two spherical expansion properties that will get coupled to
+/// produce a single `(l1, l2, n1, n2)` property in a lambda-SOAP block
+struct SpxPropertiesToCouple<'a> {
+    /// position of n1 in the first spherical expansion properties
+    property_1: usize,
+    /// position of n2 in the second spherical expansion properties
+    property_2: usize,
+    /// first spherical expansion block
+    spx_1: &'a SphericalExpansionBlock<'a>,
+    /// second spherical expansion block
+    spx_2: &'a SphericalExpansionBlock<'a>,
+    /// non-zero Clebsch-Gordan coefficients to use
+    clebsch_gordan: &'a [ClebschGordanCoefficient],
+}
+
+impl CalculatorBase for LambdaSoap {
+    fn name(&self) -> String {
+        "lambda-SOAP".into()
+    }
+
+    fn parameters(&self) -> String {
+        serde_json::to_string(&self.parameters).expect("failed to serialize to JSON")
+    }
+
+    fn cutoffs(&self) -> &[f64] {
+        self.spherical_expansion.cutoffs()
+    }
+
+    fn keys(&self, systems: &mut [Box<dyn System>]) -> Result<Labels, Error> {
+        let builder = CenterTwoNeighborsTypesKeys {
+            cutoff: self.parameters.cutoff.radius,
+            self_pairs: true,
+            symmetric: true,
+        };
+        let types_keys = builder.keys(systems)?;
+
+        let mut keys = LabelsBuilder::new(vec!["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+        for o3_lambda in 0..=self.parameters.max_lambda {
+            for o3_sigma in [1, -1] {
+                if self.coupled_channels(o3_lambda, o3_sigma, false).is_empty() {
+                    continue;
+                }
+
+                for &[center_type, neighbor_1_type, neighbor_2_type] in types_keys.iter_fixed_size() {
+                    keys.add(&[o3_lambda.into(), o3_sigma.into(), center_type, neighbor_1_type, neighbor_2_type]);
+                }
+            }
+        }
+
+        return Ok(keys.finish());
+    }
+
+    fn sample_names(&self) -> Vec<&str> {
+        AtomCenteredSamples::sample_names()
+    }
+
+    fn samples(&self, keys: &Labels, systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
+        assert_eq!(keys.names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+
+        // the samples only depend on the atomic types, only compute them once
+        let mut samples_by_types = BTreeMap::new();
+        let mut result = Vec::new();
+        for &[_, _, center_type, neighbor_1_type, neighbor_2_type] in keys.iter_fixed_size() {
+            let types = [center_type, neighbor_1_type, neighbor_2_type];
+            if !samples_by_types.contains_key(&types) {
+                let builder = AtomCenteredSamples {
+                    cutoff: self.parameters.cutoff.radius,
+                    center_type: AtomicTypeFilter::Single(center_type.i32()),
+                    // we only want center with both neighbor types present
+                    neighbor_type: AtomicTypeFilter::AllOf(
+                        [
+                            neighbor_1_type.i32(),
+                            neighbor_2_type.i32()
+                        ].iter().copied().collect()
+                    ),
+                    self_pairs: true,
+                };
+
+                samples_by_types.insert(types, builder.samples(systems)?);
+            }
+
+            result.push(samples_by_types[&types].clone());
+        }
+
+        return Ok(result);
+    }
+
+    fn positions_gradient_samples(&self, keys: &Labels, samples: &[Labels], systems: &mut [Box<dyn System>]) -> Result<Vec<Labels>, Error> {
+        assert_eq!(keys.names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+        assert_eq!(keys.count(), samples.len());
+
+        let mut gradient_samples = Vec::new();
+        for (&[_, _, center_type, neighbor_1_type, neighbor_2_type], samples) in keys.iter_fixed_size().zip(samples) {
+            let builder = AtomCenteredSamples {
+                cutoff: self.parameters.cutoff.radius,
+                center_type: AtomicTypeFilter::Single(center_type.i32()),
+                // gradients samples should contain either neighbor types
+                neighbor_type: AtomicTypeFilter::OneOf(vec![
+                    neighbor_1_type.i32(),
+                    neighbor_2_type.i32()
+                ]),
+                self_pairs: true,
+            };
+
+            gradient_samples.push(builder.gradients_for(systems, samples)?);
+        }
+
+        return Ok(gradient_samples);
+    }
+
+    fn supports_gradient(&self, parameter: &str) -> bool {
+        match parameter {
+            "positions" | "cell" | "strain" => true,
+            _ => false,
+        }
+    }
+
+    fn components(&self, keys: &Labels) -> Vec<Vec<Labels>> {
+        assert_eq!(keys.names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+
+        let mut component_by_lambda = BTreeMap::new();
+        let mut result = Vec::new();
+        for [o3_lambda, _, _, _, _] in keys.iter_fixed_size() {
+            let components = component_by_lambda.entry(*o3_lambda).or_insert_with(|| {
+                let mut component = LabelsBuilder::new(vec!["o3_mu"]);
+                for mu in -o3_lambda.i32()..=o3_lambda.i32() {
+                    component.add(&[LabelValue::new(mu)]);
+                }
+                vec![component.finish()]
+            });
+            result.push(components.clone());
+        }
+        return result;
+    }
+
+    fn property_names(&self) -> Vec<&str> {
+        vec!["l_1", "l_2", "n_1", "n_2"]
+    }
+
+    fn properties(&self, keys: &Labels) -> Vec<Labels> {
+        assert_eq!(keys.names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+
+        let mut properties_cache = BTreeMap::new();
+        let mut result = Vec::new();
+        for &[o3_lambda, o3_sigma, _, neighbor_1_type, neighbor_2_type] in keys.iter_fixed_size() {
+            let same_neighbors = neighbor_1_type == neighbor_2_type;
+            let properties = properties_cache.entry((o3_lambda, o3_sigma, same_neighbors)).or_insert_with(|| {
+                let mut properties = LabelsBuilder::new(self.property_names());
+                for (l_1, l_2) in self.coupled_channels(o3_lambda.usize(), o3_sigma.i32(), same_neighbors) {
+                    for n_1 in 0..self.radial_sizes[&l_1] {
+                        for n_2 in 0..self.radial_sizes[&l_2] {
+                            properties.add(&[l_1, l_2, n_1, n_2]);
+                        }
+                    }
+                }
+                properties.finish()
+            });
+            result.push(properties.clone());
+        }
+
+        return result;
+    }
+
+    #[time_graph::instrument(name = "LambdaSoap::compute")]
+    #[allow(clippy::too_many_lines)]
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+        assert!(descriptor.keys().count() > 0);
+
+        let mut gradients = Vec::new();
+        if descriptor.block_by_id(0).gradient("positions").is_some() {
+            gradients.push("positions");
+        }
+        if descriptor.block_by_id(0).gradient("cell").is_some() {
+            gradients.push("cell");
+        }
+        if descriptor.block_by_id(0).gradient("strain").is_some() {
+            gradients.push("strain");
+        }
+
+        let selected = self.selected_spx_labels(descriptor);
+
+        let options = CalculationOptions {
+            gradients: &gradients,
+            selected_samples: LabelsSelection::Predefined(&selected),
+            selected_properties: LabelsSelection::Predefined(&selected),
+            selected_keys: Some(selected.keys()),
+            ..Default::default()
+        };
+
+        let spherical_expansion = self.spherical_expansion.compute(
+            systems,
+            options,
+        ).expect("failed to compute spherical expansion");
+
+        let first_l = *self.radial_sizes.keys().next().expect("there should be at least one angular channel");
+        let samples_mapping = LambdaSoap::samples_mapping(descriptor, &spherical_expansion, first_l);
+
+        let spherical_expansion = spherical_expansion.iter().map(|(key, block)| {
+            let spx_block = SphericalExpansionBlock {
+                properties: block.properties(),
+                values: block.values().to_array(),
+                positions_gradients: block.gradient("positions").map(|g| g.values().to_array()),
+                cell_gradients: block.gradient("cell").map(|g| g.values().to_array()),
+                strain_gradients: block.gradient("strain").map(|g| g.values().to_array()),
+            };
+
+            (key, spx_block)
+        }).collect::<HashMap<_, _>>();
+
+        for (key, mut block) in descriptor {
+            let mut block_data = block.data_mut();
+            let properties_to_couple = self.spx_properties_to_couple(
+                key,
+                &block_data.properties,
+                &spherical_expansion,
+            );
+
+            let mapping = samples_mapping.get(key).expect("missing sample mapping");
+
+            // The Clebsch-Gordan tables only contain non-zero coefficients, so
+            // the products are accumulated directly in the output, without
+            // creating any intermediate `(m1, m2)` arrays.
+            block_data.values.as_array_mut()
+                .axis_iter_mut(ndarray::Axis(0))
+                .into_par_iter()
+                .zip_eq(&mapping.values)
+                .for_each(|(mut values, &(spx_sample_1, spx_sample_2))| {
+                    for (property_i, spx) in properties_to_couple.iter().enumerate() {
+                        let SpxPropertiesToCouple { spx_1, spx_2, ..} = spx;
+
+                        for cg in spx.clebsch_gordan {
+                            // unsafe is required to remove the bound checking
+                            // in release mode (`uget` still checks bounds in
+                            // debug mode)
+                            unsafe {
+                                let value_1 = spx_1.values.uget([spx_sample_1, cg.m_1, spx.property_1]);
+                                let value_2 = spx_2.values.uget([spx_sample_2, cg.m_2, spx.property_2]);
+                                *values.uget_mut([cg.mu, property_i]) += cg.value * value_1 * value_2;
+                            }
+                        }
+                    }
+                });
+
+            // gradients with respect to the atomic positions
+            if let Some(mut gradient) = block.gradient_mut("positions") {
+                let gradient = gradient.data_mut();
+
+                gradient.values.to_array_mut()
+                    .axis_iter_mut(ndarray::Axis(0))
+                    .into_par_iter()
+                    .zip_eq(gradient.samples.par_iter())
+                    .zip_eq(&mapping.gradients)
+                    .for_each(|((mut values, gradient_sample), &(spx_grad_sample_1, spx_grad_sample_2))| {
+                        let sample_i = gradient_sample[0].usize();
+                        let (spx_sample_1, spx_sample_2) = mapping.values[sample_i];
+
+                        for (property_i, spx) in properties_to_couple.iter().enumerate() {
+                            let SpxPropertiesToCouple { spx_1, spx_2, ..} = spx;
+
+                            let spx_1_gradient = spx_1.positions_gradients.expect("missing spherical expansion gradients");
+                            let spx_2_gradient = spx_2.positions_gradients.expect("missing spherical expansion gradients");
+
+                            for cg in spx.clebsch_gordan {
+                                // SAFETY: see same loop for values
+                                unsafe {
+                                    if let Some(grad_sample_1) = spx_grad_sample_1 {
+                                        let value_2 = cg.value * spx_2.values.uget([spx_sample_2, cg.m_2, spx.property_2]);
+                                        for d in 0..3 {
+                                            *values.uget_mut([d, cg.mu, property_i]) += value_2 * spx_1_gradient.uget([grad_sample_1, d, cg.m_1, spx.property_1]);
+                                        }
+                                    }
+
+                                    if let Some(grad_sample_2) = spx_grad_sample_2 {
+                                        let value_1 = cg.value * spx_1.values.uget([spx_sample_1, cg.m_1, spx.property_1]);
+                                        for d in 0..3 {
+                                            *values.uget_mut([d, cg.mu, property_i]) += value_1 * spx_2_gradient.uget([grad_sample_2, d, cg.m_2, spx.property_2]);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    });
+            }
+
+            // gradients with respect to the strain/cell
+            for parameter in ["cell", "strain"] {
+                if let Some(mut gradient) = block.gradient_mut(parameter) {
+                    let gradient = gradient.data_mut();
+
+                    gradient.values.to_array_mut()
+                        .axis_iter_mut(ndarray::Axis(0))
+                        .into_par_iter()
+                        .zip_eq(gradient.samples.par_iter())
+                        .for_each(|(mut values, gradient_sample)| {
+                            let sample_i = gradient_sample[0].usize();
+                            let (spx_sample_1, spx_sample_2) = mapping.values[sample_i];
+
+                            for (property_i, spx) in properties_to_couple.iter().enumerate() {
+                                let SpxPropertiesToCouple { spx_1, spx_2, ..} = spx;
+
+                                let (spx_1_gradient, spx_2_gradient) = if parameter == "cell" {
+                                    (spx_1.cell_gradients, spx_2.cell_gradients)
+                                } else {
+                                    (spx_1.strain_gradients, spx_2.strain_gradients)
+                                };
+                                let spx_1_gradient = spx_1_gradient.expect("missing spherical expansion gradients");
+                                let spx_2_gradient = spx_2_gradient.expect("missing spherical expansion gradients");
+
+                                for cg in spx.clebsch_gordan {
+                                    // SAFETY: see same loop for values
+                                    unsafe {
+                                        let value_1 = cg.value * spx_1.values.uget([spx_sample_1, cg.m_1, spx.property_1]);
+                                        let value_2 = cg.value * spx_2.values.uget([spx_sample_2, cg.m_2, spx.property_2]);
+                                        for xyz_1 in 0..3 {
+                                            for xyz_2 in 0..3 {
+                                                let gradient_1 = spx_1_gradient.uget([spx_sample_1, xyz_1, xyz_2, cg.m_1, spx.property_1]);
+                                                let gradient_2 = spx_2_gradient.uget([spx_sample_2, xyz_1, xyz_2, cg.m_2, spx.property_2]);
+                                                *values.uget_mut([xyz_1, xyz_2, cg.mu, property_i]) += value_2 * gradient_1 + value_1 * gradient_2;
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        });
+                }
+            }
+        }
+
+        Ok(())
+    }
+}
+
+
+#[cfg(test)]
+mod tests {
+    use approx::assert_relative_eq;
+    use metatensor::LabelValue;
+
+    use crate::systems::test_utils::{test_systems, test_system};
+    use crate::Calculator;
+
+    use super::*;
+    use crate::calculators::CalculatorBase;
+    use crate::calculators::soap::{SoapPowerSpectrum, PowerSpectrumParameters};
+
+    use crate::calculators::soap::{Cutoff, Smoothing};
+    use crate::calculators::shared::{Density, DensityKind};
+    use crate::calculators::shared::{SoapRadialBasis, SphericalExpansionBasis, TensorProductBasis};
+
+
+    fn parameters() -> LambdaSoapParameters {
+        LambdaSoapParameters {
+            cutoff: Cutoff {
+                radius: 8.0,
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
+            },
+            density: Density {
+                kind: DensityKind::Gaussian { width: 0.3 },
+                scaling: None,
+                center_atom_weight: 1.0,
+            },
+            basis: SphericalExpansionBasis::TensorProduct(TensorProductBasis {
+                max_angular: 3,
+                radial: SoapRadialBasis::Gto { max_radial: 3, radius: None },
+                spline_accuracy: Some(1e-8),
+            }),
+            max_lambda: 3,
+        }
+    }
+
+    #[test]
+    fn keys_and_properties() {
+        let calculator = Calculator::from(Box::new(LambdaSoap::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        // 6 types combinations, and 7 (o3_lambda, o3_sigma) since
+        // o3_lambda=0 only has o3_sigma=1
+        assert_eq!(descriptor.keys().count(), 6 * 7);
+        assert!(!descriptor.keys().contains(
+            &[LabelValue::new(0), LabelValue::new(-1), LabelValue::new(1), LabelValue::new(1), LabelValue::new(1)]
+        ));
+
+        for (key, block) in &descriptor {
+            let o3_lambda = key[0].usize();
+            let o3_sigma = key[1].i32();
+            let same_neighbors = key[3] == key[4];
+
+            assert_eq!(block.components()[0].count(), 2 * o3_lambda + 1);
+            for &[l_1, l_2, _, _] in block.properties().iter_fixed_size() {
+                let (l_1, l_2) = (l_1.usize(), l_2.usize());
+                assert!(l_1.abs_diff(l_2) <= o3_lambda && o3_lambda <= l_1 + l_2);
+
+                let parity = if (l_1 + l_2 + o3_lambda) % 2 == 0 { 1 } else { -1 };
+                assert_eq!(parity, o3_sigma);
+
+                if same_neighbors {
+                    assert!(l_1 <= l_2);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn invariants_are_power_spectrum() {
+        let parameters = parameters();
+        let calculator = Calculator::from(Box::new(LambdaSoap::new(
+            parameters.clone()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let power_spectrum = Calculator::from(Box::new(SoapPowerSpectrum::new(PowerSpectrumParameters {
+            cutoff: parameters.cutoff.clone(),
+            density: parameters.density,
+            basis: parameters.basis,
+        }).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water", "methane"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+        let expected = power_spectrum.compute(&mut systems, Default::default()).unwrap();
+
+        for (key, block) in &descriptor {
+            if key[0].usize() != 0 {
+                continue;
+            }
+
+            let expected = expected.block(&Labels::new(
+                ["center_type", "neighbor_1_type", "neighbor_2_type"],
+                &[[key[2].i32(), key[3].i32(), key[4].i32()]],
+            )).unwrap();
+
+            // the power spectrum includes a sqrt(2) factor for different
+            // neighbor types
+            let factor = if key[3] == key[4] { 1.0 } else { std::f64::consts::SQRT_2 };
+
+            assert_eq!(block.samples(), expected.samples());
+            let values = block.values().to_array();
+            let expected_values = expected.values().to_array();
+            for (property_i, &[l_1, l_2, n_1, n_2]) in block.properties().iter_fixed_size().enumerate() {
+                assert_eq!(l_1, l_2);
+                let expected_i = expected.properties().position(&[l_1, n_1, n_2]).unwrap();
+                for sample_i in 0..block.samples().count() {
+                    assert_relative_eq!(
+                        factor * values[[sample_i, 0, property_i]],
+                        expected_values[[sample_i, expected_i]],
+                        epsilon=1e-12, max_relative=1e-10
+                    );
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn finite_differences_positions() {
+        let calculator = Calculator::from(Box::new(LambdaSoap::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("ethanol");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 5e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_positions(calculator, &system, options);
+    }
+
+    #[test]
+    fn finite_differences_cell() {
+        let calculator = Calculator::from(Box::new(LambdaSoap::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("ethanol");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 1e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_cell(calculator, &system, options);
+    }
+
+    #[test]
+    fn finite_differences_strain() {
+        let calculator = Calculator::from(Box::new(LambdaSoap::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("ethanol");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 1e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_strain(calculator, &system, options);
+    }
+
+    #[test]
+    fn compute_partial() {
+        let calculator = Calculator::from(Box::new(LambdaSoap::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["methane"]);
+
+        let properties = Labels::new(["l_1", "l_2", "n_1", "n_2"], &[
+            [0, 0, 0, 1],
+            [1, 2, 2, 0],
+            [2, 1, 1, 1],
+            [1, 1, 0, 2],
+            [3, 2, 1, 0],
+        ]);
+
+        let samples = Labels::new(["system", "atom"], &[
+            [0, 2],
+            [0, 1],
+        ]);
+
+        let mut keys = LabelsBuilder::new(vec!["o3_lambda", "o3_sigma", "center_type", "neighbor_1_type", "neighbor_2_type"]);
+        // not part of the default keys
+        keys.add(&[1, 1, 1, 8, 6]);
+        for [o3_lambda, o3_sigma] in [[0, 1], [1, 1], [1, -1], [2, 1], [2, -1], [3, 1], [3, -1]] {
+            for [center_type, neighbor_1_type, neighbor_2_type] in [[1, 1, 1], [1, 1, 6], [1, 6, 6], [6, 1, 1], [6, 1, 6], [6, 6, 6]] {
+                keys.add(&[o3_lambda, o3_sigma, center_type, neighbor_1_type, neighbor_2_type]);
+            }
+        }
+        let keys = keys.finish();
+
+        crate::calculators::tests_utils::compute_partial(
+            calculator, &mut systems, &keys, &samples, &properties
+        );
+    }
+}
@@ -1,6 +1,7 @@
 mod cutoff;
 pub use self::cutoff::Cutoff;
 pub use self::cutoff::Smoothing;
+pub use self::cutoff::TypePairCutoff;
 
 
 mod radial_integral;
@@ -17,3 +18,9 @@ pub use self::radial_spectrum::{SoapRadialSpectrum, RadialSpectrumParameters};
 
 mod power_spectrum;
 pub use self::power_spectrum::{SoapPowerSpectrum, PowerSpectrumParameters};
+
+mod lambda_soap;
+pub use self::lambda_soap::{LambdaSoap, LambdaSoapParameters};
+
+mod compressed_power_spectrum;
+pub use self::compressed_power_spectrum::{SoapCompressedPowerSpectrum, CompressedPowerSpectrumParameters};
@@ -58,7 +58,7 @@ impl std::fmt::Debug for SoapPowerSpectrum {
 impl SoapPowerSpectrum {
     pub fn new(parameters: PowerSpectrumParameters) -> Result<SoapPowerSpectrum, Error> {
         let expansion_parameters = SphericalExpansionParameters {
-            cutoff: parameters.cutoff,
+            cutoff: parameters.cutoff.clone(),
             density: parameters.density,
             basis: parameters.basis.clone(),
         };
@@ -148,7 +148,8 @@ impl SoapPowerSpectrum {
             for entry in samples {
                 samples_builder.add(&entry);
             }
-            let samples = samples_builder.finish();
+            // SAFETY: samples come from a `BTreeSet`, and are thus unique
+            let samples = unsafe { samples_builder.finish_assume_unique() };
 
             let mut properties_builder = LabelsBuilder::new(vec!["n"]);
             for entry in properties {
@@ -379,32 +380,32 @@ struct SpxPropertiesToCombine<'a> {
 
 /// Data from a single spherical expansion block
 #[derive(Debug, Clone)]
-struct SphericalExpansionBlock<'a> {
-    properties: Labels,
+pub(super) struct SphericalExpansionBlock<'a> {
+    pub(super) properties: Labels,
     /// spherical expansion values
-    values: &'a ndarray::ArrayD<f64>,
+    pub(super) values: &'a ndarray::ArrayD<f64>,
     /// spherical expansion position gradients
-    positions_gradients: Option<&'a ndarray::ArrayD<f64>>,
+    pub(super) positions_gradients: Option<&'a ndarray::ArrayD<f64>>,
     /// spherical expansion cell gradients
-    cell_gradients: Option<&'a ndarray::ArrayD<f64>>,
+    pub(super) cell_gradients: Option<&'a ndarray::ArrayD<f64>>,
     /// spherical expansion strain gradients
-    strain_gradients: Option<&'a ndarray::ArrayD<f64>>,
+    pub(super) strain_gradients: Option<&'a ndarray::ArrayD<f64>>,
 }
 
 /// Indexes of the spherical expansion samples/rows corresponding to each power
 /// spectrum row.
-struct SamplesMapping {
+pub(super) struct SamplesMapping {
     /// Mapping for the values: if the row `i` of the power spectrum is a
     /// combination of the rows `j` and `k` of two spherical expansion blocks,
     /// then this vector will contain `(j, k)` at index `i`
-    values: Vec<(usize, usize)>,
+    pub(super) values: Vec<(usize, usize)>,
     /// Mapping for the gradients, with a similar layout as the `values`
     ///
     /// Some samples might not be defined in both of the spherical expansion
     /// blocks being considered, for examples when dealing with two different
     /// neighbor types, only one the sample corresponding to the right
     /// neighbor type will be `Some`.
-    gradients: Vec<(Option<usize>, Option<usize>)>,
+    pub(super) gradients: Vec<(Option<usize>, Option<usize>)>,
 }
 
 impl CalculatorBase for SoapPowerSpectrum {
@@ -526,7 +527,7 @@ impl CalculatorBase for SoapPowerSpectrum {
 
     #[time_graph::instrument(name = "SoapPowerSpectrum::compute")]
     #[allow(clippy::too_many_lines)]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert!(descriptor.keys().count() > 0);
 
         let mut gradients = Vec::new();
@@ -795,7 +796,8 @@ mod tests {
         PowerSpectrumParameters {
             cutoff: Cutoff {
                 radius: 8.0,
-                smoothing: Smoothing::ShiftedCosine { width: 0.5 }
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
             },
             density: Density {
                 kind: DensityKind::Gaussian { width: 0.3 },
@@ -808,7 +810,7 @@ mod tests {
 
     #[test]
     fn values() {
-        let mut calculator = Calculator::from(Box::new(SoapPowerSpectrum::new(
+        let calculator = Calculator::from(Box::new(SoapPowerSpectrum::new(
             parameters()
         ).unwrap()) as Box<dyn CalculatorBase>);
 
@@ -971,7 +973,7 @@ mod tests {
             ..Default::default()
         };
 
-        let mut calculator = Calculator::from(Box::new(SoapPowerSpectrum::new(
+        let calculator = Calculator::from(Box::new(SoapPowerSpectrum::new(
             parameters()
         ).unwrap()) as Box<dyn CalculatorBase>);
 
@@ -996,7 +998,8 @@ mod tests {
         let mut parameters = PowerSpectrumParameters {
             cutoff: Cutoff {
                 radius: 0.5,
-                smoothing: Smoothing::ShiftedCosine { width: 0.5 }
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
             },
             density: Density {
                 kind: DensityKind::Gaussian { width: 0.3 },
@@ -1011,13 +1014,13 @@ mod tests {
         };
 
         parameters.density.center_atom_weight = 1.0;
-        let mut calculator = Calculator::from(Box::new(
+        let calculator = Calculator::from(Box::new(
             SoapPowerSpectrum::new(parameters.clone()).unwrap(),
         ) as Box<dyn CalculatorBase>);
         let descriptor = calculator.compute(system, Default::default()).unwrap();
 
         parameters.density.center_atom_weight = 0.5;
-        let mut calculator = Calculator::from(Box::new(
+        let calculator = Calculator::from(Box::new(
             SoapPowerSpectrum::new(parameters).unwrap(),
         ) as Box<dyn CalculatorBase>);
 
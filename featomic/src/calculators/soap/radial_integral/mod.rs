@@ -1,6 +1,7 @@
 use std::collections::BTreeMap;
 
 use ndarray::{Array1, ArrayViewMut1};
+use rayon::prelude::*;
 
 use crate::calculators::shared::DensityKind;
 use crate::calculators::shared::{SphericalExpansionBasis, SoapRadialBasis};
@@ -149,32 +150,36 @@ impl SoapRadialIntegralCacheByAngular {
     ) -> Result<SoapRadialIntegralCacheByAngular, Error> {
         match basis {
             SphericalExpansionBasis::TensorProduct(basis) => {
-                let mut by_angular = BTreeMap::new();
-                for o3_lambda in 0..=basis.max_angular {
-                    let cache = SoapRadialIntegralCache::new(
-                        o3_lambda,
-                        &basis.radial,
-                        density,
-                        cutoff,
-                        basis.spline_accuracy
-                    )?;
-                    by_angular.insert(o3_lambda, cache);
-                }
+                // the setup of each angular channel (orthonormalization,
+                // splines) is independent, and can run in parallel
+                let by_angular = (0..=basis.max_angular).into_par_iter()
+                    .map(|o3_lambda| {
+                        let cache = SoapRadialIntegralCache::new(
+                            o3_lambda,
+                            &basis.radial,
+                            density,
+                            cutoff,
+                            basis.spline_accuracy
+                        )?;
+                        Ok((o3_lambda, cache))
+                    })
+                    .collect::<Result<BTreeMap<_, _>, Error>>()?;
 
                 return Ok(SoapRadialIntegralCacheByAngular { by_angular });
             }
             SphericalExpansionBasis::Explicit(basis) => {
-                let mut by_angular = BTreeMap::new();
-                for (&o3_lambda, radial) in &*basis.by_angular {
-                    let cache = SoapRadialIntegralCache::new(
-                        o3_lambda,
-                        radial,
-                        density,
-                        cutoff,
-                        basis.spline_accuracy
-                    )?;
-                    by_angular.insert(o3_lambda, cache);
-                }
+                let by_angular = basis.by_angular.par_iter()
+                    .map(|(&o3_lambda, radial)| {
+                        let cache = SoapRadialIntegralCache::new(
+                            o3_lambda,
+                            radial,
+                            density,
+                            cutoff,
+                            basis.spline_accuracy
+                        )?;
+                        Ok((o3_lambda, cache))
+                    })
+                    .collect::<Result<BTreeMap<_, _>, Error>>()?;
                 return Ok(SoapRadialIntegralCacheByAngular {
                     by_angular
                 });
@@ -81,7 +81,7 @@ impl SoapRadialSpectrum {
         by_angular.insert(0, parameters.basis.radial.clone());
 
         let expansion_parameters = SphericalExpansionParameters {
-            cutoff: parameters.cutoff,
+            cutoff: parameters.cutoff.clone(),
             density: parameters.density,
             basis: SphericalExpansionBasis::Explicit(ExplicitBasis {
                 by_angular: by_angular.into(),
@@ -224,7 +224,7 @@ impl CalculatorBase for SoapRadialSpectrum {
     }
 
     #[time_graph::instrument(name = "SoapRadialSpectrum::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert_eq!(descriptor.keys().names(), ["center_type", "neighbor_type"]);
         assert!(descriptor.keys().count() > 0);
 
@@ -343,7 +343,8 @@ mod tests {
         RadialSpectrumParameters {
             cutoff: Cutoff {
                 radius: 3.5,
-                smoothing: Smoothing::ShiftedCosine { width: 0.5 }
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
             },
             density: Density {
                 kind: DensityKind::Gaussian { width: 0.3 },
@@ -356,7 +357,7 @@ mod tests {
 
     #[test]
     fn values() {
-        let mut calculator = Calculator::from(Box::new(
+        let calculator = Calculator::from(Box::new(
             SoapRadialSpectrum::new(parameters()).unwrap()
         ) as Box<dyn CalculatorBase>);
 
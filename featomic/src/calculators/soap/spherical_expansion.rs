@@ -1,12 +1,14 @@
-use std::collections::{BTreeMap, BTreeSet, HashMap};
+use std::collections::{BTreeMap, BTreeSet};
 
+use log::debug;
 use ndarray::s;
 use rayon::prelude::*;
 
 use metatensor::{LabelsBuilder, Labels, LabelValue, TensorBlockRefMut};
 use metatensor::TensorMap;
 
-use crate::{Error, System};
+use crate::{Error, System, Vector3D};
+use crate::systems::Pair;
 
 use crate::labels::{SamplesBuilder, AtomicTypeFilter, AtomCenteredSamples};
 use crate::labels::{KeysBuilder, CenterSingleNeighborsTypesKeys};
@@ -14,9 +16,9 @@ use crate::labels::{KeysBuilder, CenterSingleNeighborsTypesKeys};
 use super::super::CalculatorBase;
 
 use super::{SphericalExpansionByPair, SphericalExpansionParameters};
-use super::spherical_expansion_pair::{GradientsOptions, PairContribution};
+use super::spherical_expansion_pair::{GradientsOptions, PairContribution, PAIRS_BATCH_SIZE};
 
-use crate::calculators::shared::SphericalExpansionBasis;
+use crate::calculators::shared::{SphericalExpansionBasis, ScratchPool, resize_zeroed};
 use super::super::shared::descriptors_by_systems::{array_mut_for_system, split_tensor_map_by_system};
 
 
@@ -27,6 +29,8 @@ pub struct SphericalExpansion {
     by_pair: SphericalExpansionByPair,
     /// Cache for (-1)^l values
     m_1_pow_l: Vec<f64>,
+    /// Re-usable memory for the calculation of a single system
+    scratch: ScratchPool<SystemScratch>,
 }
 
 impl SphericalExpansion {
@@ -39,13 +43,14 @@ impl SphericalExpansion {
         return Ok(SphericalExpansion {
             by_pair: SphericalExpansionByPair::new(parameters)?,
             m_1_pow_l,
+            scratch: ScratchPool::new(),
         });
     }
 
     /// Accumulate the self contribution to the spherical expansion
     /// coefficients, i.e. the contribution arising from the density of the
     /// center atom around itself.
-    fn do_self_contributions(&mut self, systems: &[Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn do_self_contributions(&self, systems: &[Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         debug_assert_eq!(descriptor.keys().names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_type"]);
 
         if !self.by_pair.parameters.basis.angular_channels().contains(&0) {
@@ -96,36 +101,67 @@ impl SphericalExpansion {
     }
 
     /// For one system, compute the spherical expansion and corresponding
-    /// gradients by summing over the pairs.
+    /// gradients by summing over the pairs. The atoms to include in the
+    /// calculation are taken from `scratch.requested_atoms`, and the result is
+    /// stored in `scratch.result`.
     #[allow(clippy::too_many_lines)]
     fn accumulate_all_pairs(
         &self,
         system: &dyn System,
         do_gradients: GradientsOptions,
-        requested_atoms: &BTreeSet<usize>,
-    ) -> Result<PairAccumulationResult, Error> {
-        // pre-filter pairs to only include the ones containing at least one of
-        // the requested atoms
-        let pairs = system.pairs()?;
-
-        let pair_should_contribute = |pair: &&crate::systems::Pair| {
-            requested_atoms.contains(&pair.first) || requested_atoms.contains(&pair.second)
-        };
-        let pairs_count = pairs.iter().filter(pair_should_contribute).count();
+        scratch: &mut SystemScratch,
+    ) -> Result<(), Error> {
+        let SystemScratch {
+            requested_atoms,
+            contributing_pairs,
+            contributions,
+            pairs_for_positions_gradient,
+            result,
+        } = scratch;
 
         let system_size = system.size()?;
         let types = system.types()?;
 
-        let mut types_mapping = BTreeMap::new();
+        result.types_mapping.clear();
         for &atomic_type in types {
-            let next_idx = types_mapping.len();
-            types_mapping.entry(atomic_type).or_insert(next_idx);
+            let next_idx = result.types_mapping.len();
+            result.types_mapping.entry(atomic_type).or_insert(next_idx);
         }
 
-        let center_mapping = (0..system_size).map(|atom_i| {
-            requested_atoms.iter().position(|&atom| atom == atom_i)
-        }).collect::<Vec<_>>();
+        result.center_mapping.clear();
+        result.center_mapping.resize(system_size, None);
+        for (mapped_center, &atom_i) in requested_atoms.iter().enumerate() {
+            if atom_i < system_size {
+                result.center_mapping[atom_i] = Some(mapped_center);
+            }
+        }
+
+        // pre-filter pairs to only include the ones containing at least one of
+        // the requested atoms, and within the cutoff for their types (the
+        // neighbor list is computed with the largest cutoff)
+        let radii = self.by_pair.parameters.cutoff.pair_radii(types);
+        contributing_pairs.clear();
+        if 2 * requested_atoms.len() < system_size {
+            // only a few atoms are requested (e.g. when updating a descriptor
+            // after some atoms moved): gather the pairs around these atoms
+            // instead of going over the full list of pairs
+            for &atom_i in requested_atoms.iter().filter(|&&atom_i| atom_i < system_size) {
+                contributing_pairs.extend(system.pairs_containing(atom_i)?.iter().filter(|pair| {
+                    pair.distance < radii.radius(pair.first, pair.second)
+                }));
+            }
 
+            // pairs between two requested atoms (and pairs between an atom and
+            // its own periodic image) can be found multiple times
+            contributing_pairs.sort_unstable_by_key(|pair| (pair.first, pair.second, pair.cell_shift_indices));
+            contributing_pairs.dedup_by_key(|pair| (pair.first, pair.second, pair.cell_shift_indices));
+        } else {
+            contributing_pairs.extend(system.pairs()?.iter().filter(|pair| {
+                let contributes = result.center_mapping[pair.first].is_some() || result.center_mapping[pair.second].is_some();
+                let within_cutoff = pair.distance < radii.radius(pair.first, pair.second);
+                contributes && within_cutoff
+            }));
+        }
 
         let radial_sizes = match self.by_pair.parameters.basis {
             SphericalExpansionBasis::TensorProduct(ref basis) => {
@@ -137,182 +173,108 @@ impl SphericalExpansion {
         };
         let angular_channels = self.by_pair.parameters.basis.angular_channels();
 
-        let mut contribution = PairContribution::new(
-            &angular_channels,
-            &radial_sizes,
-            do_gradients.any(),
-        );
-
-        let mut result = PairAccumulationResult {
-            values: angular_channels.iter().zip(&radial_sizes).map(|(&o3_lambda, &radial_size)| {
-                let shape = (types_mapping.len(), requested_atoms.len(), 2 * o3_lambda + 1, radial_size);
-                (o3_lambda, ndarray::Array4::from_elem(shape, 0.0))
-            }).collect(),
-            positions_gradient_by_pair: if do_gradients.positions {
-                Some(angular_channels.iter().zip(&radial_sizes).map(|(&o3_lambda, &radial_size)| {
-                    let shape = (pairs_count, 3, 2 * o3_lambda + 1, radial_size);
-                    (o3_lambda, ndarray::Array4::from_elem(shape, 0.0))
-                }).collect())
-            } else {
-                None
-            },
-            self_positions_gradients: if do_gradients.positions {
-                Some(angular_channels.iter().zip(&radial_sizes).map(|(&o3_lambda, &radial_size)| {
-                    let shape = (types_mapping.len(), requested_atoms.len(), 3, 2 * o3_lambda + 1, radial_size);
-                    (o3_lambda, ndarray::Array5::from_elem(shape, 0.0))
-                }).collect())
-            } else {
-                None
-            },
-            cell_gradients: if do_gradients.cell {
-                Some(angular_channels.iter().zip(&radial_sizes).map(|(&o3_lambda, &radial_size)| {
-                    let shape = (types_mapping.len(), requested_atoms.len(), 3, 3, 2 * o3_lambda + 1, radial_size);
-                    (o3_lambda, ndarray::Array6::from_elem(shape, 0.0))
-                }).collect())
-            } else {
-                None
-            },
-            strain_gradients: if do_gradients.strain {
-                Some(angular_channels.iter().zip(&radial_sizes).map(|(&o3_lambda, &radial_size)| {
-                    let shape = (types_mapping.len(), requested_atoms.len(), 3, 3, 2 * o3_lambda + 1, radial_size);
-                    (o3_lambda, ndarray::Array6::from_elem(shape, 0.0))
-                }).collect())
-            } else {
-                None
-            },
-            types_mapping,
-            center_mapping,
-            pairs_for_positions_gradient: HashMap::new(),
-        };
-
-        for (pair_id, pair) in pairs.iter().filter(pair_should_contribute).enumerate() {
-            debug_assert!(requested_atoms.contains(&pair.first) || requested_atoms.contains(&pair.second));
-
-            let direction = pair.vector / pair.distance;
-
-            self.by_pair.compute_for_pair(pair.distance, direction, do_gradients, &mut contribution);
-
-            if let Some(mapped_center) = result.center_mapping[pair.first] {
-                // add the pair contribution to the atomic environnement
-                // corresponding to the **first** atom in the pair
-                let neighbor_i = pair.second;
-
-                result.pairs_for_positions_gradient.entry((pair.first, pair.second))
-                    .or_default()
-                    .push(pair_id);
-
-                let neighbor_type_i = result.types_mapping[&types[neighbor_i]];
-                for (o3_lambda, &radial_size) in angular_channels.iter().zip(&radial_sizes) {
-                    let values = result.values.get_mut(o3_lambda).expect("missing o3_lambda");
-                    let mut values = values.slice_mut(s![neighbor_type_i, mapped_center, .., ..]);
-                    values += contribution.values.get(o3_lambda).expect("missing o3_lambda");
-
-
-                    if let Some(ref contribution_gradients) = contribution.gradients {
-                        let contribution_gradients = contribution_gradients.get(o3_lambda).expect("missing o3_lambda");
+        if contributions.is_empty() || contributions[0].gradients.is_some() != do_gradients.any() {
+            *contributions = (0..PAIRS_BATCH_SIZE).map(|_| PairContribution::new(
+                &angular_channels,
+                &radial_sizes,
+                do_gradients.any(),
+            )).collect();
+        }
 
-                        if let Some(ref mut positions_gradients) = result.positions_gradient_by_pair {
+        result.reset(&angular_channels, &radial_sizes, contributing_pairs.len(), requested_atoms.len(), do_gradients);
+        pairs_for_positions_gradient.clear();
+
+        let mut distances = [0.0; PAIRS_BATCH_SIZE];
+        let mut directions = [Vector3D::zero(); PAIRS_BATCH_SIZE];
+        let mut cutoffs = [0.0; PAIRS_BATCH_SIZE];
+        for (batch_i, batch) in contributing_pairs.chunks(PAIRS_BATCH_SIZE).enumerate() {
+            for (pair_i, pair) in batch.iter().enumerate() {
+                distances[pair_i] = pair.distance;
+                directions[pair_i] = pair.vector / pair.distance;
+                cutoffs[pair_i] = radii.radius(pair.first, pair.second);
+            }
+            self.by_pair.compute_for_pairs(
+                &distances[..batch.len()],
+                &directions[..batch.len()],
+                &cutoffs[..batch.len()],
+                do_gradients,
+                contributions,
+            );
+
+            for (pair_i, (pair, contribution)) in batch.iter().zip(contributions.iter()).enumerate() {
+                let pair_id = batch_i * PAIRS_BATCH_SIZE + pair_i;
+                debug_assert!(result.center_mapping[pair.first].is_some() || result.center_mapping[pair.second].is_some());
+
+                if let Some(ref contribution_gradients) = contribution.gradients {
+                    if let Some(ref mut positions_gradients) = result.positions_gradient_by_pair {
+                        for o3_lambda in &angular_channels {
                             let positions_gradients = positions_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
-                            let gradients = &mut positions_gradients.slice_mut(s![pair_id, .., .., ..]);
-                            gradients.assign(contribution_gradients);
-                        }
-
-                        if pair.first != pair.second {
-                            if let Some(ref mut positions_gradients) = result.self_positions_gradients {
-                                let positions_gradients = positions_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
-                                let mut gradients = positions_gradients.slice_mut(s![neighbor_type_i, mapped_center, .., .., ..]);
-                                gradients -= contribution_gradients;
-                            }
-                        }
-
-                        if let Some(ref mut cell_gradients) = result.cell_gradients {
-                            let cell_gradients = cell_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
-                            let mut cell_gradients = cell_gradients.slice_mut(
-                                s![neighbor_type_i, mapped_center, .., .., .., ..]
-                            );
-
-                            for abc in 0..3 {
-                                let shift = pair.cell_shift_indices[abc] as f64;
-                                for xyz in 0..3 {
-                                    for m in 0..(2 * o3_lambda + 1) {
-                                        for n in 0..radial_size {
-                                            // SAFETY: we are doing in-bounds access, and removing the bounds
-                                            // checks is a significant speed-up for this code. The bounds are
-                                            // still checked in debug mode
-                                            unsafe {
-                                                let out = cell_gradients.uget_mut([abc, xyz, m, n]);
-                                                *out += shift * contribution_gradients.uget([xyz, m, n]);
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-
-                        if let Some(ref mut strain_gradients) = result.strain_gradients {
-                            let strain_gradients = strain_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
-                            let mut strain_gradients = strain_gradients.slice_mut(
-                                s![neighbor_type_i, mapped_center, .., .., .., ..]
-                            );
-
-                            for xyz_1 in 0..3 {
-                                for xyz_2 in 0..3 {
-                                    for m in 0..(2 * o3_lambda + 1) {
-                                        for n in 0..radial_size {
-                                            // SAFETY: same as above
-                                            unsafe {
-                                                let out = strain_gradients.uget_mut([xyz_1, xyz_2, m, n]);
-                                                *out += pair.vector[xyz_1] * contribution_gradients.uget([xyz_2, m, n]);
-                                            }
-                                        }
-                                    }
-                                }
-                            }
+                            let contribution_gradients = contribution_gradients.get(o3_lambda).expect("missing o3_lambda");
+                            positions_gradients.slice_mut(s![pair_id, .., .., ..]).assign(contribution_gradients);
                         }
                     }
                 }
-            }
 
-            if let Some(mapped_center) = result.center_mapping[pair.second] {
-                // add the pair contribution to the atomic environnement
-                // corresponding to the **second** atom in the pair
-                let neighbor_i = pair.first;
+                // The same contribution is used for both orientations of the
+                // pair. Going from the i -> j to the j -> i pair is equivalent
+                // to multiplying the values by (-1)^l, and the gradients by
+                // -(-1)^l, which we do directly when accumulating.
+                for inverted in [false, true] {
+                    let (center_i, neighbor_i) = if inverted {
+                        (pair.second, pair.first)
+                    } else {
+                        (pair.first, pair.second)
+                    };
 
-                result.pairs_for_positions_gradient.entry((pair.second, pair.first))
-                    .or_default()
-                    .push(pair_id);
+                    let mapped_center = if let Some(mapped_center) = result.center_mapping[center_i] {
+                        mapped_center
+                    } else {
+                        continue;
+                    };
 
-                contribution.inverse_pair(&self.m_1_pow_l);
+                    if do_gradients.positions {
+                        pairs_for_positions_gradient.push((mapped_center, PairForGradient {
+                            neighbor: neighbor_i,
+                            pair_id: pair_id,
+                            inverted: inverted,
+                        }));
+                    }
 
-                let neighbor_type_i = result.types_mapping[&types[neighbor_i]];
+                    // the vector from center to neighbor also changes sign
+                    // when inverting the pair
+                    let vector_sign = if inverted { -1.0 } else { 1.0 };
 
-                for (o3_lambda, &radial_size) in angular_channels.iter().zip(&radial_sizes) {
-                    let values = result.values.get_mut(o3_lambda).expect("missing o3_lambda");
-                    let mut values = values.slice_mut(s![neighbor_type_i, mapped_center, .., ..]);
-                    values += contribution.values.get(o3_lambda).expect("missing o3_lambda");
+                    let neighbor_type_i = result.types_mapping[&types[neighbor_i]];
+                    for (&o3_lambda, &radial_size) in angular_channels.iter().zip(&radial_sizes) {
+                        let values_factor = if inverted { self.m_1_pow_l[o3_lambda] } else { 1.0 };
+                        let gradients_factor = if inverted { -self.m_1_pow_l[o3_lambda] } else { 1.0 };
 
+                        let values = result.values.get_mut(&o3_lambda).expect("missing o3_lambda");
+                        let mut values = values.slice_mut(s![neighbor_type_i, mapped_center, .., ..]);
+                        values.scaled_add(values_factor, contribution.values.get(&o3_lambda).expect("missing o3_lambda"));
 
-                    if let Some(ref contribution_gradients) = contribution.gradients {
-                        let contribution_gradients = contribution_gradients.get(o3_lambda).expect("missing o3_lambda");
-                        // we don't add second->first pair to positions_gradient_by_pair,
-                        // instead handling this in position_gradients_to_metatensor
+                        let contribution_gradients = if let Some(ref contribution_gradients) = contribution.gradients {
+                            contribution_gradients.get(&o3_lambda).expect("missing o3_lambda")
+                        } else {
+                            continue;
+                        };
 
                         if pair.first != pair.second {
                             if let Some(ref mut positions_gradients) = result.self_positions_gradients {
-                                let positions_gradients = positions_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
+                                let positions_gradients = positions_gradients.get_mut(&o3_lambda).expect("missing o3_lambda");
                                 let mut gradients = positions_gradients.slice_mut(s![neighbor_type_i, mapped_center, .., .., ..]);
-                                gradients -= contribution_gradients;
+                                gradients.scaled_add(-gradients_factor, contribution_gradients);
                             }
                         }
 
                         if let Some(ref mut cell_gradients) = result.cell_gradients {
-                            let cell_gradients = cell_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
+                            let cell_gradients = cell_gradients.get_mut(&o3_lambda).expect("missing o3_lambda");
                             let mut cell_gradients = cell_gradients.slice_mut(
                                 s![neighbor_type_i, mapped_center, .., .., .., ..]
                             );
 
                             for abc in 0..3 {
-                                let shift = pair.cell_shift_indices[abc] as f64;
+                                let shift = vector_sign * gradients_factor * pair.cell_shift_indices[abc] as f64;
                                 for xyz in 0..3 {
                                     for m in 0..(2 * o3_lambda + 1) {
                                         for n in 0..radial_size {
@@ -321,7 +283,7 @@ impl SphericalExpansion {
                                             // still checked in debug mode
                                             unsafe {
                                                 let out = cell_gradients.uget_mut([abc, xyz, m, n]);
-                                                *out += -shift * contribution_gradients.uget([xyz, m, n]);
+                                                *out += shift * contribution_gradients.uget([xyz, m, n]);
                                             }
                                         }
                                     }
@@ -330,19 +292,20 @@ impl SphericalExpansion {
                         }
 
                         if let Some(ref mut strain_gradients) = result.strain_gradients {
-                            let strain_gradients = strain_gradients.get_mut(o3_lambda).expect("missing o3_lambda");
+                            let strain_gradients = strain_gradients.get_mut(&o3_lambda).expect("missing o3_lambda");
                             let mut strain_gradients = strain_gradients.slice_mut(
                                 s![neighbor_type_i, mapped_center, .., .., .., ..]
                             );
 
                             for xyz_1 in 0..3 {
+                                let vector = vector_sign * gradients_factor * pair.vector[xyz_1];
                                 for xyz_2 in 0..3 {
                                     for m in 0..(2 * o3_lambda + 1) {
                                         for n in 0..radial_size {
-                                            // SAFETY: as above
+                                            // SAFETY: same as above
                                             unsafe {
                                                 let out = strain_gradients.uget_mut([xyz_1, xyz_2, m, n]);
-                                                *out += -pair.vector[xyz_1] * contribution_gradients.uget([xyz_2, m, n]);
+                                                *out += vector * contribution_gradients.uget([xyz_2, m, n]);
                                             }
                                         }
                                     }
@@ -354,7 +317,9 @@ impl SphericalExpansion {
             }
         }
 
-        return Ok(result);
+        result.pairs_for_positions_gradient.rebuild(requested_atoms.len(), pairs_for_positions_gradient);
+
+        return Ok(());
     }
 
     /// Move the pre-computed spherical expansion data to a single metatensor
@@ -454,7 +419,6 @@ impl SphericalExpansion {
         let positions_gradients = positions_gradients.get(&o3_lambda).expect("missing o3_lambda");
 
         let types = system.types()?;
-        let pairs = system.pairs()?;
         let system_size = system.size()?;
 
         let m_1_pow_l = self.m_1_pow_l[o3_lambda];
@@ -474,11 +438,11 @@ impl SphericalExpansion {
             // by the users
             debug_assert!(center_i < system_size && types[center_i] == center_type);
 
+            let mapped_center = result.center_mapping[center_i]
+                .expect("this center should be part of the requested centers");
+
             if center_i == neighbor_i {
                 // gradient of an environment w.r.t. the position of the center
-                let mapped_center = result.center_mapping[center_i]
-                    .expect("this center should be part of the requested centers");
-
                 for xyz in 0..3 {
                     for m in 0..(2 * o3_lambda + 1) {
                         for (property_i, [n]) in gradient.properties.iter_fixed_size().enumerate() {
@@ -495,16 +459,9 @@ impl SphericalExpansion {
             } else {
                 // gradient w.r.t. the position of a neighboring atom
                 debug_assert!(types[neighbor_i] == neighbor_type);
-                for &pair_id in &result.pairs_for_positions_gradient[&(center_i, neighbor_i)] {
-                    let pair = pairs[pair_id];
-                    let factor = if pair.first == center_i {
-                        debug_assert_eq!(pair.second, neighbor_i);
-                        1.0
-                    } else {
-                        debug_assert_eq!(pair.second, center_i);
-                        debug_assert_eq!(pair.first, neighbor_i);
-                        -m_1_pow_l
-                    };
+                for pair in result.pairs_for_positions_gradient.get(mapped_center, neighbor_i) {
+                    let pair_id = pair.pair_id;
+                    let factor = if pair.inverted { -m_1_pow_l } else { 1.0 };
 
                     for xyz in 0..3 {
                         for m in 0..(2 * o3_lambda + 1) {
@@ -638,12 +595,256 @@ struct PairAccumulationResult {
     /// Mapping from the atomic index to the second dimension of
     /// values/cell gradients/strain gradients
     center_mapping: Vec<Option<usize>>,
-    /// Mapping from (center, neighbor) to (potentially multiple) `pair_id`
-    /// (first dimension of `positions_gradient_by_pair`).
+    /// Mapping from (mapped center, neighbor) to (potentially multiple)
+    /// `pair_id` (first dimension of `positions_gradient_by_pair`).
     ///
     /// Two atoms can have more than one pair between them, so we need to be
     /// able store more than one pair id.
-    pairs_for_positions_gradient: HashMap<(usize, usize), Vec<usize>>,
+    pairs_for_positions_gradient: PairsByCenter,
+}
+
+impl PairAccumulationResult {
+    fn new() -> PairAccumulationResult {
+        PairAccumulationResult {
+            values: BTreeMap::new(),
+            positions_gradient_by_pair: None,
+            self_positions_gradients: None,
+            cell_gradients: None,
+            strain_gradients: None,
+            types_mapping: BTreeMap::new(),
+            center_mapping: Vec::new(),
+            pairs_for_positions_gradient: PairsByCenter::default(),
+        }
+    }
+
+    /// Resize and zero all the arrays for a new system, with the given number
+    /// of contributing pairs and requested centers. `types_mapping` must
+    /// already be set for this system.
+    fn reset(
+        &mut self,
+        angular_channels: &[usize],
+        radial_sizes: &[usize],
+        n_pairs: usize,
+        n_centers: usize,
+        do_gradients: GradientsOptions,
+    ) {
+        let n_types = self.types_mapping.len();
+
+        reset_arrays(&mut self.values, angular_channels, radial_sizes, |o3_lambda, radial_size| {
+            ndarray::Dim([n_types, n_centers, 2 * o3_lambda + 1, radial_size])
+        });
+
+        reset_optional_arrays(&mut self.positions_gradient_by_pair, do_gradients.positions, angular_channels, radial_sizes, |o3_lambda, radial_size| {
+            ndarray::Dim([n_pairs, 3, 2 * o3_lambda + 1, radial_size])
+        });
+
+        reset_optional_arrays(&mut self.self_positions_gradients, do_gradients.positions, angular_channels, radial_sizes, |o3_lambda, radial_size| {
+            ndarray::Dim([n_types, n_centers, 3, 2 * o3_lambda + 1, radial_size])
+        });
+
+        reset_optional_arrays(&mut self.cell_gradients, do_gradients.cell, angular_channels, radial_sizes, |o3_lambda, radial_size| {
+            ndarray::Dim([n_types, n_centers, 3, 3, 2 * o3_lambda + 1, radial_size])
+        });
+
+        reset_optional_arrays(&mut self.strain_gradients, do_gradients.strain, angular_channels, radial_sizes, |o3_lambda, radial_size| {
+            ndarray::Dim([n_types, n_centers, 3, 3, 2 * o3_lambda + 1, radial_size])
+        });
+    }
+}
+
+/// Resize and zero the array for each angular channel, creating them as needed
+fn reset_arrays<D: ndarray::Dimension>(
+    arrays: &mut BTreeMap<usize, ndarray::Array<f64, D>>,
+    angular_channels: &[usize],
+    radial_sizes: &[usize],
+    shape: impl Fn(usize, usize) -> D,
+) {
+    for (&o3_lambda, &radial_size) in angular_channels.iter().zip(radial_sizes) {
+        let array = arrays.entry(o3_lambda).or_default();
+        resize_zeroed(array, shape(o3_lambda, radial_size));
+    }
+}
+
+/// Same as `reset_arrays`, for arrays that are only needed when some gradients
+/// are requested
+fn reset_optional_arrays<D: ndarray::Dimension>(
+    arrays: &mut Option<BTreeMap<usize, ndarray::Array<f64, D>>>,
+    enabled: bool,
+    angular_channels: &[usize],
+    radial_sizes: &[usize],
+    shape: impl Fn(usize, usize) -> D,
+) {
+    if enabled {
+        let arrays = arrays.get_or_insert_with(BTreeMap::new);
+        reset_arrays(arrays, angular_channels, radial_sizes, shape);
+    } else {
+        *arrays = None;
+    }
+}
+
+/// Same as `AtomCenteredSamples::samples` with a single center and neighbor
+/// type, but only considering the neighbors within `radius` of the center.
+/// This is used for pairs of types with a smaller cutoff radius than the
+/// `neighbors_cutoff` used to compute the neighbor list.
+fn samples_within_radius(
+    systems: &mut [Box<dyn System>],
+    center_type: i32,
+    neighbor_type: i32,
+    neighbors_cutoff: f64,
+    radius: f64,
+) -> Result<Labels, Error> {
+    let mut builder = LabelsBuilder::new(AtomCenteredSamples::sample_names());
+    for (system_i, system) in systems.iter_mut().enumerate() {
+        system.compute_neighbors(neighbors_cutoff)?;
+        let types = system.types()?;
+        let n_local = system.local_size()?;
+
+        for (atom_i, &atomic_type) in types.iter().take(n_local).enumerate() {
+            if atomic_type != center_type {
+                continue;
+            }
+
+            // the center is its own neighbor
+            let mut matches = center_type == neighbor_type;
+            if !matches {
+                matches = system.pairs_containing(atom_i)?.iter().any(|pair| {
+                    let neighbor = if pair.first == atom_i { pair.second } else { pair.first };
+                    types[neighbor] == neighbor_type && pair.distance < radius
+                });
+            }
+
+            if matches {
+                builder.add(&[system_i, atom_i]);
+            }
+        }
+    }
+
+    // SAFETY: systems and atoms are visited in order, and each atom is added
+    // at most once, so all entries are unique
+    return Ok(unsafe { builder.finish_assume_unique() });
+}
+
+/// Same as `AtomCenteredSamples::gradients_for` with a single neighbor type,
+/// but only considering the neighbors within `radius` of the center.
+fn gradient_samples_within_radius(
+    systems: &mut [Box<dyn System>],
+    samples: &Labels,
+    neighbor_type: i32,
+    neighbors_cutoff: f64,
+    radius: f64,
+) -> Result<Labels, Error> {
+    assert_eq!(samples.names(), ["system", "atom"]);
+    let mut builder = LabelsBuilder::new(vec!["sample", "system", "atom"]);
+
+    let mut neighbors = BTreeSet::new();
+    for (sample_i, [system_i, atom_i]) in samples.iter_fixed_size().enumerate() {
+        let system_i = system_i.usize();
+        let atom_i = atom_i.usize();
+
+        let system = &mut systems[system_i];
+        system.compute_neighbors(neighbors_cutoff)?;
+        let types = system.types()?;
+
+        neighbors.clear();
+        if types[atom_i] == neighbor_type {
+            neighbors.insert(atom_i);
+        }
+
+        for pair in system.pairs_containing(atom_i)? {
+            let neighbor_i = if pair.first == atom_i { pair.second } else { pair.first };
+            if types[neighbor_i] == neighbor_type && pair.distance < radius {
+                neighbors.insert(neighbor_i);
+                neighbors.insert(atom_i);
+            }
+        }
+
+        for &neighbor in &neighbors {
+            builder.add(&[sample_i, system_i, neighbor]);
+        }
+    }
+
+    // SAFETY: each sample is visited once, and `neighbors` is a set, so all
+    // entries are unique
+    return Ok(unsafe { builder.finish_assume_unique() });
+}
+
+/// Scratch memory used to compute the spherical expansion of a single system.
+///
+/// The allocations are kept in a `ScratchPool` and re-used for the next
+/// systems and calls to `compute`, instead of being re-created every time.
+struct SystemScratch {
+    /// sorted list of atoms for which the spherical expansion is requested
+    requested_atoms: Vec<usize>,
+    /// pairs containing at least one of the requested atoms
+    contributing_pairs: Vec<Pair>,
+    /// contributions of a batch of pairs
+    contributions: Vec<PairContribution>,
+    /// (mapped center, pair) used to build `result.pairs_for_positions_gradient`
+    pairs_for_positions_gradient: Vec<(usize, PairForGradient)>,
+    /// output of `accumulate_all_pairs`
+    result: PairAccumulationResult,
+}
+
+impl SystemScratch {
+    fn new() -> SystemScratch {
+        SystemScratch {
+            requested_atoms: Vec::new(),
+            contributing_pairs: Vec::new(),
+            contributions: Vec::new(),
+            pairs_for_positions_gradient: Vec::new(),
+            result: PairAccumulationResult::new(),
+        }
+    }
+}
+
+/// A pair contributing to the gradient of a center with respect to one of its
+/// neighbors
+#[derive(Debug, Clone, Copy)]
+struct PairForGradient {
+    /// index of the neighbor atom
+    neighbor: usize,
+    /// index of the pair in `positions_gradient_by_pair`
+    pair_id: usize,
+    /// is the center the second atom of the pair? If so, the gradient must be
+    /// multiplied by `-(-1)^l`.
+    inverted: bool,
+}
+
+/// Pairs contributing to the positions gradients, grouped by mapped center
+/// and sorted by neighbor, to look them up without hashing.
+#[derive(Debug, Default)]
+struct PairsByCenter {
+    /// the pairs for mapped center `c` are `pairs[offsets[c]..offsets[c + 1]]`
+    offsets: Vec<usize>,
+    pairs: Vec<PairForGradient>,
+}
+
+impl PairsByCenter {
+    /// Re-build the lookup table from a list of `(mapped center, pair)`,
+    /// re-using the existing allocations
+    fn rebuild(&mut self, n_centers: usize, pairs: &mut [(usize, PairForGradient)]) {
+        pairs.sort_unstable_by_key(|(center, pair)| (*center, pair.neighbor, pair.pair_id));
+
+        self.offsets.clear();
+        self.offsets.resize(n_centers + 1, 0);
+        for &(center, _) in &*pairs {
+            self.offsets[center + 1] += 1;
+        }
+        for center in 0..n_centers {
+            self.offsets[center + 1] += self.offsets[center];
+        }
+
+        self.pairs.clear();
+        self.pairs.extend(pairs.iter().map(|&(_, pair)| pair));
+    }
+
+    /// Get all the pairs between the given mapped center and neighbor
+    fn get(&self, mapped_center: usize, neighbor: usize) -> &[PairForGradient] {
+        let pairs = &self.pairs[self.offsets[mapped_center]..self.offsets[mapped_center + 1]];
+        let start = pairs.partition_point(|pair| pair.neighbor < neighbor);
+        let end = pairs.partition_point(|pair| pair.neighbor <= neighbor);
+        return &pairs[start..end];
+    }
 }
 
 impl CalculatorBase for SphericalExpansion {
@@ -660,14 +861,37 @@ impl CalculatorBase for SphericalExpansion {
     }
 
     fn keys(&self, systems: &mut [Box<dyn System>]) -> Result<Labels, Error> {
+        let cutoff = &self.by_pair.parameters().cutoff;
         let builder = CenterSingleNeighborsTypesKeys {
-            cutoff: self.by_pair.parameters().cutoff.radius,
+            cutoff: cutoff.radius,
             self_pairs: true,
         };
         let keys = builder.keys(systems)?;
 
+        // the keys builder uses the global cutoff radius, remove the pairs of
+        // types with a smaller cutoff radius and no pair within this radius
+        let mut types_within_radius = BTreeSet::new();
+        if !cutoff.per_type_pair.is_empty() {
+            for system in systems.iter() {
+                let types = system.types()?;
+                let radii = cutoff.pair_radii(types);
+                for pair in system.pairs()? {
+                    if pair.distance < radii.radius(pair.first, pair.second) {
+                        types_within_radius.insert((types[pair.first], types[pair.second]));
+                        types_within_radius.insert((types[pair.second], types[pair.first]));
+                    }
+                }
+            }
+        }
+
         let mut builder = LabelsBuilder::new(vec!["o3_lambda", "o3_sigma", "center_type", "neighbor_type"]);
         for &[center_type, neighbor_type] in keys.iter_fixed_size() {
+            let (center_type_i32, neighbor_type_i32) = (center_type.i32(), neighbor_type.i32());
+            let smaller_radius = cutoff.radius_for_types(center_type_i32, neighbor_type_i32) < cutoff.radius;
+            if center_type != neighbor_type && smaller_radius && !types_within_radius.contains(&(center_type_i32, neighbor_type_i32)) {
+                continue;
+            }
+
             for o3_lambda in self.by_pair.parameters().basis.angular_channels() {
                 builder.add(&[o3_lambda.into(), 1.into(), center_type, neighbor_type]);
             }
@@ -691,14 +915,21 @@ impl CalculatorBase for SphericalExpansion {
                 continue;
             }
 
-            let builder = AtomCenteredSamples {
-                cutoff: self.by_pair.parameters().cutoff.radius,
-                center_type: AtomicTypeFilter::Single(center_type.i32()),
-                neighbor_type: AtomicTypeFilter::Single(neighbor_type.i32()),
-                self_pairs: true,
+            let cutoff = &self.by_pair.parameters().cutoff;
+            let radius = cutoff.radius_for_types(center_type.i32(), neighbor_type.i32());
+            let samples = if radius < cutoff.radius {
+                samples_within_radius(systems, center_type.i32(), neighbor_type.i32(), cutoff.radius, radius)?
+            } else {
+                let builder = AtomCenteredSamples {
+                    cutoff: cutoff.radius,
+                    center_type: AtomicTypeFilter::Single(center_type.i32()),
+                    neighbor_type: AtomicTypeFilter::Single(neighbor_type.i32()),
+                    self_pairs: true,
+                };
+                builder.samples(systems)?
             };
 
-            samples_per_types.insert((center_type, neighbor_type), builder.samples(systems)?);
+            samples_per_types.insert((center_type, neighbor_type), samples);
         }
 
         let mut result = Vec::new();
@@ -728,14 +959,21 @@ impl CalculatorBase for SphericalExpansion {
         for ([_, _, center_type, neighbor_type], samples) in keys.iter_fixed_size().zip(samples) {
             // TODO: we don't need to rebuild the gradient samples for different
             // o3_lambda
-            let builder = AtomCenteredSamples {
-                cutoff: self.by_pair.parameters().cutoff.radius,
-                center_type: AtomicTypeFilter::Single(center_type.i32()),
-                neighbor_type: AtomicTypeFilter::Single(neighbor_type.i32()),
-                self_pairs: true,
-            };
-
-            gradient_samples.push(builder.gradients_for(systems, samples)?);
+            let cutoff = &self.by_pair.parameters().cutoff;
+            let radius = cutoff.radius_for_types(center_type.i32(), neighbor_type.i32());
+            if radius < cutoff.radius {
+                gradient_samples.push(gradient_samples_within_radius(
+                    systems, samples, neighbor_type.i32(), cutoff.radius, radius
+                )?);
+            } else {
+                let builder = AtomCenteredSamples {
+                    cutoff: cutoff.radius,
+                    center_type: AtomicTypeFilter::Single(center_type.i32()),
+                    neighbor_type: AtomicTypeFilter::Single(neighbor_type.i32()),
+                    self_pairs: true,
+                };
+                gradient_samples.push(builder.gradients_for(systems, samples)?);
+            }
         }
 
         return Ok(gradient_samples);
@@ -803,7 +1041,7 @@ impl CalculatorBase for SphericalExpansion {
     }
 
     #[time_graph::instrument(name = "SphericalExpansion::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert_eq!(descriptor.keys().names(), ["o3_lambda", "o3_sigma", "center_type", "neighbor_type"]);
         assert!(descriptor.keys().count() > 0);
 
@@ -821,30 +1059,42 @@ impl CalculatorBase for SphericalExpansion {
                 system.compute_neighbors(self.by_pair.parameters().cutoff.radius)?;
                 let system = &**system;
 
+                let mut scratch = self.scratch.take(SystemScratch::new);
+
                 // we will only run the calculation on pairs where one of the
                 // atom is part of the requested samples
-                let requested_centers = descriptor.iter().flat_map(|(_, block)| {
-                    block.samples().iter().map(|sample| sample[1].usize()).collect::<Vec<_>>()
-                }).collect::<BTreeSet<_>>();
+                scratch.requested_atoms.clear();
+                for (_, block) in descriptor.iter() {
+                    scratch.requested_atoms.extend(block.samples().iter().map(|sample| sample[1].usize()));
+                }
+                scratch.requested_atoms.sort_unstable();
+                scratch.requested_atoms.dedup();
 
-                let accumulated = self.accumulate_all_pairs(
-                    system,
-                    do_gradients,
-                    &requested_centers,
-                )?;
+                self.accumulate_all_pairs(system, do_gradients, &mut scratch)?;
 
                 // all pairs are done, copy the data into metatensor, handling
                 // any property selection made by the user
+                let accumulated = &scratch.result;
                 for (key, mut block) in descriptor.iter_mut() {
-                    self.values_to_metatensor(key, &mut block, system, &accumulated)?;
-                    self.position_gradients_to_metatensor(key, &mut block, system, &accumulated)?;
-                    self.cell_strain_gradients_to_metatensor(key, "cell", &mut block, system, &accumulated)?;
-                    self.cell_strain_gradients_to_metatensor(key, "strain", &mut block, system, &accumulated)?;
+                    self.values_to_metatensor(key, &mut block, system, accumulated)?;
+                    self.position_gradients_to_metatensor(key, &mut block, system, accumulated)?;
+                    self.cell_strain_gradients_to_metatensor(key, "cell", &mut block, system, accumulated)?;
+                    self.cell_strain_gradients_to_metatensor(key, "strain", &mut block, system, accumulated)?;
                 }
 
+                // if an error happened above, the scratch memory is dropped
+                // instead of being given back, which is fine.
+                self.scratch.give_back(scratch);
+
                 Ok::<_, Error>(())
             })?;
 
+        let stats = self.scratch.stats();
+        debug!(
+            "SphericalExpansion scratch memory: {} allocated, {} re-used",
+            stats.created, stats.reused
+        );
+
         Ok(())
     }
 }
@@ -862,7 +1112,7 @@ mod tests {
     use crate::calculators::CalculatorBase;
 
     use super::{SphericalExpansion, SphericalExpansionParameters};
-    use crate::calculators::soap::{Cutoff, Smoothing};
+    use crate::calculators::soap::{Cutoff, Smoothing, TypePairCutoff};
     use crate::calculators::shared::{Density, DensityKind, DensityScaling, ExplicitBasis};
     use crate::calculators::shared::{SoapRadialBasis, SphericalExpansionBasis, TensorProductBasis};
 
@@ -879,7 +1129,8 @@ mod tests {
         SphericalExpansionParameters {
             cutoff: Cutoff {
                 radius: 7.3,
-                smoothing: Smoothing::ShiftedCosine { width: 0.5 }
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
             },
             density: Density {
                 kind: DensityKind::Gaussian { width: 0.3 },
@@ -896,7 +1147,7 @@ mod tests {
 
     #[test]
     fn values() {
-        let mut calculator = Calculator::from(Box::new(SphericalExpansion::new(
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
             parameters()
         ).unwrap()) as Box<dyn CalculatorBase>);
 
@@ -922,6 +1173,142 @@ mod tests {
         // `featomic/tests/spherical-expansion.rs`
     }
 
+    #[test]
+    fn reuse_scratch() {
+        // scratch memory is re-used between systems and calls to compute,
+        // check that results do not depend on the previous calculations
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let options = CalculationOptions {
+            gradients: &["positions", "cell", "strain"],
+            ..Default::default()
+        };
+        let mut systems = test_systems(&["methane", "water", "CH"]);
+        calculator.compute(&mut systems, options).unwrap();
+
+        let mut systems = test_systems(&["water"]);
+        let reused = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        let fresh_calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+        let mut systems = test_systems(&["water"]);
+        let expected = fresh_calculator.compute(&mut systems, Default::default()).unwrap();
+
+        assert_eq!(reused.keys(), expected.keys());
+        for (block, expected) in reused.blocks().iter().zip(expected.blocks()) {
+            assert_eq!(block.values().to_array(), expected.values().to_array());
+        }
+    }
+
+    fn per_type_pair_parameters() -> SphericalExpansionParameters {
+        let mut parameters = parameters();
+        parameters.cutoff.per_type_pair = vec![
+            TypePairCutoff { types: [1, 1], radius: 2.5 },
+            TypePairCutoff { types: [-42, 1], radius: 3.5 },
+        ];
+        return parameters;
+    }
+
+    #[test]
+    fn per_type_pair_cutoff() {
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+        let mut systems = test_systems(&["water"]);
+        let reference = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        // using the global cutoff for all pairs gives the same results
+        let mut same_cutoff = parameters();
+        same_cutoff.cutoff.per_type_pair = vec![TypePairCutoff { types: [1, -42], radius: 7.3 }];
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            same_cutoff
+        ).unwrap()) as Box<dyn CalculatorBase>);
+        let mut systems = test_systems(&["water"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        assert_eq!(descriptor.keys(), reference.keys());
+        for (block, expected) in descriptor.blocks().iter().zip(reference.blocks()) {
+            assert_eq!(block.values().to_array(), expected.values().to_array());
+        }
+
+        // smaller cutoffs only change the blocks for the corresponding types
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            per_type_pair_parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+        let mut systems = test_systems(&["water"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        assert_eq!(descriptor.keys(), reference.keys());
+        for (key, (block, expected)) in descriptor.keys().iter().zip(descriptor.blocks().iter().zip(reference.blocks())) {
+            let center_type = key[2].i32();
+            let neighbor_type = key[3].i32();
+            if center_type == -42 && neighbor_type == -42 {
+                assert_eq!(block.values().to_array(), expected.values().to_array());
+            } else {
+                assert_ne!(block.values().to_array(), expected.values().to_array());
+            }
+        }
+
+        let mut parameters = per_type_pair_parameters();
+        parameters.cutoff.per_type_pair.push(TypePairCutoff { types: [1, 1], radius: 3.0 });
+        let error = SphericalExpansion::new(parameters).err().unwrap();
+        assert_eq!(error.to_string(), "invalid parameter: the cutoff radius for types [1, 1] is given multiple times");
+    }
+
+    #[test]
+    fn per_type_pair_cutoff_samples() {
+        // the C-H distance is 1.09 in methane and 1.2 in CH
+        let mut parameters = parameters();
+        parameters.cutoff.per_type_pair = vec![TypePairCutoff { types: [1, 6], radius: 1.1 }];
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            parameters
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["CH", "methane"]);
+        let options = CalculationOptions {
+            gradients: &["positions"],
+            ..Default::default()
+        };
+        let descriptor = calculator.compute(&mut systems, options).unwrap();
+
+        let block_i = descriptor.keys().position(&[0.into(), 1.into(), 6.into(), 1.into()]).unwrap();
+        let block = descriptor.block_by_id(block_i);
+        assert_eq!(block.samples(), Labels::new(["system", "atom"], &[[1, 0]]));
+        assert_eq!(block.gradient("positions").unwrap().samples(), Labels::new(
+            ["sample", "system", "atom"],
+            &[[0, 1, 0], [0, 1, 1], [0, 1, 2], [0, 1, 3], [0, 1, 4]],
+        ));
+
+        let block_i = descriptor.keys().position(&[0.into(), 1.into(), 1.into(), 6.into()]).unwrap();
+        let block = descriptor.block_by_id(block_i);
+        assert_eq!(block.samples(), Labels::new(["system", "atom"], &[[1, 1], [1, 2], [1, 3], [1, 4]]));
+
+        // there are no C-H pair within the cutoff, so no corresponding blocks
+        let mut systems = test_systems(&["CH"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+        for key in descriptor.keys() {
+            assert_eq!(key[2], key[3]);
+        }
+    }
+
+    #[test]
+    fn per_type_pair_cutoff_finite_differences() {
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
+            per_type_pair_parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let system = test_system("water");
+        let options = crate::calculators::tests_utils::FinalDifferenceOptions {
+            displacement: 1e-6,
+            max_relative: 1e-5,
+            epsilon: 1e-9,
+        };
+        crate::calculators::tests_utils::finite_differences_positions(calculator, &system, options);
+    }
+
     #[test]
     fn finite_differences_positions() {
         let calculator = Calculator::from(Box::new(SphericalExpansion::new(
@@ -1015,7 +1402,7 @@ mod tests {
 
     #[test]
     fn non_existing_samples() {
-        let mut calculator = Calculator::from(Box::new(SphericalExpansion::new(
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
             parameters()
         ).unwrap()) as Box<dyn CalculatorBase>);
 
@@ -1080,7 +1467,7 @@ mod tests {
         by_angular.insert(1, SoapRadialBasis::Gto { max_radial: 5, radius: None });
         by_angular.insert(12, SoapRadialBasis::Gto { max_radial: 3, radius: None });
 
-        let mut calculator = Calculator::from(Box::new(SphericalExpansion::new(
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
             SphericalExpansionParameters {
                 basis: SphericalExpansionBasis::Explicit(ExplicitBasis {
                     by_angular: by_angular.into(),
@@ -59,7 +59,11 @@ impl SphericalExpansionParameters {
     }
 }
 
-/// The actual calculator used to compute spherical expansion pair-by-pair
+/// The actual calculator used to compute spherical expansion pair-by-pair.
+///
+/// The samples are the same as a full neighbor list with self pairs, so for
+/// systems with ghost atoms (see `System::local_size`) only the pairs where the
+/// first atom is local are included.
 pub struct SphericalExpansionByPair {
     pub(crate) parameters: SphericalExpansionParameters,
     /// implementation + cached allocation to compute the radial integral for a
@@ -79,6 +83,9 @@ impl std::fmt::Debug for SphericalExpansionByPair {
 }
 
 
+/// Number of pairs processed together in `SphericalExpansionByPair::compute_for_pairs`
+pub(super) const PAIRS_BATCH_SIZE: usize = 8;
+
 /// Which gradients are we computing
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub(super) struct GradientsOptions {
@@ -122,45 +129,6 @@ impl PairContribution {
 
         return PairContribution { values, gradients }
     }
-
-    /// Modify the values/gradients as required to construct the
-    /// values/gradients associated with pair j -> i from pair i -> j.
-    ///
-    /// `m_1_pow_l` should contain the values of `(-1)^l` up to `max_angular`
-    pub fn inverse_pair(&mut self, m_1_pow_l: &[f64]) {
-        // inverting the pair is equivalent to adding a (-1)^l factor to the
-        // pair contribution values, and -(-1)^l to the gradients
-        for (&o3_lambda, values) in &mut self.values {
-            let shape = values.shape();
-            debug_assert_eq!(shape[0], 2 * o3_lambda + 1);
-            let shape_n = shape[1];
-
-            let factor = m_1_pow_l[o3_lambda];
-            for m in 0..2 * o3_lambda + 1 {
-                for n in 0..shape_n {
-                    values[[m, n]] *= factor;
-                }
-            }
-        }
-
-        if let Some(ref mut gradients) = self.gradients {
-            for (&o3_lambda, gradients) in gradients.iter_mut() {
-                let shape = gradients.shape();
-                debug_assert_eq!(shape[0], 3);
-                debug_assert_eq!(shape[1], 2 * o3_lambda + 1);
-                let shape_n = shape[2];
-
-                let factor = -m_1_pow_l[o3_lambda];
-                for xyz in 0..3 {
-                    for m in 0..(2 * o3_lambda + 1) {
-                        for n in 0..shape_n {
-                            gradients[[xyz, m, n]] *= factor;
-                        }
-                    }
-                }
-            }
-        }
-    }
 }
 
 
@@ -185,17 +153,19 @@ impl SphericalExpansionByPair {
         &self.parameters
     }
 
-    /// Compute the product of radial scaling & cutoff smoothing functions
-    fn scaling_functions(&self, r: f64) -> f64 {
+    /// Compute the product of radial scaling & cutoff smoothing functions, for
+    /// a pair with the given `cutoff` radius
+    fn scaling_functions(&self, r: f64, cutoff: f64) -> f64 {
         let mut scaling = 1.0;
         if let Some(scaler) = self.parameters.density.scaling {
             scaling = scaler.compute(r);
         }
-        return scaling * self.parameters.cutoff.smoothing(r);
+        return scaling * self.parameters.cutoff.smoothing_with_radius(r, cutoff);
     }
 
-    /// Compute the gradient of the product of radial scaling & cutoff smoothing functions
-    fn scaling_functions_gradient(&self, r: f64) -> f64 {
+    /// Compute the gradient of the product of radial scaling & cutoff
+    /// smoothing functions, for a pair with the given `cutoff` radius
+    fn scaling_functions_gradient(&self, r: f64, cutoff: f64) -> f64 {
         let mut scaling = 1.0;
         let mut scaling_grad = 0.0;
         if let Some(scaler) = self.parameters.density.scaling {
@@ -203,8 +173,8 @@ impl SphericalExpansionByPair {
             scaling_grad = scaler.gradient(r);
         }
 
-        let cutoff = self.parameters.cutoff.smoothing(r);
-        let cutoff_grad = self.parameters.cutoff.smoothing_gradient(r);
+        let cutoff_grad = self.parameters.cutoff.smoothing_gradient_with_radius(r, cutoff);
+        let cutoff = self.parameters.cutoff.smoothing_with_radius(r, cutoff);
 
         return cutoff_grad * scaling + cutoff * scaling_grad;
     }
@@ -242,7 +212,7 @@ impl SphericalExpansionByPair {
         radial_integral.compute(0.0, false);
 
         spherical_harmonics.compute(Vector3D::new(0.0, 0.0, 1.0), false);
-        let f_scaling = self.scaling_functions(0.0);
+        let f_scaling = self.scaling_functions(0.0, self.parameters.cutoff.radius);
 
         let factor = self.parameters.density.center_atom_weight
             * f_scaling
@@ -313,30 +283,32 @@ impl SphericalExpansionByPair {
         return Ok(());
     }
 
-    /// Compute the contribution of a single pair and store the corresponding
-    /// data inside the given descriptor.
+    /// Compute the contribution of a batch of pairs, storing the result for
+    /// the pair `i` in `contributions[i]`.
     ///
-    /// This will store data both for the spherical expansion with `pair.first`
-    /// as the central atom and `pair.second` as the neighbor, and for the
-    /// spherical expansion with `pair.second` as the central atom and
-    /// `pair.first` as the neighbor.
-    pub(super) fn compute_for_pair(
+    /// The pairs are given in structure-of-arrays form, with their
+    /// `distances`, (normalized) `directions` and the `cutoffs` radius for the
+    /// types of the two atoms in the pair. This amortizes the access
+    /// to the thread-local radial integral and spherical harmonics caches over
+    /// the whole batch, and evaluates the smoothing and scaling functions for
+    /// all pairs at once. The contributions can then be used both for the
+    /// spherical expansion with `pair.first` as the central atom and
+    /// `pair.second` as the neighbor, and (multiplying the values by `(-1)^l`
+    /// and the gradients by `-(-1)^l`) for the spherical expansion with
+    /// `pair.second` as the central atom and `pair.first` as the neighbor.
+    pub(super) fn compute_for_pairs(
         &self,
-        distance: f64,
-        mut direction: Vector3D,
+        distances: &[f64],
+        directions: &[Vector3D],
+        cutoffs: &[f64],
         do_gradients: GradientsOptions,
-        contribution: &mut PairContribution,
+        contributions: &mut [PairContribution],
     ) {
-        debug_assert!(distance >= 0.0);
-
-        // Deal with the possibility that two atoms are at the same
-        // position. While this is not usual, there is no reason to
-        // prevent the calculation of spherical expansion. The user will
-        // still get a warning about atoms being very close together
-        // when calculating the neighbor list.
-        if distance < 1e-6 {
-            direction = Vector3D::new(0.0, 0.0, 1.0);
-        }
+        let n_pairs = distances.len();
+        assert!(n_pairs <= PAIRS_BATCH_SIZE);
+        assert_eq!(directions.len(), n_pairs);
+        assert_eq!(cutoffs.len(), n_pairs);
+        assert!(contributions.len() >= n_pairs);
 
         let mut radial_integral = self.radial_integral.get_or(|| {
             RefCell::new(SoapRadialIntegralCacheByAngular::new(
@@ -352,81 +324,102 @@ impl SphericalExpansionByPair {
             RefCell::new(SphericalHarmonicsCache::new(max_angular))
         }).borrow_mut();
 
-        radial_integral.compute(distance, do_gradients.any());
-        spherical_harmonics.compute(direction, do_gradients.any());
-
-        let f_scaling = self.scaling_functions(distance);
-        let f_scaling_grad = self.scaling_functions_gradient(distance);
-
-        for o3_lambda in self.parameters.basis.angular_channels() {
-            let radial_basis_size = match self.parameters.basis {
-                SphericalExpansionBasis::TensorProduct(ref basis) => basis.radial.size(),
-                SphericalExpansionBasis::Explicit(ref basis) => {
-                    basis.by_angular.get(&o3_lambda).expect("missing o3_lambda").size()
-                },
+        let angular_channels = self.parameters.basis.angular_channels();
+
+        // evaluate the radial scaling & cutoff smoothing for the whole batch
+        let mut batch_directions = [Vector3D::zero(); PAIRS_BATCH_SIZE];
+        let mut f_scaling = [0.0; PAIRS_BATCH_SIZE];
+        let mut f_scaling_grad = [0.0; PAIRS_BATCH_SIZE];
+        for pair_i in 0..n_pairs {
+            let distance = distances[pair_i];
+            debug_assert!(distance >= 0.0);
+
+            // Deal with the possibility that two atoms are at the same
+            // position. While this is not usual, there is no reason to
+            // prevent the calculation of spherical expansion. The user will
+            // still get a warning about atoms being very close together
+            // when calculating the neighbor list.
+            batch_directions[pair_i] = if distance < 1e-6 {
+                Vector3D::new(0.0, 0.0, 1.0)
+            } else {
+                directions[pair_i]
             };
 
-            let spherical_harmonics_grad = [
-                spherical_harmonics.gradients[0].angular_slice(o3_lambda),
-                spherical_harmonics.gradients[1].angular_slice(o3_lambda),
-                spherical_harmonics.gradients[2].angular_slice(o3_lambda),
-            ];
-            let spherical_harmonics = spherical_harmonics.values.angular_slice(o3_lambda);
-
-            let radial_integral_grad = &radial_integral.get(o3_lambda).expect("missing o3_lambda").gradients;
-            let radial_integral = &radial_integral.get(o3_lambda).expect("missing o3_lambda").values;
-
-            let values = contribution.values.get_mut(&o3_lambda).expect("missing o3_lambda");
-
-            // compute the full spherical expansion coefficients & gradients
-            for m in 0..(2 * o3_lambda + 1) {
-                let sph_value = spherical_harmonics[m];
-                for (n, ri_value) in radial_integral.iter().enumerate() {
-                    values[[m, n]] = f_scaling * sph_value * ri_value;
-                }
+            f_scaling[pair_i] = self.scaling_functions(distance, cutoffs[pair_i]);
+            if do_gradients.any() {
+                f_scaling_grad[pair_i] = self.scaling_functions_gradient(distance, cutoffs[pair_i]);
             }
+        }
 
-            if let Some(ref mut gradients) = contribution.gradients {
-                let gradients = gradients.get_mut(&o3_lambda).expect("missing o3_lambda");
-
-                let dr_d_spatial = direction;
+        for (pair_i, contribution) in contributions.iter_mut().take(n_pairs).enumerate() {
+            let distance = distances[pair_i];
+            let direction = batch_directions[pair_i];
+            let f_scaling = f_scaling[pair_i];
+            let f_scaling_grad = f_scaling_grad[pair_i];
+
+            radial_integral.compute(distance, do_gradients.any());
+            spherical_harmonics.compute(direction, do_gradients.any());
+
+            for &o3_lambda in &angular_channels {
+                let spherical_harmonics_grad = [
+                    spherical_harmonics.gradients[0].angular_slice(o3_lambda),
+                    spherical_harmonics.gradients[1].angular_slice(o3_lambda),
+                    spherical_harmonics.gradients[2].angular_slice(o3_lambda),
+                ];
+                let spherical_harmonics = spherical_harmonics.values.angular_slice(o3_lambda);
+
+                let radial_integral = radial_integral.get(o3_lambda).expect("missing o3_lambda");
+                let radial_integral_grad = &radial_integral.gradients;
+                let radial_integral = &radial_integral.values;
+
+                // compute the full spherical expansion coefficients, as the
+                // outer product of the spherical harmonics and radial integral
+                let values = contribution.values.get_mut(&o3_lambda).expect("missing o3_lambda");
+                for (mut values, &sph_value) in values.rows_mut().into_iter().zip(spherical_harmonics) {
+                    let factor = f_scaling * sph_value;
+                    for (value, &ri_value) in values.iter_mut().zip(radial_integral) {
+                        *value = factor * ri_value;
+                    }
+                }
 
-                for m in 0..(2 * o3_lambda + 1) {
-                    let sph_value = spherical_harmonics[m];
-                    let sph_grad_x = spherical_harmonics_grad[0][m];
-                    let sph_grad_y = spherical_harmonics_grad[1][m];
-                    let sph_grad_z = spherical_harmonics_grad[2][m];
+                if let Some(ref mut gradients) = contribution.gradients {
+                    let gradients = gradients.get_mut(&o3_lambda).expect("missing o3_lambda");
 
-                    for n in 0..radial_basis_size {
-                        let ri_value = radial_integral[n];
-                        let ri_grad = radial_integral_grad[n];
+                    let dr_d_spatial = direction;
+                    for xyz in 0..3 {
+                        let mut gradients = gradients.index_axis_mut(ndarray::Axis(0), xyz);
+                        let sph_grad = spherical_harmonics_grad[xyz];
 
-                        gradients[[0, m, n]] =
-                            f_scaling_grad * dr_d_spatial[0] * ri_value * sph_value
-                            + f_scaling * ri_grad * dr_d_spatial[0] * sph_value
-                            + f_scaling * ri_value * sph_grad_x / distance;
+                        for (m, mut gradients) in gradients.rows_mut().into_iter().enumerate() {
+                            let sph_value = spherical_harmonics[m];
 
-                        gradients[[1, m, n]] =
-                            f_scaling_grad * dr_d_spatial[1] * ri_value * sph_value
-                            + f_scaling * ri_grad * dr_d_spatial[1] * sph_value
-                            + f_scaling * ri_value * sph_grad_y / distance;
+                            // the gradient is a linear combination of the
+                            // radial integral values and gradients
+                            let ri_factor = f_scaling_grad * dr_d_spatial[xyz] * sph_value
+                                + f_scaling * sph_grad[m] / distance;
+                            let ri_grad_factor = f_scaling * dr_d_spatial[xyz] * sph_value;
 
-                        gradients[[2, m, n]] =
-                            f_scaling_grad * dr_d_spatial[2] * ri_value * sph_value
-                            + f_scaling * ri_grad * dr_d_spatial[2] * sph_value
-                            + f_scaling * ri_value * sph_grad_z / distance;
+                            let radial = radial_integral.iter().zip(radial_integral_grad);
+                            for (gradient, (&ri_value, &ri_grad)) in gradients.iter_mut().zip(radial) {
+                                *gradient = ri_factor * ri_value + ri_grad_factor * ri_grad;
+                            }
+                        }
                     }
                 }
             }
         }
     }
 
-    /// Accumulate a single pair `contribution` in the right block.
+    /// Accumulate a single pair `contribution` in the right block, scaling
+    /// the values by `values_factor` and the gradients by `gradients_factor`.
+    #[allow(clippy::too_many_arguments)]
     fn accumulate_in_block(
         o3_lambda: usize,
         mut block: TensorBlockRefMut,
         sample: &[LabelValue],
         contributions: &PairContribution,
+        values_factor: f64,
+        gradients_factor: f64,
         do_gradients: GradientsOptions,
         pair_vector: Vector3D,
     ) {
@@ -440,7 +433,7 @@ impl SphericalExpansionByPair {
                 for (property_i, [n]) in data.properties.iter_fixed_size().enumerate() {
                     unsafe {
                         let out = array.uget_mut([sample_i, m, property_i]);
-                        *out += *contribution_values.uget([m, n.usize()]);
+                        *out += values_factor * *contribution_values.uget([m, n.usize()]);
                     }
                 }
             }
@@ -465,7 +458,7 @@ impl SphericalExpansionByPair {
                             for (property_i, [n]) in gradient.properties.iter_fixed_size().enumerate() {
                                 unsafe {
                                     let out = array.uget_mut([first_grad_sample_i, xyz, m, property_i]);
-                                    *out -= contribution_gradients.uget([xyz, m, n.usize()]);
+                                    *out -= gradients_factor * contribution_gradients.uget([xyz, m, n.usize()]);
                                 }
                             }
                         }
@@ -482,7 +475,7 @@ impl SphericalExpansionByPair {
                             for (property_i, [n]) in gradient.properties.iter_fixed_size().enumerate() {
                                 unsafe {
                                     let out = array.uget_mut([second_grad_sample_i, xyz, m, property_i]);
-                                    *out += contribution_gradients.uget([xyz, m, n.usize()]);
+                                    *out += gradients_factor * contribution_gradients.uget([xyz, m, n.usize()]);
                                 }
                             }
                         }
@@ -503,7 +496,7 @@ impl SphericalExpansionByPair {
                                 for (property_i, [n]) in gradient.properties.iter_fixed_size().enumerate() {
                                     unsafe {
                                         let out = array.uget_mut([sample_i, xyz_1, xyz_2, m, property_i]);
-                                        *out += pair_vector[xyz_1] * contribution_gradients.uget([xyz_2, m, n.usize()]);
+                                        *out += gradients_factor * pair_vector[xyz_1] * contribution_gradients.uget([xyz_2, m, n.usize()]);
                                     }
                                 }
                             }
@@ -531,7 +524,7 @@ impl SphericalExpansionByPair {
                                 for (property_i, [n]) in gradient.properties.iter_fixed_size().enumerate() {
                                     unsafe {
                                         let out = array.uget_mut([sample_i, abc, xyz, m, property_i]);
-                                        *out += shifts[abc] * contribution_gradients.uget([xyz, m, n.usize()]);
+                                        *out += gradients_factor * shifts[abc] * contribution_gradients.uget([xyz, m, n.usize()]);
                                     }
                                 }
                             }
@@ -661,7 +654,9 @@ impl CalculatorBase for SphericalExpansionByPair {
                 }
             }
 
-            results.push(builder.finish());
+            // SAFETY: each sample is visited once, and we only add the
+            // second atom if it differs from the first one
+            results.push(unsafe { builder.finish_assume_unique() });
         }
 
         return Ok(results);
@@ -729,7 +724,7 @@ impl CalculatorBase for SphericalExpansionByPair {
     }
 
     #[time_graph::instrument(name = "SphericalExpansionByPair::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert_eq!(descriptor.keys().names(), ["o3_lambda", "o3_sigma", "first_atom_type", "second_atom_type"]);
         assert!(descriptor.keys().count() > 0);
 
@@ -752,84 +747,99 @@ impl CalculatorBase for SphericalExpansionByPair {
             },
         };
 
-        let mut contribution = PairContribution::new(
+        let mut contributions = (0..PAIRS_BATCH_SIZE).map(|_| PairContribution::new(
             &self.parameters.basis.angular_channels(),
             &radial_sizes,
             do_gradients.any(),
-        );
+        )).collect::<Vec<_>>();
 
+        let mut distances = [0.0; PAIRS_BATCH_SIZE];
+        let mut directions = [Vector3D::zero(); PAIRS_BATCH_SIZE];
+        let mut cutoffs = [0.0; PAIRS_BATCH_SIZE];
+        let mut contributing_pairs = Vec::new();
         for (system_i, system) in systems.iter_mut().enumerate() {
             system.compute_neighbors(self.parameters.cutoff.radius)?;
             let types = system.types()?;
-
-            for pair in system.pairs()? {
-                let direction = pair.vector / pair.distance;
-                self.compute_for_pair(pair.distance, direction, do_gradients, &mut contribution);
-
-                let cell_shift_a = pair.cell_shift_indices[0];
-                let cell_shift_b = pair.cell_shift_indices[1];
-                let cell_shift_c = pair.cell_shift_indices[2];
-
-                let first_type = types[pair.first];
-                let second_type = types[pair.second];
-                for o3_lambda in self.parameters.basis.angular_channels() {
-                    let block_i = keys.position(&[
-                        o3_lambda.into(),
-                        1.into(),
-                        first_type.into(),
-                        second_type.into(),
-                    ]);
-
-                    if let Some(block_i) = block_i {
-                        let sample = &[
-                            LabelValue::from(system_i),
-                            LabelValue::from(pair.first),
-                            LabelValue::from(pair.second),
-                            LabelValue::from(cell_shift_a),
-                            LabelValue::from(cell_shift_b),
-                            LabelValue::from(cell_shift_c),
-                        ];
-
-                        SphericalExpansionByPair::accumulate_in_block(
-                            o3_lambda,
-                            descriptor.block_mut_by_id(block_i),
-                            sample,
-                            &contribution,
-                            do_gradients,
-                            pair.vector,
-                        );
-                    }
+            let n_local = system.local_size()?;
+
+            // the neighbor list is computed with the largest cutoff, remove
+            // the pairs further apart than the cutoff for their types, and the
+            // pairs between two ghost atoms which do not have any sample
+            let radii = self.parameters.cutoff.pair_radii(types);
+            let pairs = system.pairs()?;
+            contributing_pairs.clear();
+            contributing_pairs.extend(pairs.iter().enumerate().filter_map(|(pair_i, pair)| {
+                let has_local = pair.first < n_local || pair.second < n_local;
+                let within_cutoff = pair.distance < radii.radius(pair.first, pair.second);
+                (has_local && within_cutoff).then_some(pair_i)
+            }));
+
+            for batch in contributing_pairs.chunks(PAIRS_BATCH_SIZE) {
+                for (pair_i, &pair_index) in batch.iter().enumerate() {
+                    let pair = &pairs[pair_index];
+                    distances[pair_i] = pair.distance;
+                    directions[pair_i] = pair.vector / pair.distance;
+                    cutoffs[pair_i] = radii.radius(pair.first, pair.second);
                 }
-
-                // also check for the block with a reversed pair
-                contribution.inverse_pair(&self.m_1_pow_l);
-
-                for o3_lambda in self.parameters.basis.angular_channels() {
-                    let block_i = keys.position(&[
-                        o3_lambda.into(),
-                        1.into(),
-                        second_type.into(),
-                        first_type.into(),
-                    ]);
-
-                    if let Some(block_i) = block_i {
-                        let sample = &[
-                            LabelValue::from(system_i),
-                            LabelValue::from(pair.second),
-                            LabelValue::from(pair.first),
-                            LabelValue::from(-cell_shift_a),
-                            LabelValue::from(-cell_shift_b),
-                            LabelValue::from(-cell_shift_c),
-                        ];
-
-                        SphericalExpansionByPair::accumulate_in_block(
-                            o3_lambda,
-                            descriptor.block_mut_by_id(block_i),
-                            sample,
-                            &contribution,
-                            do_gradients,
-                            -pair.vector,
-                        );
+                self.compute_for_pairs(
+                    &distances[..batch.len()],
+                    &directions[..batch.len()],
+                    &cutoffs[..batch.len()],
+                    do_gradients,
+                    &mut contributions,
+                );
+
+                for (&pair_index, contribution) in batch.iter().zip(&contributions) {
+                    let pair = &pairs[pair_index];
+                    // The same contribution is used for both orientations of
+                    // the pair. Going from the i -> j to the j -> i pair is
+                    // equivalent to multiplying the values by (-1)^l, and the
+                    // gradients by -(-1)^l.
+                    for inverted in [false, true] {
+                        let (first, second, cell_shift, pair_vector) = if inverted {
+                            (pair.second, pair.first, pair.cell_shift_indices.map(|shift| -shift), -pair.vector)
+                        } else {
+                            (pair.first, pair.second, pair.cell_shift_indices, pair.vector)
+                        };
+
+                        let first_type = types[first];
+                        let second_type = types[second];
+                        for o3_lambda in self.parameters.basis.angular_channels() {
+                            let block_i = keys.position(&[
+                                o3_lambda.into(),
+                                1.into(),
+                                first_type.into(),
+                                second_type.into(),
+                            ]);
+
+                            if let Some(block_i) = block_i {
+                                let sample = &[
+                                    LabelValue::from(system_i),
+                                    LabelValue::from(first),
+                                    LabelValue::from(second),
+                                    LabelValue::from(cell_shift[0]),
+                                    LabelValue::from(cell_shift[1]),
+                                    LabelValue::from(cell_shift[2]),
+                                ];
+
+                                let (values_factor, gradients_factor) = if inverted {
+                                    (self.m_1_pow_l[o3_lambda], -self.m_1_pow_l[o3_lambda])
+                                } else {
+                                    (1.0, 1.0)
+                                };
+
+                                SphericalExpansionByPair::accumulate_in_block(
+                                    o3_lambda,
+                                    descriptor.block_mut_by_id(block_i),
+                                    sample,
+                                    contribution,
+                                    values_factor,
+                                    gradients_factor,
+                                    do_gradients,
+                                    pair_vector,
+                                );
+                            }
+                        }
                     }
                 }
             }
@@ -851,7 +861,7 @@ mod tests {
 
 
     use crate::systems::test_utils::{test_system, test_systems};
-    use crate::Calculator;
+    use crate::{Calculator, System};
     use crate::calculators::{CalculatorBase, SphericalExpansion};
 
     use super::{SphericalExpansionByPair, SphericalExpansionParameters};
@@ -871,7 +881,8 @@ mod tests {
         SphericalExpansionParameters {
             cutoff: Cutoff {
                 radius: 7.3,
-                smoothing: Smoothing::ShiftedCosine { width: 0.5 }
+                smoothing: Smoothing::ShiftedCosine { width: 0.5 },
+                per_type_pair: Vec::new(),
             },
             density: Density {
                 kind: DensityKind::Gaussian { width: 0.3 },
@@ -979,10 +990,10 @@ mod tests {
 
     #[test]
     fn sums_to_spherical_expansion() {
-        let mut calculator_by_pair = Calculator::from(Box::new(SphericalExpansionByPair::new(
+        let calculator_by_pair = Calculator::from(Box::new(SphericalExpansionByPair::new(
             parameters()
         ).unwrap()) as Box<dyn CalculatorBase>);
-        let mut calculator = Calculator::from(Box::new(SphericalExpansion::new(
+        let calculator = Calculator::from(Box::new(SphericalExpansion::new(
             parameters()
         ).unwrap()) as Box<dyn CalculatorBase>);
 
@@ -1020,13 +1031,50 @@ mod tests {
         }
     }
 
+    #[test]
+    fn ghost_atoms() {
+        let calculator = Calculator::from(Box::new(SphericalExpansionByPair::new(
+            parameters()
+        ).unwrap()) as Box<dyn CalculatorBase>);
+
+        let mut systems = test_systems(&["water"]);
+        let reference = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        // only the oxygen is local
+        let mut water = test_system("water");
+        water.set_local_size(1);
+        let mut systems = vec![Box::new(water) as Box<dyn System>];
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        assert_eq!(reference.keys(), descriptor.keys());
+        for (block, expected) in descriptor.blocks().iter().zip(reference.blocks()) {
+            let block = block.data();
+            let values = block.values.as_array();
+
+            let expected = expected.data();
+            let expected_values = expected.values.as_array();
+
+            let mut n_local_samples = 0;
+            for (expected_i, sample) in expected.samples.iter().enumerate() {
+                if sample[1].usize() != 0 {
+                    continue;
+                }
+                n_local_samples += 1;
+
+                let sample_i = block.samples.position(sample).expect("missing sample");
+                assert_ulps_eq!(values.slice(s![sample_i, .., ..]), expected_values.slice(s![expected_i, .., ..]));
+            }
+            assert_eq!(block.samples.count(), n_local_samples);
+        }
+    }
+
     #[test]
     fn explicit_basis() {
         let mut by_angular = BTreeMap::new();
         by_angular.insert(1, SoapRadialBasis::Gto { max_radial: 5, radius: None });
         by_angular.insert(12, SoapRadialBasis::Gto { max_radial: 3, radius: None });
 
-        let mut calculator = Calculator::from(Box::new(SphericalExpansionByPair::new(
+        let calculator = Calculator::from(Box::new(SphericalExpansionByPair::new(
             SphericalExpansionParameters {
                 basis: SphericalExpansionBasis::Explicit(ExplicitBasis {
                     by_angular: by_angular.into(),
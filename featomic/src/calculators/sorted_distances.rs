@@ -1,3 +1,6 @@
+use ndarray::Axis;
+use rayon::prelude::*;
+
 use metatensor::{Labels, LabelsBuilder, TensorMap};
 
 use super::CalculatorBase;
@@ -115,13 +118,16 @@ impl CalculatorBase for SortedDistances {
     }
 
     #[time_graph::instrument(name = "SortedDistances::compute")]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         if self.separate_neighbor_types {
             assert_eq!(descriptor.keys().names(), ["center_type", "neighbor_type"]);
         } else {
             assert_eq!(descriptor.keys().names(), ["center_type"]);
         }
 
+        systems.par_iter_mut().try_for_each(|system| system.compute_neighbors(self.cutoff))?;
+        let systems = &*systems;
+
         for (key, mut block) in descriptor {
             let neighbor_type = if self.separate_neighbor_types {
                 Some(key[1].i32())
@@ -130,42 +136,60 @@ impl CalculatorBase for SortedDistances {
             };
 
             let block_data = block.data_mut();
-            let array = block_data.values.to_array_mut();
-
-            for (sample_i, [system_i, center_i]) in block_data.samples.iter_fixed_size().enumerate() {
-                let center_i = center_i.usize();
-
-                let system = &mut systems[system_i.usize()];
-                system.compute_neighbors(self.cutoff)?;
-                let types = system.types()?;
-
-                let mut distances = Vec::new();
-                for pair in system.pairs_containing(center_i)? {
-                    if let Some(neighbor_type) = neighbor_type {
-                        let neighbor_i = if pair.first == center_i {
-                            pair.second
+            let samples = &*block_data.samples;
+            let properties = &*block_data.properties;
+
+            // we only need to find the `n_smallest` distances, where
+            // `n_smallest` is at most `self.max_neighbors` but can be smaller
+            // if the user selected a subset of the properties
+            let n_smallest = properties.iter_fixed_size()
+                .map(|[neighbor]| neighbor.usize() + 1)
+                .max()
+                .unwrap_or(0);
+
+            block_data.values.to_array_mut()
+                .axis_iter_mut(Axis(0))
+                .into_par_iter()
+                .zip_eq(samples.par_iter())
+                .try_for_each_init(Vec::new, |distances, (mut row, sample)| {
+                    let system = &systems[sample[0].usize()];
+                    let center_i = sample[1].usize();
+                    let types = system.types()?;
+
+                    distances.clear();
+                    for pair in system.pairs_containing(center_i)? {
+                        if let Some(neighbor_type) = neighbor_type {
+                            let neighbor_i = if pair.first == center_i {
+                                pair.second
+                            } else {
+                                debug_assert_eq!(pair.second, center_i);
+                                pair.first
+                            };
+
+                            if types[neighbor_i] == neighbor_type {
+                                distances.push(pair.distance);
+                            }
                         } else {
-                            debug_assert_eq!(pair.second, center_i);
-                            pair.first
-                        };
-
-                        if types[neighbor_i] == neighbor_type {
                             distances.push(pair.distance);
                         }
-                    } else {
-                        distances.push(pair.distance);
                     }
-                }
 
-                // Sort, resize to limit to at most `self.max_neighbors` values
-                // and pad the distance vectors as needed
-                distances.sort_unstable_by(|a, b| a.partial_cmp(b).unwrap());
-                distances.resize(self.max_neighbors, self.cutoff);
+                    // Only keep the `n_smallest` distances, sort them and pad
+                    // the distance vectors as needed. Partial selection is
+                    // O(n), and we only sort the few remaining values.
+                    if n_smallest > 0 && distances.len() > n_smallest {
+                        distances.select_nth_unstable_by(n_smallest - 1, f64::total_cmp);
+                        distances.truncate(n_smallest);
+                    }
+                    distances.sort_unstable_by(f64::total_cmp);
+                    distances.resize(n_smallest, self.cutoff);
 
-                for (property_i, [neighbor]) in block_data.properties.iter_fixed_size().enumerate() {
-                    array[[sample_i, property_i]] = distances[neighbor.usize()];
-                }
-            }
+                    for (property_i, [neighbor]) in properties.iter_fixed_size().enumerate() {
+                        row[property_i] = distances[neighbor.usize()];
+                    }
+
+                    return Ok::<(), Error>(());
+                })?;
         }
 
         Ok(())
@@ -197,7 +221,7 @@ mod tests {
 
     #[test]
     fn values() {
-        let mut calculator = Calculator::from(Box::new(SortedDistances {
+        let calculator = Calculator::from(Box::new(SortedDistances {
             cutoff: 1.7,
             max_neighbors: 4,
             separate_neighbor_types: false
@@ -219,6 +243,33 @@ mod tests {
         assert_eq!(values.slice(s![2, ..]), aview1(&[0.957897074324794, 1.4891, 1.5109, 1.7]));
     }
 
+    #[test]
+    fn partial_selection() {
+        // only the smallest distances are selected and sorted, check that
+        // this gives the same values as sorting all distances
+        let calculator = Calculator::from(Box::new(SortedDistances {
+            cutoff: 5.0,
+            max_neighbors: 3,
+            separate_neighbor_types: false
+        }) as Box<dyn CalculatorBase>);
+        let mut systems = test_systems(&["methane", "water"]);
+        let descriptor = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        let calculator = Calculator::from(Box::new(SortedDistances {
+            cutoff: 5.0,
+            max_neighbors: 200,
+            separate_neighbor_types: false
+        }) as Box<dyn CalculatorBase>);
+        let mut systems = test_systems(&["methane", "water"]);
+        let reference = calculator.compute(&mut systems, Default::default()).unwrap();
+
+        assert_eq!(descriptor.keys(), reference.keys());
+        for (block, reference) in descriptor.blocks().iter().zip(reference.blocks()) {
+            let reference = reference.values().to_array();
+            assert_eq!(block.values().to_array(), reference.slice(s![.., ..3]));
+        }
+    }
+
     #[test]
     fn compute_partial() {
         let calculator = Calculator::from(Box::new(SortedDistances{
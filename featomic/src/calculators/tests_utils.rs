@@ -14,7 +14,7 @@ use crate::systems::{System, SimpleSystem, UnitCell};
 /// `samples`/`features`. If `gradients` is true, this function also checks the
 /// gradients.
 pub fn compute_partial(
-    mut calculator: Calculator,
+    calculator: Calculator,
     systems: &mut [Box<dyn System>],
     keys: &Labels,
     samples: &Labels,
@@ -27,30 +27,30 @@ pub fn compute_partial(
         full.keys().count(),
         "selected keys should be a superset of the keys, a subset will be created manually"
     );
-    check_compute_partial_keys(&mut calculator, &mut *systems, &full, keys);
+    check_compute_partial_keys(&calculator, &mut *systems, &full, keys);
 
     assert!(keys.count() > 3, "selected keys should have more than 3 keys");
     let mut subset_keys = LabelsBuilder::new(keys.names());
     for key in keys.iter().take(3) {
         subset_keys.add(key);
     }
-    check_compute_partial_keys(&mut calculator, &mut *systems, &full, &subset_keys.finish());
+    check_compute_partial_keys(&calculator, &mut *systems, &full, &subset_keys.finish());
 
-    check_compute_partial_properties(&mut calculator, &mut *systems, &full, properties);
+    check_compute_partial_properties(&calculator, &mut *systems, &full, properties);
     // check we can remove all properties
     let empty_properties = Labels::empty(properties.names());
-    check_compute_partial_properties(&mut calculator, &mut *systems, &full, &empty_properties);
+    check_compute_partial_properties(&calculator, &mut *systems, &full, &empty_properties);
 
-    check_compute_partial_samples(&mut calculator, &mut *systems, &full, samples);
+    check_compute_partial_samples(&calculator, &mut *systems, &full, samples);
     // check we can remove all samples
     let empty_samples = Labels::empty(samples.names());
-    check_compute_partial_samples(&mut calculator, &mut *systems, &full, &empty_samples);
+    check_compute_partial_samples(&calculator, &mut *systems, &full, &empty_samples);
 
-    check_compute_partial_both(&mut calculator, &mut *systems, &full, samples, properties);
+    check_compute_partial_both(&calculator, &mut *systems, &full, samples, properties);
 }
 
 fn check_compute_partial_keys(
-    calculator: &mut Calculator,
+    calculator: &Calculator,
     systems: &mut [Box<dyn System>],
     full: &TensorMap,
     keys: &Labels,
@@ -83,7 +83,7 @@ fn check_compute_partial_keys(
 }
 
 fn check_compute_partial_properties(
-    calculator: &mut Calculator,
+    calculator: &Calculator,
     systems: &mut [Box<dyn System>],
     full: &TensorMap,
     properties: &Labels,
@@ -129,7 +129,7 @@ fn check_compute_partial_properties(
 }
 
 fn check_compute_partial_samples(
-    calculator: &mut Calculator,
+    calculator: &Calculator,
     systems: &mut [Box<dyn System>],
     full: &TensorMap,
     samples: &Labels,
@@ -182,7 +182,7 @@ fn check_compute_partial_samples(
 }
 
 fn check_compute_partial_both(
-    calculator: &mut Calculator,
+    calculator: &Calculator,
     systems: &mut [Box<dyn System>],
     full: &TensorMap,
     samples: &Labels,
@@ -260,7 +260,7 @@ pub struct FinalDifferenceOptions {
 
 /// Check that analytical gradients with respect to positions agree with a
 /// finite difference calculation of the gradients.
-pub fn finite_differences_positions(mut calculator: Calculator, system: &SimpleSystem, options: FinalDifferenceOptions) {
+pub fn finite_differences_positions(calculator: Calculator, system: &SimpleSystem, options: FinalDifferenceOptions) {
     let calculation_options = CalculationOptions {
         gradients: &["positions"],
         ..Default::default()
@@ -322,7 +322,7 @@ pub fn finite_differences_positions(mut calculator: Calculator, system: &SimpleS
 
 /// Check that analytical gradients with respect to cell agree with a
 /// finite difference calculation of the gradients.
-pub fn finite_differences_cell(mut calculator: Calculator, system: &SimpleSystem, options: FinalDifferenceOptions) {
+pub fn finite_differences_cell(calculator: Calculator, system: &SimpleSystem, options: FinalDifferenceOptions) {
     let calculation_options = CalculationOptions {
         gradients: &["cell"],
         ..Default::default()
@@ -384,7 +384,7 @@ pub fn finite_differences_cell(mut calculator: Calculator, system: &SimpleSystem
 
 /// Check that analytical gradients with respect to strain agree with a
 /// finite difference calculation of the gradients.
-pub fn finite_differences_strain(mut calculator: Calculator, system: &SimpleSystem, options: FinalDifferenceOptions) {
+pub fn finite_differences_strain(calculator: Calculator, system: &SimpleSystem, options: FinalDifferenceOptions) {
     let calculation_options = CalculationOptions {
         gradients: &["strain"],
         ..Default::default()
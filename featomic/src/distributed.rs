@@ -0,0 +1,474 @@
+use std::collections::BTreeMap;
+
+use ndarray::{ArrayD, ArrayViewD, Axis};
+
+use metatensor::{LabelsBuilder, LabelValue};
+use metatensor::{TensorBlock, TensorBlockRef, TensorMap};
+
+use crate::{Calculator, CalculationOptions, LabelsSelection};
+use crate::{Error, System, SimpleSystem};
+
+/// A single domain in a `DomainDecomposition`, containing the atoms owned by
+/// this domain followed by the ghost atoms in the halo around it.
+#[derive(Clone, Debug)]
+pub struct Domain {
+    system: SimpleSystem,
+    atoms: Vec<usize>,
+    local_size: usize,
+}
+
+impl Domain {
+    /// Get the system for this domain. The local atoms come first, followed
+    /// by the ghost atoms, and `System::local_size` is set accordingly.
+    pub fn system(&self) -> &SimpleSystem {
+        &self.system
+    }
+
+    /// Get the index in the full system of each atom in this domain
+    pub fn atoms(&self) -> &[usize] {
+        &self.atoms
+    }
+
+    /// Get the number of atoms owned by this domain
+    pub fn local_size(&self) -> usize {
+        self.local_size
+    }
+}
+
+/// Spatial decomposition of a single large system in multiple domains, to
+/// compute a descriptor in a distributed way.
+///
+/// The system is cut in slabs along the direction where it is the largest
+/// (the lattice direction with the largest distance between faces for
+/// periodic systems), each slab containing the same number of atoms. Every
+/// domain then contains the atoms in its slab as local atoms, and all the
+/// atoms within `halo` of the slab as ghosts (see `System::local_size`).
+///
+/// As long as `halo` is larger than the cutoff of the calculator, the
+/// per-atom values and positions gradients computed for the local atoms of a
+/// domain are the same as the one computed with the full system. This does
+/// not hold for calculators using long-range interactions (LODE).
+///
+/// The decomposition is deterministic, so separate processes (for example
+/// MPI ranks) can all create it from the full system, call
+/// `DomainDecomposition::compute_domain` with their own rank, and send the
+/// resulting shards to a single process to be merged with
+/// `DomainDecomposition::gather`. Shards use indexes of the full system in
+/// their labels, so they can also be used directly without gathering.
+#[derive(Clone, Debug)]
+pub struct DomainDecomposition {
+    domains: Vec<Domain>,
+}
+
+impl DomainDecomposition {
+    /// Decompose `system` into `n_domains` domains, including ghost atoms up
+    /// to a distance of `halo` from each domain.
+    pub fn new(system: &dyn System, n_domains: usize, halo: f64) -> Result<DomainDecomposition, Error> {
+        if n_domains == 0 {
+            return Err(Error::InvalidParameter(
+                "the number of domains must be at least 1".into()
+            ));
+        }
+
+        if !(halo >= 0.0 && halo.is_finite()) {
+            return Err(Error::InvalidParameter(format!(
+                "the halo size must be a positive number, got {}", halo
+            )));
+        }
+
+        let cell = system.cell()?;
+        let types = system.types()?;
+        let positions = system.positions()?;
+        let n_atoms = positions.len();
+
+        // coordinate of all atoms along the decomposition direction, together
+        // with the period of this coordinate and the halo in the same units
+        let (coordinates, period, halo) = if cell.is_infinite() {
+            let mut axis = 0;
+            let mut largest_extent = -1.0;
+            for dimension in 0..3 {
+                let min = positions.iter().map(|p| p[dimension]).fold(f64::INFINITY, f64::min);
+                let max = positions.iter().map(|p| p[dimension]).fold(f64::NEG_INFINITY, f64::max);
+                if max - min > largest_extent {
+                    largest_extent = max - min;
+                    axis = dimension;
+                }
+            }
+
+            let coordinates = positions.iter().map(|p| p[axis]).collect::<Vec<_>>();
+            (coordinates, None, halo)
+        } else {
+            let faces = cell.distances_between_faces();
+            let mut axis = 0;
+            for dimension in 1..3 {
+                if faces[dimension] > faces[axis] {
+                    axis = dimension;
+                }
+            }
+
+            let coordinates = positions.iter()
+                .map(|&p| cell.fractional(p)[axis].rem_euclid(1.0))
+                .collect::<Vec<_>>();
+            (coordinates, Some(1.0), halo / faces[axis])
+        };
+
+        let mut order = (0..n_atoms).collect::<Vec<_>>();
+        order.sort_by(|&i, &j| coordinates[i].total_cmp(&coordinates[j]).then(i.cmp(&j)));
+
+        let mut owner = vec![0; n_atoms];
+        let mut domains = Vec::with_capacity(n_domains);
+        for domain_i in 0..n_domains {
+            let mut atoms = order[(domain_i * n_atoms / n_domains)..((domain_i + 1) * n_atoms / n_domains)].to_vec();
+            atoms.sort_unstable();
+            for &atom in &atoms {
+                owner[atom] = domain_i;
+            }
+            domains.push(atoms);
+        }
+
+        let domains = domains.into_iter().enumerate().map(|(domain_i, mut atoms)| {
+            let local_size = atoms.len();
+            if local_size != 0 {
+                let min = atoms.iter().map(|&i| coordinates[i]).fold(f64::INFINITY, f64::min);
+                let max = atoms.iter().map(|&i| coordinates[i]).fold(f64::NEG_INFINITY, f64::max);
+
+                for atom in 0..n_atoms {
+                    if owner[atom] != domain_i && distance_to_slab(coordinates[atom], min, max, period) <= halo {
+                        atoms.push(atom);
+                    }
+                }
+            }
+
+            let mut system = SimpleSystem::from_arrays(
+                cell,
+                atoms.iter().map(|&i| types[i]).collect(),
+                atoms.iter().map(|&i| positions[i]).collect(),
+            );
+            system.set_local_size(local_size);
+
+            Domain {
+                system: system,
+                atoms: atoms,
+                local_size: local_size,
+            }
+        }).collect();
+
+        return Ok(DomainDecomposition {
+            domains: domains,
+        });
+    }
+
+    /// Get the number of domains in this decomposition
+    pub fn len(&self) -> usize {
+        self.domains.len()
+    }
+
+    /// Check if this decomposition contains no domains
+    pub fn is_empty(&self) -> bool {
+        self.domains.is_empty()
+    }
+
+    /// Get all the domains in this decomposition
+    pub fn domains(&self) -> &[Domain] {
+        &self.domains
+    }
+
+    /// Compute the descriptor for the local atoms of the domain at index
+    /// `domain`, returning a shard of the full descriptor. The `"system"`
+    /// dimension of the samples is always 0 and the atoms indexes refer to
+    /// the full system.
+    pub fn compute_domain(
+        &self,
+        calculator: &Calculator,
+        domain: usize,
+        options: CalculationOptions,
+    ) -> Result<TensorMap, Error> {
+        check_options(&options)?;
+        let current = self.domains.get(domain).ok_or_else(|| Error::InvalidParameter(format!(
+            "domain index ({}) is out of bounds for a decomposition with {} domains",
+            domain, self.domains.len()
+        )))?;
+
+        let mut systems = vec![Box::new(current.system.clone()) as Box<dyn System>];
+        let descriptor = calculator.compute(&mut systems, options)?;
+
+        return merge(&[(&descriptor, Some(&[&current.atoms[..]][..]))], options.gradients);
+    }
+
+    /// Compute the descriptor for the full system, running the calculation
+    /// for all domains at once (in parallel) and gathering the results.
+    pub fn compute(&self, calculator: &Calculator, options: CalculationOptions) -> Result<TensorMap, Error> {
+        check_options(&options)?;
+        let mut systems = self.domains.iter()
+            .map(|domain| Box::new(domain.system.clone()) as Box<dyn System>)
+            .collect::<Vec<_>>();
+        let descriptor = calculator.compute(&mut systems, options)?;
+
+        let atoms = self.domains.iter().map(|domain| &domain.atoms[..]).collect::<Vec<_>>();
+        return merge(&[(&descriptor, Some(&atoms[..]))], options.gradients);
+    }
+
+    /// Gather the `shards` created by `DomainDecomposition::compute_domain`
+    /// in a single descriptor for the full system, in the same order as
+    /// `Calculator::compute` would produce. The gradients in `gradients` are
+    /// also gathered, and must be present in all shards.
+    pub fn gather(shards: &[TensorMap], gradients: &[&str]) -> Result<TensorMap, Error> {
+        if shards.is_empty() {
+            return Err(Error::InvalidParameter("can not gather an empty list of shards".into()));
+        }
+
+        let parts = shards.iter().map(|shard| (shard, None)).collect::<Vec<_>>();
+        return merge(&parts, gradients);
+    }
+}
+
+/// Get the distance between `x` and the `[min, max]` range, taking into
+/// account periodic boundary conditions if `period` is set
+fn distance_to_slab(x: f64, min: f64, max: f64, period: Option<f64>) -> f64 {
+    if x >= min && x <= max {
+        return 0.0;
+    }
+
+    return match period {
+        None => if x < min { min - x } else { x - max },
+        Some(period) => f64::min((min - x).rem_euclid(period), (x - max).rem_euclid(period)),
+    };
+}
+
+fn check_options(options: &CalculationOptions) -> Result<(), Error> {
+    if !matches!(options.selected_samples, LabelsSelection::All) {
+        return Err(Error::InvalidParameter(
+            "selection of samples is not supported with DomainDecomposition".into()
+        ));
+    }
+    return Ok(());
+}
+
+/// A descriptor to merge, with an optional mapping from the atoms indexes in
+/// each system to the atoms indexes in the full system. If the mapping is
+/// `None`, the descriptor already uses indexes in the full system.
+type MergePart<'a> = (&'a TensorMap, Option<&'a [&'a [usize]]>);
+
+/// Merge multiple descriptors for disjoint sets of atoms in a single
+/// descriptor, with samples sorted by atom index in the full system
+fn merge(parts: &[MergePart<'_>], gradients: &[&str]) -> Result<TensorMap, Error> {
+    let key_names = parts[0].0.keys().names();
+    let mut all_keys = BTreeMap::new();
+    for (part_i, (tensor, _)) in parts.iter().enumerate() {
+        if tensor.keys().names() != key_names {
+            return Err(Error::InvalidParameter(
+                "all shards must have the same key names".into()
+            ));
+        }
+
+        for (block_i, key) in tensor.keys().iter().enumerate() {
+            let key = key.iter().map(|value| value.i32()).collect::<Vec<_>>();
+            all_keys.entry(key).or_insert_with(Vec::new).push((part_i, block_i));
+        }
+    }
+
+    let mut keys = LabelsBuilder::new(key_names);
+    let mut blocks = Vec::new();
+    for (key, entries) in all_keys {
+        keys.add(&key);
+
+        let block_parts = entries.iter()
+            .map(|&(part_i, block_i)| (parts[part_i].0.block_by_id(block_i), parts[part_i].1))
+            .collect::<Vec<_>>();
+        blocks.push(merge_blocks(&block_parts, gradients)?);
+    }
+
+    return Ok(TensorMap::new(keys.finish(), blocks)?);
+}
+
+fn global_atom(mapping: Option<&[&[usize]]>, system: LabelValue, atom: LabelValue) -> usize {
+    match mapping {
+        Some(mapping) => mapping[system.usize()][atom.usize()],
+        None => atom.usize(),
+    }
+}
+
+fn merge_blocks(parts: &[(TensorBlockRef<'_>, Option<&[&[usize]]>)], gradients: &[&str]) -> Result<TensorBlock, Error> {
+    let first = &parts[0].0;
+    let components = first.components();
+    let properties = first.properties();
+
+    // (atom in the full system, part, row in this part)
+    let mut rows = Vec::new();
+    for (part_i, (block, mapping)) in parts.iter().enumerate() {
+        let samples = block.samples();
+        if samples.names() != ["system", "atom"] {
+            return Err(Error::InvalidParameter(format!(
+                "distributed calculations require samples to be ['system', 'atom'], got [{}]",
+                samples.names().join(", ")
+            )));
+        }
+
+        if block.components() != components || block.properties() != properties {
+            return Err(Error::InvalidParameter(
+                "all shards must have the same components and properties for a given key".into()
+            ));
+        }
+
+        for (sample_i, sample) in samples.iter().enumerate() {
+            rows.push((global_atom(*mapping, sample[0], sample[1]), part_i, sample_i));
+        }
+    }
+    rows.sort_unstable();
+
+    let mut new_sample = parts.iter().map(|(block, _)| vec![0; block.samples().count()]).collect::<Vec<_>>();
+    let mut samples = LabelsBuilder::new(vec!["system", "atom"]);
+    for (new_sample_i, &(atom, part_i, sample_i)) in rows.iter().enumerate() {
+        if new_sample_i > 0 && rows[new_sample_i - 1].0 == atom {
+            return Err(Error::InvalidParameter(format!(
+                "atom {} is present in multiple shards", atom
+            )));
+        }
+        new_sample[part_i][sample_i] = new_sample_i;
+        samples.add(&[0, atom]);
+    }
+    // SAFETY: atoms are sorted and we checked for duplicates above
+    let samples = unsafe { samples.finish_assume_unique() };
+
+    let values = parts.iter().map(|(block, _)| block.values().to_array()).collect::<Vec<_>>();
+    let selected = rows.iter().map(|&(_, part_i, sample_i)| (part_i, sample_i));
+    let mut block = TensorBlock::new(
+        stack_rows(&values, selected)?,
+        &samples,
+        &components,
+        &properties,
+    )?;
+
+    for &parameter in gradients {
+        let mut gradient_parts = Vec::new();
+        for (block, mapping) in parts {
+            let gradient = block.gradient(parameter).ok_or_else(|| Error::InvalidParameter(format!(
+                "missing {} gradients in one of the shards", parameter
+            )))?;
+            gradient_parts.push((gradient, *mapping));
+        }
+
+        let all_gradient_samples = gradient_parts.iter()
+            .map(|(gradient, _)| gradient.samples())
+            .collect::<Vec<_>>();
+        let first_gradient = &gradient_parts[0].0;
+        let gradient_names = all_gradient_samples[0].names();
+        let system_dimension = gradient_names.iter().position(|&name| name == "system");
+        let atom_dimension = gradient_names.iter().position(|&name| name == "atom");
+
+        // (new sample, sorting key, part, row in this part), the sorting key
+        // is the atom in the full system for positions gradients
+        let mut gradient_rows = Vec::new();
+        for (part_i, (gradient_samples, (_, mapping))) in all_gradient_samples.iter().zip(&gradient_parts).enumerate() {
+            if gradient_samples.names() != gradient_names {
+                return Err(Error::InvalidParameter(format!(
+                    "all shards must have the same {} gradient samples names", parameter
+                )));
+            }
+
+            for (row_i, gradient_sample) in gradient_samples.iter().enumerate() {
+                let sample = new_sample[part_i][gradient_sample[0].usize()];
+                let atom = match (system_dimension, atom_dimension) {
+                    (Some(system), Some(atom)) => global_atom(*mapping, gradient_sample[system], gradient_sample[atom]),
+                    _ => 0,
+                };
+                gradient_rows.push((sample, atom, part_i, row_i));
+            }
+        }
+        gradient_rows.sort_unstable();
+
+        let mut gradient_samples = LabelsBuilder::new(gradient_names.clone());
+        for &(sample, atom, part_i, row_i) in &gradient_rows {
+            let mut row = all_gradient_samples[part_i][row_i].to_vec();
+            row[0] = sample.into();
+            if let (Some(system), Some(atom_i)) = (system_dimension, atom_dimension) {
+                row[system] = 0_i32.into();
+                row[atom_i] = atom.into();
+            }
+            gradient_samples.add(&row);
+        }
+
+        let gradient_values = gradient_parts.iter().map(|(gradient, _)| gradient.values().to_array()).collect::<Vec<_>>();
+        let selected = gradient_rows.iter().map(|&(_, _, part_i, row_i)| (part_i, row_i));
+        block.add_gradient(parameter, TensorBlock::new(
+            stack_rows(&gradient_values, selected)?,
+            &gradient_samples.finish(),
+            &first_gradient.components(),
+            &properties,
+        )?)?;
+    }
+
+    return Ok(block);
+}
+
+/// Create a new array by stacking the given `(array, row)` along the first
+/// axis
+fn stack_rows(arrays: &[ArrayViewD<'_, f64>], rows: impl Iterator<Item=(usize, usize)>) -> Result<ArrayD<f64>, Error> {
+    let views = rows.map(|(array_i, row)| arrays[array_i].index_axis(Axis(0), row)).collect::<Vec<_>>();
+    if views.is_empty() {
+        let mut shape = arrays[0].shape().to_vec();
+        shape[0] = 0;
+        return Ok(ArrayD::zeros(shape));
+    }
+
+    return ndarray::stack(Axis(0), &views).map_err(|e| Error::Internal(format!(
+        "failed to gather distributed descriptor: {}", e
+    )));
+}
+
+#[cfg(test)]
+mod tests {
+    use crate::systems::{SimpleSystem, UnitCell};
+    use crate::{System, Vector3D};
+
+    use super::DomainDecomposition;
+
+    fn periodic_system() -> SimpleSystem {
+        let mut system = SimpleSystem::new(UnitCell::orthorhombic(6.0, 7.0, 12.0));
+        // deterministic pseudo-random positions
+        let mut state = 42_u64;
+        let mut random = || {
+            state = state.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+            (state >> 11) as f64 / (1_u64 << 53) as f64
+        };
+
+        for atom in 0..30 {
+            let position = Vector3D::new(6.0 * random(), 7.0 * random(), 12.0 * random());
+            system.add_atom([1, 6, 8][atom % 3], position);
+        }
+        return system;
+    }
+
+    #[test]
+    fn decomposition() {
+        let system = periodic_system();
+        let decomposition = DomainDecomposition::new(&system, 4, 2.0).unwrap();
+        assert_eq!(decomposition.len(), 4);
+
+        let mut owned = vec![0; system.size().unwrap()];
+        for domain in decomposition.domains() {
+            let domain_system = domain.system();
+            assert_eq!(domain_system.local_size().unwrap(), domain.local_size());
+            assert_eq!(domain_system.size().unwrap(), domain.atoms().len());
+
+            for (i, &atom) in domain.atoms().iter().enumerate() {
+                assert_eq!(domain_system.positions().unwrap()[i], system.positions().unwrap()[atom]);
+                if i < domain.local_size() {
+                    owned[atom] += 1;
+                }
+            }
+        }
+
+        // all atoms are owned by exactly one domain
+        assert!(owned.iter().all(|&count| count == 1));
+
+        // the halo covers all atoms
+        let decomposition = DomainDecomposition::new(&system, 2, 20.0).unwrap();
+        for domain in decomposition.domains() {
+            assert_eq!(domain.atoms().len(), system.size().unwrap());
+        }
+
+        assert!(DomainDecomposition::new(&system, 0, 2.0).is_err());
+        assert!(DomainDecomposition::new(&system, 2, -1.0).is_err());
+    }
+}
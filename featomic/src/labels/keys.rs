@@ -73,14 +73,11 @@ impl KeysBuilder for CenterSingleNeighborsTypesKeys {
         for system in systems {
             system.compute_neighbors(self.cutoff)?;
 
-            let types = system.types()?;
-            for pair in system.pairs()? {
-                all_types_pairs.insert((types[pair.first], types[pair.second]));
-                all_types_pairs.insert((types[pair.second], types[pair.first]));
-            }
+            let summary = system.types_summary()?;
+            all_types_pairs.extend(summary.pairs.iter().copied());
 
             if self.self_pairs {
-                for &atomic_type in types {
+                for &atomic_type in summary.types.keys() {
                     all_types_pairs.insert((atomic_type, atomic_type));
                 }
             }
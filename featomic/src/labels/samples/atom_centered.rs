@@ -34,10 +34,13 @@ impl SamplesBuilder for AtomCenteredSamples {
         for (system_i, system) in systems.iter_mut().enumerate() {
             system.compute_neighbors(self.cutoff)?;
             let types = system.types()?;
+            // only local atoms are used as centers, ghost atoms can still be
+            // neighbors of the local atoms
+            let n_local = system.local_size()?;
 
             match &self.neighbor_type {
                 AtomicTypeFilter::Any => {
-                    for (center_i, &center_type) in types.iter().enumerate() {
+                    for (center_i, &center_type) in types.iter().take(n_local).enumerate() {
                         if self.center_type.matches(center_type) {
                             builder.add(&[system_i, center_i]);
                         }
@@ -45,7 +48,7 @@ impl SamplesBuilder for AtomCenteredSamples {
                 }
                 AtomicTypeFilter::AllOf(requested_types) => {
                     let mut neighbor_types = BTreeSet::new();
-                    for (atom_i, &center_type) in types.iter().enumerate() {
+                    for (atom_i, &center_type) in types.iter().take(n_local).enumerate() {
                         if self.center_type.matches(center_type) {
                             for pair in system.pairs_containing(atom_i)? {
                                 let neighbor = if pair.first == atom_i {
@@ -69,8 +72,20 @@ impl SamplesBuilder for AtomCenteredSamples {
                     }
                 }
                 selection => {
+                    // skip systems without any pair of matching types
+                    let summary = system.types_summary()?;
+                    let has_matching_pairs = summary.pairs.iter().any(|&(center_type, neighbor_type)| {
+                        self.center_type.matches(center_type) && selection.matches(neighbor_type)
+                    });
+                    let has_matching_self_pairs = self.self_pairs && summary.types.keys().any(|&atomic_type| {
+                        self.center_type.matches(atomic_type) && selection.matches(atomic_type)
+                    });
+                    if !has_matching_pairs && !has_matching_self_pairs {
+                        continue;
+                    }
+
                     let mut matching_atoms = BTreeSet::new();
-                    for (atom_i, &center_type) in types.iter().enumerate() {
+                    for (atom_i, &center_type) in types.iter().take(n_local).enumerate() {
                         if self.center_type.matches(center_type) {
                             if self.self_pairs && selection.matches(center_type) {
                                 matching_atoms.insert(atom_i);
@@ -97,7 +112,9 @@ impl SamplesBuilder for AtomCenteredSamples {
             }
         }
 
-        return Ok(builder.finish());
+        // SAFETY: systems and atoms are visited in order, and each atom is
+        // added at most once, so all entries are unique
+        return Ok(unsafe { builder.finish_assume_unique() });
     }
 
     fn gradients_for(&self, systems: &mut [Box<dyn System>], samples: &Labels) -> Result<Labels, Error> {
@@ -145,14 +162,16 @@ impl SamplesBuilder for AtomCenteredSamples {
             }
         }
 
-        return Ok(builder.finish());
+        // SAFETY: each sample is visited once, and `neighbors` is a set, so all
+        // entries are unique
+        return Ok(unsafe { builder.finish_assume_unique() });
     }
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
-    use crate::systems::test_utils::test_systems;
+    use crate::systems::test_utils::{test_system, test_systems};
 
     #[test]
     fn all_samples() {
@@ -307,4 +326,40 @@ mod tests {
             ]
         ));
     }
+
+    #[test]
+    fn ghost_atoms() {
+        let mut water = test_system("water");
+        water.set_local_size(2);
+        let mut systems: Vec<Box<dyn System>> = vec![
+            Box::new(test_system("CH")),
+            Box::new(water),
+        ];
+
+        let builder = AtomCenteredSamples {
+            cutoff: 2.0,
+            center_type: AtomicTypeFilter::Any,
+            neighbor_type: AtomicTypeFilter::Any,
+            self_pairs: true,
+        };
+
+        // the last atom in water is a ghost, and does not get a sample
+        let samples = builder.samples(&mut systems).unwrap();
+        assert_eq!(samples, Labels::new(
+            ["system", "atom"],
+            &[[0, 0], [0, 1], [1, 0], [1, 1]],
+        ));
+
+        // but it is still a neighbor of the local atoms
+        let gradient_samples = builder.gradients_for(&mut systems, &samples).unwrap();
+        assert_eq!(gradient_samples, Labels::new(
+            ["sample", "system", "atom"],
+            &[
+                [0, 0, 0], [0, 0, 1],
+                [1, 0, 0], [1, 0, 1],
+                [2, 1, 0], [2, 1, 1], [2, 1, 2],
+                [3, 1, 0], [3, 1, 1], [3, 1, 2],
+            ],
+        ));
+    }
 }
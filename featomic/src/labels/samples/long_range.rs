@@ -49,7 +49,8 @@ impl SamplesBuilder for LongRangeSamplesPerAtom {
             }
         }
 
-        return Ok(builder.finish());
+        // SAFETY: each (system, atom) pair is added at most once
+        return Ok(unsafe { builder.finish_assume_unique() });
     }
 
     fn gradients_for(&self, systems: &mut [Box<dyn System>], samples: &Labels) -> Result<Labels, Error> {
@@ -67,7 +68,8 @@ impl SamplesBuilder for LongRangeSamplesPerAtom {
             }
         }
 
-        return Ok(builder.finish());
+        // SAFETY: each (sample, neighbor) pair is added at most once
+        return Ok(unsafe { builder.finish_assume_unique() });
     }
 }
 
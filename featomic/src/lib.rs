@@ -28,13 +28,19 @@ mod errors;
 pub use self::errors::Error;
 
 pub mod systems;
-pub use self::systems::{System, SimpleSystem};
+pub use self::systems::{System, SimpleSystem, TypesSummary};
 
 pub mod labels;
 
 mod calculator;
 pub use self::calculator::{Calculator, CalculationOptions, LabelsSelection};
 
+mod cache;
+pub use self::cache::DescriptorCache;
+
+mod distributed;
+pub use self::distributed::{DomainDecomposition, Domain};
+
 pub mod calculators;
 
 // only try to build the tutorials in test mode
@@ -0,0 +1,246 @@
+/// A single non-zero Clebsch-Gordan coefficient, coupling real spherical
+/// harmonics of degree `l_1` and `l_2` into a real spherical harmonic of degree
+/// `o3_lambda`.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct ClebschGordanCoefficient {
+    /// index of `m_1` in the `[-l_1, l_1]` range, i.e. `m_1 + l_1`
+    pub m_1: usize,
+    /// index of `m_2` in the `[-l_2, l_2]` range, i.e. `m_2 + l_2`
+    pub m_2: usize,
+    /// index of `mu` in the `[-o3_lambda, o3_lambda]` range, i.e.
+    /// `mu + o3_lambda`
+    pub mu: usize,
+    /// value of the coefficient
+    pub value: f64,
+}
+
+/// Coefficients smaller than this are considered to be zero
+const ZERO_THRESHOLD: f64 = 1e-14;
+
+/// Compute all the non-zero Clebsch-Gordan coefficients for real spherical
+/// harmonics of degree `l_1`, `l_2` and `o3_lambda`.
+///
+/// The coefficients are built from the complex Clebsch-Gordan coefficients
+/// (using the Condon-Shortley phase convention) and the transformation between
+/// complex and real spherical harmonics. This gives the same coefficients as
+/// the ones used in `featomic.clebsch_gordan` in Python, such that
+///
+/// `A^{o3_lambda}_{mu} = \sum_{m_1 m_2} C^{l_1 l_2 o3_lambda}_{m_1 m_2 mu} A^{l_1}_{m_1} A^{l_2}_{m_2}`
+///
+/// transforms like a real spherical harmonic of degree `o3_lambda` under
+/// rotations. Only the non-zero coefficients are returned, which is usually a
+/// small fraction of the `(2 l_1 + 1) (2 l_2 + 1) (2 o3_lambda + 1)` entries.
+///
+/// The result is empty if `l_1`, `l_2` and `o3_lambda` do not satisfy the
+/// triangle inequality `|l_1 - l_2| <= o3_lambda <= l_1 + l_2`.
+pub fn real_clebsch_gordan(l_1: usize, l_2: usize, o3_lambda: usize) -> Vec<ClebschGordanCoefficient> {
+    let mut coefficients = Vec::new();
+    if o3_lambda < l_1.abs_diff(l_2) || o3_lambda > l_1 + l_2 {
+        return coefficients;
+    }
+
+    // the real coefficients are either purely real or purely imaginary,
+    // depending on the parity of l_1 + l_2 + o3_lambda
+    let use_real_part = (l_1 + l_2 + o3_lambda) % 2 == 0;
+
+    for m_1 in 0..(2 * l_1 + 1) {
+        for m_2 in 0..(2 * l_2 + 1) {
+            for mu in 0..(2 * o3_lambda + 1) {
+                let mut sum = Complex::ZERO;
+                for &(complex_m_1, u_1) in &real_to_complex(l_1, m_1) {
+                    for &(complex_m_2, u_2) in &real_to_complex(l_2, m_2) {
+                        for &(complex_mu, u_3) in &real_to_complex(o3_lambda, mu) {
+                            let cg = complex_clebsch_gordan(
+                                l_1, complex_m_1,
+                                l_2, complex_m_2,
+                                o3_lambda, complex_mu,
+                            );
+
+                            if cg != 0.0 {
+                                sum = sum + u_1 * u_2 * u_3.conj() * cg;
+                            }
+                        }
+                    }
+                }
+
+                let value = if use_real_part { sum.re } else { sum.im };
+                if value.abs() > ZERO_THRESHOLD {
+                    coefficients.push(ClebschGordanCoefficient { m_1, m_2, mu, value });
+                }
+            }
+        }
+    }
+
+    return coefficients;
+}
+
+/// Complex Clebsch-Gordan coefficient `<l_1 m_1 l_2 m_2 | l m>`, computed with
+/// Racah's formula.
+#[allow(clippy::similar_names)]
+fn complex_clebsch_gordan(l_1: usize, m_1: i64, l_2: usize, m_2: i64, l: usize, m: i64) -> f64 {
+    if m_1 + m_2 != m {
+        return 0.0;
+    }
+
+    let l_1 = l_1 as i64;
+    let l_2 = l_2 as i64;
+    let l = l as i64;
+
+    let mut prefactor = (2 * l + 1) as f64
+        * factorial(l + l_1 - l_2) * factorial(l - l_1 + l_2) * factorial(l_1 + l_2 - l)
+        / factorial(l_1 + l_2 + l + 1);
+
+    prefactor *= factorial(l + m) * factorial(l - m)
+        * factorial(l_1 - m_1) * factorial(l_1 + m_1)
+        * factorial(l_2 - m_2) * factorial(l_2 + m_2);
+
+    let mut sum = 0.0;
+    for k in 0..=(l_1 + l_2 - l) {
+        let arguments = [k, l_1 + l_2 - l - k, l_1 - m_1 - k, l_2 + m_2 - k, l - l_2 + m_1 + k, l - l_1 - m_2 + k];
+        if arguments.iter().any(|&a| a < 0) {
+            continue;
+        }
+
+        let denominator = arguments.iter().map(|&a| factorial(a)).product::<f64>();
+        let sign = if k % 2 == 0 { 1.0 } else { -1.0 };
+        sum += sign / denominator;
+    }
+
+    return prefactor.sqrt() * sum;
+}
+
+fn factorial(n: i64) -> f64 {
+    debug_assert!(n >= 0);
+    return (1..=n).map(|i| i as f64).product();
+}
+
+/// Non-zero entries in the row `m` (as an index in `[0, 2 l + 1)`) of the
+/// matrix transforming real spherical harmonics of degree `l` into complex
+/// ones. Each entry contains the complex `m` value and the corresponding
+/// coefficient.
+fn real_to_complex(l: usize, m: usize) -> Vec<(i64, Complex)> {
+    let inv_sqrt_2 = std::f64::consts::FRAC_1_SQRT_2;
+    let m = m as i64 - l as i64;
+    let m_1_pow_m = if m % 2 == 0 { 1.0 } else { -1.0 };
+
+    if m < 0 {
+        return vec![
+            (m, Complex { re: 0.0, im: -inv_sqrt_2 }),
+            (-m, Complex { re: 0.0, im: m_1_pow_m * inv_sqrt_2 }),
+        ];
+    } else if m == 0 {
+        return vec![(0, Complex { re: 1.0, im: 0.0 })];
+    } else {
+        return vec![
+            (-m, Complex { re: inv_sqrt_2, im: 0.0 }),
+            (m, Complex { re: m_1_pow_m * inv_sqrt_2, im: 0.0 }),
+        ];
+    }
+}
+
+/// Minimal complex number implementation, only used to build the real
+/// Clebsch-Gordan coefficients
+#[derive(Debug, Clone, Copy)]
+struct Complex {
+    re: f64,
+    im: f64,
+}
+
+impl Complex {
+    const ZERO: Complex = Complex { re: 0.0, im: 0.0 };
+
+    fn conj(self) -> Complex {
+        Complex { re: self.re, im: -self.im }
+    }
+}
+
+impl std::ops::Add for Complex {
+    type Output = Complex;
+    fn add(self, other: Complex) -> Complex {
+        Complex { re: self.re + other.re, im: self.im + other.im }
+    }
+}
+
+impl std::ops::Mul for Complex {
+    type Output = Complex;
+    fn mul(self, other: Complex) -> Complex {
+        Complex {
+            re: self.re * other.re - self.im * other.im,
+            im: self.re * other.im + self.im * other.re,
+        }
+    }
+}
+
+impl std::ops::Mul<f64> for Complex {
+    type Output = Complex;
+    fn mul(self, other: f64) -> Complex {
+        Complex { re: self.re * other, im: self.im * other }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use approx::assert_relative_eq;
+
+    use super::*;
+
+    fn dense(l_1: usize, l_2: usize, o3_lambda: usize) -> ndarray::Array3<f64> {
+        let mut array = ndarray::Array3::zeros((2 * l_1 + 1, 2 * l_2 + 1, 2 * o3_lambda + 1));
+        for cg in real_clebsch_gordan(l_1, l_2, o3_lambda) {
+            array[[cg.m_1, cg.m_2, cg.mu]] = cg.value;
+        }
+        return array;
+    }
+
+    #[test]
+    fn complex_values() {
+        // check a couple of known values
+        assert_relative_eq!(complex_clebsch_gordan(1, 1, 1, -1, 0, 0), f64::sqrt(1.0 / 3.0), epsilon=1e-15);
+        assert_relative_eq!(complex_clebsch_gordan(1, 0, 1, 0, 0, 0), -f64::sqrt(1.0 / 3.0), epsilon=1e-15);
+        assert_relative_eq!(complex_clebsch_gordan(1, 1, 1, 0, 2, 1), f64::sqrt(0.5), epsilon=1e-15);
+        assert_relative_eq!(complex_clebsch_gordan(2, 1, 1, -1, 1, 0), f64::sqrt(3.0 / 10.0), epsilon=1e-15);
+        assert_eq!(complex_clebsch_gordan(2, 1, 1, 1, 1, 0), 0.0);
+    }
+
+    #[test]
+    fn invariants() {
+        // coupling to lambda=0 gives the usual power spectrum normalization
+        for l in 0..6 {
+            let sign = if l % 2 == 0 { 1.0 } else { -1.0 };
+            let expected = sign / f64::sqrt((2 * l + 1) as f64);
+
+            let coefficients = real_clebsch_gordan(l, l, 0);
+            assert_eq!(coefficients.len(), 2 * l + 1);
+            for cg in coefficients {
+                assert_eq!(cg.m_1, cg.m_2);
+                assert_relative_eq!(cg.value, expected, max_relative=1e-12);
+            }
+        }
+    }
+
+    #[test]
+    fn orthonormality() {
+        for l_1 in 0..5 {
+            for l_2 in 0..5 {
+                for o3_lambda in l_1.abs_diff(l_2)..=(l_1 + l_2) {
+                    let cg = dense(l_1, l_2, o3_lambda);
+                    let cg = cg.to_shape(((2 * l_1 + 1) * (2 * l_2 + 1), 2 * o3_lambda + 1)).unwrap();
+
+                    let product = cg.t().dot(&cg);
+                    let identity = ndarray::Array2::<f64>::eye(2 * o3_lambda + 1);
+                    assert_relative_eq!(product, identity, epsilon=1e-12);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn selection_rules() {
+        assert!(real_clebsch_gordan(1, 3, 1).is_empty());
+        assert!(real_clebsch_gordan(1, 1, 3).is_empty());
+
+        // the sparse tables are much smaller than the dense ones
+        let coefficients = real_clebsch_gordan(4, 4, 4);
+        assert!(coefficients.len() < 9 * 9 * 9 / 4);
+    }
+}
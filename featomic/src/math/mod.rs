@@ -29,3 +29,6 @@ pub(crate) use self::spherical_harmonics::SphericalHarmonicsCache;
 mod k_vectors;
 pub use self::k_vectors::KVector;
 pub use self::k_vectors::compute_k_vectors;
+
+mod clebsch_gordan;
+pub(crate) use self::clebsch_gordan::{real_clebsch_gordan, ClebschGordanCoefficient};
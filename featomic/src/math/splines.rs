@@ -34,7 +34,7 @@ pub struct SplineParameters {
 }
 
 /// A single control point/knot in the Hermit cubic spline
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, PartialEq)]
 pub struct HermitSplinePoint<D: ndarray::Dimension> {
     /// Position of the point
     pub(crate) position: f64,
@@ -1,3 +1,6 @@
+use std::borrow::Cow;
+use std::collections::{BTreeMap, BTreeSet};
+
 use crate::{Error, Vector3D};
 
 mod cell;
@@ -9,6 +12,9 @@ pub use self::neighbors::NeighborsList;
 mod simple_system;
 pub use self::simple_system::SimpleSystem;
 
+mod trajectory;
+pub use self::trajectory::{TrajectoryReader, TrajectoryFormat, write_binary_trajectory};
+
 #[cfg(feature = "chemfiles")]
 mod chemfiles;
 
@@ -45,6 +51,18 @@ pub trait System: Send + Sync {
     /// Get the number of atoms in this system
     fn size(&self) -> Result<usize, Error>;
 
+    /// Get the number of local atoms in this system. Atoms with indexes in
+    /// `0..self.local_size()` are local, and the remaining ones are ghosts
+    /// (for example periodic images or atoms owned by another domain in a
+    /// domain-decomposed simulation). Ghost atoms are used as neighbors of the
+    /// local atoms and appear in gradient samples, but atom-centered samples
+    /// are only created for local atoms.
+    ///
+    /// By default, all atoms are local.
+    fn local_size(&self) -> Result<usize, Error> {
+        self.size()
+    }
+
     /// Get the atomic types for all atoms in this system. The returned value
     /// must be a slice of length `self.size()`, where each different atomic
     /// type is identified with a different integer value. These values are
@@ -74,4 +92,72 @@ pub trait System: Send + Sync {
     /// included both in the return of `pairs_containing(i)` and
     /// `pairs_containing(j)`.
     fn pairs_containing(&self, atom: usize) -> Result<&[Pair], Error>;
+
+    /// Get a summary of the atomic types in this system, and of the pairs of
+    /// atomic types in the neighbor list. This function is only valid to call
+    /// after a call to `compute_neighbors`.
+    ///
+    /// This is used when creating keys and samples, to avoid iterating over
+    /// all the pairs in the system. Implementations should compute the summary
+    /// once with `TypesSummary::new` after computing the neighbor list, and
+    /// store it until the next call to `compute_neighbors`.
+    ///
+    /// By default, the summary is re-computed from `types` and `pairs` every
+    /// time this function is called.
+    fn types_summary(&self) -> Result<Cow<'_, TypesSummary>, Error> {
+        let summary = TypesSummary::new(self.types()?, self.pairs()?);
+        return Ok(Cow::Owned(summary));
+    }
+}
+
+/// Summary of the atomic types present in a system and in its neighbor list,
+/// see [`System::types_summary`].
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct TypesSummary {
+    /// Number of atoms with each atomic type in the system
+    pub types: BTreeMap<i32, usize>,
+    /// All the pairs of atomic types in the neighbor list. Each pair is
+    /// included in both orders, i.e. both `(a, b)` and `(b, a)` are present.
+    pub pairs: BTreeSet<(i32, i32)>,
+}
+
+impl TypesSummary {
+    /// Create the summary corresponding to the given atomic `types` and
+    /// neighbor list `pairs`
+    pub fn new(types: &[i32], pairs: &[Pair]) -> TypesSummary {
+        let mut counts = BTreeMap::new();
+        for &atomic_type in types {
+            *counts.entry(atomic_type).or_insert(0) += 1;
+        }
+
+        // use dense indexes for the types and a boolean matrix, to make the
+        // loop over pairs as cheap as possible
+        let all_types = counts.keys().copied().collect::<Vec<_>>();
+        let n_types = all_types.len();
+        let type_indexes = types.iter()
+            .map(|atomic_type| all_types.binary_search(atomic_type).expect("missing atomic type"))
+            .collect::<Vec<_>>();
+
+        let mut present = vec![false; n_types * n_types];
+        for pair in pairs {
+            let first = type_indexes[pair.first];
+            let second = type_indexes[pair.second];
+            present[first * n_types + second] = true;
+            present[second * n_types + first] = true;
+        }
+
+        let mut type_pairs = BTreeSet::new();
+        for (first, &first_type) in all_types.iter().enumerate() {
+            for (second, &second_type) in all_types.iter().enumerate() {
+                if present[first * n_types + second] {
+                    type_pairs.insert((first_type, second_type));
+                }
+            }
+        }
+
+        return TypesSummary {
+            types: counts,
+            pairs: type_pairs,
+        };
+    }
 }
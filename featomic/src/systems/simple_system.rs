@@ -1,6 +1,8 @@
+use std::borrow::Cow;
+
 use crate::Error;
 
-use super::{UnitCell, System, Vector3D, Pair};
+use super::{UnitCell, System, Vector3D, Pair, TypesSummary};
 
 use super::neighbors::NeighborsList;
 
@@ -11,6 +13,10 @@ pub struct SimpleSystem {
     types: Vec<i32>,
     positions: Vec<Vector3D>,
     neighbors: Option<NeighborsList>,
+    /// summary of the types in this system, computed together with the
+    /// neighbor list
+    types_summary: Option<TypesSummary>,
+    local_size: Option<usize>,
 }
 
 impl SimpleSystem {
@@ -21,19 +27,50 @@ impl SimpleSystem {
             types: Vec::new(),
             positions: Vec::new(),
             neighbors: None,
+            types_summary: None,
+            local_size: None,
+        }
+    }
+
+    /// Create a new system with the given unit cell, atomic types and
+    /// positions.
+    ///
+    /// # Panics
+    ///
+    /// If `types` and `positions` have different lengths
+    pub fn from_arrays(cell: UnitCell, types: Vec<i32>, positions: Vec<Vector3D>) -> SimpleSystem {
+        assert_eq!(types.len(), positions.len(), "types and positions must have the same length");
+        SimpleSystem {
+            cell: cell,
+            types: types,
+            positions: positions,
+            neighbors: None,
+            types_summary: None,
+            local_size: None,
         }
     }
 
     /// Add an atom with the given atomic type and position to this system
     pub fn add_atom(&mut self, atomic_type: i32, position: Vector3D) {
+        // adding atoms invalidates the neighbor list
+        self.neighbors = None;
+        self.types_summary = None;
         self.types.push(atomic_type);
         self.positions.push(position);
     }
 
+    /// Set the number of local atoms in this system. The first `local_size`
+    /// atoms are local, and all the others are ghosts. See
+    /// [`System::local_size`] for more information.
+    pub fn set_local_size(&mut self, local_size: usize) {
+        self.local_size = Some(local_size);
+    }
+
     #[cfg(test)]
     pub(crate) fn positions_mut(&mut self) -> &mut [Vector3D] {
         // any position access invalidates the neighbor list
         self.neighbors = None;
+        self.types_summary = None;
         return &mut self.positions;
     }
 
@@ -41,6 +78,7 @@ impl SimpleSystem {
     pub(crate) fn set_cell(&mut self, cell: UnitCell) {
         // cell change invalidate the neighbor list
         self.neighbors = None;
+        self.types_summary = None;
         self.cell = cell;
     }
 }
@@ -50,6 +88,21 @@ impl System for SimpleSystem {
         Ok(self.types.len())
     }
 
+    fn local_size(&self) -> Result<usize, Error> {
+        match self.local_size {
+            None => Ok(self.types.len()),
+            Some(local_size) => {
+                if local_size > self.types.len() {
+                    return Err(Error::InvalidParameter(format!(
+                        "local size ({}) is larger than the number of atoms ({}) in this system",
+                        local_size, self.types.len()
+                    )));
+                }
+                Ok(local_size)
+            }
+        }
+    }
+
     fn positions(&self) -> Result<&[Vector3D], Error> {
         Ok(&self.positions)
     }
@@ -71,7 +124,9 @@ impl System for SimpleSystem {
             }
         }
 
-        self.neighbors = Some(NeighborsList::new(self.positions()?, self.cell()?, cutoff));
+        let neighbors = NeighborsList::new(self.positions()?, self.cell()?, cutoff);
+        self.types_summary = Some(TypesSummary::new(&self.types, &neighbors.pairs));
+        self.neighbors = Some(neighbors);
         Ok(())
     }
 
@@ -88,6 +143,13 @@ impl System for SimpleSystem {
         ))?;
         Ok(&neighbors.pairs_by_atom[atom])
     }
+
+    fn types_summary(&self) -> Result<Cow<'_, TypesSummary>, Error> {
+        let summary = self.types_summary.as_ref().ok_or_else(|| Error::Internal(
+            "neighbor list is not initialized".into()
+        ))?;
+        Ok(Cow::Borrowed(summary))
+    }
 }
 
 impl std::convert::TryFrom<&dyn System> for SimpleSystem {
@@ -98,12 +160,19 @@ impl std::convert::TryFrom<&dyn System> for SimpleSystem {
         for (&atomic_type, &position) in system.types()?.iter().zip(system.positions()?) {
             new.add_atom(atomic_type, position);
         }
+
+        let local_size = system.local_size()?;
+        if local_size != new.size()? {
+            new.set_local_size(local_size);
+        }
         return Ok(new);
     }
 }
 
 #[cfg(test)]
 mod tests {
+    use std::collections::{BTreeMap, BTreeSet};
+
     use super::*;
 
     #[test]
@@ -124,4 +193,52 @@ mod tests {
             Vector3D::new(5.0, 3.0, 4.0),
         ]);
     }
+
+    #[test]
+    fn types_summary() {
+        let mut system = SimpleSystem::new(UnitCell::cubic(10.0));
+        system.add_atom(3, Vector3D::new(2.0, 3.0, 4.0));
+        system.add_atom(1, Vector3D::new(1.0, 3.0, 4.0));
+        system.add_atom(3, Vector3D::new(5.0, 3.0, 4.0));
+        system.add_atom(8, Vector3D::new(8.0, 3.0, 4.0));
+
+        assert!(system.types_summary().is_err());
+
+        system.compute_neighbors(1.5).unwrap();
+        let summary = system.types_summary().unwrap();
+        assert_eq!(summary.types, BTreeMap::from([(1, 1), (3, 2), (8, 1)]));
+        assert_eq!(summary.pairs, BTreeSet::from([(1, 3), (3, 1)]));
+
+        // the cached summary is the same as the one computed from the pairs
+        assert_eq!(*summary, TypesSummary::new(system.types().unwrap(), system.pairs().unwrap()));
+
+        system.compute_neighbors(3.5).unwrap();
+        let summary = system.types_summary().unwrap();
+        assert_eq!(summary.pairs, BTreeSet::from([(1, 3), (1, 8), (3, 1), (3, 3), (3, 8), (8, 1), (8, 3)]));
+
+        // adding atoms invalidates the summary
+        system.add_atom(1, Vector3D::new(8.5, 3.0, 4.0));
+        assert!(system.types_summary().is_err());
+    }
+
+    #[test]
+    fn local_size() {
+        let mut system = SimpleSystem::new(UnitCell::cubic(10.0));
+        system.add_atom(3, Vector3D::new(2.0, 3.0, 4.0));
+        system.add_atom(1, Vector3D::new(1.0, 3.0, 4.0));
+        system.add_atom(3, Vector3D::new(5.0, 3.0, 4.0));
+        assert_eq!(system.local_size().unwrap(), 3);
+
+        system.set_local_size(2);
+        assert_eq!(system.local_size().unwrap(), 2);
+
+        let copy = SimpleSystem::try_from(&system as &dyn System).unwrap();
+        assert_eq!(copy.local_size().unwrap(), 2);
+
+        system.set_local_size(5);
+        assert_eq!(
+            system.local_size().unwrap_err().to_string(),
+            "invalid parameter: local size (5) is larger than the number of atoms (3) in this system"
+        );
+    }
 }
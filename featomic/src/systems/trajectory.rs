@@ -0,0 +1,655 @@
+//! Native readers for trajectory files, producing `SimpleSystem` without going
+//! through an external library.
+//!
+//! Two formats are supported: extended XYZ (as written by ASE and most
+//! simulation codes), and a compact binary format storing the atomic types,
+//! positions and cell of each frame. The frames offsets in the file are indexed
+//! once when opening the file, and frames can then be read and parsed in
+//! parallel.
+use std::fs::File;
+use std::io::{BufRead, BufReader, Read, Seek, SeekFrom, Write};
+use std::ops::Range;
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+
+use rayon::prelude::*;
+
+use crate::{Error, Matrix3, Vector3D};
+use super::{UnitCell, SimpleSystem, System};
+
+/// Magic bytes at the start of binary trajectory files
+const BINARY_MAGIC: &[u8; 8] = b"FTMCTRJ1";
+
+/// Size in bytes of the per-frame header in binary trajectory files: number of
+/// atoms as `u64` and cell matrix as 9 `f64`
+const BINARY_FRAME_HEADER: u64 = 8 + 9 * 8;
+
+/// Format of a trajectory file
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TrajectoryFormat {
+    /// Extended XYZ format. The cell is read from the `Lattice` property in the
+    /// comment line. The columns containing the atomic types (`species`) and
+    /// positions (`pos`) are found from the `Properties` entry in the comment
+    /// line, defaulting to `species:S:1:pos:R:3`. The atomic types can either
+    /// be element symbols or integers.
+    ExtendedXYZ,
+    /// Compact binary format, as written by `write_binary_trajectory`. All
+    /// values are stored in little-endian order. The file starts with 8 magic
+    /// bytes (`FTMCTRJ1`), followed by the frames. Each frame contains the
+    /// number of atoms `n` as `u64`, the cell matrix as 9 `f64` (in row major
+    /// order, with all zeros for infinite cells), the atomic types as `n`
+    /// `i32`, and the positions as `3 x n` `f64`.
+    Binary,
+}
+
+impl TrajectoryFormat {
+    /// Guess the format of a file from its extension: `.xyz` and `.extxyz`
+    /// files are read as `ExtendedXYZ`, and `.ftraj` files as `Binary`.
+    pub fn from_extension(path: &Path) -> Result<TrajectoryFormat, Error> {
+        let extension = path.extension().and_then(|e| e.to_str()).unwrap_or("");
+        match extension {
+            "xyz" | "extxyz" => Ok(TrajectoryFormat::ExtendedXYZ),
+            "ftraj" => Ok(TrajectoryFormat::Binary),
+            _ => Err(Error::InvalidParameter(format!(
+                "could not guess trajectory format for '{}', expected a .xyz, .extxyz or .ftraj file",
+                path.display()
+            ))),
+        }
+    }
+}
+
+/// Reader for trajectory files, giving random access to the frames in the file.
+///
+/// The position of each frame in the file is indexed once when creating the
+/// reader. The file is kept open, and frames are read with positioned reads
+/// that do not change the file cursor, which allow to read and parse multiple
+/// frames in parallel with `TrajectoryReader::read_range`.
+#[derive(Debug, Clone)]
+pub struct TrajectoryReader {
+    path: PathBuf,
+    file: Arc<File>,
+    format: TrajectoryFormat,
+    /// start offset and size in bytes of each frame in the file
+    frames: Vec<(u64, usize)>,
+}
+
+fn io_error(path: &Path, error: &std::io::Error) -> Error {
+    Error::InvalidParameter(format!("failed to read '{}': {}", path.display(), error))
+}
+
+/// Read exactly `buffer.len()` bytes from `file`, starting at `offset`, without
+/// using the file cursor. This allows multiple threads to read from the same
+/// file at once.
+#[cfg(unix)]
+fn read_exact_at(file: &File, buffer: &mut [u8], offset: u64) -> std::io::Result<()> {
+    use std::os::unix::fs::FileExt;
+    return file.read_exact_at(buffer, offset);
+}
+
+#[cfg(windows)]
+fn read_exact_at(file: &File, mut buffer: &mut [u8], mut offset: u64) -> std::io::Result<()> {
+    use std::os::windows::fs::FileExt;
+    while !buffer.is_empty() {
+        match file.seek_read(buffer, offset) {
+            Ok(0) => return Err(std::io::ErrorKind::UnexpectedEof.into()),
+            Ok(count) => {
+                buffer = &mut buffer[count..];
+                offset += count as u64;
+            }
+            Err(e) if e.kind() == std::io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    return Ok(());
+}
+
+impl TrajectoryReader {
+    /// Open the trajectory at `path`, guessing the format from the extension
+    pub fn open(path: impl AsRef<Path>) -> Result<TrajectoryReader, Error> {
+        let path = path.as_ref();
+        let format = TrajectoryFormat::from_extension(path)?;
+        return TrajectoryReader::with_format(path, format);
+    }
+
+    /// Open the trajectory at `path`, using the given `format`
+    pub fn with_format(path: impl AsRef<Path>, format: TrajectoryFormat) -> Result<TrajectoryReader, Error> {
+        let path = path.as_ref().to_path_buf();
+        let file = File::open(&path).map_err(|e| io_error(&path, &e))?;
+        let frames = match format {
+            TrajectoryFormat::ExtendedXYZ => index_xyz(&path, &file)?,
+            TrajectoryFormat::Binary => index_binary(&path, &file)?,
+        };
+
+        return Ok(TrajectoryReader { path, file: Arc::new(file), format, frames });
+    }
+
+    /// Get the number of frames in this trajectory
+    pub fn len(&self) -> usize {
+        self.frames.len()
+    }
+
+    /// Check if this trajectory contains any frame
+    pub fn is_empty(&self) -> bool {
+        self.frames.is_empty()
+    }
+
+    /// Read the frame at index `step` in this trajectory
+    pub fn read(&self, step: usize) -> Result<SimpleSystem, Error> {
+        let &(offset, size) = self.frames.get(step).ok_or_else(|| Error::InvalidParameter(format!(
+            "out of bounds frame index {} for '{}', which contains {} frames",
+            step, self.path.display(), self.frames.len()
+        )))?;
+
+        let mut buffer = vec![0; size];
+        read_exact_at(&self.file, &mut buffer, offset).map_err(|e| io_error(&self.path, &e))?;
+
+        return match self.format {
+            TrajectoryFormat::ExtendedXYZ => parse_xyz_frame(&buffer),
+            TrajectoryFormat::Binary => parse_binary_frame(&buffer),
+        }.map_err(|e| Error::InvalidParameter(format!(
+            "invalid frame {} in '{}': {}", step, self.path.display(), e
+        )));
+    }
+
+    /// Read all frames with index in `steps`, reading and parsing the frames
+    /// in parallel
+    pub fn read_range(&self, steps: Range<usize>) -> Result<Vec<SimpleSystem>, Error> {
+        return steps.into_par_iter().map(|step| self.read(step)).collect();
+    }
+}
+
+/// Write the given `systems` to `path`, using the binary format described in
+/// `TrajectoryFormat::Binary`.
+pub fn write_binary_trajectory(path: impl AsRef<Path>, systems: &[Box<dyn System>]) -> Result<(), Error> {
+    let path = path.as_ref();
+    let file = File::create(path).map_err(|e| io_error(path, &e))?;
+    let mut writer = std::io::BufWriter::new(file);
+
+    let mut write = |data: &[u8]| writer.write_all(data).map_err(|e| io_error(path, &e));
+
+    write(BINARY_MAGIC)?;
+    for system in systems {
+        let types = system.types()?;
+        let positions = system.positions()?;
+
+        write(&(types.len() as u64).to_le_bytes())?;
+        for row in system.cell()?.matrix().iter() {
+            for value in row {
+                write(&value.to_le_bytes())?;
+            }
+        }
+
+        for atomic_type in types {
+            write(&atomic_type.to_le_bytes())?;
+        }
+
+        for position in positions {
+            for value in [position[0], position[1], position[2]] {
+                write(&value.to_le_bytes())?;
+            }
+        }
+    }
+
+    writer.flush().map_err(|e| io_error(path, &e))?;
+    return Ok(());
+}
+
+/// Find the offset and size of each frame in a binary trajectory file
+fn index_binary(path: &Path, mut file: &File) -> Result<Vec<(u64, usize)>, Error> {
+    let file_size = file.metadata().map_err(|e| io_error(path, &e))?.len();
+
+    let mut magic = [0; 8];
+    file.read_exact(&mut magic).map_err(|e| io_error(path, &e))?;
+    if &magic != BINARY_MAGIC {
+        return Err(Error::InvalidParameter(format!(
+            "'{}' is not a featomic binary trajectory file", path.display()
+        )));
+    }
+
+    let mut frames = Vec::new();
+    let mut offset = BINARY_MAGIC.len() as u64;
+    while offset < file_size {
+        let mut n_atoms = [0; 8];
+        file.seek(SeekFrom::Start(offset)).map_err(|e| io_error(path, &e))?;
+        file.read_exact(&mut n_atoms).map_err(|e| io_error(path, &e))?;
+        let n_atoms = u64::from_le_bytes(n_atoms);
+
+        // `offset < file_size` here, and a frame is never larger than the
+        // remaining part of the file
+        let size = n_atoms.checked_mul(4 + 3 * 8)
+            .and_then(|size| size.checked_add(BINARY_FRAME_HEADER))
+            .filter(|&size| size <= file_size - offset)
+            .ok_or_else(|| Error::InvalidParameter(format!(
+                "'{}' is truncated: frame {} is incomplete", path.display(), frames.len()
+            )))?;
+
+        let buffer_size = usize::try_from(size).map_err(|_| Error::InvalidParameter(format!(
+            "frame {} in '{}' is too large to be read on this platform", frames.len(), path.display()
+        )))?;
+
+        frames.push((offset, buffer_size));
+        offset += size;
+    }
+
+    return Ok(frames);
+}
+
+fn parse_binary_frame(buffer: &[u8]) -> Result<SimpleSystem, String> {
+    let read_f64 = |offset: usize| {
+        let bytes = buffer[offset..offset + 8].try_into().expect("slice should have 8 bytes");
+        f64::from_le_bytes(bytes)
+    };
+
+    let header_size = BINARY_FRAME_HEADER as usize;
+    if buffer.len() < header_size {
+        return Err(format!("expected at least {} bytes, got {}", header_size, buffer.len()));
+    }
+
+    let n_atoms = u64::from_le_bytes(buffer[..8].try_into().expect("slice should have 8 bytes"));
+    let expected_size = usize::try_from(n_atoms).ok()
+        .and_then(|n_atoms| n_atoms.checked_mul(4 + 3 * 8))
+        .and_then(|size| size.checked_add(header_size));
+    if expected_size != Some(buffer.len()) {
+        return Err(format!("invalid number of atoms ({}) for a frame of {} bytes", n_atoms, buffer.len()));
+    }
+    // this can not overflow since the frame size fits in an usize
+    let n_atoms = n_atoms as usize;
+
+    let mut matrix = [[0.0; 3]; 3];
+    for i in 0..3 {
+        for j in 0..3 {
+            matrix[i][j] = read_f64(8 + 8 * (3 * i + j));
+        }
+    }
+
+    let types_start = header_size;
+    let types = buffer[types_start..types_start + 4 * n_atoms]
+        .chunks_exact(4)
+        .map(|bytes| i32::from_le_bytes(bytes.try_into().expect("chunk should have 4 bytes")))
+        .collect();
+
+    let positions_start = types_start + 4 * n_atoms;
+    let positions = (0..n_atoms).map(|i| {
+        let offset = positions_start + 24 * i;
+        Vector3D::new(read_f64(offset), read_f64(offset + 8), read_f64(offset + 16))
+    }).collect();
+
+    let cell = cell_from_matrix(matrix)?;
+    return Ok(SimpleSystem::from_arrays(cell, types, positions));
+}
+
+/// Find the offset and size of each frame in an XYZ file, only reading the
+/// number of atoms of each frame and skipping over the other lines.
+fn index_xyz(path: &Path, file: &File) -> Result<Vec<(u64, usize)>, Error> {
+    let mut reader = BufReader::with_capacity(1 << 20, file);
+    let mut line = Vec::new();
+    let mut frames = Vec::new();
+    let mut offset = 0;
+
+    let mut read_line = |line: &mut Vec<u8>| -> Result<usize, Error> {
+        line.clear();
+        reader.read_until(b'\n', line).map_err(|e| io_error(path, &e))
+    };
+
+    loop {
+        let start = offset;
+        let size = read_line(&mut line)?;
+        if size == 0 {
+            break;
+        }
+        offset += size as u64;
+
+        let header = std::str::from_utf8(&line).map_err(Error::from)?.trim();
+        if header.is_empty() {
+            // allow empty lines at the end of the file
+            continue;
+        }
+
+        let n_atoms = header.parse::<usize>().map_err(|_| Error::InvalidParameter(format!(
+            "invalid XYZ file '{}': expected a number of atoms for frame {}, got '{}'",
+            path.display(), frames.len(), header
+        )))?;
+
+        // comment line, then one line per atom
+        for _ in 0..(n_atoms + 1) {
+            let size = read_line(&mut line)?;
+            if size == 0 {
+                return Err(Error::InvalidParameter(format!(
+                    "invalid XYZ file '{}': frame {} is incomplete",
+                    path.display(), frames.len()
+                )));
+            }
+            offset += size as u64;
+        }
+
+        frames.push((start, (offset - start) as usize));
+    }
+
+    return Ok(frames);
+}
+
+fn parse_xyz_frame(buffer: &[u8]) -> Result<SimpleSystem, String> {
+    let content = std::str::from_utf8(buffer).map_err(|e| e.to_string())?;
+    let mut lines = content.lines();
+
+    let n_atoms = lines.next()
+        .and_then(|line| line.trim().parse::<usize>().ok())
+        .ok_or_else(|| "missing number of atoms".to_string())?;
+
+    let comment = lines.next().ok_or_else(|| "missing comment line".to_string())?;
+    let comment = extxyz_comment(comment);
+    let cell = extxyz_cell(&comment)?;
+    let columns = extxyz_columns(&comment)?;
+
+    let mut types = Vec::with_capacity(n_atoms);
+    let mut positions = Vec::with_capacity(n_atoms);
+    let mut fields = Vec::with_capacity(columns.count);
+    for (atom_i, line) in lines.take(n_atoms).enumerate() {
+        fields.clear();
+        fields.extend(line.split_whitespace());
+        if fields.len() < columns.count {
+            return Err(format!(
+                "expected {} values for atom {}, got {}", columns.count, atom_i, fields.len()
+            ));
+        }
+
+        types.push(atomic_type(fields[columns.species])?);
+
+        let mut position = [0.0; 3];
+        for (value, field) in position.iter_mut().zip(&fields[columns.positions..columns.positions + 3]) {
+            *value = field.parse().map_err(|_| format!("invalid position '{}' for atom {}", field, atom_i))?;
+        }
+        positions.push(Vector3D::new(position[0], position[1], position[2]));
+    }
+
+    if types.len() != n_atoms {
+        return Err(format!("expected {} atoms, got {}", n_atoms, types.len()));
+    }
+
+    return Ok(SimpleSystem::from_arrays(cell, types, positions));
+}
+
+/// Parse the `key=value` pairs in an extended XYZ comment line. Keys without
+/// values are ignored.
+fn extxyz_comment(comment: &str) -> Vec<(String, String)> {
+    let mut result = Vec::new();
+
+    let mut chars = comment.chars().peekable();
+    loop {
+        while chars.next_if(|c| c.is_whitespace()).is_some() {}
+        if chars.peek().is_none() {
+            break;
+        }
+
+        let key = std::iter::from_fn(|| chars.next_if(|&c| c != '=' && !c.is_whitespace())).collect::<String>();
+        if chars.next_if_eq(&'=').is_none() {
+            // key without a value, ignore it
+            continue;
+        }
+
+        let value = if chars.next_if_eq(&'"').is_some() {
+            let value = std::iter::from_fn(|| chars.next_if(|&c| c != '"')).collect::<String>();
+            chars.next();
+            value
+        } else {
+            std::iter::from_fn(|| chars.next_if(|&c| !c.is_whitespace())).collect::<String>()
+        };
+
+        result.push((key, value));
+    }
+
+    return result;
+}
+
+/// Get the value associated with `key` (ignoring case) in the parsed comment
+fn extxyz_value<'a>(comment: &'a [(String, String)], key: &str) -> Option<&'a str> {
+    return comment.iter()
+        .find(|(k, _)| k.eq_ignore_ascii_case(key))
+        .map(|(_, value)| value.as_str());
+}
+
+/// Extract the unit cell from the parsed extended XYZ comment line
+fn extxyz_cell(comment: &[(String, String)]) -> Result<UnitCell, String> {
+    if let Some(pbc) = extxyz_value(comment, "pbc") {
+        let pbc = pbc.split_whitespace().map(|v| matches!(v, "T" | "t" | "True" | "true" | "1")).collect::<Vec<_>>();
+        if pbc.iter().all(|&v| !v) {
+            return Ok(UnitCell::infinite());
+        } else if !pbc.iter().all(|&v| v) {
+            return Err("mixed periodic boundary conditions are not supported".into());
+        }
+    }
+
+    let lattice = match extxyz_value(comment, "lattice") {
+        Some(lattice) => lattice,
+        None => return Ok(UnitCell::infinite()),
+    };
+
+    let values = lattice.split_whitespace()
+        .map(|v| v.parse::<f64>().map_err(|_| format!("invalid Lattice value '{}'", v)))
+        .collect::<Result<Vec<_>, _>>()?;
+
+    if values.len() != 9 {
+        return Err(format!("expected 9 values in Lattice, got {}", values.len()));
+    }
+
+    let matrix = [
+        [values[0], values[1], values[2]],
+        [values[3], values[4], values[5]],
+        [values[6], values[7], values[8]],
+    ];
+
+    return cell_from_matrix(matrix);
+}
+
+/// Position of the columns we need in the atom lines of an extended XYZ frame
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct XYZColumns {
+    /// index of the column containing the atomic species
+    species: usize,
+    /// index of the first of the three columns containing the positions
+    positions: usize,
+    /// total number of columns
+    count: usize,
+}
+
+/// Find the species and positions columns from the `Properties` entry of the
+/// parsed extended XYZ comment line. Without `Properties`, the columns are
+/// assumed to be `species:S:1:pos:R:3`.
+fn extxyz_columns(comment: &[(String, String)]) -> Result<XYZColumns, String> {
+    let properties = match extxyz_value(comment, "properties") {
+        Some(properties) => properties,
+        None => return Ok(XYZColumns { species: 0, positions: 1, count: 4 }),
+    };
+
+    let fields = properties.split(':').collect::<Vec<_>>();
+    if fields.len() % 3 != 0 {
+        return Err(format!("invalid Properties '{}': expected name:type:count triplets", properties));
+    }
+
+    let mut species = None;
+    let mut positions = None;
+    let mut count = 0;
+    for property in fields.chunks_exact(3) {
+        let (name, kind, size) = (property[0], property[1], property[2]);
+        if !matches!(kind, "S" | "R" | "I" | "L") {
+            return Err(format!("invalid type '{}' for '{}' in Properties", kind, name));
+        }
+
+        let size = match size.parse::<usize>() {
+            Ok(size) if size > 0 => size,
+            _ => return Err(format!("invalid number of columns '{}' for '{}' in Properties", size, name)),
+        };
+
+        if name == "species" {
+            if kind != "S" || size != 1 {
+                return Err(format!("unsupported species property in Properties: expected species:S:1, got species:{}:{}", kind, size));
+            }
+            species = Some(count);
+        } else if name == "pos" {
+            if kind != "R" || size != 3 {
+                return Err(format!("unsupported pos property in Properties: expected pos:R:3, got pos:{}:{}", kind, size));
+            }
+            positions = Some(count);
+        }
+
+        count += size;
+    }
+
+    return Ok(XYZColumns {
+        species: species.ok_or_else(|| "missing species in Properties".to_string())?,
+        positions: positions.ok_or_else(|| "missing pos in Properties".to_string())?,
+        count: count,
+    });
+}
+
+fn cell_from_matrix(matrix: [[f64; 3]; 3]) -> Result<UnitCell, String> {
+    let matrix = Matrix3::new(matrix);
+    if matrix != Matrix3::zero() && matrix.determinant().abs() <= 1e-6 {
+        return Err("the cell matrix is not invertible".into());
+    }
+    return Ok(UnitCell::from(matrix));
+}
+
+/// Get the atomic type from the name of an atom, which can either be an
+/// integer or an element symbol
+fn atomic_type(name: &str) -> Result<i32, String> {
+    if let Ok(value) = name.parse::<i32>() {
+        return Ok(value);
+    }
+
+    return ELEMENTS.iter()
+        .position(|&symbol| symbol.eq_ignore_ascii_case(name))
+        .map(|index| index as i32 + 1)
+        .ok_or_else(|| format!("unknown element '{}'", name));
+}
+
+const ELEMENTS: [&str; 118] = [
+    "H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne", "Na", "Mg", "Al",
+    "Si", "P", "S", "Cl", "Ar", "K", "Ca", "Sc", "Ti", "V", "Cr", "Mn", "Fe",
+    "Co", "Ni", "Cu", "Zn", "Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr",
+    "Y", "Zr", "Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn",
+    "Sb", "Te", "I", "Xe", "Cs", "Ba", "La", "Ce", "Pr", "Nd", "Pm", "Sm",
+    "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb", "Lu", "Hf", "Ta", "W",
+    "Re", "Os", "Ir", "Pt", "Au", "Hg", "Tl", "Pb", "Bi", "Po", "At", "Rn",
+    "Fr", "Ra", "Ac", "Th", "Pa", "U", "Np", "Pu", "Am", "Cm", "Bk", "Cf",
+    "Es", "Fm", "Md", "No", "Lr", "Rf", "Db", "Sg", "Bh", "Hs", "Mt", "Ds",
+    "Rg", "Cn", "Nh", "Fl", "Mc", "Lv", "Ts", "Og",
+];
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::systems::test_utils::test_systems;
+
+    fn temporary_path(name: &str) -> PathBuf {
+        let mut path = std::env::temp_dir();
+        path.push(format!("featomic-{}-{}", std::process::id(), name));
+        return path;
+    }
+
+    #[test]
+    fn extended_xyz() {
+        let path = temporary_path("test.xyz");
+        std::fs::write(&path, "\
+3
+Lattice=\"10.0 0.0 0.0 0.0 10.0 0.0 0.0 0.0 10.0\" Properties=species:S:1:pos:R:3 pbc=\"T T T\"
+O 0.0 0.0 0.0
+H 0.0 0.75 -0.58
+H 0.0 -0.75 -0.58
+2
+Properties=species:S:1:pos:R:3
+C 1.0 2.0 3.0
+-42 4.0 5.0 6.0
+").unwrap();
+
+        let trajectory = TrajectoryReader::open(&path).unwrap();
+        assert_eq!(trajectory.len(), 2);
+
+        let systems = trajectory.read_range(0..2).unwrap();
+        assert_eq!(systems[0].types().unwrap(), [8, 1, 1]);
+        assert_eq!(systems[0].positions().unwrap()[1], Vector3D::new(0.0, 0.75, -0.58));
+        assert_eq!(systems[0].cell().unwrap().matrix(), UnitCell::cubic(10.0).matrix());
+
+        assert_eq!(systems[1].types().unwrap(), [6, -42]);
+        assert_eq!(systems[1].positions().unwrap()[1], Vector3D::new(4.0, 5.0, 6.0));
+        assert!(systems[1].cell().unwrap().is_infinite());
+
+        let error = trajectory.read(2).unwrap_err();
+        assert!(error.to_string().contains("out of bounds frame index 2"));
+
+        drop(trajectory);
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[test]
+    fn extended_xyz_properties() {
+        let frame = "\
+2
+Properties=id:I:1:forces:R:3:pos:R:3:species:S:1 pbc=\"F F F\"
+1 0.1 0.2 0.3 1.0 2.0 3.0 O
+2 0.4 0.5 0.6 4.0 5.0 6.0 H
+";
+        let system = parse_xyz_frame(frame.as_bytes()).unwrap();
+        assert_eq!(system.types().unwrap(), [8, 1]);
+        assert_eq!(system.positions().unwrap()[1], Vector3D::new(4.0, 5.0, 6.0));
+
+        let error = parse_xyz_frame(b"1\nProperties=species:S:1:pos:R:3\nO 0.0 0.0\n").unwrap_err();
+        assert_eq!(error, "expected 4 values for atom 0, got 3");
+
+        let error = parse_xyz_frame(b"1\nProperties=species:S:1:pos:R:2\nO 0.0 0.0\n").unwrap_err();
+        assert_eq!(error, "unsupported pos property in Properties: expected pos:R:3, got pos:R:2");
+
+        let error = parse_xyz_frame(b"1\nProperties=species:S:1:velo:R:3\nO 0.0 0.0 0.0\n").unwrap_err();
+        assert_eq!(error, "missing pos in Properties");
+
+        let error = parse_xyz_frame(b"1\nProperties=species:S:1:pos:X:3\nO 0.0 0.0 0.0\n").unwrap_err();
+        assert_eq!(error, "invalid type 'X' for 'pos' in Properties");
+
+        let error = parse_xyz_frame(b"1\nProperties=species:S:1:pos:R\nO 0.0 0.0 0.0\n").unwrap_err();
+        assert_eq!(error, "invalid Properties 'species:S:1:pos:R': expected name:type:count triplets");
+    }
+
+    #[test]
+    fn binary() {
+        let path = temporary_path("test.ftraj");
+        let systems = test_systems(&["water", "CH", "methane"]);
+        write_binary_trajectory(&path, &systems).unwrap();
+
+        let trajectory = TrajectoryReader::open(&path).unwrap();
+        assert_eq!(trajectory.len(), 3);
+
+        let read = trajectory.read_range(0..3).unwrap();
+        for (expected, actual) in systems.iter().zip(&read) {
+            assert_eq!(expected.types().unwrap(), actual.types().unwrap());
+            assert_eq!(expected.positions().unwrap(), actual.positions().unwrap());
+            assert_eq!(expected.cell().unwrap().matrix(), actual.cell().unwrap().matrix());
+        }
+
+        drop(trajectory);
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[test]
+    fn binary_invalid_size() {
+        let path = temporary_path("invalid.ftraj");
+
+        // the size of this frame overflows u64
+        let mut content = BINARY_MAGIC.to_vec();
+        content.extend_from_slice(&(u64::MAX / 8).to_le_bytes());
+        content.extend_from_slice(&[0; 9 * 8]);
+        std::fs::write(&path, content).unwrap();
+
+        let error = TrajectoryReader::open(&path).unwrap_err();
+        assert!(error.to_string().contains("frame 0 is incomplete"));
+
+        std::fs::remove_file(&path).unwrap();
+
+        let error = parse_binary_frame(&[0; 8]).unwrap_err();
+        assert_eq!(error, "expected at least 80 bytes, got 8");
+
+        let mut frame = (u64::MAX / 4).to_le_bytes().to_vec();
+        frame.extend_from_slice(&[0; 9 * 8]);
+        let error = parse_binary_frame(&frame).unwrap_err();
+        assert!(error.starts_with("invalid number of atoms"));
+    }
+}
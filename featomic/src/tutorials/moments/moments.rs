@@ -100,7 +100,7 @@ impl CalculatorBase for GeometricMoments {
     }
 
     // [compute]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert_eq!(descriptor.keys().names(), ["center_type", "neighbor_type"]);
         assert!(descriptor.keys().count() > 0);
 
@@ -262,7 +262,7 @@ mod tests {
     #[test]
     fn zeroth_moment() {
         // Create a Calculator wrapping a GeometricMoments instance
-        let mut calculator = Calculator::from(Box::new(GeometricMoments{
+        let calculator = Calculator::from(Box::new(GeometricMoments{
             cutoff: 2.5,
             max_moment: 0,
         }) as Box<dyn CalculatorBase>);
@@ -355,7 +355,7 @@ mod more_tests {
     // [partial-test]
     #[test]
     fn compute_partial() {
-        let mut calculator = Calculator::from(Box::new(GeometricMoments{
+        let calculator = Calculator::from(Box::new(GeometricMoments{
             cutoff: 2.5,
             max_moment: 6,
         }) as Box<dyn CalculatorBase>);
@@ -389,7 +389,7 @@ mod more_tests {
     // [finite-differences-test]
     #[test]
     fn finite_differences() {
-        let mut calculator = Calculator::from(Box::new(GeometricMoments{
+        let calculator = Calculator::from(Box::new(GeometricMoments{
             cutoff: 2.5,
             max_moment: 7,
         }) as Box<dyn CalculatorBase>);
@@ -61,7 +61,7 @@ impl CalculatorBase for GeometricMoments {
         todo!()
     }
 
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         todo!()
     }
 }
@@ -127,7 +127,7 @@ impl CalculatorBase for GeometricMoments {
     }
     // [CalculatorBase::properties]
 
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         todo!()
     }
 
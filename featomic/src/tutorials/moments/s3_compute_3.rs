@@ -58,7 +58,7 @@ impl CalculatorBase for GeometricMoments {
     }
 
     // [compute]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         assert_eq!(descriptor.keys().names(), ["center_type", "neighbor_type"]);
 
         for (system_i, system) in systems.iter_mut().enumerate() {
@@ -65,7 +65,7 @@ impl CalculatorBase for GeometricMoments {
     }
 
     // [compute]
-    fn compute(&mut self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
+    fn compute(&self, systems: &mut [Box<dyn System>], descriptor: &mut TensorMap) -> Result<(), Error> {
         // ...
         for (system_i, system) in systems.iter_mut().enumerate() {
             // ...
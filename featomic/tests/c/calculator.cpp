@@ -128,6 +128,54 @@ TEST_CASE("calculator creation errors") {
     CHECK(std::string(featomic_last_error()) == "json error: invalid type: string \"532\", expected f64 at line 2 column 23");
 }
 
+TEST_CASE("registered tabulated basis") {
+    // 3 points with 1 basis function: position, value, derivative
+    auto points = std::vector<double>{
+        0.0, 1.0, -1.0,
+        2.0, 0.5, -0.5,
+        4.0, 0.0, 0.0,
+    };
+    CHECK_SUCCESS(featomic_register_tabulated_basis("c-api-basis", points.data(), 3, 1, nullptr));
+
+    const char* HYPERS_JSON = R"({
+        "cutoff": {
+            "radius": 4.0,
+            "smoothing": {"type": "Step"}
+        },
+        "density": {"type": "DiracDelta"},
+        "basis": {
+            "type": "TensorProduct",
+            "max_angular": 2,
+            "radial": {"type": "Tabulated", "registered": "c-api-basis"}
+        }
+    })";
+    auto* calculator = featomic_calculator("spherical_expansion", HYPERS_JSON);
+    REQUIRE(calculator != nullptr);
+    featomic_calculator_free(calculator);
+
+    auto status = featomic_register_tabulated_basis("c-api-basis", points.data(), 1, 1, nullptr);
+    CHECK(status == FEATOMIC_INVALID_PARAMETER_ERROR);
+    CHECK(std::string(featomic_last_error()) == "invalid parameter: we need at least two points to define a 'Tabulated' radial basis");
+
+    HYPERS_JSON = R"({
+        "cutoff": {
+            "radius": 4.0,
+            "smoothing": {"type": "Step"}
+        },
+        "density": {"type": "DiracDelta"},
+        "basis": {
+            "type": "TensorProduct",
+            "max_angular": 2,
+            "radial": {"type": "Tabulated", "registered": "not-there"}
+        }
+    })";
+    calculator = featomic_calculator("spherical_expansion", HYPERS_JSON);
+    CHECK(calculator == nullptr);
+    CHECK_THAT(std::string(featomic_last_error()), Catch::Matchers::Contains(
+        "no tabulated radial basis registered with the name 'not-there'"
+    ));
+}
+
 TEST_CASE("Compute descriptor") {
     const char* HYPERS_JSON = R"({
         "cutoff": 3.0,
@@ -1,5 +1,6 @@
 #include <vector>
 #include <string>
+#include <thread>
 
 #include "featomic.hpp"
 #include "catch.hpp"
@@ -465,3 +466,341 @@ TEST_CASE("Compute descriptor") {
         ));
     }
 }
+
+TEST_CASE("Compressed positions gradients") {
+    const char* HYPERS_JSON = R"({
+        "cutoff": 3.0, "delta": 4, "name": ""
+    })";
+
+    auto systems = std::vector<TestSystem>{TestSystem()};
+    auto calculator = featomic::Calculator("dummy_calculator", HYPERS_JSON);
+
+    auto options = featomic::CalculationOptions();
+    options.gradients.push_back("positions");
+    auto descriptor = calculator.compute(systems, options);
+
+    // H block
+    auto block = descriptor.block_by_id(0);
+    auto gradient = block.gradient("positions");
+    auto compressed = featomic::CompressedPositionsGradient(gradient, block.samples().count());
+
+    CHECK(compressed.samples_count() == 3);
+    CHECK(compressed.gradient_samples_count() == 8);
+    CHECK(compressed.components_size() == 3);
+    CHECK(compressed.properties_count() == 2);
+
+    // the first property is always zero in the gradients of the dummy
+    // calculator, so only the second one is stored
+    CHECK(compressed.stored_size() == 8 * 3 * 1);
+    for (uintptr_t grad_sample_i = 0; grad_sample_i < 8; grad_sample_i++) {
+        CHECK(compressed.properties_ranges(grad_sample_i) == std::vector<std::pair<uintptr_t, uintptr_t>>{{1, 2}});
+    }
+
+    CHECK(compressed.gradient_samples_for(0) == std::pair<uintptr_t, uintptr_t>(0, 3));
+    CHECK(compressed.gradient_samples_for(1) == std::pair<uintptr_t, uintptr_t>(3, 6));
+    CHECK(compressed.gradient_samples_for(2) == std::pair<uintptr_t, uintptr_t>(6, 8));
+
+    CHECK(compressed.system(4) == 0);
+    CHECK(compressed.atom(4) == 2);
+
+    CHECK(compressed.get(4, 1, 0) == 0.0);
+    CHECK(compressed.get(4, 1, 1) == 1.0);
+    CHECK_THROWS_WITH(
+        compressed.get(4, 3, 1),
+        "out of bounds access in CompressedPositionsGradient"
+    );
+
+    auto values_gradient = std::vector<double>(3 * 2, 1.0);
+    auto positions_gradient = std::vector<double>(4 * 3, 0.0);
+    compressed.vjp(values_gradient.data(), {0}, positions_gradient.data());
+
+    CHECK(positions_gradient == std::vector<double>{
+        1.0, 1.0, 1.0,
+        2.0, 2.0, 2.0,
+        3.0, 3.0, 3.0,
+        2.0, 2.0, 2.0,
+    });
+}
+
+TEST_CASE("Compressed positions gradients with multiple ranges") {
+    auto xyz = metatensor::Labels({"xyz"}, {{0}, {1}, {2}});
+    auto gradient = metatensor::TensorBlock(
+        std::make_unique<metatensor::SimpleDataArray<double>>(
+            std::vector<uintptr_t>{2, 3, 5},
+            std::vector<double>{
+                // first gradient sample, properties 0, 3 and 4 are non-zero
+                1.0, 0.0, 0.0, 2.0, 0.0,
+                0.0, 0.0, 0.0, 3.0, 4.0,
+                5.0, 0.0, 0.0, 0.0, 0.0,
+                // second gradient sample, all values are zero
+                0.0, 0.0, 0.0, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.0, 0.0,
+            }
+        ),
+        metatensor::Labels({"sample", "system", "atom"}, {{0, 0, 1}, {0, 0, 2}}),
+        std::vector<metatensor::Labels>{xyz},
+        metatensor::Labels({"property"}, {{0}, {1}, {2}, {3}, {4}})
+    );
+
+    auto compressed = featomic::CompressedPositionsGradient(gradient, 1);
+    CHECK(compressed.stored_size() == 3 * 3);
+    CHECK(compressed.properties_ranges(0) == std::vector<std::pair<uintptr_t, uintptr_t>>{{0, 1}, {3, 5}});
+    CHECK(compressed.properties_ranges(1).empty());
+
+    CHECK(compressed.get(0, 0, 0) == 1.0);
+    CHECK(compressed.get(0, 0, 1) == 0.0);
+    CHECK(compressed.get(0, 1, 4) == 4.0);
+    CHECK(compressed.get(0, 2, 0) == 5.0);
+    CHECK(compressed.get(1, 1, 3) == 0.0);
+
+    auto values_gradient = std::vector<double>{1.0, 1.0, 1.0, 1.0, 1.0};
+    auto positions_gradient = std::vector<double>(3 * 3, 0.0);
+    compressed.vjp(values_gradient.data(), {0}, positions_gradient.data());
+
+    CHECK(positions_gradient == std::vector<double>{
+        0.0, 0.0, 0.0,
+        3.0, 7.0, 5.0,
+        0.0, 0.0, 0.0,
+    });
+}
+
+TEST_CASE("Compute descriptor in chunks") {
+    const char* HYPERS_JSON = R"({
+        "cutoff": 3.0, "delta": 4, "name": ""
+    })";
+
+    auto systems = std::vector<TestSystem>{TestSystem(), TestSystem(), TestSystem()};
+    auto calculator = featomic::Calculator("dummy_calculator", HYPERS_JSON);
+
+    SECTION("one system per chunk") {
+        // the callback runs on a separate thread, so we only collect the
+        // results there and check them from the main thread
+        auto chunks = std::vector<std::pair<uintptr_t, uintptr_t>>();
+        auto descriptors = std::vector<metatensor::TensorMap>();
+        calculator.compute_chunks(systems.begin(), systems.end(), 1,
+            [&](uintptr_t first_system, uintptr_t systems_count, metatensor::TensorMap descriptor) {
+                chunks.emplace_back(first_system, systems_count);
+                descriptors.emplace_back(std::move(descriptor));
+            }
+        );
+
+        auto expected = std::vector<std::pair<uintptr_t, uintptr_t>>{{0, 1}, {1, 1}, {2, 1}};
+        CHECK(chunks == expected);
+
+        REQUIRE(descriptors.size() == 3);
+        for (auto& descriptor: descriptors) {
+            CHECK(descriptor.keys() == metatensor::Labels(
+                {"center_type"},
+                {{1}, {6}}
+            ));
+
+            auto block = descriptor.block_by_id(1);
+            CHECK(block.samples() == metatensor::Labels(
+                {"system", "atom"},
+                {{0, 0}}
+            ));
+        }
+    }
+
+    SECTION("all systems in a single chunk") {
+        auto chunks = std::vector<std::pair<uintptr_t, uintptr_t>>();
+        calculator.compute_chunks(systems.begin(), systems.end(), 1024 * 1024 * 1024,
+            [&](uintptr_t first_system, uintptr_t systems_count, metatensor::TensorMap /*descriptor*/) {
+                chunks.emplace_back(first_system, systems_count);
+            }
+        );
+
+        // the first chunk always contains a single system, to estimate the
+        // memory used per atom
+        auto expected = std::vector<std::pair<uintptr_t, uintptr_t>>{{0, 1}, {1, 2}};
+        CHECK(chunks == expected);
+    }
+
+    SECTION("errors in callback") {
+        CHECK_THROWS_WITH(
+            calculator.compute_chunks(systems.begin(), systems.end(), 1,
+                [](uintptr_t, uintptr_t, metatensor::TensorMap) {
+                    throw std::runtime_error("oops");
+                }
+            ),
+            "oops"
+        );
+    }
+}
+
+TEST_CASE("Concurrent compute") {
+    const char* HYPERS_JSON = R"({
+        "cutoff": {
+            "radius": 3.0,
+            "smoothing": {"type": "ShiftedCosine", "width": 0.5}
+        },
+        "density": {"type": "Gaussian", "width": 0.3},
+        "basis": {
+            "type": "TensorProduct",
+            "max_angular": 3,
+            "radial": {"type": "Gto", "max_radial": 3}
+        }
+    })";
+
+    // a single const calculator can be shared between multiple threads
+    const auto calculator = featomic::Calculator("spherical_expansion", HYPERS_JSON);
+
+    auto options = featomic::CalculationOptions();
+    options.gradients = {"positions"};
+
+    auto system = TestSystem();
+    auto expected = calculator.compute(system, options);
+
+    auto n_threads = 8;
+    auto threads = std::vector<std::thread>();
+    auto descriptors = std::vector<std::optional<metatensor::TensorMap>>(static_cast<size_t>(n_threads));
+    for (int thread_i = 0; thread_i < n_threads; thread_i++) {
+        threads.emplace_back([&, thread_i]() {
+            auto system = TestSystem();
+            for (int i = 0; i < 10; i++) {
+                descriptors[static_cast<size_t>(thread_i)] = calculator.compute(system, options);
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    for (auto& descriptor: descriptors) {
+        REQUIRE(descriptor->keys() == expected.keys());
+        for (uintptr_t block_i = 0; block_i < expected.keys().count(); block_i++) {
+            auto block = descriptor->block_by_id(block_i);
+            auto expected_block = expected.block_by_id(block_i);
+
+            CHECK(block.samples() == expected_block.samples());
+            CHECK(block.values() == expected_block.values());
+
+            auto gradient = block.gradient("positions");
+            auto expected_gradient = expected_block.gradient("positions");
+            CHECK(gradient.values() == expected_gradient.values());
+        }
+    }
+}
+
+TEST_CASE("Extract systems") {
+    SECTION("system is not the first sample dimension") {
+        // the single block neighbor list has the atomic types first
+        auto calculator = featomic::Calculator("neighbor_list", R"({
+            "cutoff": 2.0,
+            "full_neighbor_list": false,
+            "self_pairs": false,
+            "single_block": true
+        })");
+
+        auto options = featomic::CalculationOptions();
+        options.gradients = {"positions"};
+
+        auto systems = std::vector<TestSystem>{TestSystem(), TestSystem()};
+        auto descriptor = calculator.compute(systems, options);
+
+        auto single_system = std::vector<TestSystem>{TestSystem()};
+        auto expected = calculator.compute(single_system, options);
+
+        auto extracted = featomic::details::extract_systems(descriptor, 1, 2, {"positions"});
+        REQUIRE(extracted.keys() == expected.keys());
+
+        auto block = extracted.block_by_id(0);
+        auto expected_block = expected.block_by_id(0);
+        CHECK(block.samples() == expected_block.samples());
+        CHECK(block.values() == expected_block.values());
+
+        auto gradient = block.gradient("positions");
+        auto expected_gradient = expected_block.gradient("positions");
+        CHECK(gradient.samples() == expected_gradient.samples());
+        CHECK(gradient.values() == expected_gradient.values());
+    }
+
+    SECTION("missing system dimension") {
+        auto blocks = std::vector<metatensor::TensorBlock>();
+        blocks.emplace_back(
+            std::make_unique<metatensor::SimpleDataArray<double>>(std::vector<uintptr_t>{1, 1}),
+            metatensor::Labels({"structure"}, {{0}}),
+            std::vector<metatensor::Labels>{},
+            metatensor::Labels({"property"}, {{0}})
+        );
+        auto tensor = metatensor::TensorMap(metatensor::Labels({"key"}, {{0}}), std::move(blocks));
+
+        CHECK_THROWS_WITH(
+            featomic::details::extract_systems(tensor, 0, 1, {}),
+            "expected a \"system\" dimension in the samples, got [structure]"
+        );
+    }
+}
+
+TEST_CASE("Batched calculator") {
+    const char* HYPERS_JSON = R"({
+        "cutoff": 3.0, "delta": 4, "name": ""
+    })";
+
+    SECTION("concurrent requests") {
+        auto expected_options = featomic::CalculationOptions();
+        expected_options.gradients = {"positions"};
+        auto system = TestSystem();
+        auto expected = featomic::Calculator("dummy_calculator", HYPERS_JSON).compute(system, expected_options);
+
+        auto options = featomic::BatchingOptions();
+        options.max_latency = std::chrono::milliseconds(50);
+        options.max_batch_size = 4;
+        options.gradients = {"positions"};
+        auto batched = featomic::BatchedCalculator(
+            featomic::Calculator("dummy_calculator", HYPERS_JSON), options
+        );
+
+        auto n_threads = 8;
+        auto threads = std::vector<std::thread>();
+        auto descriptors = std::vector<std::optional<metatensor::TensorMap>>(static_cast<size_t>(n_threads));
+        for (int thread_i = 0; thread_i < n_threads; thread_i++) {
+            threads.emplace_back([&, thread_i]() {
+                auto system = TestSystem();
+                descriptors[static_cast<size_t>(thread_i)] = batched.compute(system);
+            });
+        }
+
+        for (auto& thread: threads) {
+            thread.join();
+        }
+
+        // how requests are grouped depends on thread scheduling, so only
+        // check the bounds given by max_batch_size
+        CHECK(batched.requests_count() == 8);
+        CHECK(batched.batches_count() >= 2);
+        CHECK(batched.batches_count() <= batched.requests_count());
+
+        for (auto& descriptor: descriptors) {
+            REQUIRE(descriptor->keys() == expected.keys());
+            for (uintptr_t block_i = 0; block_i < expected.keys().count(); block_i++) {
+                auto block = descriptor->block_by_id(block_i);
+                auto expected_block = expected.block_by_id(block_i);
+
+                CHECK(block.samples() == expected_block.samples());
+                CHECK(block.values() == expected_block.values());
+
+                auto gradient = block.gradient("positions");
+                auto expected_gradient = expected_block.gradient("positions");
+                CHECK(gradient.samples() == expected_gradient.samples());
+                CHECK(gradient.values() == expected_gradient.values());
+            }
+        }
+    }
+
+    SECTION("errors") {
+        auto options = featomic::BatchingOptions();
+        options.gradients = {"not-a-gradient"};
+        auto batched = featomic::BatchedCalculator(
+            featomic::Calculator("dummy_calculator", HYPERS_JSON), options
+        );
+
+        auto system = TestSystem();
+        CHECK_THROWS_WITH(
+            batched.compute(system),
+            "invalid parameter: unexpected gradient \"not-a-gradient\", should be one of \"positions\", \"cell\", or \"strain\""
+        );
+    }
+}
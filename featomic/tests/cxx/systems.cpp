@@ -1,6 +1,8 @@
 #include "featomic.hpp"
 #include "catch.hpp"
 
+#include "test_system.hpp"
+
 
 class BadSystem: public featomic::System {
 public:
@@ -46,3 +48,39 @@ TEST_CASE("systems errors") {
 
     CHECK_THROWS_WITH(calculator.compute(system), "unimplemented function 'types'");
 }
+
+class GhostSystem: public TestSystem {
+public:
+    uintptr_t local_size() const override {
+        return 2;
+    }
+};
+
+TEST_CASE("systems with ghost atoms") {
+    const char* HYPERS_JSON = R"({
+        "cutoff": 3.0,
+        "delta": 4,
+        "name": ""
+    })";
+
+    auto system = GhostSystem();
+    auto calculator = featomic::Calculator("dummy_calculator", HYPERS_JSON);
+
+    auto options = featomic::CalculationOptions();
+    options.gradients.push_back("positions");
+    auto descriptor = calculator.compute(system, options);
+
+    // only the first two atoms are local and get a sample
+    auto block = descriptor.block_by_id(0);
+    CHECK(block.samples() == metatensor::Labels(
+        {"system", "atom"},
+        {{0, 1}}
+    ));
+
+    // ghost atoms are still included as neighbors
+    auto gradient = block.gradient("positions");
+    CHECK(gradient.samples() == metatensor::Labels(
+        {"sample", "system", "atom"},
+        {{0, 0, 0}, {0, 0, 1}, {0, 0, 2}}
+    ));
+}
@@ -104,7 +104,7 @@ fn madelung() {
                     })
                 };
 
-                let mut calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
+                let calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
                     lode_parameters
                 ).unwrap()) as Box<dyn CalculatorBase>);
 
@@ -155,7 +155,7 @@ fn madelung_high_accuracy() {
             })
         };
 
-        let mut calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
+        let calculator = Calculator::from(Box::new(LodeSphericalExpansion::new(
             lode_parameters
         ).unwrap()) as Box<dyn CalculatorBase>);
 
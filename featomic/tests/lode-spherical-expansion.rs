@@ -19,7 +19,7 @@ fn values() {
 
         let (mut systems, parameters) = data::load_calculator_input(path);
 
-        let mut calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
+        let calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
         let descriptor = calculator.compute(&mut systems, Default::default()).expect("failed to run calculation");
 
         let keys_to_move = Labels::empty(vec!["center_type"]);
@@ -53,7 +53,7 @@ fn gradients() {
         let (mut systems, parameters) = data::load_calculator_input(path);
         let n_atoms = systems.iter().map(|s| s.size().unwrap()).sum();
 
-        let mut calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
+        let calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
 
         let options = CalculationOptions {
             gradients: &["positions"],
@@ -83,6 +83,43 @@ fn gradients() {
     }
 }
 
+#[test]
+fn concurrent() {
+    let mut path = PathBuf::from("lode-spherical-expansion");
+    path.push("exponent-1");
+    path.push("gradients-input.json");
+
+    let (mut systems, parameters) = data::load_calculator_input(&path);
+    let calculator = Calculator::new("lode_spherical_expansion", parameters).unwrap();
+
+    let options = CalculationOptions {
+        gradients: &["positions"],
+        ..Default::default()
+    };
+    let expected = calculator.compute(&mut systems, options).expect("failed to run calculation");
+
+    // run multiple calculations at the same time with the same calculator
+    std::thread::scope(|scope| {
+        let handles = (0..4).map(|_| scope.spawn(|| {
+            let (mut systems, _) = data::load_calculator_input(&path);
+            calculator.compute(&mut systems, options).expect("failed to run calculation")
+        })).collect::<Vec<_>>();
+
+        for handle in handles {
+            let descriptor = handle.join().expect("thread panicked");
+            assert_eq!(descriptor.keys(), expected.keys());
+            for (block, expected) in descriptor.blocks().iter().zip(expected.blocks()) {
+                assert_eq!(block.samples(), expected.samples());
+                assert_relative_eq!(block.values().to_array(), expected.values().to_array(), max_relative=1e-12);
+
+                let gradient = block.gradient("positions").unwrap();
+                let expected = expected.gradient("positions").unwrap();
+                assert_relative_eq!(gradient.values().to_array(), expected.values().to_array(), max_relative=1e-12);
+            }
+        }
+    });
+}
+
 fn sum_gradients(n_atoms: usize, gradients: TensorBlockRef<'_>) -> ArrayD<f64> {
     assert_eq!(gradients.samples().names(), &["sample", "system", "atom"]);
     let array = gradients.values().to_array();
@@ -3,7 +3,7 @@ use ndarray::{ArrayD, Axis, s};
 
 use metatensor::{Labels, TensorBlockRef};
 
-use featomic::{CalculationOptions, Calculator};
+use featomic::{CalculationOptions, Calculator, SimpleSystem, System, Vector3D};
 
 mod data;
 
@@ -11,7 +11,7 @@ mod data;
 fn values() {
     let (mut systems, parameters) = data::load_calculator_input("soap-power-spectrum-values-input.json");
 
-    let mut calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
+    let calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
     let descriptor = calculator.compute(&mut systems, Default::default()).expect("failed to run calculation");
 
     let keys_to_move = Labels::empty(vec!["center_type"]);
@@ -33,7 +33,7 @@ fn gradients() {
     let (mut systems, parameters) = data::load_calculator_input("soap-power-spectrum-gradients-input.json");
     let n_atoms = systems.iter().map(|s| s.size().unwrap()).sum();
 
-    let mut calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
+    let calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
     let options = CalculationOptions {
         gradients: &["positions", "strain", "cell"],
         ..Default::default()
@@ -77,3 +77,89 @@ fn sum_gradients(n_atoms: usize, gradients: TensorBlockRef<'_>) -> ArrayD<f64> {
 
     sum
 }
+
+#[test]
+fn incremental() {
+    let (mut systems, parameters) = data::load_calculator_input("soap-power-spectrum-gradients-input.json");
+    let calculator = Calculator::new("soap_power_spectrum", parameters).unwrap();
+
+    let mut previous_system = systems.swap_remove(0);
+
+    // move the first atom
+    let moved_atoms = [0];
+    let mut positions = previous_system.positions().unwrap().to_vec();
+    positions[0] += Vector3D::new(0.1, -0.2, 0.05);
+    let new_system = SimpleSystem::from_arrays(
+        previous_system.cell().unwrap(),
+        previous_system.types().unwrap().to_vec(),
+        positions,
+    );
+    let mut system = Box::new(new_system) as Box<dyn System>;
+
+    let gradients: [&[&str]; 2] = [&[], &["positions"]];
+    for gradients in gradients {
+        let options = CalculationOptions {
+            gradients: gradients,
+            ..Default::default()
+        };
+
+        let previous = calculator.compute(std::slice::from_mut(&mut previous_system), options).unwrap();
+        let updated = calculator.compute_incremental(
+            &mut system, &mut previous_system, previous, &moved_atoms, options
+        ).unwrap();
+        let expected = calculator.compute(std::slice::from_mut(&mut system), options).unwrap();
+
+        assert_eq!(updated.keys(), expected.keys());
+        for (updated, expected) in updated.blocks().iter().zip(expected.blocks()) {
+            assert_eq!(updated.samples(), expected.samples());
+            assert_relative_eq!(updated.values().to_array(), expected.values().to_array(), max_relative=1e-12);
+
+            for &parameter in gradients {
+                let updated = updated.gradient(parameter).unwrap();
+                let expected = expected.gradient(parameter).unwrap();
+                assert_eq!(updated.samples(), expected.samples());
+                assert_relative_eq!(updated.values().to_array(), expected.values().to_array(), max_relative=1e-12);
+            }
+        }
+    }
+}
+
+#[test]
+fn compute_many() {
+    let (mut systems, parameters) = data::load_calculator_input("soap-power-spectrum-gradients-input.json");
+
+    let mut other_parameters = serde_json::from_str::<serde_json::Value>(&parameters).unwrap();
+    other_parameters["density"]["center_atom_weight"] = serde_json::Value::from(0.5);
+    let other_parameters = serde_json::to_string(&other_parameters).unwrap();
+
+    let calculators = [
+        Calculator::new("soap_power_spectrum", parameters.clone()).unwrap(),
+        Calculator::new("soap_power_spectrum", other_parameters).unwrap(),
+        Calculator::new("soap_power_spectrum", parameters).unwrap(),
+        Calculator::new("atomic_composition", r#"{"per_system": false}"#.into()).unwrap(),
+    ];
+
+    let options = CalculationOptions {
+        gradients: &["positions"],
+        use_native_system: true,
+        ..Default::default()
+    };
+
+    let descriptors = Calculator::compute_many(&calculators.iter().collect::<Vec<_>>(), &mut systems, options).unwrap();
+    assert_eq!(descriptors.len(), calculators.len());
+
+    for (calculator, descriptor) in calculators.iter().zip(&descriptors) {
+        let expected = calculator.compute(&mut systems, options).unwrap();
+
+        assert_eq!(descriptor.keys(), expected.keys());
+        for (block, expected) in descriptor.blocks().iter().zip(expected.blocks()) {
+            assert_eq!(block.samples(), expected.samples());
+            assert_relative_eq!(block.values().to_array(), expected.values().to_array(), max_relative=1e-12);
+
+            let gradient = block.gradient("positions").unwrap();
+            let expected = expected.gradient("positions").unwrap();
+            assert_eq!(gradient.samples(), expected.samples());
+            assert_relative_eq!(gradient.values().to_array(), expected.values().to_array(), max_relative=1e-12);
+        }
+    }
+}
@@ -3,7 +3,7 @@ use ndarray::{ArrayD, Axis, s};
 
 use metatensor::{Labels, TensorBlockRef};
 
-use featomic::{CalculationOptions, Calculator};
+use featomic::{CalculationOptions, Calculator, DomainDecomposition};
 
 mod data;
 
@@ -11,7 +11,7 @@ mod data;
 fn values_no_pbc() {
     let (mut systems, parameters) = data::load_calculator_input("spherical-expansion-values-input.json");
 
-    let mut calculator = Calculator::new("spherical_expansion", parameters).unwrap();
+    let calculator = Calculator::new("spherical_expansion", parameters).unwrap();
     let descriptor = calculator.compute(&mut systems, Default::default()).expect("failed to run calculation");
 
     let keys_to_move = Labels::empty(vec!["center_type"]);
@@ -36,7 +36,7 @@ fn values_no_pbc() {
 fn values_pbc() {
     let (mut systems, parameters) = data::load_calculator_input("spherical-expansion-pbc-values-input.json");
 
-    let mut calculator = Calculator::new("spherical_expansion", parameters).unwrap();
+    let calculator = Calculator::new("spherical_expansion", parameters).unwrap();
     let descriptor = calculator.compute(&mut systems, Default::default()).expect("failed to run calculation");
 
     let keys_to_move = Labels::empty(vec!["center_type"]);
@@ -62,7 +62,7 @@ fn gradients() {
     let (mut systems, parameters) = data::load_calculator_input("spherical-expansion-gradients-input.json");
     let n_atoms = systems.iter().map(|s| s.size().unwrap()).sum();
 
-    let mut calculator = Calculator::new("spherical_expansion", parameters).unwrap();
+    let calculator = Calculator::new("spherical_expansion", parameters).unwrap();
 
     let options = CalculationOptions {
         gradients: &["positions", "strain", "cell"],
@@ -99,6 +99,40 @@ fn gradients() {
     assert_relative_eq!(array, expected, max_relative=1e-6);
 }
 
+#[test]
+fn distributed() {
+    let (mut systems, parameters) = data::load_calculator_input("spherical-expansion-gradients-input.json");
+    let calculator = Calculator::new("spherical_expansion", parameters).unwrap();
+
+    let options = CalculationOptions {
+        gradients: &["positions"],
+        ..Default::default()
+    };
+    let mut system = systems.swap_remove(0);
+    let expected = calculator.compute(std::slice::from_mut(&mut system), options).unwrap();
+
+    let decomposition = DomainDecomposition::new(&*system, 3, 5.5).unwrap();
+    let all_domains = decomposition.compute(&calculator, options).unwrap();
+
+    let shards = (0..decomposition.len())
+        .map(|domain| decomposition.compute_domain(&calculator, domain, options).unwrap())
+        .collect::<Vec<_>>();
+    let gathered = DomainDecomposition::gather(&shards, options.gradients).unwrap();
+
+    for descriptor in [all_domains, gathered] {
+        assert_eq!(descriptor.keys(), expected.keys());
+        for (block, expected) in descriptor.blocks().iter().zip(expected.blocks()) {
+            assert_eq!(block.samples(), expected.samples());
+            assert_relative_eq!(block.values().to_array(), expected.values().to_array(), epsilon=1e-12, max_relative=1e-10);
+
+            let gradient = block.gradient("positions").unwrap();
+            let expected = expected.gradient("positions").unwrap();
+            assert_eq!(gradient.samples(), expected.samples());
+            assert_relative_eq!(gradient.values().to_array(), expected.values().to_array(), epsilon=1e-12, max_relative=1e-10);
+        }
+    }
+}
+
 fn sum_gradients(n_atoms: usize, gradients: TensorBlockRef<'_>) -> ArrayD<f64> {
     assert_eq!(gradients.samples().names(), &["sample", "system", "atom"]);
     let array = gradients.values().to_array();
@@ -7,14 +7,16 @@ from . import (  # noqa: F401
     utils,
 )
 from ._hypers import BadHyperParameters, convert_hypers, hypers_to_json  # noqa: F401
-from .calculator_base import CalculatorBase  # noqa: F401
+from .calculator_base import CalculatorBase, atomic_composition_packed  # noqa: F401
 
 # don't forget to also update `featomic/torch/__init__.py` and
 # `featomic/torch/calculators.py` when modifying this file
 from .calculators import (
     AtomicComposition,
+    LambdaSoap,
     LodeSphericalExpansion,
     NeighborList,
+    SoapCompressedPowerSpectrum,
     SoapPowerSpectrum,
     SoapRadialSpectrum,
     SortedDistances,
@@ -30,8 +32,10 @@ from .version import __version__  # noqa: F401
 
 __all__ = [
     "AtomicComposition",
+    "LambdaSoap",
     "LodeSphericalExpansion",
     "NeighborList",
+    "SoapCompressedPowerSpectrum",
     "SoapPowerSpectrum",
     "SoapRadialSpectrum",
     "SortedDistances",
@@ -59,6 +59,7 @@ class featomic_system_t(ctypes.Structure):
         ("compute_neighbors", CFUNCTYPE(featomic_status_t, ctypes.c_void_p, ctypes.c_double)),
         ("pairs", CFUNCTYPE(featomic_status_t, ctypes.c_void_p, POINTER(ndpointer(featomic_pair_t, flags='C_CONTIGUOUS')), POINTER(c_uintptr_t))),
         ("pairs_containing", CFUNCTYPE(featomic_status_t, ctypes.c_void_p, c_uintptr_t, POINTER(ndpointer(featomic_pair_t, flags='C_CONTIGUOUS')), POINTER(c_uintptr_t))),
+        ("local_size", CFUNCTYPE(featomic_status_t, ctypes.c_void_p, POINTER(c_uintptr_t))),
     ]
 
 
@@ -134,6 +135,24 @@ def setup_functions(lib):
     ]
     lib.featomic_calculator_compute.restype = _check_featomic_status_t
 
+    lib.featomic_atomic_composition_packed.argtypes = [
+        POINTER(POINTER(mts_tensormap_t)),
+        POINTER(ctypes.c_int32),
+        c_uintptr_t,
+        POINTER(c_uintptr_t),
+        c_uintptr_t
+    ]
+    lib.featomic_atomic_composition_packed.restype = _check_featomic_status_t
+
+    lib.featomic_register_tabulated_basis.argtypes = [
+        ctypes.c_char_p,
+        POINTER(ctypes.c_double),
+        c_uintptr_t,
+        c_uintptr_t,
+        POINTER(ctypes.c_double)
+    ]
+    lib.featomic_register_tabulated_basis.restype = _check_featomic_status_t
+
     lib.featomic_profiling_clear.argtypes = [
         
     ]
@@ -1,6 +1,7 @@
 import ctypes
 from typing import List, Optional, Union
 
+import numpy as np
 from metatensor import Labels, TensorMap
 from metatensor._c_api import c_uintptr_t, mts_tensormap_t
 
@@ -312,3 +313,36 @@ class CalculatorBase:
         )
 
         return TensorMap._from_ptr(tensor_map_ptr)
+
+
+def atomic_composition_packed(types, system_offsets) -> TensorMap:
+    """
+    Compute the per-system atomic composition of many systems stored as a single
+    packed array of atomic types, without creating systems or a calculator.
+
+    This gives the same counts as :py:class:`featomic.AtomicComposition` with
+    ``per_system=True``, stored in a single block with one ``system`` sample per
+    system and one ``center_type`` property per atomic type in ``types``. This is
+    intended for dataset-wide statistics over many systems.
+
+    :param types: atomic types of all atoms in all systems, one system after the
+        other
+    :param system_offsets: offset of the first atom of each system in ``types``,
+        followed by ``len(types)``. This must start with 0 and be sorted.
+    """
+    types = np.ascontiguousarray(types, dtype=np.int32)
+    system_offsets = np.ascontiguousarray(system_offsets, dtype=np.uintp)
+    if len(types.shape) != 1 or len(system_offsets.shape) != 1:
+        raise ValueError("`types` and `system_offsets` must be 1-dimensional arrays")
+
+    lib = _get_library()
+    tensor_map_ptr = ctypes.POINTER(mts_tensormap_t)()
+    lib.featomic_atomic_composition_packed(
+        tensor_map_ptr,
+        types.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+        types.shape[0],
+        system_offsets.ctypes.data_as(ctypes.POINTER(c_uintptr_t)),
+        system_offsets.shape[0],
+    )
+
+    return TensorMap._from_ptr(tensor_map_ptr)
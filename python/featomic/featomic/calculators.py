@@ -61,14 +61,22 @@ class NeighborList(CalculatorBase):
 
     The samples contain the two atoms indexes, as well as the number of cell boundaries
     crossed to create this pair.
+
+    By default, there is one block for each pair of atomic types. With
+    ``single_block=True``, all pairs are stored in a single block instead, with the
+    atomic types as additional samples dimensions. The samples are then sorted by pair
+    of atomic types, such that all pairs with the same types are contiguous in memory.
     """
 
-    def __init__(self, *, cutoff, full_neighbor_list, self_pairs=False):
+    def __init__(
+        self, *, cutoff, full_neighbor_list, self_pairs=False, single_block=False
+    ):
         parameters = hypers_to_json(
             {
                 "cutoff": cutoff,
                 "full_neighbor_list": full_neighbor_list,
                 "self_pairs": self_pairs,
+                "single_block": single_block,
             }
         )
         super().__init__("neighbor_list", json.dumps(parameters))
@@ -273,6 +281,93 @@ class SoapPowerSpectrum(CalculatorBase):
         super().__init__("soap_power_spectrum", json.dumps(parameters))
 
 
+class SoapCompressedPowerSpectrum(CalculatorBase):
+    """Compressed power spectrum of Smooth Overlap of Atomic Positions (SOAP).
+
+    This is a version of :py:class:`SoapPowerSpectrum` where the
+    :py:class:`SphericalExpansion` coefficients are linearly contracted before
+    being combined, mixing the neighbor types into a smaller number of channels
+    (``type_embedding``) and the radial basis functions into a smaller number of
+    radial channels (``radial_contraction``). The number of features is then
+    controlled by the size of these contractions instead of growing
+    quadratically with the number of neighbor types, and the full power spectrum
+    is never computed.
+
+    ``type_embedding`` should have one row per output channel and one column per
+    entry in ``neighbor_types``, and ``radial_contraction`` one row per
+    contracted radial channel and one column per radial basis function. Both can
+    be given as nested lists or 2-dimensional arrays.
+
+    For a full description of the hyper-parameters, see the corresponding
+    :ref:`documentation <soap-compressed-power-spectrum>`.
+    """
+
+    def __init__(
+        self,
+        *,
+        cutoff,
+        density,
+        basis,
+        neighbor_types,
+        type_embedding=None,
+        radial_contraction=None,
+    ):
+        parameters = hypers_to_json(
+            {
+                "cutoff": cutoff,
+                "density": density,
+                "basis": basis,
+            }
+        )
+
+        parameters["neighbor_types"] = [int(t) for t in neighbor_types]
+        if type_embedding is not None:
+            parameters["type_embedding"] = _matrix_to_json(type_embedding)
+        if radial_contraction is not None:
+            parameters["radial_contraction"] = _matrix_to_json(radial_contraction)
+
+        super().__init__("soap_compressed_power_spectrum", json.dumps(parameters))
+
+
+def _matrix_to_json(matrix):
+    return [[float(value) for value in row] for row in matrix]
+
+
+class LambdaSoap(CalculatorBase):
+    """Equivariant power spectrum of Smooth Overlap of Atomic Positions
+    (lambda-SOAP).
+
+    lambda-SOAP combines pairs of :py:class:`SphericalExpansion` coefficients
+    with Clebsch-Gordan coefficients, creating a three-body descriptor which
+    transforms like spherical harmonics of degree ``o3_lambda`` under rotations.
+    The ``o3_lambda=0`` blocks contain the same values as
+    :py:class:`SoapPowerSpectrum`.
+
+    See `this article <https://doi.org/10.1103/PhysRevLett.120.036002>`_ for
+    more information on the lambda-SOAP representation.
+
+    For a full description of the hyper-parameters, see the corresponding
+    :ref:`documentation <lambda-soap>`.
+
+    .. seealso::
+        :py:class:`featomic.clebsch_gordan.EquivariantPowerSpectrum` is a
+        Python implementation that allows to combine different spherical
+        expansions.
+    """
+
+    def __init__(self, *, cutoff, density, basis, max_lambda):
+        parameters = hypers_to_json(
+            {
+                "cutoff": cutoff,
+                "density": density,
+                "basis": basis,
+                "max_lambda": max_lambda,
+            }
+        )
+
+        super().__init__("lambda_soap", json.dumps(parameters))
+
+
 class LodeSphericalExpansion(CalculatorBase):
     """Long-Distance Equivariant (LODE).
 
@@ -1,3 +1,4 @@
+import ctypes
 import functools
 from typing import Callable, Optional
 
@@ -12,6 +13,7 @@ try:
 except ImportError:
     HAS_SCIPY = False
 
+from ._c_lib import _get_library
 from .basis import ExpansionBasis, Explicit, RadialBasis
 from .cutoff import Cutoff
 from .density import AtomicDensity, DiracDelta, Gaussian, SmearedPowerLaw
@@ -209,11 +211,72 @@ class Spline:
         return spline
 
 
+def register_tabulated_basis(
+    name: str,
+    points: np.ndarray,
+    center_contribution: Optional[np.ndarray] = None,
+):
+    """
+    Register a tabulated radial basis in the native library under the given ``name``.
+
+    The basis can then be used in the hyper-parameters of SOAP and LODE calculators
+    with ``{"type": "Tabulated", "registered": name}``, instead of passing all the
+    spline points as JSON. The data is validated once when registering it, and shared
+    by all calculators using this basis.
+
+    Registering the same data again under a given ``name`` does nothing, but
+    registering different data under an existing ``name`` raises an error.
+
+    :param name: name of the basis
+    :param points: array with shape ``(n_points, 1 + 2 * n_basis)``, where each row
+        contains the position of a spline point, the ``n_basis`` values and then the
+        ``n_basis`` derivatives at this position. Contiguous ``float64`` arrays (for
+        example loaded from a ``.npy`` file with ``np.load(path, mmap_mode="r")``) are
+        passed to the native library without copying them.
+    :param center_contribution: optional array with ``n_basis`` values, containing the
+        center contribution of this basis for LODE calculators.
+    """
+    points = np.ascontiguousarray(points, dtype=np.float64)
+    if len(points.shape) != 2 or points.shape[1] % 2 != 1:
+        raise ValueError(
+            "`points` must be a 2-dimensional array with 1 + 2 * n_basis columns, "
+            f"got an array with shape {points.shape}"
+        )
+    n_basis = (points.shape[1] - 1) // 2
+
+    center_contribution_ptr = None
+    if center_contribution is not None:
+        center_contribution = np.ascontiguousarray(
+            center_contribution, dtype=np.float64
+        )
+        if center_contribution.shape != (n_basis,):
+            raise ValueError(
+                f"`center_contribution` must have shape ({n_basis},), "
+                f"got {center_contribution.shape}"
+            )
+        center_contribution_ptr = center_contribution.ctypes.data_as(
+            ctypes.POINTER(ctypes.c_double)
+        )
+
+    lib = _get_library()
+    lib.featomic_register_tabulated_basis(
+        name.encode("utf8"),
+        points.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+        points.shape[0],
+        n_basis,
+        center_contribution_ptr,
+    )
+
+
 class SplinedRadialBasis(RadialBasis):
     """
     Radial basis based on a spline. This is mainly intended to be used to transfer hyper
     parameters to the native code, but can also be used to check the exact shape of the
     splined radial basis.
+
+    If ``registered_name`` is given, the spline is registered once in the native
+    library with :py:func:`register_tabulated_basis`, and the hyper-parameters only
+    refer to it by name instead of containing all the spline points.
     """
 
     def __init__(
@@ -223,12 +286,29 @@ class SplinedRadialBasis(RadialBasis):
         max_radial: int,
         radius: float,
         lode_center_contribution: Optional[np.ndarray] = None,
+        registered_name: Optional[str] = None,
     ):
         super().__init__(max_radial=max_radial, radius=radius)
         self.spline = spline
         self.lode_center_contribution = lode_center_contribution
+        self.registered_name = registered_name
+
+        if self.registered_name is not None:
+            points = np.hstack(
+                [
+                    self.spline.positions.reshape(-1, 1),
+                    self.spline.values,
+                    self.spline.derivatives,
+                ]
+            )
+            register_tabulated_basis(
+                self.registered_name, points, self.lode_center_contribution
+            )
 
     def get_hypers(self):
+        if self.registered_name is not None:
+            return {"type": "Tabulated", "registered": self.registered_name}
+
         hypers = {
             "type": "Tabulated",
             "points": [
@@ -257,6 +257,16 @@ class SystemBase:
             featomic_system_pairs_containing
         )
 
+        @catch_exceptions
+        def featomic_system_local_size(user_data, local_size):
+            """
+            Implementation of ``featomic_system_t::local_size`` using
+            :py:func:`SystemBase.local_size`.
+            """
+            local_size[0] = c_uintptr_t(get_self(user_data).local_size())
+
+        struct.local_size = struct.local_size.__class__(featomic_system_local_size)
+
         return struct
 
     def size(self):
@@ -264,6 +274,17 @@ class SystemBase:
 
         raise NotImplementedError("System.size method is not implemented")
 
+    def local_size(self):
+        """Get the number of local atoms in this system as an integer.
+
+        Atoms with index in ``[0, local_size)`` are local, and all other atoms
+        are ghosts: they are used as neighbors of the local atoms, but no
+        atom-centered sample is created for them. By default, all atoms are
+        local.
+        """
+
+        return self.size()
+
     def types(self):
         """Get the atomic types of all atoms in the system.
 
@@ -0,0 +1,24 @@
+import numpy as np
+import pytest
+from metatensor import Labels
+
+import featomic
+from featomic import FeatomicError
+
+
+def test_packed():
+    # two systems: [1, 1, 8] and [6, 1]
+    types = np.array([1, 1, 8, 6, 1], dtype=np.int32)
+    system_offsets = np.array([0, 3, 5])
+
+    descriptor = featomic.atomic_composition_packed(types, system_offsets)
+    assert descriptor.keys == Labels.single()
+
+    block = descriptor.block()
+    assert block.samples == Labels("system", np.array([[0], [1]]))
+    assert block.properties == Labels("center_type", np.array([[1], [6], [8]]))
+    np.testing.assert_equal(block.values, [[2.0, 0.0, 1.0], [1.0, 1.0, 0.0]])
+
+    message = "system_offsets must be sorted in increasing order"
+    with pytest.raises(FeatomicError, match=message):
+        featomic.atomic_composition_packed(types, [0, 4, 3, 5])
@@ -232,6 +232,32 @@ def test_o3_equivariance():
     assert metatensor.allclose(nu_3_transf, nu_3_o3)
 
 
+@pytest.mark.skipif(
+    not HAS_SYMPY or not HAS_METATENSOR_OPERATIONS,
+    reason="SymPy or metatensor-operations are not installed",
+)
+def test_lambda_soap_calculator_so3_equivariance():
+    """
+    Tests that the output of the native :py:class:`featomic.LambdaSoap`
+    calculator is equivariant under SO(3) transformations, including the
+    ``o3_lambda > 0`` blocks.
+    """
+    frames = h2o_periodic()
+    max_lambda = 2 * MAX_ANGULAR
+
+    wig = wigner_d_matrices(max_lambda)
+    rotated_frames = [transform_frame_so3(frame, wig.angles) for frame in frames]
+
+    calculator = featomic.LambdaSoap(**SPHEX_HYPERS, max_lambda=max_lambda)
+    lambda_soap = calculator.compute(frames)
+    lambda_soap_so3 = calculator.compute(rotated_frames)
+
+    assert np.any(lambda_soap.keys.column("o3_lambda") > 0)
+
+    lambda_soap_transf = wig.transform_tensormap_so3(lambda_soap)
+    assert metatensor.allclose(lambda_soap_transf, lambda_soap_so3)
+
+
 # ============ Test lambda-SOAP vs PowerSpectrum ============
 
 
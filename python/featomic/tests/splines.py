@@ -43,6 +43,75 @@ def test_soap_spliner():
         )
 
 
+def test_registered_tabulated_basis():
+    """Check that a registered tabulated basis gives the same results as the same
+    spline given in JSON."""
+    cutoff = 4.0
+
+    spline = featomic.splines.Spline(0, cutoff)
+    positions = np.linspace(0, cutoff, 20)
+    spline.add_points(
+        positions=positions,
+        values=np.vstack([np.exp(-positions), positions * np.exp(-positions)]).T,
+        derivatives=np.vstack(
+            [-np.exp(-positions), (1 - positions) * np.exp(-positions)]
+        ).T,
+    )
+
+    smoothing = featomic.cutoff.Step()
+
+    def hypers(registered_name):
+        return {
+            "cutoff": featomic.cutoff.Cutoff(radius=cutoff, smoothing=smoothing),
+            "density": featomic.density.DiracDelta(),
+            "basis": featomic.basis.TensorProduct(
+                max_angular=2,
+                radial=featomic.splines.SplinedRadialBasis(
+                    spline=spline,
+                    max_radial=1,
+                    radius=cutoff,
+                    registered_name=registered_name,
+                ),
+                spline_accuracy=None,
+            ),
+        }
+
+    calculator = SphericalExpansion(**hypers("test-registered"))
+    assert '"registered": "test-registered"' in calculator.parameters
+
+    registered = calculator.compute(SystemForTests())
+    reference = SphericalExpansion(**hypers(None)).compute(SystemForTests())
+
+    for key, block in reference.items():
+        np.testing.assert_equal(registered.block(key).values, block.values)
+
+    # re-creating the same basis is fine, but re-using the name for different
+    # data is an error
+    SphericalExpansion(**hypers("test-registered"))
+
+    points = np.zeros((3, 5))
+    points[:, 0] = [0.0, 1.0, 2.0]
+    message = "a different tabulated radial basis is already registered"
+    with pytest.raises(featomic.FeatomicError, match=message):
+        featomic.splines.register_tabulated_basis("test-registered", points)
+
+    message = "`points` must be a 2-dimensional array with 1 \\+ 2 \\* n_basis columns"
+    with pytest.raises(ValueError, match=message):
+        featomic.splines.register_tabulated_basis("test", np.zeros((3, 4)))
+
+    message = "no tabulated radial basis registered with the name 'not-there'"
+    with pytest.raises(featomic.FeatomicError, match=message):
+        SphericalExpansion(
+            cutoff=featomic.cutoff.Cutoff(radius=cutoff, smoothing=smoothing),
+            density=featomic.density.DiracDelta(),
+            basis={
+                "type": "TensorProduct",
+                "max_angular": 2,
+                "radial": {"type": "Tabulated", "registered": "not-there"},
+            },
+        )
+
+
 @pytest.mark.parametrize("exponent", [0, 1, 4])
 def test_lode_spliner(exponent):
     """Compare splined LODE spherical expansion with GTOs and a Gaussian density to
@@ -16,8 +16,10 @@ from .calculator_base import CalculatorModule, register_autograd  # noqa: E402,
 # `featomic/torch/calculators.py` when modifying this file
 from .calculators import (  # noqa: E402, F401
     AtomicComposition,
+    LambdaSoap,
     LodeSphericalExpansion,
     NeighborList,
+    SoapCompressedPowerSpectrum,
     SoapPowerSpectrum,
     SoapRadialSpectrum,
     SortedDistances,
@@ -29,8 +31,10 @@ from .system import systems_to_torch  # noqa: E402, F401
 
 __all__ = [
     "AtomicComposition",
+    "LambdaSoap",
     "LodeSphericalExpansion",
     "NeighborList",
+    "SoapCompressedPowerSpectrum",
     "SoapPowerSpectrum",
     "SoapRadialSpectrum",
     "SortedDistances",